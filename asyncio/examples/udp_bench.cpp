@@ -0,0 +1,121 @@
+#include "marlin/asyncio/udp/UdpTransportFactory.hpp"
+#include "marlin/asyncio/core/Timer.hpp"
+#include "marlin/asyncio/core/EventLoop.hpp"
+#include <uv.h>
+#include <spdlog/spdlog.h>
+
+#include <sys/resource.h>
+#include <cstring>
+
+using namespace marlin::core;
+using namespace marlin::asyncio;
+
+// Usage: udp_bench_example [batch] [offload]
+// Blasts bursts of packets over loopback for a few seconds and reports
+// packets/s and packets per cpu second, with or without recvmmsg/sendmmsg batching
+// and GSO/GRO segmentation offload. Build with -DMARLIN_ASYNCIO_IO_URING=ON to
+// receive through io_uring instead of libuv
+
+#define BENCH_PACKET_SIZE 1350
+#define BENCH_BURST_SIZE 256
+#define BENCH_DURATION 5000
+
+struct Delegate {
+	bool batch = false;
+	uint64_t recv_count = 0;
+	uint64_t send_count = 0;
+
+	UdpTransport<Delegate> *out = nullptr;
+
+	Timer burst_timer;
+	Timer end_timer;
+
+	Delegate(bool batch) : batch(batch), burst_timer(this), end_timer(this) {}
+
+	void did_recv(UdpTransport<Delegate> &, Buffer &&) {
+		recv_count++;
+	}
+
+	void did_send(UdpTransport<Delegate> &, Buffer &&) {
+		send_count++;
+	}
+
+	void did_dial(UdpTransport<Delegate> &transport) {
+		out = &transport;
+		burst_timer.template start<Delegate, &Delegate::burst_timer_cb>(0, 1);
+		end_timer.template start<Delegate, &Delegate::end_timer_cb>(BENCH_DURATION, 0);
+	}
+
+	void did_close(UdpTransport<Delegate> &, uint16_t) {}
+
+	bool should_accept(SocketAddress const &) {
+		return true;
+	}
+
+	void did_create_transport(UdpTransport<Delegate> &transport) {
+		transport.setup(this);
+	}
+
+	void burst_timer_cb() {
+		if(batch) {
+			out->batch_send_start();
+		}
+
+		for(int i = 0; i < BENCH_BURST_SIZE; i++) {
+			Buffer packet(BENCH_PACKET_SIZE);
+			std::memset(packet.data(), 0, BENCH_PACKET_SIZE);
+			out->send(std::move(packet));
+		}
+
+		if(batch) {
+			out->batch_send_end();
+		}
+	}
+
+	void end_timer_cb() {
+		burst_timer.stop();
+
+		rusage usage;
+		getrusage(RUSAGE_SELF, &usage);
+		double cpu = usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+			(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+
+		SPDLOG_INFO(
+			"Batch: {}, Sent: {}, Recv: {}, Recv pps: {:.0f}, Recv packets per cpu second: {:.0f}",
+			batch,
+			send_count,
+			recv_count,
+			recv_count * 1000.0 / BENCH_DURATION,
+			recv_count / cpu
+		);
+
+		uv_stop(uv_default_loop());
+	}
+};
+
+int main(int argc, char **argv) {
+	bool batch = false;
+	bool offload = false;
+	for(int i = 1; i < argc; i++) {
+		batch = batch || std::strcmp(argv[i], "batch") == 0;
+		offload = offload || std::strcmp(argv[i], "offload") == 0;
+	}
+	unsigned recv_batch_size = batch ? 32 : 1;
+
+	UdpTransportFactory<Delegate, Delegate> s, c;
+	Delegate d(batch);
+
+	s.bind(SocketAddress::loopback_ipv4(8000), recv_batch_size);
+	c.bind(SocketAddress::loopback_ipv4(0), recv_batch_size);
+	if(offload) {
+		s.enable_offload();
+		c.enable_offload();
+	}
+
+	s.listen(d);
+	c.dial(SocketAddress::loopback_ipv4(8000), d);
+
+	SPDLOG_INFO("Recv backend: {}", s.is_uring() ? "io_uring" : "libuv");
+
+	return EventLoop::run();
+}
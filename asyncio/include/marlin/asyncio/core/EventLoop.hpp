@@ -5,6 +5,9 @@
 #define MARLIN_CORE_EVENTLOOP_HPP
 
 #include <uv.h>
+#include <sys/socket.h>
+#include <cerrno>
+#include <marlin/asyncio/core/LoopTimerWheel.hpp>
 #include <marlin/simulator/core/Simulator.hpp>
 
 
@@ -22,18 +25,121 @@ struct EventLoop {
 	static uint64_t now() {
 		return simulator::Simulator::default_instance.current_tick();
 	}
+
+	static uint64_t now_ns() {
+		return simulator::Simulator::default_instance.current_tick() * 1000000;
+	}
+
+	static uv_loop_t* loop() {
+		return uv_default_loop();
+	}
+
+	static bool is_sharded() {
+		return false;
+	}
+
+	static int share_port(uv_handle_t*) {
+		return 0;
+	}
 };
 
 #else
 
+/// @brief Event loop which timers and transports run on
+///
+/// The default loop is used unless an EventLoop instance is made current on the calling thread.
+/// Timers, transport factories and fibers attach to the loop which is current when they are created,
+/// so running one instance per thread lets a process use multiple cores.
 class EventLoop {
+private:
+	uv_loop_t uv_loop;
+	/// Shards bind their listening sockets with SO_REUSEPORT
+	bool sharded = false;
+	/// Created on first use, once the loop is initialized
+	LoopTimerWheel* timer_wheel = nullptr;
+
+	static inline thread_local EventLoop* current = nullptr;
+
 public:
+	EventLoop(bool sharded = false) : sharded(sharded) {
+		uv_loop_init(&uv_loop);
+	}
+
+	EventLoop(EventLoop const&) = delete;
+	EventLoop(EventLoop&&) = delete;
+
+	~EventLoop() {
+		if(current == this) {
+			current = nullptr;
+		}
+
+		delete timer_wheel;
+
+		// Let pending close callbacks run
+		uv_run(&uv_loop, UV_RUN_NOWAIT);
+		uv_loop_close(&uv_loop);
+	}
+
+	/// Make this the loop of the calling thread
+	void make_current() {
+		current = this;
+	}
+
+	/// Loop of the calling thread
+	static uv_loop_t* loop() {
+		return current == nullptr ? uv_default_loop() : &current->uv_loop;
+	}
+
+	/// Whether the loop of the calling thread is one of many shards sharing listening ports
+	static bool is_sharded() {
+		return current != nullptr && current->sharded;
+	}
+
+	/// Let listening sockets of other shards bind the same port, kernel spreads peers across them.
+	/// No-op unless the current loop is sharded, the handle must already have a socket.
+	static int share_port(uv_handle_t* handle) {
+		if(!is_sharded()) {
+			return 0;
+		}
+
+		uv_os_fd_t fd;
+		int res = uv_fileno(handle, &fd);
+		if(res < 0) {
+			return res;
+		}
+
+		int val = 1;
+		if(setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &val, sizeof(val)) < 0) {
+			return -errno;
+		}
+
+		return 0;
+	}
+
+	/// Timing wheel backing the timers of the calling thread's loop
+	static LoopTimerWheel& timers() {
+		if(current == nullptr) {
+			static LoopTimerWheel default_timers(uv_default_loop());
+			return default_timers;
+		}
+
+		if(current->timer_wheel == nullptr) {
+			current->timer_wheel = new LoopTimerWheel(&current->uv_loop);
+		}
+		return *current->timer_wheel;
+	}
+
 	static int run() {
-		return uv_run(uv_default_loop(), UV_RUN_DEFAULT);
+		return uv_run(loop(), UV_RUN_DEFAULT);
 	}
 
 	static uint64_t now() {
-		return uv_now(uv_default_loop());
+		return uv_now(loop());
+	}
+
+	/// Current CLOCK_MONOTONIC time in nanoseconds, unlike now it is not cached per loop iteration
+	static uint64_t now_ns() {
+		return uv_hrtime();
 	}
 };
 
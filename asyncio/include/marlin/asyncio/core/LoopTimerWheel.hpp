@@ -0,0 +1,88 @@
+/*! \file LoopTimerWheel.hpp
+*/
+
+#ifndef MARLIN_ASYNCIO_LOOPTIMERWHEEL_HPP
+#define MARLIN_ASYNCIO_LOOPTIMERWHEEL_HPP
+
+#include <uv.h>
+#include <marlin/core/TimerWheel.hpp>
+
+namespace marlin {
+namespace asyncio {
+
+/// @brief Timing wheel holding all timers of a loop, driven by a single uv timer
+///
+/// The uv timer is only rearmed when the earliest expiry moves earlier, so restarting
+/// timers further out, the common case for ack and loss timers, never touches libuv.
+class LoopTimerWheel {
+private:
+	uv_loop_t* loop;
+	uv_timer_t* handle;
+	core::TimerWheel wheel;
+	/// Tick the uv timer is armed for
+	uint64_t armed = core::TimerWheel::never;
+
+	static void handle_close_cb(uv_handle_t* handle) {
+		delete (uv_timer_t*)handle;
+	}
+
+	static void handle_cb(uv_timer_t* handle) {
+		auto& self = *(LoopTimerWheel*)handle->data;
+
+		self.armed = core::TimerWheel::never;
+		self.wheel.advance(uv_now(self.loop));
+		self.arm();
+	}
+
+	void arm() {
+		auto next = wheel.next_expiry();
+		if(next >= armed) {
+			return;
+		}
+
+		armed = next;
+		auto now = uv_now(loop);
+		uv_timer_start(handle, handle_cb, next > now ? next - now : 0, 0);
+	}
+
+public:
+	LoopTimerWheel(uv_loop_t* loop) : loop(loop), wheel(uv_now(loop)) {
+		handle = new uv_timer_t();
+		handle->data = this;
+		uv_timer_init(loop, handle);
+	}
+
+	LoopTimerWheel(LoopTimerWheel const&) = delete;
+	LoopTimerWheel(LoopTimerWheel&&) = delete;
+
+	~LoopTimerWheel() {
+		uv_timer_stop(handle);
+		uv_close((uv_handle_t*)handle, handle_close_cb);
+	}
+
+	/// Fire the node timeout ms from now
+	void schedule(core::TimerWheel::Node* node, uint64_t timeout) {
+		// Catch up if the wheel sat idle
+		if(wheel.size() == 0) {
+			wheel.advance(uv_now(loop));
+		}
+
+		wheel.schedule(node, uv_now(loop) + timeout);
+		arm();
+	}
+
+	void cancel(core::TimerWheel::Node* node) {
+		wheel.cancel(node);
+
+		// Idle wheels must not keep the loop alive
+		if(wheel.size() == 0 && armed != core::TimerWheel::never) {
+			uv_timer_stop(handle);
+			armed = core::TimerWheel::never;
+		}
+	}
+};
+
+} // namespace asyncio
+} // namespace marlin
+
+#endif // MARLIN_ASYNCIO_LOOPTIMERWHEEL_HPP
@@ -0,0 +1,95 @@
+/*! \file ShardChannel.hpp
+*/
+
+#ifndef MARLIN_ASYNCIO_SHARDCHANNEL_HPP
+#define MARLIN_ASYNCIO_SHARDCHANNEL_HPP
+
+#include <uv.h>
+#include <marlin/asyncio/core/EventLoop.hpp>
+
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace marlin {
+namespace asyncio {
+
+/// @brief Thread safe queue delivering messages to a delegate on the loop which created the channel
+///
+/// Any thread can send, messages are handed to the delegate in order on the owning loop.
+/// Sends are coalesced, a burst of sends wakes the owning loop once.
+template<typename MessageType>
+class ShardChannel {
+private:
+	using Self = ShardChannel<MessageType>;
+
+	uv_async_t* async;
+
+	std::mutex mutex;
+	std::vector<MessageType> queue;
+	/// Only touched on the owning loop
+	std::vector<MessageType> draining;
+
+	void* delegate = nullptr;
+	void (*dispatch)(void*, MessageType&&) = nullptr;
+
+	static void async_close_cb(uv_handle_t* handle) {
+		delete (uv_async_t*)handle;
+	}
+
+	static void async_cb(uv_async_t* handle) {
+		auto& channel = *(Self*)handle->data;
+
+		{
+			std::lock_guard<std::mutex> lock(channel.mutex);
+			channel.queue.swap(channel.draining);
+		}
+
+		for(auto& message : channel.draining) {
+			channel.dispatch(channel.delegate, std::move(message));
+		}
+		channel.draining.clear();
+	}
+
+	template<typename DelegateType, void (DelegateType::*callback)(MessageType&&)>
+	static void dispatch_to(void* delegate, MessageType&& message) {
+		(((DelegateType*)delegate)->*callback)(std::move(message));
+	}
+
+public:
+	ShardChannel() {
+		async = new uv_async_t();
+		async->data = this;
+		uv_async_init(EventLoop::loop(), async, async_cb);
+	}
+
+	ShardChannel(ShardChannel const&) = delete;
+	ShardChannel(ShardChannel&&) = delete;
+
+	/// Set the receiver, must be called on the owning loop before messages are sent
+	template<typename DelegateType, void (DelegateType::*callback)(MessageType&&)>
+	void setup(DelegateType* delegate) {
+		this->delegate = delegate;
+		dispatch = dispatch_to<DelegateType, callback>;
+	}
+
+	/// Queue a message for the owning loop, callable from any thread
+	void send(MessageType&& message) {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			queue.push_back(std::move(message));
+		}
+
+		uv_async_send(async);
+	}
+
+	/// Must be destroyed on the owning loop after all senders are done
+	~ShardChannel() {
+		uv_close((uv_handle_t*)async, async_close_cb);
+	}
+};
+
+} // namespace asyncio
+} // namespace marlin
+
+#endif // MARLIN_ASYNCIO_SHARDCHANNEL_HPP
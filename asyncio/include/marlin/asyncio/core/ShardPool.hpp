@@ -0,0 +1,75 @@
+/*! \file ShardPool.hpp
+*/
+
+#ifndef MARLIN_ASYNCIO_SHARDPOOL_HPP
+#define MARLIN_ASYNCIO_SHARDPOOL_HPP
+
+#include <marlin/asyncio/core/EventLoop.hpp>
+
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace marlin {
+namespace asyncio {
+
+#ifndef MARLIN_ASYNCIO_SIMULATOR
+
+/// @brief Runs a number of sharded event loops, each on its own thread
+///
+/// Every shard makes a fresh sharded EventLoop current, sets itself up through the given init function
+/// and runs the loop until it has nothing left to do. Listening sockets bound on a shard use SO_REUSEPORT,
+/// so shards binding the same address each own a disjoint set of peers.
+class ShardPool {
+private:
+	std::vector<std::thread> threads;
+
+public:
+	ShardPool() = default;
+
+	ShardPool(ShardPool const&) = delete;
+	ShardPool(ShardPool&&) = delete;
+
+	/// Start num_shards loops, init(shard_index) runs on the shard thread before its loop runs.
+	/// Whatever init returns, usually the shard's node, is kept alive until the loop finishes.
+	template<typename InitType>
+	void start(size_t num_shards, InitType init) {
+		for(size_t i = 0; i < num_shards; i++) {
+			threads.emplace_back([init, i]() mutable {
+				EventLoop loop(true);
+				loop.make_current();
+
+				if constexpr (std::is_void_v<decltype(init(i))>) {
+					init(i);
+					EventLoop::run();
+				} else {
+					[[maybe_unused]] auto state = init(i);
+					EventLoop::run();
+				}
+			});
+		}
+	}
+
+	size_t size() const {
+		return threads.size();
+	}
+
+	/// Wait for all shard loops to finish
+	void join() {
+		for(auto& thread : threads) {
+			thread.join();
+		}
+		threads.clear();
+	}
+
+	~ShardPool() {
+		join();
+	}
+};
+
+#endif
+
+} // namespace asyncio
+} // namespace marlin
+
+#endif // MARLIN_ASYNCIO_SHARDPOOL_HPP
@@ -5,6 +5,7 @@
 #define MARLIN_CORE_TIMER_HPP
 
 #include <uv.h>
+#include <marlin/asyncio/core/EventLoop.hpp>
 #include <type_traits>
 #include <marlin/simulator/timer/Timer.hpp>
 
@@ -18,38 +19,48 @@ using Timer = simulator::Timer;
 
 #else
 
+/// @brief Timer on the calling thread's loop, backed by the loop's timing wheel
+///
+/// Starting, stopping and restarting only relink the embedded wheel node.
 class Timer {
 private:
 	using Self = Timer;
 
-	uv_timer_t* timer;
+	core::TimerWheel::Node node;
+	LoopTimerWheel* wheel;
+	uint64_t repeat = 0;
 	void* data = nullptr;
 
-	static void timer_close_cb(uv_handle_t* handle) {
-		delete (uv_timer_t*)handle;
-	}
-
 	template<typename DelegateType, void (DelegateType::*callback)()>
-	static void timer_cb(uv_timer_t* handle) {
-		auto& timer = *(Self*)handle->data;
+	static void timer_cb(core::TimerWheel::Node* node) {
+		auto& timer = *(Self*)node->owner;
+		timer.restart();
 		(((DelegateType*)(timer.delegate))->*callback)();
 	}
 
 	template<typename DelegateType, typename DataType, void (DelegateType::*callback)(DataType&)>
-	static void timer_cb(uv_timer_t* handle) {
-		auto& timer = *(Self*)handle->data;
+	static void timer_cb(core::TimerWheel::Node* node) {
+		auto& timer = *(Self*)node->owner;
+		timer.restart();
 		(((DelegateType*)(timer.delegate))->*callback)(*(DataType*)timer.data);
 	}
+
+	/// Repeating timers are rescheduled before their callback runs, like uv timers
+	void restart() {
+		if(repeat > 0) {
+			wheel->schedule(&node, repeat);
+		}
+	}
 public:
 	void* delegate;
 
 	template<typename DelegateType>
-	Timer(DelegateType* delegate) : delegate(delegate) {
-		timer = new uv_timer_t();
-		timer->data = this;
-		uv_timer_init(uv_default_loop(), timer);
+	Timer(DelegateType* delegate) : wheel(&EventLoop::timers()), delegate(delegate) {
+		node.owner = this;
 	}
 
+	Timer(Timer const&) = delete;
+
 	template<typename DataType>
 	void set_data(DataType* data) {
 		this->data = (void*)data;
@@ -57,21 +68,25 @@ public:
 
 	template<typename DelegateType, void (DelegateType::*callback)()>
 	void start(uint64_t timeout, uint64_t repeat) {
-		uv_timer_start(timer, timer_cb<DelegateType, callback>, timeout, repeat);
+		this->repeat = repeat;
+		node.callback = timer_cb<DelegateType, callback>;
+		wheel->schedule(&node, timeout);
 	}
 
 	template<typename DelegateType, typename DataType, void (DelegateType::*callback)(DataType&)>
 	void start(uint64_t timeout, uint64_t repeat) {
-		uv_timer_start(timer, timer_cb<DelegateType, DataType, callback>, timeout, repeat);
+		this->repeat = repeat;
+		node.callback = timer_cb<DelegateType, DataType, callback>;
+		wheel->schedule(&node, timeout);
 	}
 
 	void stop() {
-		uv_timer_stop(timer);
+		repeat = 0;
+		wheel->cancel(&node);
 	}
 
 	~Timer() {
-		uv_timer_stop(timer);
-		uv_close((uv_handle_t*)timer, timer_close_cb);
+		wheel->cancel(&node);
 	}
 };
 
@@ -0,0 +1,144 @@
+/*! \file WorkerPool.hpp
+*/
+
+#ifndef MARLIN_ASYNCIO_WORKERPOOL_HPP
+#define MARLIN_ASYNCIO_WORKERPOOL_HPP
+
+#include <marlin/asyncio/core/ShardChannel.hpp>
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <iterator>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace marlin {
+namespace asyncio {
+
+/// @brief Runs CPU heavy jobs on worker threads and hands them back on the loop which created the pool
+///
+/// Workers take up to max_batch queued jobs at a time and run the work function over the whole batch,
+/// letting it reuse whatever it set up across jobs. Finished jobs are handed to the delegate in order
+/// of completion, bursts of completions wake the owning loop once.
+///
+/// The work function runs on worker threads and must only touch the jobs it is given.
+template<typename JobType>
+class WorkerPool {
+public:
+	using WorkType = void (*)(JobType*, size_t);
+
+private:
+	WorkType work;
+	size_t max_batch;
+
+	std::mutex mutex;
+	std::condition_variable cv;
+	std::deque<JobType> queue;
+	bool is_stopping = false;
+
+	std::vector<std::thread> threads;
+
+	ShardChannel<JobType> done;
+	/// Jobs submitted and not handed back yet, only touched on the owning loop
+	size_t num_pending = 0;
+
+	void run() {
+		std::vector<JobType> batch;
+		batch.reserve(max_batch);
+
+		while(true) {
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				cv.wait(lock, [this]() { return is_stopping || !queue.empty(); });
+				if(is_stopping) {
+					return;
+				}
+
+				auto count = std::min(max_batch, queue.size());
+				std::move(queue.begin(), queue.begin() + count, std::back_inserter(batch));
+				queue.erase(queue.begin(), queue.begin() + count);
+			}
+
+			work(batch.data(), batch.size());
+
+			for(auto& job : batch) {
+				done.send(std::move(job));
+			}
+			batch.clear();
+		}
+	}
+
+	void* delegate = nullptr;
+	void (*dispatch)(void*, JobType&&) = nullptr;
+
+	void did_finish(JobType&& job) {
+		num_pending--;
+		dispatch(delegate, std::move(job));
+	}
+
+	template<typename DelegateType, void (DelegateType::*callback)(JobType&&)>
+	static void dispatch_to(void* delegate, JobType&& job) {
+		(((DelegateType*)delegate)->*callback)(std::move(job));
+	}
+
+public:
+	/// Start num_threads workers, no jobs can be submitted without any
+	WorkerPool(size_t num_threads, size_t max_batch, WorkType work) : work(work), max_batch(std::max<size_t>(max_batch, 1)) {
+		done.template setup<WorkerPool, &WorkerPool::did_finish>(this);
+
+		for(size_t i = 0; i < num_threads; i++) {
+			threads.emplace_back([this]() { run(); });
+		}
+	}
+
+	WorkerPool(WorkerPool const&) = delete;
+	WorkerPool(WorkerPool&&) = delete;
+
+	/// Set the receiver of finished jobs, must be called on the owning loop before jobs are submitted
+	template<typename DelegateType, void (DelegateType::*callback)(JobType&&)>
+	void setup(DelegateType* delegate) {
+		this->delegate = delegate;
+		dispatch = dispatch_to<DelegateType, callback>;
+	}
+
+	/// Queue a job for the workers, on the owning loop
+	void submit(JobType&& job) {
+		num_pending++;
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			queue.push_back(std::move(job));
+		}
+
+		cv.notify_one();
+	}
+
+	/// Jobs submitted and not handed back yet
+	size_t pending() const {
+		return num_pending;
+	}
+
+	size_t size() const {
+		return threads.size();
+	}
+
+	/// Must be destroyed on the owning loop, queued and unfinished jobs are dropped
+	~WorkerPool() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			is_stopping = true;
+		}
+		cv.notify_all();
+
+		for(auto& thread : threads) {
+			thread.join();
+		}
+	}
+};
+
+} // namespace asyncio
+} // namespace marlin
+
+#endif // MARLIN_ASYNCIO_WORKERPOOL_HPP
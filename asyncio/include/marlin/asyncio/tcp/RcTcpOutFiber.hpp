@@ -9,6 +9,7 @@
 #include <marlin/uvpp/Tcp.hpp>
 
 #include <uv.h>
+#include <marlin/asyncio/core/EventLoop.hpp>
 #include <spdlog/spdlog.h>
 
 
@@ -58,7 +59,7 @@ public:
 		// EOF
 		if(nread == -4095) {
 			fiber.did_disconnect(fiber, 0);
-			delete[] buf->base;
+			core::BufferPool::deallocate((uint8_t*)buf->base, buf->len);
 			return;
 		}
 
@@ -70,18 +71,18 @@ public:
 			);
 
 			fiber.close();
-			delete[] buf->base;
+			core::BufferPool::deallocate((uint8_t*)buf->base, buf->len);
 			return;
 		}
 
 		if(nread == 0) {
-			delete[] buf->base;
+			core::BufferPool::deallocate((uint8_t*)buf->base, buf->len);
 			return;
 		}
 
 		fiber.did_recv(
 			fiber,
-			core::Buffer((uint8_t*)buf->base, nread),
+			core::Buffer((uint8_t*)buf->base, nread, buf->len),
 			fiber.dst
 		);
 	}
@@ -103,7 +104,7 @@ public:
 				size_t suggested_size,
 				uv_buf_t* buf
 			) {
-				buf->base = new char[suggested_size];
+				buf->base = (char*)core::BufferPool::allocate(suggested_size);
 				buf->len = suggested_size;
 			},
 			recv_cb
@@ -121,7 +122,7 @@ public:
 	}
 
 	[[nodiscard]] int dial(core::SocketAddress dst) {
-		uv_tcp_init(uv_default_loop(), tcp_handle);
+		uv_tcp_init(EventLoop::loop(), tcp_handle);
 
 		this->dst = dst;
 
@@ -35,7 +35,7 @@ void RCTCPTRANSPORT::recv_cb(
 	// EOF
 	if(nread == -4095) {
 		transport->delegate->did_disconnect(*transport, 0);
-		delete[] buf->base;
+		core::BufferPool::deallocate((uint8_t*)buf->base, buf->len);
 		return;
 	}
 
@@ -47,18 +47,18 @@ void RCTCPTRANSPORT::recv_cb(
 		);
 
 		transport->close();
-		delete[] buf->base;
+		core::BufferPool::deallocate((uint8_t*)buf->base, buf->len);
 		return;
 	}
 
 	if(nread == 0) {
-		delete[] buf->base;
+		core::BufferPool::deallocate((uint8_t*)buf->base, buf->len);
 		return;
 	}
 
 	transport->delegate->did_recv(
 		*transport,
-		core::Buffer((uint8_t*)buf->base, nread)
+		core::Buffer((uint8_t*)buf->base, nread, buf->len)
 	);
 }
 
@@ -80,7 +80,7 @@ void RCTCPTRANSPORT::connect_cb(uv_connect_t* req, int status) {
 			size_t suggested_size,
 			uv_buf_t* buf
 		) {
-			buf->base = new char[suggested_size];
+			buf->base = (char*)core::BufferPool::allocate(suggested_size);
 			buf->len = suggested_size;
 		},
 		recv_cb
@@ -99,7 +99,7 @@ void RCTCPTRANSPORT::connect_cb(uv_connect_t* req, int status) {
 
 template<RCTCPTRANSPORT_TEMPLATE>
 void RCTCPTRANSPORT::connect(core::SocketAddress dst) {
-	uv_tcp_init(uv_default_loop(), tcp);
+	uv_tcp_init(EventLoop::loop(), tcp);
 
 	auto req = new uv_connect_t();
 	req->data = this;
@@ -76,7 +76,7 @@ private:
 		// EOF
 		if(nread == -4095) {
 			fiber.close();
-			delete[] buf->base;
+			core::BufferPool::deallocate((uint8_t*)buf->base, buf->len);
 			return;
 		}
 
@@ -88,18 +88,18 @@ private:
 			);
 
 			fiber.close();
-			delete[] buf->base;
+			core::BufferPool::deallocate((uint8_t*)buf->base, buf->len);
 			return;
 		}
 
 		if(nread == 0) {
-			delete[] buf->base;
+			core::BufferPool::deallocate((uint8_t*)buf->base, buf->len);
 			return;
 		}
 
 		fiber.template outer_call<"did_recv"_tag>(
 			fiber,
-			core::Buffer((uint8_t*)buf->base, nread),
+			core::Buffer((uint8_t*)buf->base, nread, buf->len),
 			fiber.dst
 		);
 	}
@@ -116,7 +116,7 @@ private:
 				size_t suggested_size,
 				uv_buf_t* buf
 			) {
-				buf->base = new char[suggested_size];
+				buf->base = (char*)core::BufferPool::allocate(suggested_size);
 				buf->len = suggested_size;
 			},
 			recv_cb
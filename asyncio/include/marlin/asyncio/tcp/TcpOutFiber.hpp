@@ -9,6 +9,7 @@
 #include <marlin/uvpp/Tcp.hpp>
 
 #include <uv.h>
+#include <marlin/asyncio/core/EventLoop.hpp>
 #include <spdlog/spdlog.h>
 
 
@@ -44,7 +45,7 @@ public:
 		tcp_handle = new uv_tcp_t();
 		tcp_handle->data = this;
 
-		uv_tcp_init(uv_default_loop(), tcp_handle);
+		uv_tcp_init(EventLoop::loop(), tcp_handle);
 	}
 
 	TcpOutFiber(TcpOutFiber const&) = delete;
@@ -81,7 +82,7 @@ private:
 		// EOF
 		if(nread == -4095) {
 			fiber.close();
-			delete[] buf->base;
+			core::BufferPool::deallocate((uint8_t*)buf->base, buf->len);
 			return;
 		}
 
@@ -93,18 +94,18 @@ private:
 			);
 
 			fiber.close();
-			delete[] buf->base;
+			core::BufferPool::deallocate((uint8_t*)buf->base, buf->len);
 			return;
 		}
 
 		if(nread == 0) {
-			delete[] buf->base;
+			core::BufferPool::deallocate((uint8_t*)buf->base, buf->len);
 			return;
 		}
 
 		fiber.ext_fabric.template outer_call<"did_recv"_tag>(
 			fiber,
-			core::Buffer((uint8_t*)buf->base, nread),
+			core::Buffer((uint8_t*)buf->base, nread, buf->len),
 			fiber.dst
 		);
 	}
@@ -126,7 +127,7 @@ private:
 				size_t suggested_size,
 				uv_buf_t* buf
 			) {
-				buf->base = new char[suggested_size];
+				buf->base = (char*)core::BufferPool::allocate(suggested_size);
 				buf->len = suggested_size;
 			},
 			recv_cb
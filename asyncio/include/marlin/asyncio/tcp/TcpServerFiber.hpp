@@ -9,6 +9,7 @@
 #include <marlin/uvpp/Tcp.hpp>
 
 #include <uv.h>
+#include <marlin/asyncio/core/EventLoop.hpp>
 #include <spdlog/spdlog.h>
 
 
@@ -72,7 +73,7 @@ private:
 	[[nodiscard]] int bind(auto&&, core::SocketAddress const& addr) {
 		this->addr = addr;
 
-		int res = uv_tcp_init(uv_default_loop(), tcp_handle);
+		int res = uv_tcp_init(EventLoop::loop(), tcp_handle);
 		if (res < 0) {
 			SPDLOG_ERROR(
 				"TcpServerFiber: Socket {}: Init error: {}",
@@ -115,7 +116,7 @@ private:
 
 		// create handle
 		auto* client = new uv_tcp_t();
-		status = uv_tcp_init(uv_default_loop(), client);
+		status = uv_tcp_init(EventLoop::loop(), client);
 		if (status < 0) {
 			SPDLOG_ERROR(
 				"TcpServerFiber: Socket {}: TCP init error: {}",
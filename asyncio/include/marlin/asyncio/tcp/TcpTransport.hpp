@@ -98,7 +98,7 @@ void TcpTransport<DelegateType>::naive_alloc_cb(
 	size_t suggested_size,
 	uv_buf_t *buf
 ) {
-	buf->base = new char[suggested_size];
+	buf->base = (char*)core::BufferPool::allocate(suggested_size);
 	buf->len = suggested_size;
 }
 
@@ -114,7 +114,7 @@ void TcpTransport<DelegateType>::recv_cb(
 	// EOF
 	if(nread == -4095) {
 		transport->close();
-		delete[] buf->base;
+		core::BufferPool::deallocate((uint8_t*)buf->base, buf->len);
 		return;
 	}
 
@@ -131,17 +131,17 @@ void TcpTransport<DelegateType>::recv_cb(
 			nread
 		);
 
-		delete[] buf->base;
+		core::BufferPool::deallocate((uint8_t*)buf->base, buf->len);
 		return;
 	}
 
 	if(nread == 0) {
-		delete[] buf->base;
+		core::BufferPool::deallocate((uint8_t*)buf->base, buf->len);
 		return;
 	}
 
 	transport->did_recv(
-		core::Buffer((uint8_t*)buf->base, nread)
+		core::Buffer((uint8_t*)buf->base, nread, buf->len)
 	);
 }
 
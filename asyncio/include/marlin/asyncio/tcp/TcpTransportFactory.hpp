@@ -8,6 +8,7 @@
 #define MARLIN_ASYNCIO_TCPTRANSPORTFACTORY_HPP
 
 #include <uv.h>
+#include <marlin/asyncio/core/EventLoop.hpp>
 #include "marlin/core/Buffer.hpp"
 #include "marlin/core/SocketAddress.hpp"
 #include "TcpTransport.hpp"
@@ -101,9 +102,10 @@ TcpTransportFactory<ListenDelegate, TransportDelegate>::
 bind(core::SocketAddress const &addr) {
 	this->addr = addr;
 
-	uv_loop_t *loop = uv_default_loop();
+	uv_loop_t *loop = EventLoop::loop();
 
-	int res = uv_tcp_init(loop, socket);
+	// Create the socket right away so options can be set before bind
+	int res = uv_tcp_init_ex(loop, socket, addr.ss_family);
 	if (res < 0) {
 		SPDLOG_ERROR(
 			"Asyncio: Socket {}: Init error: {}",
@@ -113,6 +115,16 @@ bind(core::SocketAddress const &addr) {
 		return res;
 	}
 
+	res = EventLoop::share_port((uv_handle_t *)socket);
+	if (res < 0) {
+		SPDLOG_ERROR(
+			"Asyncio: Socket {}: Reuse port error: {}",
+			this->addr.to_string(),
+			res
+		);
+		return res;
+	}
+
 	res = uv_tcp_bind(
 		socket,
 		reinterpret_cast<sockaddr const *>(&this->addr),
@@ -164,7 +176,7 @@ connection_cb(uv_stream_t *handle, int status) {
 	}
 
 	auto *client = new uv_tcp_t();
-	status = uv_tcp_init(uv_default_loop(), client);
+	status = uv_tcp_init(EventLoop::loop(), client);
 	if (status < 0) {
 		SPDLOG_ERROR(
 			"Asyncio: Socket {}: TCP init error: {}",
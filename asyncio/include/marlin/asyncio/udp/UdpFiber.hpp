@@ -2,9 +2,11 @@
 #define MARLIN_ASYNCIO_UDP_UDPFIBER_HPP
 
 #include <marlin/core/Buffer.hpp>
+#include <marlin/core/BufferChain.hpp>
 #include <marlin/core/fibers/FiberScaffold.hpp>
 #include <marlin/core/messages/BaseMessage.hpp>
 #include <marlin/uvpp/Udp.hpp>
+#include "UdpRecvBatch.hpp"
 
 #include <spdlog/spdlog.h>
 
@@ -32,6 +34,7 @@ public:
 
 private:
 	uvpp::UdpE* udp_handle = nullptr;
+	UdpRecvBatch recv_batch;
 
 public:
 	UdpFiber(auto&&... args) :
@@ -68,8 +71,9 @@ public:
 	}
 
 private:
-	[[nodiscard]] int bind(auto&&, core::SocketAddress const& addr) {
-		int res = uv_udp_init(uv_default_loop(), udp_handle);
+	// Reads up to recv_batch_size datagrams per wakeup using recvmmsg where available
+	[[nodiscard]] int bind(auto&&, core::SocketAddress const& addr, unsigned recv_batch_size = 1) {
+		int res = recv_batch.init(udp_handle, recv_batch_size);
 		if (res < 0) {
 			SPDLOG_ERROR(
 				"Asyncio: Socket {}: Init error: {}",
@@ -97,12 +101,12 @@ private:
 	}
 
 	static void naive_alloc_cb(
-		uv_handle_t*,
+		uv_handle_t* handle,
 		size_t suggested_size,
 		uv_buf_t* buf
 	) {
-		buf->base = new char[suggested_size];
-		buf->len = suggested_size;
+		auto& fiber = *(SelfType*)(handle->data);
+		fiber.recv_batch.alloc(suggested_size, buf);
 	}
 
 	static void recv_cb(
@@ -110,8 +114,15 @@ private:
 		ssize_t nread,
 		uv_buf_t const* buf,
 		sockaddr const* _addr,
-		unsigned
+		unsigned flags
 	) {
+		auto& fiber = *(SelfType*)(handle->data);
+
+		// End of recvmmsg batch, slab is owned by the fiber
+		if(UdpRecvBatch::is_batch_end(flags)) {
+			return;
+		}
+
 		// Error
 		if(nread < 0) {
 			sockaddr saddr;
@@ -125,21 +136,20 @@ private:
 				nread
 			);
 
-			delete[] buf->base;
+			fiber.recv_batch.free(buf);
 			return;
 		}
 
 		if(nread == 0) {
-			delete[] buf->base;
+			fiber.recv_batch.free(buf);
 			return;
 		}
 
 		auto& addr = *reinterpret_cast<core::SocketAddress const*>(_addr);
-		auto& fiber = *(SelfType*)(handle->data);
 
 		fiber.ext_fabric.template outer_call<"did_recv"_tag>(
 			fiber,
-			core::Buffer((uint8_t*)buf->base, nread),
+			fiber.recv_batch.take(buf, nread),
 			addr
 		);
 	}
@@ -177,7 +187,7 @@ private:
 		uv_udp_send_t* _req,
 		int status
 	) {
-		auto* req = (uvpp::UdpSendReq<std::tuple<core::Buffer, core::SocketAddress>>*)_req;
+		auto* req = (uvpp::UdpSendReq<std::tuple<core::BufferChain, core::SocketAddress>>*)_req;
 
 		if(req->data == nullptr) {
 			delete req;
@@ -193,7 +203,7 @@ private:
 		} else {
 			fiber.ext_fabric.template outer_call<"did_send"_tag>(
 				fiber,
-				std::move(std::get<0>(req->extra_data)),
+				std::move(std::get<0>(req->extra_data).head()),
 				std::get<1>(req->extra_data)
 			);
 		}
@@ -205,16 +215,27 @@ private:
 		return send(std::forward<decltype(src)>(src), std::move(buf.buf), addr);
 	}
 
-	[[nodiscard]] int send(auto&&, core::Buffer&& buf, core::SocketAddress addr) {
-		auto* req = new uvpp::UdpSendReq<std::tuple<core::Buffer, core::SocketAddress>>(std::forward_as_tuple(std::move(buf), addr));
+	[[nodiscard]] int send(auto&& src, core::Buffer&& buf, core::SocketAddress addr) {
+		return send(std::forward<decltype(src)>(src), core::BufferChain(std::move(buf)), addr);
+	}
+
+	[[nodiscard]] int send(auto&&, core::BufferChain&& buf, core::SocketAddress addr) {
+		auto* req = new uvpp::UdpSendReq<std::tuple<core::BufferChain, core::SocketAddress>>(std::forward_as_tuple(std::move(buf), addr));
 		req->data = this;
 
-		auto uv_buf = uv_buf_init((char*)std::get<0>(req->extra_data).data(), std::get<0>(req->extra_data).size());
+		// Segments are passed as separate buffers, libuv copies the array
+		auto& chain = std::get<0>(req->extra_data);
+		uv_buf_t uv_bufs[core::BufferChain::max_segments];
+		for(size_t i = 0; i < chain.num_segments(); i++) {
+			auto segment = chain.segment(i);
+			uv_bufs[i] = uv_buf_init((char*)segment.data(), segment.size());
+		}
+
 		int res = uv_udp_send(
 			req,
 			udp_handle,
-			&uv_buf,
-			1,
+			uv_bufs,
+			chain.num_segments(),
 			reinterpret_cast<const sockaddr*>(&addr),
 			send_cb
 		);
@@ -0,0 +1,141 @@
+/*! \file UdpOffload.hpp
+	\brief Helpers for linux UDP segmentation offload
+
+	Features:
+	\li GSO, a run of same size datagrams to one destination is handed to the kernel as a single super datagram
+	\li GRO, the kernel coalesces same size datagrams from one source and reports the segment size
+	\li SO_TXTIME, datagrams carry a departure time which the fq qdisc holds them until
+	\li Don't fragment, datagrams larger than the path MTU are dropped instead of fragmented
+*/
+
+#ifndef MARLIN_ASYNCIO_UDPOFFLOAD_HPP
+#define MARLIN_ASYNCIO_UDPOFFLOAD_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __linux__
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+
+#ifndef SOL_UDP
+#define SOL_UDP 17
+#endif
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+#ifndef UDP_GRO
+#define UDP_GRO 104
+#endif
+#ifndef SO_TXTIME
+#define SO_TXTIME 61
+#define SCM_TXTIME SO_TXTIME
+#endif
+#include <time.h>
+#endif
+
+namespace marlin {
+namespace asyncio {
+
+struct UdpOffload {
+	/// Maximum number of segments in a super datagram
+	static constexpr size_t max_segments = 64;
+	/// Maximum size of a super datagram, stays below the 64KB datagram limit
+	static constexpr size_t max_size = 65000;
+
+#ifdef __linux__
+	/// Ancillary data size needed to send a segment size
+	static constexpr size_t gso_control_size = CMSG_SPACE(sizeof(uint16_t));
+	/// Ancillary data size needed to receive a segment size
+	static constexpr size_t gro_control_size = CMSG_SPACE(sizeof(int));
+	/// Ancillary data size needed to send a departure time
+	static constexpr size_t txtime_control_size = CMSG_SPACE(sizeof(uint64_t));
+	/// Ancillary data size needed to send both a segment size and a departure time
+	static constexpr size_t send_control_size = gso_control_size + txtime_control_size;
+
+	//! checks whether the kernel supports GSO on the socket
+	static bool enable_gso(int fd) {
+		// Zero keeps segmentation per message, fails on kernels without GSO
+		int val = 0;
+		return setsockopt(fd, SOL_UDP, UDP_SEGMENT, &val, sizeof(val)) == 0;
+	}
+
+	//! asks the kernel to coalesce received datagrams on the socket
+	static bool enable_gro(int fd) {
+		int val = 1;
+		return setsockopt(fd, SOL_UDP, UDP_GRO, &val, sizeof(val)) == 0;
+	}
+
+	//! stops coalescing received datagrams, for receivers which can not split them
+	static bool disable_gro(int fd) {
+		int val = 0;
+		return setsockopt(fd, SOL_UDP, UDP_GRO, &val, sizeof(val)) == 0;
+	}
+
+	//! lets outgoing messages carry CLOCK_MONOTONIC departure times, only the fq qdisc honours them
+	static bool enable_txtime(int fd) {
+		// struct sock_txtime, not in older headers
+		struct {
+			clockid_t clockid;
+			uint32_t flags;
+		} config = {CLOCK_MONOTONIC, 0};
+		return setsockopt(fd, SOL_SOCKET, SO_TXTIME, &config, sizeof(config)) == 0;
+	}
+
+	//! sets the don't fragment bit and stops the kernel from fragmenting to its cached path MTU,
+	//! lets the application probe the path MTU itself
+	static bool enable_dont_fragment(int fd) {
+		int val = IP_PMTUDISC_PROBE;
+		bool v4 = setsockopt(fd, IPPROTO_IP, IP_MTU_DISCOVER, &val, sizeof(val)) == 0;
+		val = IPV6_PMTUDISC_PROBE;
+		bool v6 = setsockopt(fd, IPPROTO_IPV6, IPV6_MTU_DISCOVER, &val, sizeof(val)) == 0;
+
+		return v4 || v6;
+	}
+
+	//! attaches the segment size to an outgoing message, control must have gso_control_size bytes
+	static void set_segment_size(msghdr &msg, uint8_t *control, uint16_t segment_size) {
+		msg.msg_control = control;
+		msg.msg_controllen = gso_control_size;
+
+		auto *cmsg = CMSG_FIRSTHDR(&msg);
+		cmsg->cmsg_level = SOL_UDP;
+		cmsg->cmsg_type = UDP_SEGMENT;
+		cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+		*(uint16_t *)CMSG_DATA(cmsg) = segment_size;
+	}
+
+	//! appends a departure time in nanoseconds to an outgoing message, after any segment size
+	static void add_send_time(msghdr &msg, uint8_t *control, uint64_t send_time) {
+		if(msg.msg_control == nullptr) {
+			msg.msg_control = control;
+			msg.msg_controllen = 0;
+		}
+
+		auto *cmsg = (cmsghdr *)((uint8_t *)msg.msg_control + msg.msg_controllen);
+		msg.msg_controllen += txtime_control_size;
+
+		cmsg->cmsg_level = SOL_SOCKET;
+		cmsg->cmsg_type = SCM_TXTIME;
+		cmsg->cmsg_len = CMSG_LEN(sizeof(uint64_t));
+		*(uint64_t *)CMSG_DATA(cmsg) = send_time;
+	}
+
+	//! segment size of a received message, 0 if it was not coalesced
+	static size_t segment_size(msghdr &msg) {
+		for(auto *cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+			if(cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO) {
+				return *(int *)CMSG_DATA(cmsg);
+			}
+		}
+
+		return 0;
+	}
+#endif
+};
+
+} // namespace asyncio
+} // namespace marlin
+
+#endif // MARLIN_ASYNCIO_UDPOFFLOAD_HPP
@@ -0,0 +1,124 @@
+/*! \file UdpRecvBatch.hpp
+	\brief Receive buffer management for batched UDP reads
+
+	Features:
+	\li uses recvmmsg through libuv to drain multiple datagrams per wakeup on linux
+	\li falls back to a pooled buffer per datagram when batching is disabled or unsupported
+*/
+
+#ifndef MARLIN_ASYNCIO_UDPRECVBATCH_HPP
+#define MARLIN_ASYNCIO_UDPRECVBATCH_HPP
+
+#include <marlin/core/Buffer.hpp>
+#include <uv.h>
+#include <marlin/asyncio/core/EventLoop.hpp>
+#include <spdlog/spdlog.h>
+
+namespace marlin {
+namespace asyncio {
+
+//! Owns the receive memory of a udp handle, one large slab when batching and pooled buffers otherwise
+/*!
+	libuv splits the slab into 64KB chunks and fills one chunk per datagram with a single recvmmsg call.
+	Chunks stay owned by the slab, so received datagrams are copied into right sized pooled buffers.
+*/
+class UdpRecvBatch {
+public:
+	/// Size of a single datagram chunk in the slab, fixed by libuv
+	static constexpr size_t chunk_size = 65536;
+
+private:
+	uint8_t *slab = nullptr;
+	size_t slab_size = 0;
+
+public:
+	UdpRecvBatch() = default;
+
+	UdpRecvBatch(UdpRecvBatch const&) = delete;
+	UdpRecvBatch(UdpRecvBatch&&) = delete;
+
+	~UdpRecvBatch() {
+		delete[] slab;
+	}
+
+	//! initializes the handle, with recvmmsg enabled if batch_size > 1
+	/*!
+		\param handle udp handle to initialize
+		\param batch_size maximum number of datagrams to read per wakeup
+		\param domain address family of the socket, created immediately unless AF_UNSPEC
+		\return integer, 0 for success, failure otherwise
+	*/
+	int init(uv_udp_t *handle, unsigned batch_size, unsigned domain = AF_UNSPEC) {
+#if UV_VERSION_HEX >= 0x012800
+		if(batch_size > 1) {
+			int res = uv_udp_init_ex(EventLoop::loop(), handle, domain | UV_UDP_RECVMMSG);
+			if(res < 0) {
+				return res;
+			}
+
+			slab_size = chunk_size * batch_size;
+			slab = new uint8_t[slab_size];
+
+			return 0;
+		}
+#else
+		if(batch_size > 1) {
+			SPDLOG_INFO("Asyncio: recvmmsg needs libuv 1.40, batching disabled");
+		}
+#endif
+
+		return uv_udp_init_ex(EventLoop::loop(), handle, domain);
+	}
+
+	bool is_batching() const {
+		return slab != nullptr;
+	}
+
+	//! provides memory for the next read
+	void alloc(size_t suggested_size, uv_buf_t *buf) {
+		if(slab != nullptr) {
+			buf->base = (char*)slab;
+			buf->len = slab_size;
+			return;
+		}
+
+		buf->base = (char*)core::BufferPool::allocate(suggested_size);
+		buf->len = suggested_size;
+	}
+
+	//! releases memory of a read whose datagram was not taken
+	void free(uv_buf_t const *buf) {
+		// Slab chunks are reused
+		if(slab != nullptr || buf->base == nullptr) {
+			return;
+		}
+
+		core::BufferPool::deallocate((uint8_t*)buf->base, buf->len);
+	}
+
+	//! takes a received datagram of nread bytes out of buf
+	core::Buffer take(uv_buf_t const *buf, ssize_t nread) {
+		if(slab != nullptr) {
+			// Copy out of the slab chunk
+			core::Buffer packet(nread);
+			packet.write_unsafe(0, (uint8_t*)buf->base, nread);
+			return packet;
+		}
+
+		return core::Buffer((uint8_t*)buf->base, nread, buf->len);
+	}
+
+	//! whether the callback only signals the end of a batch
+	static bool is_batch_end([[maybe_unused]] unsigned flags) {
+#if UV_VERSION_HEX >= 0x012800
+		return (flags & UV_UDP_MMSG_FREE) != 0;
+#else
+		return false;
+#endif
+	}
+};
+
+} // namespace asyncio
+} // namespace marlin
+
+#endif // MARLIN_ASYNCIO_UDPRECVBATCH_HPP
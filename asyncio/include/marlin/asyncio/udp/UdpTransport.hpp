@@ -9,12 +9,21 @@
 #ifndef MARLIN_ASYNCIO_UDPTRANSPORT_HPP
 #define MARLIN_ASYNCIO_UDPTRANSPORT_HPP
 
+#include <marlin/core/BufferChain.hpp>
 #include <marlin/core/CidrBlock.hpp>
 #include <marlin/core/transports/TransportScaffold.hpp>
+#include "UdpOffload.hpp"
 #include <uv.h>
 #include <spdlog/spdlog.h>
 
+#include <algorithm>
 #include <list>
+#include <vector>
+
+#ifdef __linux__
+#include <sys/socket.h>
+#include <sys/uio.h>
+#endif
 
 namespace marlin {
 namespace asyncio {
@@ -37,17 +46,36 @@ private:
 	);
 
 	struct SendPayload {
-		core::Buffer packet;
+		core::BufferChain packet;
 		UdpTransport<DelegateType> *transport;
 	};
 
 	std::list<uv_udp_send_t *> pending_req;
+
+	/// Packets held back while a send batch is open
+	std::vector<core::BufferChain> batched_packets;
+	/// Departure time of each batched packet, 0 if it leaves immediately
+	std::vector<uint64_t> batched_send_times;
+	bool is_batching = false;
+	/// Departure time given to packets batched from now on
+	uint64_t send_time = 0;
+
+	int flush_batch();
 public:
+	/// Maximum number of packets handed to a single sendmmsg call
+	static constexpr size_t max_sendmmsg_batch = 64;
+
 	using MessageType = typename TransportScaffoldType::MessageType;
 	static_assert(std::is_same_v<MessageType, core::BaseMessage>);
 
 	using TransportScaffoldType::delegate;
 	bool internal = false;
+	/// Coalesce batched packets of the same size with UDP GSO, set by the factory
+	bool gso = false;
+	/// Hand batched packets to the kernel with departure times (SO_TXTIME), set by the factory
+	bool txtime = false;
+	/// Datagrams are never fragmented, too large ones are dropped, set by the factory
+	bool dont_fragment = false;
 
 	UdpTransport(
 		core::SocketAddress const &src_addr,
@@ -64,6 +92,21 @@ public:
 	bool is_internal();
 
 	int send(core::Buffer &&packet);
+	/// Send segments as a single datagram without coalescing them, did_send returns the head segment
+	int send(core::BufferChain &&packet);
+
+	/// Hold back sent packets until batch_send_end
+	void batch_send_start();
+	/// Send held back packets, with sendmmsg on linux.
+	/// did_send is called synchronously for packets sent by sendmmsg, delegates must not close the transport from it.
+	int batch_send_end();
+	/// Whether departure times given to set_send_time are honoured
+	bool is_send_time_enabled() const;
+	/// CLOCK_MONOTONIC departure time in nanoseconds for packets batched after this call.
+	/// Only applies to packets sent with sendmmsg, others leave immediately.
+	void set_send_time(uint64_t send_time);
+	/// Whether datagrams larger than the path MTU are dropped instead of fragmented
+	bool is_dont_fragment() const;
 };
 
 
@@ -119,7 +162,7 @@ void UdpTransport<DelegateType>::send_cb(
 	} else {
 		data->transport->delegate->did_send(
 			*data->transport,
-			std::move(data->packet)
+			std::move(data->packet.head())
 		);
 	}
 
@@ -134,18 +177,41 @@ void UdpTransport<DelegateType>::send_cb(
 */
 template<typename DelegateType>
 int UdpTransport<DelegateType>::send(core::Buffer &&packet) {
+	return send(core::BufferChain(std::move(packet)));
+}
+
+//! called by higher level to send data spread across multiple segments
+/*!
+	\param packet Marlin::core::BufferChain type of packet, segments are passed to libuv as separate buffers
+	\return integer, 0 for success, failure otherwise
+*/
+template<typename DelegateType>
+int UdpTransport<DelegateType>::send(core::BufferChain &&packet) {
+	if(is_batching) {
+		batched_packets.push_back(std::move(packet));
+		batched_send_times.push_back(send_time);
+		return 0;
+	}
+
 	uv_udp_send_t *req = new uv_udp_send_t();
 	auto req_data = new SendPayload{std::move(packet), this};
 	req->data = req_data;
 
 	pending_req.push_back(req);
 
-	auto buf = uv_buf_init((char*)req_data->packet.data(), req_data->packet.size());
+	// libuv copies the buf array, segment memory is kept alive by req_data
+	uv_buf_t bufs[core::BufferChain::max_segments];
+	auto num_bufs = req_data->packet.num_segments();
+	for(size_t i = 0; i < num_bufs; i++) {
+		auto segment = req_data->packet.segment(i);
+		bufs[i] = uv_buf_init((char*)segment.data(), segment.size());
+	}
+
 	int res = uv_udp_send(
 		req,
 		base_transport,
-		&buf,
-		1,
+		bufs,
+		num_bufs,
 		reinterpret_cast<const sockaddr *>(&dst_addr),
 		UdpTransport<DelegateType>::send_cb
 	);
@@ -163,6 +229,197 @@ int UdpTransport<DelegateType>::send(core::Buffer &&packet) {
 	return 0;
 }
 
+//! starts collecting packets instead of sending them one by one
+template<typename DelegateType>
+void UdpTransport<DelegateType>::batch_send_start() {
+	is_batching = true;
+}
+
+//! sends all packets collected since batch_send_start
+/*!
+	\return integer, 0 for success, failure otherwise
+*/
+template<typename DelegateType>
+int UdpTransport<DelegateType>::batch_send_end() {
+	is_batching = false;
+	send_time = 0;
+
+	if(batched_packets.empty()) {
+		return 0;
+	}
+
+	int res = flush_batch();
+	batched_packets.clear();
+	batched_send_times.clear();
+
+	return res;
+}
+
+template<typename DelegateType>
+bool UdpTransport<DelegateType>::is_send_time_enabled() const {
+	return txtime;
+}
+
+template<typename DelegateType>
+void UdpTransport<DelegateType>::set_send_time(uint64_t send_time) {
+	this->send_time = send_time;
+}
+
+template<typename DelegateType>
+bool UdpTransport<DelegateType>::is_dont_fragment() const {
+	return dont_fragment;
+}
+
+template<typename DelegateType>
+int UdpTransport<DelegateType>::flush_batch() {
+	size_t sent = 0;
+
+#ifdef __linux__
+	uv_os_fd_t fd;
+	// Bypass libuv only if nothing is queued in it, preserves packet order
+	if(
+		uv_udp_get_send_queue_count(base_transport) == 0 &&
+		uv_fileno((uv_handle_t *)base_transport, &fd) == 0
+	) {
+		mmsghdr msgs[max_sendmmsg_batch];
+		iovec iovs[max_sendmmsg_batch * core::BufferChain::max_segments];
+		alignas(cmsghdr) uint8_t controls[max_sendmmsg_batch][UdpOffload::send_control_size];
+		// Packets covered by each message, more than one with GSO
+		size_t msg_packets[max_sendmmsg_batch];
+
+		while(sent < batched_packets.size()) {
+			size_t num_msgs = 0;
+			size_t num_packets = 0;
+			size_t num_iovs = 0;
+
+			while(sent + num_packets < batched_packets.size() && num_packets < max_sendmmsg_batch) {
+				auto first = sent + num_packets;
+				auto segment_size = batched_packets[first].size();
+				auto packet_send_time = txtime ? batched_send_times[first] : 0;
+
+				// Coalesce a run of same size packets leaving together, the last one can be shorter
+				size_t count = 1;
+				size_t total_size = segment_size;
+				while(
+					gso && segment_size > 0 &&
+					first + count < batched_packets.size() &&
+					num_packets + count < max_sendmmsg_batch &&
+					count < UdpOffload::max_segments
+				) {
+					if(txtime && batched_send_times[first + count] != packet_send_time) {
+						break;
+					}
+
+					auto size = batched_packets[first + count].size();
+					if(size > segment_size || total_size + size > UdpOffload::max_size) {
+						break;
+					}
+
+					total_size += size;
+					count++;
+
+					if(size < segment_size) {
+						break;
+					}
+				}
+
+				auto &msg = msgs[num_msgs];
+				msg = {};
+				msg.msg_hdr.msg_name = &dst_addr;
+				msg.msg_hdr.msg_namelen = dst_addr.ss_family == AF_INET6 ? sizeof(sockaddr_in6) : sizeof(sockaddr_in);
+				msg.msg_hdr.msg_iov = &iovs[num_iovs];
+
+				for(size_t i = first; i < first + count; i++) {
+					auto &packet = batched_packets[i];
+					for(size_t j = 0; j < packet.num_segments(); j++) {
+						auto segment = packet.segment(j);
+						iovs[num_iovs].iov_base = (void*)segment.data();
+						iovs[num_iovs].iov_len = segment.size();
+						num_iovs++;
+					}
+				}
+				msg.msg_hdr.msg_iovlen = &iovs[num_iovs] - msg.msg_hdr.msg_iov;
+
+				if(count > 1) {
+					UdpOffload::set_segment_size(msg.msg_hdr, controls[num_msgs], segment_size);
+				}
+				if(packet_send_time != 0) {
+					UdpOffload::add_send_time(msg.msg_hdr, controls[num_msgs], packet_send_time);
+				}
+
+				msg_packets[num_msgs] = count;
+				num_msgs++;
+				num_packets += count;
+			}
+
+			int res;
+			do {
+				res = ::sendmmsg(fd, msgs, num_msgs, 0);
+			} while(res < 0 && errno == EINTR);
+
+			if(res < 0) {
+				if(gso && (errno == EIO || errno == EINVAL)) {
+					// Kernel or device rejected segmentation, retry without it
+					SPDLOG_INFO(
+						"Asyncio: Socket {}: GSO rejected: {}, To: {}, Disabling",
+						src_addr.to_string(),
+						-errno,
+						dst_addr.to_string()
+					);
+					gso = false;
+					continue;
+				}
+
+				if(txtime && errno == EINVAL) {
+					SPDLOG_INFO(
+						"Asyncio: Socket {}: SO_TXTIME rejected: {}, To: {}, Disabling",
+						src_addr.to_string(),
+						-errno,
+						dst_addr.to_string()
+					);
+					txtime = false;
+					continue;
+				}
+
+				// Would block or failed, let libuv queue or report the rest
+				if(errno != EAGAIN && errno != EWOULDBLOCK) {
+					SPDLOG_ERROR(
+						"Asyncio: Socket {}: sendmmsg error: {}, To: {}",
+						src_addr.to_string(),
+						-errno,
+						dst_addr.to_string()
+					);
+				}
+				break;
+			}
+
+			for(int i = 0; i < res; i++) {
+				sent += msg_packets[i];
+			}
+			if((size_t)res < num_msgs) {
+				break;
+			}
+		}
+	}
+#endif
+
+	// Send the rest through libuv
+	int res = 0;
+	for(size_t i = sent; i < batched_packets.size(); i++) {
+		auto status = send(std::move(batched_packets[i]));
+		if(status < 0) {
+			res = status;
+		}
+	}
+
+	// Notify after all member access, packets sent by sendmmsg have completed
+	for(size_t i = 0; i < sent; i++) {
+		delegate->did_send(*this, std::move(batched_packets[i].head()));
+	}
+
+	return res;
+}
+
 template<typename DelegateType>
 int UdpTransport<DelegateType>::send(MessageType &&packet) {
 	return send(std::move(packet).payload_buffer());
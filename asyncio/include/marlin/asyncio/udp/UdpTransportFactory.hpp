@@ -8,14 +8,21 @@
 #define MARLIN_ASYNCIO_UDPTRANSPORTFACTORY_HPP
 
 #include <uv.h>
+#include <marlin/asyncio/core/EventLoop.hpp>
 #include <marlin/uvpp/Udp.hpp>
 #include <marlin/core/transports/TransportFactoryScaffold.hpp>
 #include "marlin/core/Buffer.hpp"
 #include "marlin/core/SocketAddress.hpp"
 #include "UdpTransport.hpp"
+#include "UdpRecvBatch.hpp"
+#include "UdpOffload.hpp"
+#include "UdpUring.hpp"
 
 #include <spdlog/spdlog.h>
 
+#include <algorithm>
+#include <unistd.h>
+
 
 namespace marlin {
 namespace asyncio {
@@ -42,7 +49,7 @@ private:
 	using TransportFactoryScaffoldType::transport_manager;
 
 	static void naive_alloc_cb(
-		uv_handle_t *,
+		uv_handle_t *handle,
 		size_t suggested_size,
 		uv_buf_t *buf
 	);
@@ -58,6 +65,34 @@ private:
 	);
 
 	bool is_listening = false;
+	UdpRecvBatch recv_batch;
+
+	bool gso = false;
+	bool gro = false;
+	bool txtime = false;
+	bool dont_fragment = false;
+	/// Polls a duplicate of the socket when GRO is on, libuv can not report segment sizes
+	uv_poll_t *gro_poll = nullptr;
+	/// Duplicate of the socket polled by gro_poll
+	uv_os_fd_t gro_fd = -1;
+	/// Start polling for coalesced datagrams, nothing is left behind on failure
+	int start_gro_poll();
+
+	static void gro_poll_cb(uv_poll_t *handle, int status, int events);
+	static void gro_close_cb(uv_handle_t *handle);
+
+#ifdef MARLIN_ASYNCIO_IO_URING
+	/// Receives through io_uring when the kernel supports it, libuv otherwise
+	UdpUring uring;
+
+	void did_recv_uring(core::SocketAddress const &addr, core::Buffer &&packet);
+#endif
+
+	void did_recv_packet(
+		ListenDelegate &delegate,
+		core::SocketAddress const &addr,
+		core::Buffer &&packet
+	);
 
 	struct RecvPayload {
 		UdpTransportFactory<ListenDelegate, TransportDelegate> *factory;
@@ -73,8 +108,19 @@ public:
 	UdpTransportFactory(UdpTransportFactory const&) = delete;
 	UdpTransportFactory(UdpTransportFactory&&) = delete;
 
-	int bind(core::SocketAddress const &addr);
+	/// Bind to the given address, reads up to recv_batch_size datagrams per wakeup using recvmmsg where available
+	int bind(core::SocketAddress const &addr, unsigned recv_batch_size = 1);
 	int listen(ListenDelegate &delegate);
+	/// Enable UDP GSO/GRO where the kernel supports it, call after bind and before listen or dial
+	int enable_offload();
+	/// Let transports hand paced packets to the kernel with departure times,
+	/// needs the fq qdisc on the egress device, call after bind and before listen or dial
+	int enable_txtime();
+	/// Send datagrams with the don't fragment bit so transports can discover the path MTU,
+	/// call after bind and before listen or dial
+	int enable_dont_fragment();
+	/// Whether datagrams are received through io_uring
+	bool is_uring() const;
 
 	template<typename... Args>
 	int dial(core::SocketAddress const &addr, ListenDelegate &delegate, Args&&... args);
@@ -105,6 +151,13 @@ close_cb(uv_handle_t *handle) {
 template<typename ListenDelegate, typename TransportDelegate>
 UdpTransportFactory<ListenDelegate, TransportDelegate>::
 ~UdpTransportFactory() {
+	if(gro_poll != nullptr) {
+		uv_poll_stop(gro_poll);
+		uv_close((uv_handle_t *)gro_poll, gro_close_cb);
+		// Closing the handle already took the fd out of the loop
+		::close(gro_fd);
+	}
+
 	uv_close(
 		(uv_handle_t *)(uv_udp_t*)base_factory,
 		close_cb
@@ -114,17 +167,16 @@ UdpTransportFactory<ListenDelegate, TransportDelegate>::
 //! binds the socket to given arg address
 /*!
 	/param addr address to bind the socket to
+	/param recv_batch_size maximum number of datagrams read per wakeup, batching is disabled if 1
 	/return an integer 0 if successful, negative otherwise
 */
 template<typename ListenDelegate, typename TransportDelegate>
 int
 UdpTransportFactory<ListenDelegate, TransportDelegate>::
-bind(core::SocketAddress const &addr) {
+bind(core::SocketAddress const &addr, unsigned recv_batch_size) {
 	this->addr = addr;
 
-	uv_loop_t *loop = uv_default_loop();
-
-	int res = uv_udp_init(loop, base_factory);
+	int res = recv_batch.init(base_factory, recv_batch_size, addr.ss_family);
 	if (res < 0) {
 		SPDLOG_ERROR(
 			"Asyncio: Socket {}: Init error: {}",
@@ -134,6 +186,16 @@ bind(core::SocketAddress const &addr) {
 		return res;
 	}
 
+	res = EventLoop::share_port((uv_handle_t *)(uv_udp_t*)base_factory);
+	if (res < 0) {
+		SPDLOG_ERROR(
+			"Asyncio: Socket {}: Reuse port error: {}",
+			this->addr.to_string(),
+			res
+		);
+		return res;
+	}
+
 	res = uv_udp_bind(
 		base_factory,
 		reinterpret_cast<sockaddr const *>(&this->addr),
@@ -153,12 +215,12 @@ bind(core::SocketAddress const &addr) {
 
 template<typename ListenDelegate, typename TransportDelegate>
 void UdpTransportFactory<ListenDelegate, TransportDelegate>::naive_alloc_cb(
-	uv_handle_t *,
+	uv_handle_t *handle,
 	size_t suggested_size,
 	uv_buf_t *buf
 ) {
-	buf->base = new char[suggested_size];
-	buf->len = suggested_size;
+	auto payload = (RecvPayload *)handle->data;
+	payload->factory->recv_batch.alloc(suggested_size, buf);
 }
 
 //! callback on receiving a message on the socket
@@ -172,8 +234,16 @@ void UdpTransportFactory<ListenDelegate, TransportDelegate>::recv_cb(
 	ssize_t nread,
 	uv_buf_t const *buf,
 	sockaddr const *_addr,
-	unsigned
+	unsigned flags
 ) {
+	auto payload = (RecvPayload *)handle->data;
+	auto &recv_batch = payload->factory->recv_batch;
+
+	// End of recvmmsg batch, slab is owned by the factory
+	if(UdpRecvBatch::is_batch_end(flags)) {
+		return;
+	}
+
 	// Error
 	if(nread < 0) {
 		sockaddr saddr;
@@ -187,45 +257,164 @@ void UdpTransportFactory<ListenDelegate, TransportDelegate>::recv_cb(
 			nread
 		);
 
-		delete[] buf->base;
+		recv_batch.free(buf);
 		return;
 	}
 
 	if(nread == 0) {
-		delete[] buf->base;
+		recv_batch.free(buf);
 		return;
 	}
 
 	auto &addr = *reinterpret_cast<core::SocketAddress const *>(_addr);
-	auto payload = (RecvPayload *)handle->data;
 
-	auto &factory = *(payload->factory);
-	auto &delegate = *static_cast<ListenDelegate *>(payload->delegate);
+	payload->factory->did_recv_packet(
+		*static_cast<ListenDelegate *>(payload->delegate),
+		addr,
+		recv_batch.take(buf, nread)
+	);
+}
 
-	auto *transport = factory.transport_manager.get(addr);
+//! redirects a received packet to the udp transport connection instance of its source
+/*!
+	\li creates an instance if not already present
+*/
+template<typename ListenDelegate, typename TransportDelegate>
+void UdpTransportFactory<ListenDelegate, TransportDelegate>::did_recv_packet(
+	ListenDelegate &delegate,
+	core::SocketAddress const &addr,
+	core::Buffer &&packet
+) {
+	auto *transport = transport_manager.get(addr);
 	if(transport == nullptr) {
 		// Create new transport if permitted
 		if(delegate.should_accept(addr)) {
-			transport = factory.transport_manager.get_or_create(
+			transport = transport_manager.get_or_create(
 				addr,
-				factory.addr,
+				this->addr,
 				addr,
-				factory.base_factory,
-				factory.transport_manager
+				base_factory,
+				transport_manager
 			).first;
+			transport->gso = gso;
+			transport->txtime = txtime;
+			transport->dont_fragment = dont_fragment;
 			delegate.did_create_transport(*transport);
 		} else {
-			delete[] buf->base;
 			return;
 		}
 	}
 
 	transport->did_recv(
-		handle,
-		core::Buffer((uint8_t*)buf->base, nread)
+		base_factory,
+		std::move(packet)
 	);
 }
 
+//! callback on the GRO socket becoming readable
+/*!
+	\li reads coalesced datagrams and splits them using the segment size reported by the kernel
+*/
+template<typename ListenDelegate, typename TransportDelegate>
+void UdpTransportFactory<ListenDelegate, TransportDelegate>::gro_poll_cb(
+	uv_poll_t *handle,
+	int status,
+	int
+) {
+	auto &factory = *(UdpTransportFactory<ListenDelegate, TransportDelegate> *)handle->data;
+
+	if(status < 0) {
+		SPDLOG_ERROR(
+			"Asyncio: Socket {}: GRO poll error: {}",
+			factory.addr.to_string(),
+			status
+		);
+		return;
+	}
+
+#ifdef __linux__
+	auto &delegate = *static_cast<ListenDelegate *>(((RecvPayload *)factory.base_factory->data)->delegate);
+
+	uv_os_fd_t fd;
+	uv_fileno((uv_handle_t *)handle, &fd);
+
+	// Bound reads per wakeup like libuv does
+	for(int i = 0; i < 32; i++) {
+		auto *buf = core::BufferPool::allocate(UdpRecvBatch::chunk_size);
+
+		core::SocketAddress addr;
+		iovec iov = {buf, UdpRecvBatch::chunk_size};
+		alignas(cmsghdr) uint8_t control[UdpOffload::gro_control_size];
+
+		msghdr msg = {};
+		msg.msg_name = &addr;
+		msg.msg_namelen = sizeof(sockaddr_storage);
+		msg.msg_iov = &iov;
+		msg.msg_iovlen = 1;
+		msg.msg_control = control;
+		msg.msg_controllen = sizeof(control);
+
+		ssize_t nread;
+		do {
+			nread = recvmsg(fd, &msg, MSG_DONTWAIT);
+		} while(nread < 0 && errno == EINTR);
+
+		if(nread <= 0) {
+			core::BufferPool::deallocate(buf, UdpRecvBatch::chunk_size);
+
+			if(nread == 0) {
+				continue;
+			}
+
+			if(errno != EAGAIN && errno != EWOULDBLOCK) {
+				SPDLOG_ERROR(
+					"Asyncio: Socket {}: Recv callback error: {}",
+					factory.addr.to_string(),
+					-errno
+				);
+			}
+			return;
+		}
+
+		auto segment_size = UdpOffload::segment_size(msg);
+		if(segment_size == 0 || segment_size >= (size_t)nread) {
+			factory.did_recv_packet(delegate, addr, core::Buffer(buf, nread, UdpRecvBatch::chunk_size));
+			continue;
+		}
+
+		for(size_t offset = 0; offset < (size_t)nread; offset += segment_size) {
+			auto length = std::min<size_t>(segment_size, nread - offset);
+
+			core::Buffer packet(length);
+			packet.write_unsafe(0, buf + offset, length);
+			factory.did_recv_packet(delegate, addr, std::move(packet));
+		}
+
+		core::BufferPool::deallocate(buf, UdpRecvBatch::chunk_size);
+	}
+#endif
+}
+
+template<typename ListenDelegate, typename TransportDelegate>
+void UdpTransportFactory<ListenDelegate, TransportDelegate>::gro_close_cb(
+	uv_handle_t *handle
+) {
+	delete (uv_poll_t *)handle;
+}
+
+#ifdef MARLIN_ASYNCIO_IO_URING
+template<typename ListenDelegate, typename TransportDelegate>
+void UdpTransportFactory<ListenDelegate, TransportDelegate>::did_recv_uring(
+	core::SocketAddress const &addr,
+	core::Buffer &&packet
+) {
+	did_recv_packet(
+		*static_cast<ListenDelegate *>(((RecvPayload *)base_factory->data)->delegate),
+		addr,
+		std::move(packet)
+	);
+}
+#endif
 
 //! starts listening for incoming messages on the socket address
 template<typename ListenDelegate, typename TransportDelegate>
@@ -239,11 +428,53 @@ listen(ListenDelegate &delegate) {
 		this,
 		&delegate
 	};
-	int res = uv_udp_recv_start(
-		base_factory,
-		naive_alloc_cb,
-		recv_cb
-	);
+
+	int res = -1;
+#ifdef MARLIN_ASYNCIO_IO_URING
+	if(uring.is_running()) {
+		res = 0;
+	} else {
+		uv_os_fd_t fd;
+		uv_fileno((uv_handle_t *)(uv_udp_t *)base_factory, &fd);
+
+		res = uring.template start<SelfType, &SelfType::did_recv_uring>(fd, this, gro);
+		if(res < 0) {
+			SPDLOG_INFO(
+				"Asyncio: Socket {}: io_uring unavailable, using libuv: {}",
+				this->addr.to_string(),
+				res
+			);
+		}
+	}
+#endif
+
+	if(res == 0) {
+		// Receiving through io_uring
+	} else if(gro && (gro_poll != nullptr || start_gro_poll() == 0)) {
+		// Receiving through the GRO poll
+		res = 0;
+	} else {
+		if(gro) {
+			SPDLOG_INFO(
+				"Asyncio: Socket {}: GRO poll unavailable, receiving without GRO",
+				this->addr.to_string()
+			);
+
+			// libuv would hand over coalesced datagrams unsplit
+#ifdef __linux__
+			uv_os_fd_t fd;
+			uv_fileno((uv_handle_t *)(uv_udp_t *)base_factory, &fd);
+			UdpOffload::disable_gro(fd);
+#endif
+			gro = false;
+		}
+
+		res = uv_udp_recv_start(
+			base_factory,
+			naive_alloc_cb,
+			recv_cb
+		);
+	}
 	if (res < 0) {
 		SPDLOG_ERROR(
 			"Asyncio: Socket {}: Start recv error: {}",
@@ -258,6 +489,148 @@ listen(ListenDelegate &delegate) {
 	return 0;
 }
 
+template<typename ListenDelegate, typename TransportDelegate>
+int
+UdpTransportFactory<ListenDelegate, TransportDelegate>::
+start_gro_poll() {
+	uv_os_fd_t fd;
+	uv_fileno((uv_handle_t *)(uv_udp_t *)base_factory, &fd);
+
+	fd = ::dup(fd);
+	if(fd < 0) {
+		return -errno;
+	}
+
+	gro_poll = new uv_poll_t();
+	gro_poll->data = this;
+
+	int res = uv_poll_init(EventLoop::loop(), gro_poll, fd);
+	if(res < 0) {
+		// Not known to the loop yet
+		delete gro_poll;
+	} else {
+		res = uv_poll_start(gro_poll, UV_READABLE, gro_poll_cb);
+		if(res < 0) {
+			uv_close((uv_handle_t *)gro_poll, gro_close_cb);
+		}
+	}
+
+	if(res < 0) {
+		::close(fd);
+		gro_poll = nullptr;
+		return res;
+	}
+
+	gro_fd = fd;
+	return 0;
+}
+
+//! enables segmentation offload on the socket
+/*!
+	\li GSO lets transports send a burst of same size packets as one super datagram
+	\li GRO lets the kernel coalesce received datagrams, which are split again before delivery
+	\return integer, 0 if either is enabled, negative otherwise
+*/
+template<typename ListenDelegate, typename TransportDelegate>
+int
+UdpTransportFactory<ListenDelegate, TransportDelegate>::
+enable_offload() {
+#ifdef __linux__
+	uv_os_fd_t fd;
+	int res = uv_fileno((uv_handle_t *)(uv_udp_t *)base_factory, &fd);
+	if(res < 0) {
+		return res;
+	}
+
+	gso = UdpOffload::enable_gso(fd);
+	gro = UdpOffload::enable_gro(fd);
+
+	SPDLOG_INFO(
+		"Asyncio: Socket {}: GSO: {}, GRO: {}",
+		this->addr.to_string(),
+		gso,
+		gro
+	);
+
+	return gso || gro ? 0 : -1;
+#else
+	return -1;
+#endif
+}
+
+//! lets transports send packets with departure times using SO_TXTIME
+/*!
+	Packets are held by the fq qdisc until their departure time, so paced senders can
+	hand over packets ahead of time instead of waking up for each one
+	\return integer, 0 if enabled, negative otherwise
+*/
+template<typename ListenDelegate, typename TransportDelegate>
+int
+UdpTransportFactory<ListenDelegate, TransportDelegate>::
+enable_txtime() {
+#ifdef __linux__
+	uv_os_fd_t fd;
+	int res = uv_fileno((uv_handle_t *)(uv_udp_t *)base_factory, &fd);
+	if(res < 0) {
+		return res;
+	}
+
+	txtime = UdpOffload::enable_txtime(fd);
+
+	SPDLOG_INFO(
+		"Asyncio: Socket {}: SO_TXTIME: {}",
+		this->addr.to_string(),
+		txtime
+	);
+
+	return txtime ? 0 : -1;
+#else
+	return -1;
+#endif
+}
+
+//! sends datagrams with the don't fragment bit set
+/*!
+	The kernel neither fragments datagrams nor limits them to its cached path MTU,
+	so transports probing the path MTU see probes which are too large get dropped
+	\return integer, 0 if enabled, negative otherwise
+*/
+template<typename ListenDelegate, typename TransportDelegate>
+int
+UdpTransportFactory<ListenDelegate, TransportDelegate>::
+enable_dont_fragment() {
+#ifdef __linux__
+	uv_os_fd_t fd;
+	int res = uv_fileno((uv_handle_t *)(uv_udp_t *)base_factory, &fd);
+	if(res < 0) {
+		return res;
+	}
+
+	dont_fragment = UdpOffload::enable_dont_fragment(fd);
+
+	SPDLOG_INFO(
+		"Asyncio: Socket {}: Don't fragment: {}",
+		this->addr.to_string(),
+		dont_fragment
+	);
+
+	return dont_fragment ? 0 : -1;
+#else
+	return -1;
+#endif
+}
+
+template<typename ListenDelegate, typename TransportDelegate>
+bool
+UdpTransportFactory<ListenDelegate, TransportDelegate>::
+is_uring() const {
+#ifdef MARLIN_ASYNCIO_IO_URING
+	return uring.is_running();
+#else
+	return false;
+#endif
+}
+
 template<typename ListenDelegate, typename TransportDelegate>
 template<typename... Args>
 int
@@ -279,6 +652,9 @@ dial(core::SocketAddress const &addr, ListenDelegate &delegate, Args&&... args)
 	);
 
 	if(res) {
+		transport->gso = gso;
+		transport->txtime = txtime;
+		transport->dont_fragment = dont_fragment;
 		delegate.did_create_transport(*transport);
 	}
 
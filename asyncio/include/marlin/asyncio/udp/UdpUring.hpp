@@ -0,0 +1,319 @@
+/*! \file UdpUring.hpp
+	\brief io_uring receive path for UDP sockets
+
+	Features:
+	\li a single multishot recvmsg keeps receiving without a syscall per datagram
+	\li datagrams land in a buffer ring registered with the kernel and are recycled right after delivery
+	\li completions are signalled through an eventfd polled on the current EventLoop, so timers and tcp stay on libuv
+	\li reports GRO segment sizes, no separate GRO poll is needed
+
+	Only compiled with MARLIN_ASYNCIO_IO_URING, enabled by the MARLIN_ASYNCIO_IO_URING cmake option.
+*/
+
+#ifndef MARLIN_ASYNCIO_UDPURING_HPP
+#define MARLIN_ASYNCIO_UDPURING_HPP
+
+#ifdef MARLIN_ASYNCIO_IO_URING
+
+#include <marlin/core/Buffer.hpp>
+#include <marlin/core/SocketAddress.hpp>
+#include <uv.h>
+#include <marlin/asyncio/core/EventLoop.hpp>
+#include "UdpOffload.hpp"
+
+#include <liburing.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <cerrno>
+#include <algorithm>
+
+#include <spdlog/spdlog.h>
+
+namespace marlin {
+namespace asyncio {
+
+//! Receives datagrams of a udp socket through io_uring and hands them to a delegate
+class UdpUring {
+public:
+	/// Number of buffers in the ring, power of 2
+	static constexpr unsigned num_buffers = 64;
+	/// Room for a full datagram plus the recvmsg header, address and control data
+	static constexpr size_t buffer_size = 65536 + 512;
+
+private:
+	static constexpr int buffer_group = 0;
+	static constexpr unsigned ring_entries = 8;
+
+	io_uring ring;
+	bool ring_ready = false;
+
+	io_uring_buf_ring *buf_ring = nullptr;
+	uint8_t *slab = nullptr;
+
+	int fd = -1;
+	/// Template for every datagram of the multishot recvmsg, must outlive it
+	msghdr msg = {};
+
+	int event_fd = -1;
+	uv_poll_t *event_poll = nullptr;
+
+	void *delegate = nullptr;
+	void (*dispatch)(void*, core::SocketAddress const&, core::Buffer&&) = nullptr;
+
+	template<typename DelegateType, void (DelegateType::*callback)(core::SocketAddress const&, core::Buffer&&)>
+	static void dispatch_to(void *delegate, core::SocketAddress const &addr, core::Buffer &&packet) {
+		(((DelegateType*)delegate)->*callback)(addr, std::move(packet));
+	}
+
+	static void event_close_cb(uv_handle_t *handle) {
+		uv_os_fd_t fd;
+		if(uv_fileno(handle, &fd) == 0) {
+			::close(fd);
+		}
+
+		delete (uv_poll_t *)handle;
+	}
+
+	static void event_poll_cb(uv_poll_t *handle, int status, int) {
+		auto &self = *(UdpUring *)handle->data;
+
+		if(status < 0) {
+			SPDLOG_ERROR("Asyncio: io_uring poll error: {}", status);
+			return;
+		}
+
+		uint64_t count;
+		[[maybe_unused]] auto res = ::read(self.event_fd, &count, sizeof(count));
+
+		self.drain();
+	}
+
+	int arm() {
+		auto *sqe = io_uring_get_sqe(&ring);
+		if(sqe == nullptr) {
+			return -EBUSY;
+		}
+
+		io_uring_prep_recvmsg_multishot(sqe, fd, &msg, 0);
+		sqe->flags |= IOSQE_BUFFER_SELECT;
+		sqe->buf_group = buffer_group;
+
+		int res = io_uring_submit(&ring);
+		return res < 0 ? res : 0;
+	}
+
+	void recycle(unsigned bid) {
+		io_uring_buf_ring_add(
+			buf_ring,
+			slab + bid * buffer_size,
+			buffer_size,
+			bid,
+			io_uring_buf_ring_mask(num_buffers),
+			0
+		);
+		io_uring_buf_ring_advance(buf_ring, 1);
+	}
+
+	void deliver(uint8_t *buf, int len) {
+		auto *out = io_uring_recvmsg_validate(buf, len, &msg);
+		if(out == nullptr) {
+			return;
+		}
+
+		if(out->flags & MSG_TRUNC) {
+			SPDLOG_ERROR("Asyncio: io_uring datagram truncated");
+			return;
+		}
+
+		auto &addr = *(core::SocketAddress const *)io_uring_recvmsg_name(out);
+		auto *payload = (uint8_t *)io_uring_recvmsg_payload(out, &msg);
+		size_t length = io_uring_recvmsg_payload_length(out, len, &msg);
+
+		size_t segment_size = 0;
+		for(
+			auto *cmsg = io_uring_recvmsg_cmsg_firsthdr(out, &msg);
+			cmsg != nullptr;
+			cmsg = io_uring_recvmsg_cmsg_nexthdr(out, &msg, cmsg)
+		) {
+			if(cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO) {
+				segment_size = *(int *)CMSG_DATA(cmsg);
+			}
+		}
+		if(segment_size == 0) {
+			segment_size = length;
+		}
+
+		// Copy out so the ring buffer can be reused immediately
+		for(size_t offset = 0; offset < length; offset += segment_size) {
+			auto size = std::min<size_t>(segment_size, length - offset);
+
+			core::Buffer packet(size);
+			packet.write_unsafe(0, payload + offset, size);
+			dispatch(delegate, addr, std::move(packet));
+		}
+	}
+
+	void drain() {
+		io_uring_cqe *cqe;
+		unsigned head;
+		unsigned seen = 0;
+		bool rearm = false;
+
+		io_uring_for_each_cqe(&ring, head, cqe) {
+			seen++;
+
+			// Multishot ends on errors and when the buffer ring runs dry
+			if(!(cqe->flags & IORING_CQE_F_MORE)) {
+				rearm = true;
+			}
+
+			if(cqe->res < 0) {
+				if(cqe->res != -ENOBUFS) {
+					SPDLOG_ERROR("Asyncio: io_uring recv error: {}", cqe->res);
+				}
+				continue;
+			}
+
+			if(!(cqe->flags & IORING_CQE_F_BUFFER)) {
+				continue;
+			}
+
+			unsigned bid = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+			deliver(slab + bid * buffer_size, cqe->res);
+			recycle(bid);
+		}
+		io_uring_cq_advance(&ring, seen);
+
+		if(rearm) {
+			int res = arm();
+			if(res < 0) {
+				SPDLOG_ERROR("Asyncio: io_uring rearm error: {}", res);
+			}
+		}
+	}
+
+	/// Releases the ring, which also cancels the outstanding recv
+	int teardown(int res) {
+		if(buf_ring != nullptr) {
+			io_uring_free_buf_ring(&ring, buf_ring, num_buffers, buffer_group);
+			buf_ring = nullptr;
+		}
+
+		if(ring_ready) {
+			io_uring_queue_exit(&ring);
+			ring_ready = false;
+		}
+
+		if(event_fd >= 0) {
+			::close(event_fd);
+			event_fd = -1;
+		}
+
+		delete[] slab;
+		slab = nullptr;
+
+		return res;
+	}
+
+public:
+	UdpUring() = default;
+
+	UdpUring(UdpUring const&) = delete;
+	UdpUring(UdpUring&&) = delete;
+
+	~UdpUring() {
+		if(event_poll != nullptr) {
+			uv_poll_stop(event_poll);
+			// Closes the eventfd once libuv is done with it
+			uv_close((uv_handle_t *)event_poll, event_close_cb);
+			event_fd = -1;
+		}
+
+		teardown(0);
+	}
+
+	bool is_running() const {
+		return event_poll != nullptr;
+	}
+
+	//! starts receiving on the socket, fails if the kernel lacks io_uring or multishot recvmsg
+	/*!
+		\param socket_fd bound udp socket, must stay open while receiving
+		\param delegate receiver of datagrams, gets them on the current EventLoop
+		\param gro whether GRO is enabled on the socket, coalesced datagrams are split before delivery
+		\return integer, 0 for success, failure otherwise
+	*/
+	template<typename DelegateType, void (DelegateType::*callback)(core::SocketAddress const&, core::Buffer&&)>
+	int start(int socket_fd, DelegateType *delegate, bool gro) {
+		this->delegate = delegate;
+		dispatch = dispatch_to<DelegateType, callback>;
+		fd = socket_fd;
+
+		int res = io_uring_queue_init(ring_entries, &ring, 0);
+		if(res < 0) {
+			return res;
+		}
+		ring_ready = true;
+
+		buf_ring = io_uring_setup_buf_ring(&ring, num_buffers, buffer_group, 0, &res);
+		if(buf_ring == nullptr) {
+			return teardown(res);
+		}
+
+		slab = new uint8_t[num_buffers * buffer_size];
+		for(unsigned i = 0; i < num_buffers; i++) {
+			io_uring_buf_ring_add(
+				buf_ring,
+				slab + i * buffer_size,
+				buffer_size,
+				i,
+				io_uring_buf_ring_mask(num_buffers),
+				i
+			);
+		}
+		io_uring_buf_ring_advance(buf_ring, num_buffers);
+
+		msg.msg_namelen = sizeof(sockaddr_storage);
+		msg.msg_controllen = gro ? UdpOffload::gro_control_size : 0;
+
+		event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+		if(event_fd < 0) {
+			return teardown(-errno);
+		}
+
+		res = io_uring_register_eventfd(&ring, event_fd);
+		if(res < 0) {
+			return teardown(res);
+		}
+
+		res = arm();
+		if(res < 0) {
+			return teardown(res);
+		}
+
+		// Kernels without multishot recvmsg reject the request inline
+		io_uring_cqe *cqe;
+		if(io_uring_peek_cqe(&ring, &cqe) == 0 && cqe->res < 0 && !(cqe->flags & IORING_CQE_F_MORE)) {
+			return teardown(cqe->res);
+		}
+
+		event_poll = new uv_poll_t();
+		event_poll->data = this;
+		res = uv_poll_init(EventLoop::loop(), event_poll, event_fd);
+		if(res < 0) {
+			delete event_poll;
+			event_poll = nullptr;
+			return teardown(res);
+		}
+
+		res = uv_poll_start(event_poll, UV_READABLE, event_poll_cb);
+		return res;
+	}
+};
+
+} // namespace asyncio
+} // namespace marlin
+
+#endif // MARLIN_ASYNCIO_IO_URING
+
+#endif // MARLIN_ASYNCIO_UDPURING_HPP
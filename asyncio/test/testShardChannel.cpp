@@ -0,0 +1,55 @@
+#include "gtest/gtest.h"
+#include "marlin/asyncio/core/ShardChannel.hpp"
+
+#include <thread>
+#include <vector>
+
+using namespace marlin::asyncio;
+
+struct ChannelDelegate {
+	std::vector<int> received;
+
+	void did_recv(int&& message) {
+		received.push_back(message);
+	}
+};
+
+TEST(ShardChannel, DeliversInOrderOnOwningLoop) {
+	EventLoop loop;
+	loop.make_current();
+
+	ChannelDelegate delegate;
+	auto* channel = new ShardChannel<int>();
+	channel->setup<ChannelDelegate, &ChannelDelegate::did_recv>(&delegate);
+
+	std::thread sender([channel]() {
+		for(int i = 0; i < 100; i++) {
+			channel->send(int(i));
+		}
+	});
+	sender.join();
+
+	// Wakeups are coalesced, a single iteration drains the whole queue
+	uv_run(EventLoop::loop(), UV_RUN_NOWAIT);
+
+	ASSERT_EQ(delegate.received.size(), 100u);
+	for(int i = 0; i < 100; i++) {
+		EXPECT_EQ(delegate.received[i], i);
+	}
+
+	delete channel;
+}
+
+TEST(EventLoop, CurrentLoopIsPerThread) {
+	EventLoop loop(true);
+	loop.make_current();
+
+	EXPECT_NE(EventLoop::loop(), uv_default_loop());
+	EXPECT_TRUE(EventLoop::is_sharded());
+
+	std::thread other([]() {
+		EXPECT_EQ(EventLoop::loop(), uv_default_loop());
+		EXPECT_FALSE(EventLoop::is_sharded());
+	});
+	other.join();
+}
@@ -0,0 +1,82 @@
+#include "gtest/gtest.h"
+#include "marlin/asyncio/core/WorkerPool.hpp"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace marlin::asyncio;
+
+struct Job {
+	int input;
+	int output;
+	std::thread::id worker;
+};
+
+static std::atomic<size_t> largest_batch = 0;
+
+static void square(Job* jobs, size_t count) {
+	largest_batch = std::max(largest_batch.load(), count);
+	for(size_t i = 0; i < count; i++) {
+		jobs[i].output = jobs[i].input * jobs[i].input;
+		jobs[i].worker = std::this_thread::get_id();
+	}
+}
+
+struct PoolDelegate {
+	std::vector<Job> finished;
+
+	void did_finish(Job&& job) {
+		finished.push_back(job);
+	}
+};
+
+TEST(WorkerPool, RunsJobsOffLoop) {
+	EventLoop loop;
+	loop.make_current();
+
+	PoolDelegate delegate;
+	auto* pool = new WorkerPool<Job>(2, 8, square);
+	pool->setup<PoolDelegate, &PoolDelegate::did_finish>(&delegate);
+
+	for(int i = 0; i < 1000; i++) {
+		pool->submit(Job{i, 0, {}});
+	}
+	EXPECT_LE(pool->pending(), 1000u);
+
+	while(pool->pending() > 0) {
+		uv_run(EventLoop::loop(), UV_RUN_NOWAIT);
+	}
+
+	ASSERT_EQ(delegate.finished.size(), 1000u);
+
+	std::vector<bool> seen(1000, false);
+	for(auto& job : delegate.finished) {
+		EXPECT_EQ(job.output, job.input * job.input);
+		EXPECT_NE(job.worker, std::this_thread::get_id());
+		seen[job.input] = true;
+	}
+	EXPECT_EQ(std::count(seen.begin(), seen.end(), true), 1000);
+	EXPECT_LE(largest_batch.load(), 8u);
+
+	delete pool;
+}
+
+TEST(WorkerPool, DropsQueuedJobsOnDestruction) {
+	EventLoop loop;
+	loop.make_current();
+
+	PoolDelegate delegate;
+	auto* pool = new WorkerPool<Job>(1, 1, square);
+	pool->setup<PoolDelegate, &PoolDelegate::did_finish>(&delegate);
+
+	for(int i = 0; i < 1000; i++) {
+		pool->submit(Job{i, 0, {}});
+	}
+
+	// Must not hang or hand anything over once gone
+	delete pool;
+	uv_run(EventLoop::loop(), UV_RUN_NOWAIT);
+
+	EXPECT_LE(delegate.finished.size(), 1000u);
+}
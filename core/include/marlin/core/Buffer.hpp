@@ -5,6 +5,7 @@
 #define MARLIN_CORE_BUFFER_HPP
 
 #include "marlin/core/WeakBuffer.hpp"
+#include "marlin/core/BufferPool.hpp"
 
 namespace marlin {
 namespace core {
@@ -12,10 +13,14 @@ namespace core {
 /// @brief Byte buffer implementation with modifiable bounds and memory ownership
 /// @headerfile Buffer.hpp <marlin/core/Buffer.hpp>
 class [[clang::trivial_abi]] Buffer : public BaseBuffer<Buffer> {
+private:
+	/// BufferPool size class the memory was obtained from
+	uint8_t size_class = BufferPool::heap_class;
+
 public:
 	using BaseBuffer<Buffer>::BaseBuffer;
 
-	/// Construct with given size - preferred constructor
+	/// Construct with given size, memory is obtained from BufferPool - preferred constructor
 	Buffer(size_t size);
 
 	/// Construct with initializer list and given size - preferred constructor
@@ -27,6 +32,9 @@ public:
 	/// Construct from uint8_t array - unsafe if uint8_t * isn't obtained from new
 	Buffer(uint8_t *buf, size_t size);
 
+	/// Construct from uint8_t array obtained from BufferPool::allocate(alloc_size)
+	Buffer(uint8_t *buf, size_t size, size_t alloc_size);
+
 	/// Move contructor
 	Buffer(Buffer &&b) noexcept;
 
@@ -52,6 +60,7 @@ public:
 	}
 
 	/// Release the memory held by the buffer
+	/// Memory from the pool (see is_pooled) has to be returned through BufferPool::deallocate_class
 	inline uint8_t *release() {
 		uint8_t *_buf = buf;
 
@@ -59,10 +68,16 @@ public:
 		capacity = 0;
 		start_index = 0;
 		end_index = 0;
+		size_class = BufferPool::heap_class;
 
 		return _buf;
 	}
 
+	/// Is the memory held by the buffer owned by BufferPool?
+	inline bool is_pooled() const {
+		return size_class != BufferPool::heap_class;
+	}
+
 	/// Get a WeakBuffer corresponding to the payload area
 	WeakBuffer payload_buffer() &;
 	WeakBuffer const payload_buffer() const&;
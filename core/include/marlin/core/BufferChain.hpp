@@ -0,0 +1,86 @@
+/*! \file BufferChain.hpp
+*/
+
+#ifndef MARLIN_CORE_BUFFERCHAIN_HPP
+#define MARLIN_CORE_BUFFERCHAIN_HPP
+
+#include "marlin/core/Buffer.hpp"
+#include "marlin/core/SharedBuffer.hpp"
+
+#include <array>
+#include <cassert>
+
+namespace marlin {
+namespace core {
+
+/// @brief Ordered list of owned and shared segments which together make up a single packet
+/// @headerfile BufferChain.hpp <marlin/core/BufferChain.hpp>
+///
+/// Meant for scatter-gather IO, lets a packet be assembled out of a freshly written header
+/// and payload referenced from elsewhere without copying the payload into the header.
+class BufferChain {
+public:
+	/// Maximum number of segments in a chain
+	static constexpr size_t max_segments = 4;
+
+private:
+	struct Segment {
+		Buffer owned = Buffer(nullptr, 0);
+		SharedBuffer shared;
+		bool is_shared = false;
+	};
+
+	std::array<Segment, max_segments> segments;
+	size_t num = 0;
+	size_t total_size = 0;
+
+public:
+	/// Construct empty chain
+	BufferChain() = default;
+
+	/// Construct chain with a single owned segment
+	explicit BufferChain(Buffer &&buf);
+
+	/// Move contructor
+	BufferChain(BufferChain &&) = default;
+	/// Move assign
+	BufferChain &operator=(BufferChain &&) = default;
+
+	/// Append an owned segment, returns -1 if the chain is full
+	int append(Buffer &&buf);
+	/// Append a shared segment, returns -1 if the chain is full
+	int append(SharedBuffer const &buf);
+
+	/// Number of segments
+	inline size_t num_segments() const {
+		return num;
+	}
+
+	/// Total length of all segments
+	inline size_t size() const {
+		return total_size;
+	}
+
+	/// View of the segment at the given index
+	WeakBuffer const segment(size_t idx) const {
+		assert(idx < num);
+
+		auto &s = segments[idx];
+		return s.is_shared ? WeakBuffer(s.shared) : WeakBuffer(s.owned);
+	}
+
+	/// First segment, must be owned, usually the packet header
+	Buffer &head() {
+		assert(num > 0 && !segments[0].is_shared);
+
+		return segments[0].owned;
+	}
+
+	/// Copy all segments into a single buffer
+	Buffer flatten() const;
+};
+
+} // namespace core
+} // namespace marlin
+
+#endif // MARLIN_CORE_BUFFERCHAIN_HPP
@@ -0,0 +1,73 @@
+/*! \file BufferPool.hpp
+*/
+
+#ifndef MARLIN_CORE_BUFFERPOOL_HPP
+#define MARLIN_CORE_BUFFERPOOL_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace marlin {
+namespace core {
+
+/// @brief Thread local slab pool with power of two size classes, backs Buffer memory
+/// @headerfile BufferPool.hpp <marlin/core/BufferPool.hpp>
+///
+/// Blocks are handed out from per size class free lists and returned to the
+/// free list of the releasing thread. Requests larger than the largest size class
+/// go straight to the heap.
+class BufferPool {
+public:
+	/// Log2 of the smallest size class
+	static constexpr size_t min_class_shift = 6;
+	/// Log2 of the largest size class
+	static constexpr size_t max_class_shift = 16;
+	/// Number of size classes, 64B to 64KB
+	static constexpr size_t num_classes = max_class_shift - min_class_shift + 1;
+	/// Size class denoting memory obtained directly from new[]
+	static constexpr uint8_t heap_class = 0xff;
+
+	/// Allocation counters, tracked per thread
+	struct Stats {
+		/// Total number of allocations
+		uint64_t allocs = 0;
+		/// Total number of deallocations
+		uint64_t frees = 0;
+		/// Allocations which had to go to the system allocator
+		uint64_t heap_allocs = 0;
+		/// Deallocations which had to go to the system allocator
+		uint64_t heap_frees = 0;
+	};
+
+	/// Maximum number of free blocks cached per size class per thread, 0 disables pooling
+	static size_t max_cached_blocks;
+
+	/// Size class which can fit the given size, heap_class if too large
+	static uint8_t size_class(size_t size);
+	/// Size of blocks in the given size class
+	static size_t class_size(uint8_t size_class);
+
+	/// Allocate a block from the given size class, must not be heap_class
+	static uint8_t *allocate_class(uint8_t size_class);
+	/// Return a block to the given size class, heap_class blocks are deleted
+	static void deallocate_class(uint8_t *buf, uint8_t size_class);
+
+	/// Allocate a block which can hold atleast size bytes
+	static uint8_t *allocate(size_t size);
+	/// Return a block obtained from allocate(size)
+	static void deallocate(uint8_t *buf, size_t size) {
+		deallocate_class(buf, size_class(size));
+	}
+
+	/// Allocation counters of the calling thread
+	static Stats const &stats();
+	/// Reset allocation counters of the calling thread
+	static void reset_stats();
+	/// Release all cached blocks of the calling thread to the system allocator
+	static void trim();
+};
+
+} // namespace core
+} // namespace marlin
+
+#endif // MARLIN_CORE_BUFFERPOOL_HPP
@@ -0,0 +1,109 @@
+/*! \file SharedBuffer.hpp
+*/
+
+#ifndef MARLIN_CORE_SHAREDBUFFER_HPP
+#define MARLIN_CORE_SHAREDBUFFER_HPP
+
+#include "marlin/core/Buffer.hpp"
+
+#include <atomic>
+#include <cassert>
+
+namespace marlin {
+namespace core {
+
+/// @brief Reference counted immutable byte buffer
+/// @headerfile SharedBuffer.hpp <marlin/core/SharedBuffer.hpp>
+///
+/// Copies share the underlying memory, which is released once the last copy is destroyed.
+/// Every SharedBuffer is a view into the shared memory, slice() creates narrower views.
+/// Useful for sending the same bytes on multiple transports without copying.
+class SharedBuffer {
+private:
+	/// Control block holding the reference count and the memory
+	struct Storage {
+		std::atomic<uint32_t> ref_count;
+		Buffer buffer;
+
+		Storage(Buffer &&buffer) : ref_count(1), buffer(std::move(buffer)) {}
+	};
+
+	Storage *storage = nullptr;
+	/// Start of the view relative to the start of the underlying buffer
+	size_t offset = 0;
+	/// Length of the view
+	size_t length = 0;
+
+	void acquire() {
+		if(storage != nullptr) {
+			storage->ref_count.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+	void release();
+
+public:
+	/// Construct empty buffer
+	SharedBuffer() = default;
+
+	/// Construct by taking ownership of the given buffer
+	explicit SharedBuffer(Buffer &&buf);
+
+	/// Copy constructor, shares memory
+	SharedBuffer(SharedBuffer const &b) : storage(b.storage), offset(b.offset), length(b.length) {
+		acquire();
+	}
+
+	/// Move constructor
+	SharedBuffer(SharedBuffer &&b) noexcept : storage(b.storage), offset(b.offset), length(b.length) {
+		b.storage = nullptr;
+		b.offset = 0;
+		b.length = 0;
+	}
+
+	/// Copy assign, shares memory
+	SharedBuffer &operator=(SharedBuffer const &b);
+
+	/// Move assign
+	SharedBuffer &operator=(SharedBuffer &&b) noexcept;
+
+	~SharedBuffer() {
+		release();
+	}
+
+	/// Start of buffer
+	inline uint8_t const *data() const {
+		return storage == nullptr ? nullptr : storage->buffer.data() + offset;
+	}
+
+	/// Length of buffer
+	inline size_t size() const {
+		return length;
+	}
+
+	/// Number of views sharing the underlying memory
+	inline uint32_t use_count() const {
+		return storage == nullptr ? 0 : storage->ref_count.load(std::memory_order_relaxed);
+	}
+
+	/// Get a view of length bytes starting at offset, shares memory
+	SharedBuffer slice(size_t offset, size_t length) const {
+		assert(offset + length <= this->length);
+
+		SharedBuffer b(*this);
+		b.offset += offset;
+		b.length = length;
+
+		return b;
+	}
+
+	/// Implicit conversion to WeakBuffer
+	operator WeakBuffer const() const {
+		// Note: Const stripping, but safe since return value is const
+		return WeakBuffer((uint8_t*)data(), size());
+	}
+};
+
+} // namespace core
+} // namespace marlin
+
+#endif // MARLIN_CORE_SHAREDBUFFER_HPP
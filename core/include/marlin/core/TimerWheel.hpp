@@ -0,0 +1,98 @@
+/*! \file TimerWheel.hpp
+*/
+
+#ifndef MARLIN_CORE_TIMERWHEEL_HPP
+#define MARLIN_CORE_TIMERWHEEL_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace marlin {
+namespace core {
+
+/// @brief Hashed hierarchical timing wheel with intrusive timer nodes
+/// @headerfile TimerWheel.hpp <marlin/core/TimerWheel.hpp>
+///
+/// Four levels of 64 slots cover about 4.6 hours of 1 tick resolution, later expiries wait
+/// in an overflow list. Scheduling and cancelling only link or unlink a node, timers are moved
+/// to lower levels as the wheel turns. The wheel only tracks time, the owner advances it
+/// and uses next_expiry() to decide when to wake up.
+class TimerWheel {
+public:
+	/// Log2 of the number of slots per level
+	static constexpr size_t slot_bits = 6;
+	static constexpr size_t num_slots = 1 << slot_bits;
+	static constexpr size_t num_levels = 4;
+	/// Sentinel returned by next_expiry() when nothing is scheduled
+	static constexpr uint64_t never = UINT64_MAX;
+
+	/// Embedded in the timer owning it, must stay cancelled or fired before it is destroyed
+	struct Node {
+		Node *prev = nullptr;
+		Node *next = nullptr;
+		uint64_t expiry = 0;
+		/// Level the node is linked into, num_levels for the overflow list
+		uint8_t level = 0;
+		uint8_t slot = 0;
+		bool linked = false;
+
+		/// Called when the node expires, the node is already unlinked
+		void (*callback)(Node *) = nullptr;
+		/// Passed back to the callback through the node
+		void *owner = nullptr;
+
+		bool is_scheduled() const {
+			return linked;
+		}
+	};
+
+private:
+	uint64_t current;
+	size_t count = 0;
+
+	Node *slots[num_levels][num_slots] = {};
+	/// Occupied slots per level
+	uint64_t occupied[num_levels] = {};
+	Node *overflow = nullptr;
+
+	Node *&list(Node *node);
+	void link(Node *node);
+	void unlink(Node *node);
+	/// Move the nodes of a higher level slot down as the wheel reaches it
+	void cascade(size_t level, size_t slot);
+	void tick();
+	/// Next tick which fires or cascades nodes
+	uint64_t next_tick() const;
+
+public:
+	/// Wheel starting at the given tick
+	TimerWheel(uint64_t now = 0);
+
+	TimerWheel(TimerWheel const&) = delete;
+	TimerWheel(TimerWheel&&) = delete;
+
+	/// Schedule the node to fire at the given tick, rescheduling it if already scheduled.
+	/// Expiries not after the current tick fire on the next tick.
+	void schedule(Node *node, uint64_t expiry);
+	/// Cancel the node, no-op if not scheduled
+	void cancel(Node *node);
+
+	/// Fire all nodes expiring upto and including the given tick
+	void advance(uint64_t now);
+
+	/// Tick the wheel has been advanced to
+	uint64_t now() const {
+		return current;
+	}
+	/// Number of scheduled nodes
+	size_t size() const {
+		return count;
+	}
+	/// Earliest tick at which advance() has work to do, moving nodes down counts as work
+	uint64_t next_expiry() const;
+};
+
+} // namespace core
+} // namespace marlin
+
+#endif // MARLIN_CORE_TIMERWHEEL_HPP
@@ -55,6 +55,19 @@ public:
 	void erase(SocketAddress const &addr) {
 		transport_map.erase(addr);
 	}
+
+	/// Store the transport with the given destination address against another address,
+	/// replacing any transport stored against that address
+	void rekey(SocketAddress const &from, SocketAddress const &to) {
+		auto iter = transport_map.find(from);
+		if(iter == transport_map.end()) {
+			return;
+		}
+
+		auto transport = std::move(iter->second);
+		transport_map.erase(iter);
+		transport_map.insert_or_assign(to, std::move(transport));
+	}
 };
 
 } // namespace core
@@ -8,10 +8,12 @@ namespace marlin {
 namespace core {
 
 Buffer::Buffer(size_t size) :
-BaseBuffer(new uint8_t[size], size) {}
+BaseBuffer(BufferPool::allocate(size), size),
+size_class(BufferPool::size_class(size)) {}
 
 Buffer::Buffer(std::initializer_list<uint8_t> il, size_t size) :
-BaseBuffer(new uint8_t[size], size) {
+BaseBuffer(BufferPool::allocate(size), size),
+size_class(BufferPool::size_class(size)) {
 	assert(il.size() <= size);
 	std::copy(il.begin(), il.end(), buf);
 }
@@ -19,34 +21,44 @@ BaseBuffer(new uint8_t[size], size) {
 Buffer::Buffer(uint8_t *buf, size_t size) :
 BaseBuffer(buf, size) {}
 
+Buffer::Buffer(uint8_t *buf, size_t size, size_t alloc_size) :
+BaseBuffer(buf, size),
+size_class(BufferPool::size_class(alloc_size)) {
+	assert(size <= alloc_size);
+}
+
 Buffer::Buffer(Buffer &&b) noexcept :
-BaseBuffer(static_cast<BaseBuffer&&>(std::move(b))) {
+BaseBuffer(static_cast<BaseBuffer&&>(std::move(b))),
+size_class(b.size_class) {
 	b.buf = nullptr;
 	b.capacity = 0;
 	b.start_index = 0;
 	b.end_index = 0;
+	b.size_class = BufferPool::heap_class;
 }
 
 Buffer &Buffer::operator=(Buffer &&b) noexcept {
 	// Destroy old
-	delete[] buf;
+	BufferPool::deallocate_class(buf, size_class);
 
 	// Assign from new
 	buf = b.buf;
 	capacity = b.capacity;
 	start_index = b.start_index;
 	end_index = b.end_index;
+	size_class = b.size_class;
 
 	b.buf = nullptr;
 	b.capacity = 0;
 	b.start_index = 0;
 	b.end_index = 0;
+	b.size_class = BufferPool::heap_class;
 
 	return *this;
 }
 
 Buffer::~Buffer() {
-	delete[] buf;
+	BufferPool::deallocate_class(buf, size_class);
 }
 
 WeakBuffer Buffer::payload_buffer() & {
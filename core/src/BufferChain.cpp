@@ -0,0 +1,50 @@
+#include "marlin/core/BufferChain.hpp"
+
+namespace marlin {
+namespace core {
+
+BufferChain::BufferChain(Buffer &&buf) {
+	append(std::move(buf));
+}
+
+int BufferChain::append(Buffer &&buf) {
+	if(num == max_segments) {
+		return -1;
+	}
+
+	total_size += buf.size();
+	segments[num].owned = std::move(buf);
+	segments[num].is_shared = false;
+	num++;
+
+	return 0;
+}
+
+int BufferChain::append(SharedBuffer const &buf) {
+	if(num == max_segments) {
+		return -1;
+	}
+
+	total_size += buf.size();
+	segments[num].shared = buf;
+	segments[num].is_shared = true;
+	num++;
+
+	return 0;
+}
+
+Buffer BufferChain::flatten() const {
+	Buffer buf(total_size);
+
+	size_t offset = 0;
+	for(size_t i = 0; i < num; i++) {
+		auto s = segment(i);
+		buf.write_unsafe(offset, s.data(), s.size());
+		offset += s.size();
+	}
+
+	return buf;
+}
+
+} // namespace core
+} // namespace marlin
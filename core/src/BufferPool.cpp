@@ -0,0 +1,145 @@
+#include "marlin/core/BufferPool.hpp"
+
+#include <array>
+#include <cassert>
+
+namespace marlin {
+namespace core {
+
+size_t BufferPool::max_cached_blocks = 1024;
+
+namespace {
+
+/// Free block, the link is stored inside the block itself
+struct FreeBlock {
+	FreeBlock *next;
+};
+
+struct FreeList {
+	FreeBlock *head = nullptr;
+	size_t count = 0;
+};
+
+/// Set once the thread local pool is destroyed, trivially destructible so
+/// it stays usable by buffers released during thread or program teardown
+thread_local bool pool_destroyed = false;
+
+struct ThreadPool {
+	std::array<FreeList, BufferPool::num_classes> free_lists;
+	BufferPool::Stats stats;
+
+	void trim() {
+		for(auto &list : free_lists) {
+			while(list.head != nullptr) {
+				auto *block = list.head;
+				list.head = block->next;
+				delete[] reinterpret_cast<uint8_t *>(block);
+			}
+			list.count = 0;
+		}
+	}
+
+	~ThreadPool() {
+		trim();
+		pool_destroyed = true;
+	}
+};
+
+thread_local ThreadPool pool;
+
+} // namespace
+
+uint8_t BufferPool::size_class(size_t size) {
+	if(size > ((size_t)1 << max_class_shift)) {
+		return heap_class;
+	}
+
+	uint8_t cls = 0;
+	while(((size_t)1 << (min_class_shift + cls)) < size) {
+		cls++;
+	}
+
+	return cls;
+}
+
+size_t BufferPool::class_size(uint8_t size_class) {
+	assert(size_class < num_classes);
+
+	return (size_t)1 << (min_class_shift + size_class);
+}
+
+uint8_t *BufferPool::allocate_class(uint8_t size_class) {
+	assert(size_class < num_classes);
+
+	if(pool_destroyed) {
+		return new uint8_t[class_size(size_class)];
+	}
+
+	pool.stats.allocs++;
+
+	auto &list = pool.free_lists[size_class];
+	if(list.head != nullptr) {
+		auto *block = list.head;
+		list.head = block->next;
+		list.count--;
+
+		return reinterpret_cast<uint8_t *>(block);
+	}
+
+	pool.stats.heap_allocs++;
+	return new uint8_t[class_size(size_class)];
+}
+
+void BufferPool::deallocate_class(uint8_t *buf, uint8_t size_class) {
+	if(buf == nullptr) {
+		return;
+	}
+
+	if(pool_destroyed) {
+		delete[] buf;
+		return;
+	}
+
+	pool.stats.frees++;
+
+	if(size_class == heap_class || pool.free_lists[size_class].count >= max_cached_blocks) {
+		pool.stats.heap_frees++;
+		delete[] buf;
+		return;
+	}
+
+	auto &list = pool.free_lists[size_class];
+	auto *block = reinterpret_cast<FreeBlock *>(buf);
+	block->next = list.head;
+	list.head = block;
+	list.count++;
+}
+
+uint8_t *BufferPool::allocate(size_t size) {
+	auto cls = size_class(size);
+	if(cls != heap_class) {
+		return allocate_class(cls);
+	}
+
+	if(!pool_destroyed) {
+		pool.stats.allocs++;
+		pool.stats.heap_allocs++;
+	}
+
+	return new uint8_t[size];
+}
+
+BufferPool::Stats const &BufferPool::stats() {
+	return pool.stats;
+}
+
+void BufferPool::reset_stats() {
+	pool.stats = Stats();
+}
+
+void BufferPool::trim() {
+	pool.trim();
+}
+
+} // namespace core
+} // namespace marlin
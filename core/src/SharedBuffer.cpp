@@ -0,0 +1,59 @@
+#include "marlin/core/SharedBuffer.hpp"
+
+namespace marlin {
+namespace core {
+
+SharedBuffer::SharedBuffer(Buffer &&buf) :
+storage(new Storage(std::move(buf))), offset(0), length(storage->buffer.size()) {}
+
+void SharedBuffer::release() {
+	if(storage == nullptr) {
+		return;
+	}
+
+	if(storage->ref_count.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+		delete storage;
+	}
+
+	storage = nullptr;
+}
+
+SharedBuffer &SharedBuffer::operator=(SharedBuffer const &b) {
+	if(this == &b) {
+		return *this;
+	}
+
+	// Acquire before release in case both share storage
+	auto *new_storage = b.storage;
+	if(new_storage != nullptr) {
+		new_storage->ref_count.fetch_add(1, std::memory_order_relaxed);
+	}
+	release();
+
+	storage = new_storage;
+	offset = b.offset;
+	length = b.length;
+
+	return *this;
+}
+
+SharedBuffer &SharedBuffer::operator=(SharedBuffer &&b) noexcept {
+	if(this == &b) {
+		return *this;
+	}
+
+	release();
+
+	storage = b.storage;
+	offset = b.offset;
+	length = b.length;
+
+	b.storage = nullptr;
+	b.offset = 0;
+	b.length = 0;
+
+	return *this;
+}
+
+} // namespace core
+} // namespace marlin
@@ -0,0 +1,189 @@
+#include "marlin/core/TimerWheel.hpp"
+
+namespace marlin {
+namespace core {
+
+namespace {
+
+constexpr uint64_t slot_mask = TimerWheel::num_slots - 1;
+
+/// Ticks spanned by a single slot of the given level
+constexpr uint64_t level_span(size_t level) {
+	return uint64_t(1) << (TimerWheel::slot_bits * level);
+}
+
+}
+
+TimerWheel::TimerWheel(uint64_t now) : current(now) {}
+
+TimerWheel::Node *&TimerWheel::list(Node *node) {
+	if(node->level == num_levels) {
+		return overflow;
+	}
+
+	return slots[node->level][node->slot];
+}
+
+void TimerWheel::link(Node *node) {
+	// Level is decided by the highest slot group in which expiry differs from now
+	auto diff = node->expiry ^ current;
+
+	node->level = num_levels;
+	for(size_t level = 0; level < num_levels; level++) {
+		if(diff < level_span(level + 1)) {
+			node->level = level;
+			node->slot = (node->expiry >> (slot_bits * level)) & slot_mask;
+			occupied[level] |= uint64_t(1) << node->slot;
+			break;
+		}
+	}
+
+	// Append so nodes expiring together fire in the order they were scheduled
+	auto &head = list(node);
+	if(head == nullptr) {
+		node->prev = node;
+		node->next = node;
+		head = node;
+	} else {
+		node->prev = head->prev;
+		node->next = head;
+		head->prev->next = node;
+		head->prev = node;
+	}
+
+	node->linked = true;
+	count++;
+}
+
+void TimerWheel::unlink(Node *node) {
+	auto &head = list(node);
+	if(node->next == node) {
+		head = nullptr;
+		if(node->level < num_levels) {
+			occupied[node->level] &= ~(uint64_t(1) << node->slot);
+		}
+	} else {
+		node->prev->next = node->next;
+		node->next->prev = node->prev;
+		if(head == node) {
+			head = node->next;
+		}
+	}
+
+	node->prev = nullptr;
+	node->next = nullptr;
+	node->linked = false;
+	count--;
+}
+
+void TimerWheel::schedule(Node *node, uint64_t expiry) {
+	if(node->linked) {
+		unlink(node);
+	}
+
+	node->expiry = expiry > current ? expiry : current + 1;
+	link(node);
+}
+
+void TimerWheel::cancel(Node *node) {
+	if(node->linked) {
+		unlink(node);
+	}
+}
+
+void TimerWheel::cascade(size_t level, size_t slot) {
+	Node *node;
+	if(level == num_levels) {
+		node = overflow;
+		overflow = nullptr;
+	} else {
+		node = slots[level][slot];
+		slots[level][slot] = nullptr;
+		occupied[level] &= ~(uint64_t(1) << slot);
+	}
+
+	if(node == nullptr) {
+		return;
+	}
+
+	// Detach the whole list before relinking into it
+	node->prev->next = nullptr;
+	while(node != nullptr) {
+		auto *next = node->next;
+		count--;
+		link(node);
+		node = next;
+	}
+}
+
+void TimerWheel::tick() {
+	current++;
+
+	// Higher levels first, their nodes can land in lower level slots reached at the same tick
+	size_t top = 0;
+	while(top < num_levels && (current & (level_span(top + 1) - 1)) == 0) {
+		top++;
+	}
+	for(size_t level = top; level > 0; level--) {
+		cascade(level, (current >> (slot_bits * level)) & slot_mask);
+	}
+
+	// Nodes scheduled by callbacks always land after the current tick
+	auto &head = slots[0][current & slot_mask];
+	while(head != nullptr) {
+		auto *node = head;
+		unlink(node);
+		node->callback(node);
+	}
+}
+
+uint64_t TimerWheel::next_tick() const {
+	// Slots at or before the current position of a level are always empty
+	for(size_t level = 0; level < num_levels; level++) {
+		auto shift = slot_bits * level;
+		auto slot = (current >> shift) & slot_mask;
+		if(slot == slot_mask) {
+			continue;
+		}
+
+		auto pending = occupied[level] & (~uint64_t(0) << (slot + 1));
+		if(pending != 0) {
+			auto base = current & ~(level_span(level + 1) - 1);
+			return base + (uint64_t(__builtin_ctzll(pending)) << shift);
+		}
+	}
+
+	// Only the overflow list is left
+	return (current | (level_span(num_levels) - 1)) + 1;
+}
+
+void TimerWheel::advance(uint64_t now) {
+	while(current < now) {
+		// Nothing to turn, jump straight to now
+		if(count == 0) {
+			current = now;
+			return;
+		}
+
+		// Skip ticks without work, stopping at the next fire or cascade
+		auto target = next_tick();
+		if(target > now) {
+			current = now;
+			return;
+		}
+
+		current = target - 1;
+		tick();
+	}
+}
+
+uint64_t TimerWheel::next_expiry() const {
+	if(count == 0) {
+		return never;
+	}
+
+	return next_tick();
+}
+
+} // namespace core
+} // namespace marlin
@@ -0,0 +1,72 @@
+#include "gtest/gtest.h"
+#include "marlin/core/BufferChain.hpp"
+
+#include <cstring>
+
+using namespace marlin::core;
+
+TEST(BufferChainConstruct, Empty) {
+	BufferChain chain;
+
+	EXPECT_EQ(chain.num_segments(), 0);
+	EXPECT_EQ(chain.size(), 0);
+}
+
+TEST(BufferChainAppend, OwnedAndShared) {
+	SharedBuffer payload(Buffer({'4','5','6','7','8'}, 5));
+
+	BufferChain chain(Buffer({'0','1','2','3'}, 4));
+	EXPECT_EQ(chain.append(payload.slice(1, 3)), 0);
+	EXPECT_EQ(chain.append(Buffer({'9'}, 1)), 0);
+
+	EXPECT_EQ(chain.num_segments(), 3);
+	EXPECT_EQ(chain.size(), 8);
+	EXPECT_EQ(payload.use_count(), 2);
+
+	// Shared segment references payload memory
+	EXPECT_EQ(chain.segment(1).data(), payload.data() + 1);
+	EXPECT_EQ(chain.segment(1).size(), 3);
+
+	EXPECT_EQ(chain.head().size(), 4);
+	EXPECT_EQ(chain.head().data()[0], '0');
+}
+
+TEST(BufferChainAppend, FailsWhenFull) {
+	BufferChain chain;
+
+	for(size_t i = 0; i < BufferChain::max_segments; i++) {
+		EXPECT_EQ(chain.append(Buffer(10)), 0);
+	}
+	EXPECT_EQ(chain.append(Buffer(10)), -1);
+	EXPECT_EQ(chain.append(SharedBuffer(Buffer(10))), -1);
+
+	EXPECT_EQ(chain.num_segments(), BufferChain::max_segments);
+	EXPECT_EQ(chain.size(), 10 * BufferChain::max_segments);
+}
+
+TEST(BufferChainFlatten, CopiesInOrder) {
+	SharedBuffer payload(Buffer({'4','5','6','7','8'}, 5));
+
+	BufferChain chain(Buffer({'0','1','2','3'}, 4));
+	chain.append(payload.slice(0, 4));
+	chain.append(Buffer({'8','9'}, 2));
+
+	auto buf = chain.flatten();
+
+	EXPECT_EQ(buf.size(), 10);
+	EXPECT_EQ(std::memcmp(buf.data(), "0123456789", 10), 0);
+}
+
+TEST(BufferChainMove, KeepsSharedAlive) {
+	BufferChain nchain;
+	{
+		SharedBuffer payload(Buffer({'0','1'}, 2));
+		BufferChain chain;
+		chain.append(payload);
+		nchain = std::move(chain);
+	}
+
+	EXPECT_EQ(nchain.num_segments(), 1);
+	EXPECT_EQ(nchain.segment(0).data()[0], '0');
+	EXPECT_EQ(nchain.segment(0).data()[1], '1');
+}
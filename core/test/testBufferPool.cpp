@@ -0,0 +1,98 @@
+#include "gtest/gtest.h"
+#include "marlin/core/Buffer.hpp"
+#include "marlin/core/BufferPool.hpp"
+
+#include <thread>
+
+using namespace marlin::core;
+
+TEST(BufferPoolSizeClass, RoundsUpToPowerOfTwo) {
+	EXPECT_EQ(BufferPool::size_class(0), 0);
+	EXPECT_EQ(BufferPool::size_class(64), 0);
+	EXPECT_EQ(BufferPool::size_class(65), 1);
+	EXPECT_EQ(BufferPool::size_class(1400), 5);
+	EXPECT_EQ(BufferPool::class_size(BufferPool::size_class(1400)), 2048);
+	EXPECT_EQ(BufferPool::size_class(65536), BufferPool::num_classes - 1);
+	EXPECT_EQ(BufferPool::size_class(65537), BufferPool::heap_class);
+}
+
+TEST(BufferPoolAllocate, ReusesFreedBlocks) {
+	BufferPool::trim();
+
+	auto *ptr = BufferPool::allocate(1400);
+	BufferPool::deallocate(ptr, 1400);
+
+	BufferPool::reset_stats();
+	auto *nptr = BufferPool::allocate(1200);
+
+	EXPECT_EQ(nptr, ptr);
+	EXPECT_EQ(BufferPool::stats().allocs, 1);
+	EXPECT_EQ(BufferPool::stats().heap_allocs, 0);
+
+	BufferPool::deallocate(nptr, 1200);
+}
+
+TEST(BufferPoolAllocate, LargeSizesGoToHeap) {
+	BufferPool::reset_stats();
+
+	auto *ptr = BufferPool::allocate(100000);
+	BufferPool::deallocate(ptr, 100000);
+
+	EXPECT_EQ(BufferPool::stats().heap_allocs, 1);
+	EXPECT_EQ(BufferPool::stats().heap_frees, 1);
+}
+
+TEST(BufferPoolBuffer, SteadyStateDoesNotAllocate) {
+	BufferPool::trim();
+
+	// Warm up
+	{
+		auto buf = Buffer(1400);
+	}
+
+	BufferPool::reset_stats();
+	for(int i = 0; i < 1000; i++) {
+		auto buf = Buffer(1400);
+		auto nbuf = std::move(buf);
+		EXPECT_TRUE(nbuf.is_pooled());
+	}
+
+	EXPECT_EQ(BufferPool::stats().allocs, 1000);
+	EXPECT_EQ(BufferPool::stats().frees, 1000);
+	EXPECT_EQ(BufferPool::stats().heap_allocs, 0);
+	EXPECT_EQ(BufferPool::stats().heap_frees, 0);
+}
+
+TEST(BufferPoolBuffer, RawPtrIsNotPooled) {
+	auto buf = Buffer(new uint8_t[1400], 1400);
+
+	EXPECT_FALSE(buf.is_pooled());
+
+	BufferPool::reset_stats();
+	buf = Buffer(1400);
+
+	EXPECT_TRUE(buf.is_pooled());
+	EXPECT_EQ(BufferPool::stats().heap_frees, 1);
+}
+
+TEST(BufferPoolBuffer, PooledPtrConstructible) {
+	auto *ptr = BufferPool::allocate(65536);
+
+	auto buf = Buffer(ptr, 1400, 65536);
+
+	EXPECT_TRUE(buf.is_pooled());
+	EXPECT_EQ(buf.data(), ptr);
+	EXPECT_EQ(buf.size(), 1400);
+}
+
+TEST(BufferPoolBuffer, CrossThreadRelease) {
+	auto buf = Buffer(1400);
+
+	std::thread t([buf = std::move(buf)]() mutable {
+		BufferPool::reset_stats();
+		buf = Buffer(nullptr, 0);
+
+		EXPECT_EQ(BufferPool::stats().frees, 1);
+	});
+	t.join();
+}
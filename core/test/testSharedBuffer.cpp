@@ -0,0 +1,91 @@
+#include "gtest/gtest.h"
+#include "marlin/core/SharedBuffer.hpp"
+
+#include <cstring>
+
+using namespace marlin::core;
+
+TEST(SharedBufferConstruct, DefaultConstructible) {
+	SharedBuffer buf;
+
+	EXPECT_EQ(buf.data(), nullptr);
+	EXPECT_EQ(buf.size(), 0);
+	EXPECT_EQ(buf.use_count(), 0);
+}
+
+TEST(SharedBufferConstruct, BufferConstructible) {
+	auto buf = Buffer({'0','1','2','3'}, 4);
+	uint8_t *raw_ptr = buf.data();
+
+	SharedBuffer sbuf(std::move(buf));
+
+	EXPECT_EQ(sbuf.data(), raw_ptr);
+	EXPECT_EQ(sbuf.size(), 4);
+	EXPECT_EQ(sbuf.use_count(), 1);
+	EXPECT_EQ(buf.data(), nullptr);
+}
+
+TEST(SharedBufferConstruct, CopySharesMemory) {
+	SharedBuffer sbuf(Buffer(1400));
+
+	{
+		auto nbuf = sbuf;
+
+		EXPECT_EQ(nbuf.data(), sbuf.data());
+		EXPECT_EQ(nbuf.size(), 1400);
+		EXPECT_EQ(sbuf.use_count(), 2);
+	}
+
+	EXPECT_EQ(sbuf.use_count(), 1);
+}
+
+TEST(SharedBufferConstruct, MoveDoesNotShare) {
+	SharedBuffer sbuf(Buffer(1400));
+	auto *raw_ptr = sbuf.data();
+
+	auto nbuf = std::move(sbuf);
+
+	EXPECT_EQ(nbuf.data(), raw_ptr);
+	EXPECT_EQ(nbuf.use_count(), 1);
+	EXPECT_EQ(sbuf.data(), nullptr);
+	EXPECT_EQ(sbuf.size(), 0);
+}
+
+TEST(SharedBufferConstruct, AssignReleasesOld) {
+	SharedBuffer sbuf(Buffer(1400));
+	SharedBuffer obuf(Buffer(100));
+	auto nbuf = obuf;
+
+	nbuf = sbuf;
+
+	EXPECT_EQ(sbuf.use_count(), 2);
+	EXPECT_EQ(obuf.use_count(), 1);
+}
+
+TEST(SharedBufferSlice, SliceSharesMemory) {
+	SharedBuffer sbuf(Buffer({'0','1','2','3'}, 4));
+
+	auto slice = sbuf.slice(1, 2);
+
+	EXPECT_EQ(slice.data(), sbuf.data() + 1);
+	EXPECT_EQ(slice.size(), 2);
+	EXPECT_EQ(sbuf.use_count(), 2);
+	EXPECT_TRUE(std::memcmp(slice.data(), "12", 2) == 0);
+
+	auto nslice = slice.slice(1, 1);
+
+	EXPECT_EQ(nslice.data(), sbuf.data() + 2);
+	EXPECT_EQ(nslice.size(), 1);
+}
+
+TEST(SharedBufferSlice, OutlivesOriginal) {
+	SharedBuffer slice;
+
+	{
+		SharedBuffer sbuf(Buffer({'0','1','2','3'}, 4));
+		slice = sbuf.slice(2, 2);
+	}
+
+	EXPECT_EQ(slice.use_count(), 1);
+	EXPECT_TRUE(std::memcmp(slice.data(), "23", 2) == 0);
+}
@@ -0,0 +1,172 @@
+#include "gtest/gtest.h"
+#include "marlin/core/TimerWheel.hpp"
+
+#include <map>
+#include <random>
+#include <vector>
+
+using namespace marlin::core;
+
+struct Fired {
+	std::vector<std::pair<uint64_t, int>> log;
+	TimerWheel *wheel = nullptr;
+};
+
+struct TestTimer {
+	TimerWheel::Node node;
+	Fired *fired;
+	int id;
+
+	TestTimer(Fired *fired, int id) : fired(fired), id(id) {
+		node.owner = this;
+		node.callback = [](TimerWheel::Node *node) {
+			auto *timer = (TestTimer *)node->owner;
+			timer->fired->log.emplace_back(timer->fired->wheel->now(), timer->id);
+		};
+	}
+};
+
+TEST(TimerWheelSchedule, FiresAtExpiry) {
+	TimerWheel wheel(1000);
+	Fired fired;
+	fired.wheel = &wheel;
+	TestTimer a(&fired, 0), b(&fired, 1);
+
+	wheel.schedule(&a.node, 1010);
+	wheel.schedule(&b.node, 1005);
+	EXPECT_EQ(wheel.size(), 2u);
+	EXPECT_EQ(wheel.next_expiry(), 1005u);
+
+	wheel.advance(1004);
+	EXPECT_TRUE(fired.log.empty());
+
+	wheel.advance(1020);
+	ASSERT_EQ(fired.log.size(), 2u);
+	EXPECT_EQ(fired.log[0], std::make_pair(uint64_t(1005), 1));
+	EXPECT_EQ(fired.log[1], std::make_pair(uint64_t(1010), 0));
+	EXPECT_EQ(wheel.size(), 0u);
+	EXPECT_EQ(wheel.next_expiry(), TimerWheel::never);
+}
+
+TEST(TimerWheelSchedule, SameExpiryFiresInScheduleOrder) {
+	TimerWheel wheel;
+	Fired fired;
+	fired.wheel = &wheel;
+	TestTimer a(&fired, 0), b(&fired, 1), c(&fired, 2);
+
+	wheel.schedule(&a.node, 7);
+	wheel.schedule(&b.node, 7);
+	wheel.schedule(&c.node, 7);
+	wheel.advance(7);
+
+	ASSERT_EQ(fired.log.size(), 3u);
+	EXPECT_EQ(fired.log[0].second, 0);
+	EXPECT_EQ(fired.log[1].second, 1);
+	EXPECT_EQ(fired.log[2].second, 2);
+}
+
+TEST(TimerWheelSchedule, PastExpiryFiresOnNextTick) {
+	TimerWheel wheel(50);
+	Fired fired;
+	fired.wheel = &wheel;
+	TestTimer a(&fired, 0);
+
+	wheel.schedule(&a.node, 10);
+	EXPECT_EQ(wheel.next_expiry(), 51u);
+
+	wheel.advance(51);
+	ASSERT_EQ(fired.log.size(), 1u);
+	EXPECT_EQ(fired.log[0].first, 51u);
+}
+
+TEST(TimerWheelCancel, CancelAndReschedule) {
+	TimerWheel wheel;
+	Fired fired;
+	fired.wheel = &wheel;
+	TestTimer a(&fired, 0), b(&fired, 1);
+
+	wheel.schedule(&a.node, 100);
+	wheel.schedule(&b.node, 200);
+	wheel.cancel(&a.node);
+	EXPECT_FALSE(a.node.is_scheduled());
+	wheel.cancel(&a.node);
+
+	// Restart pushes the expiry out
+	wheel.schedule(&b.node, 5000);
+	EXPECT_EQ(wheel.size(), 1u);
+
+	wheel.advance(4999);
+	EXPECT_TRUE(fired.log.empty());
+
+	wheel.advance(5000);
+	ASSERT_EQ(fired.log.size(), 1u);
+	EXPECT_EQ(fired.log[0], std::make_pair(uint64_t(5000), 1));
+}
+
+TEST(TimerWheelCascade, FarExpiriesFireExactly) {
+	TimerWheel wheel(123);
+	Fired fired;
+	fired.wheel = &wheel;
+
+	std::vector<uint64_t> expiries = {
+		123 + 64,
+		123 + 4096,
+		123 + 300000,
+		123 + 20000000,
+		123 + (uint64_t(1) << 30)
+	};
+	std::vector<TestTimer> timers;
+	timers.reserve(expiries.size());
+	for(size_t i = 0; i < expiries.size(); i++) {
+		timers.emplace_back(&fired, i);
+		wheel.schedule(&timers[i].node, expiries[i]);
+	}
+
+	wheel.advance(expiries.back());
+
+	ASSERT_EQ(fired.log.size(), expiries.size());
+	for(size_t i = 0; i < expiries.size(); i++) {
+		EXPECT_EQ(fired.log[i], std::make_pair(expiries[i], int(i)));
+	}
+}
+
+TEST(TimerWheelCascade, MatchesOrderedReference) {
+	TimerWheel wheel;
+	Fired fired;
+	fired.wheel = &wheel;
+
+	std::mt19937_64 gen(42);
+	std::uniform_int_distribution<uint64_t> delay(1, 100000);
+	std::uniform_int_distribution<uint64_t> step(1, 3000);
+
+	std::vector<TestTimer> timers;
+	timers.reserve(500);
+	for(int i = 0; i < 500; i++) {
+		timers.emplace_back(&fired, i);
+	}
+
+	std::map<int, uint64_t> expected;
+	for(auto &timer : timers) {
+		auto expiry = delay(gen);
+		wheel.schedule(&timer.node, expiry);
+		expected[timer.id] = expiry;
+	}
+	// Restart a few of them
+	for(int i = 0; i < 500; i += 7) {
+		auto expiry = delay(gen);
+		wheel.schedule(&timers[i].node, expiry);
+		expected[i] = expiry;
+	}
+
+	while(wheel.size() > 0) {
+		wheel.advance(wheel.now() + step(gen));
+	}
+
+	ASSERT_EQ(fired.log.size(), 500u);
+	uint64_t last = 0;
+	for(auto &[tick, id] : fired.log) {
+		EXPECT_EQ(tick, expected[id]);
+		EXPECT_GE(tick, last);
+		last = tick;
+	}
+}
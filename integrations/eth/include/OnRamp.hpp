@@ -5,7 +5,7 @@
 #include <marlin/pubsub/attestation/SigAttester.hpp>
 #include <marlin/pubsub/witness/LpfBloomWitnesser.hpp>
 #include <marlin/rlpx/RlpxTransportFactory.hpp>
-#include <cryptopp/blake2.h>
+#include <marlin/pubsub/MessageDigest.hpp>
 
 using namespace marlin;
 using namespace marlin::core;
@@ -75,15 +75,11 @@ public:
 	Buffer header;
 
 	void did_recv(RlpxTransport<OnRamp> &transport, Buffer &&message) {
-		CryptoPP::BLAKE2b blake2b((uint)8);
-		blake2b.Update((uint8_t *)message.data(), message.size());
-		uint64_t message_id;
-		blake2b.TruncatedFinal((uint8_t *)&message_id, 8);
+		// Ids are only derived for messages which get forwarded
 		SPDLOG_DEBUG(
-			"Transport {{ Src: {}, Dst: {} }}: Did recv message {}: {} bytes",
+			"Transport {{ Src: {}, Dst: {} }}: Did recv message: {} bytes",
 			transport.src_addr.to_string(),
 			transport.dst_addr.to_string(),
-			message_id,
 			message.size()
 		);
 
@@ -264,10 +260,7 @@ public:
 			// 	spdlog::to_hex(final.data(), final.data() + final.size())
 			// );
 
-			CryptoPP::BLAKE2b blake2b((uint)8);
-			blake2b.Update((uint8_t *)final.data(), final.size());
-			uint64_t message_id;
-			blake2b.TruncatedFinal((uint8_t *)&message_id, 8);
+			auto message_id = MessageDigest::compute_blake2b64(final.data(), final.size());
 
 			SPDLOG_INFO(
 				"Received message {} on channel 0",
@@ -321,6 +314,7 @@ public:
 				transport.dst_addr.to_string(),
 				message.size()
 			);
+			auto message_id = MessageDigest::compute_blake2b64(message.data(), message.size());
 			SPDLOG_INFO(
 				"Received message {} on channel 0",
 				message_id
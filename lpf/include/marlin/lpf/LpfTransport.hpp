@@ -7,6 +7,7 @@
 
 #include <marlin/core/SocketAddress.hpp>
 #include <marlin/core/Buffer.hpp>
+#include <marlin/core/SharedBuffer.hpp>
 #include <marlin/core/TransportManager.hpp>
 
 #include <marlin/lpf/CutThroughBuffer.hpp>
@@ -22,6 +23,23 @@ struct IsTransportEncrypted {
 	constexpr static bool value = false;
 };
 
+/// Priority classes of a stream transport, transports without them have a single class
+template<typename T>
+struct TransportPriorities {
+	constexpr static uint8_t num_priorities = 1;
+	constexpr static uint8_t default_priority = 0;
+};
+
+template<typename T>
+requires requires {
+	T::num_priorities;
+	T::default_priority;
+}
+struct TransportPriorities<T> {
+	constexpr static uint8_t num_priorities = T::num_priorities;
+	constexpr static uint8_t default_priority = T::default_priority;
+};
+
 template<
 	typename DelegateType,
 	template<typename> class StreamTransportType,
@@ -38,20 +56,53 @@ private:
 	>;
 	static constexpr bool should_cut_through = SHOULD_CUT_THROUGH::value;
 	static constexpr uint8_t prefix_length = PREFIX_LENGTH::value;
+	static_assert(prefix_length > 0 && prefix_length <= 8, "Lengths are at most 64 bits");
 	using BaseTransport = StreamTransportType<Self>;
 
 	BaseTransport &transport;
 	core::TransportManager<Self> &transport_manager;
 
-	std::unordered_map<uint16_t, StoreThenForwardBuffer> stf_buffers;
+	std::unordered_map<uint16_t, StoreThenForwardBuffer<PREFIX_LENGTH>> stf_buffers;
+
+	/// Big endian length prefix framing a message
+	static void write_prefix(uint8_t *out, uint64_t length);
+	static uint64_t read_prefix(uint8_t const *in);
+
+	/// Stream carrying framed messages of the given priority class, -1 if the class is not valid
+	int priority_stream_id(uint8_t priority);
+	int set_stream_priority(uint16_t stream_id, uint8_t priority);
+
+	/// Messages at least this large go on whole streams of their own where the stream transport has them,
+	/// smaller ones share the framed stream of their class so they pack into packets together
+	static constexpr uint64_t whole_stream_min_size = 16384;
+	/// Whole streams take ids from this range in turn, above the cut through streams
+	static constexpr uint16_t whole_stream_ids_begin = 32;
+	static constexpr uint16_t num_whole_stream_ids = 1024;
+	/// Ids tried before falling back to the framed stream, ids in use or held back are skipped
+	static constexpr uint16_t max_whole_stream_attempts = 4;
+	uint16_t next_whole_stream_id = 0;
+	/// Send the message on a whole stream of its own, delivered in place without being copied
+	/// into a framing buffer, -1 if no id is free or the stream transport has no whole streams
+	int send_whole(core::SharedBuffer const &message, uint8_t priority, bool fec);
 public:
+	/// Priority classes of the stream transport, sends in other classes fail
+	static constexpr uint8_t num_priorities = TransportPriorities<BaseTransport>::num_priorities;
+	/// Priority class of messages sent without one, the default class of the stream transport
+	static constexpr uint8_t default_priority = TransportPriorities<BaseTransport>::default_priority;
+	static_assert(num_priorities <= 9, "Framed streams of all classes sit below the cut through streams");
+
 	int did_recv_stf_message(uint16_t id, core::Buffer &&message);
 
 	// Delegate
 	void did_dial(BaseTransport &transport);
 	int did_recv(BaseTransport &transport, core::Buffer &&bytes, uint16_t stream_id = 0);
+	int did_recv_stream(BaseTransport &transport, core::Buffer &&bytes, uint16_t stream_id);
+	/// Messages sent as datagrams are not framed, each is delivered as is
+	int did_recv_datagram(BaseTransport &transport, core::Buffer &&bytes);
 	void did_send(BaseTransport &transport, core::Buffer &&bytes);
 	void did_close(BaseTransport& transport, uint16_t reason);
+	/// The stream transport followed its peer to a new address
+	void did_migrate(BaseTransport& transport, core::SocketAddress const &old_addr);
 	void did_recv_flush_stream(BaseTransport &transport, uint16_t id, uint64_t offset, uint64_t old_offset);
 	void did_recv_skip_stream(BaseTransport &transport, uint16_t id);
 	void did_recv_flush_conf(BaseTransport &transport, uint16_t id);
@@ -73,19 +124,33 @@ public:
 	void setup(DelegateType *delegate, uint8_t const* keys = nullptr);
 
 	int send(core::Buffer &&message);
+	/// Send a shared message without copying it, can be sent on multiple transports.
+	/// Messages of a more urgent priority class, lower is more urgent, go out first.
+	/// Fails for classes from num_priorities on.
+	/// With fec, lost packets of messages sent as whole streams are rebuilt by the destination
+	/// from repair packets instead of waiting for retransmissions.
+	int send(core::SharedBuffer const &message, uint8_t priority = default_priority, bool fec = false);
+	/// Send a message in a single datagram which is never retransmitted.
+	/// Fails if it is larger than max_datagram_size.
+	int send_datagram(core::SharedBuffer const &message);
+	/// Largest message send_datagram takes, 0 if the stream transport has no datagrams
+	uint16_t max_datagram_size();
 	void close(uint16_t reason = 0);
 
 	bool is_active();
 	double get_rtt();
 
 	int cut_through_send(core::Buffer &&message);
+	/// Cut through on internal transports, otherwise sent like send
+	int cut_through_send(core::SharedBuffer const &message, uint8_t priority = default_priority, bool fec = false);
 private:
-	std::unordered_map<uint16_t, CutThroughBuffer> cut_through_buffers;
+	std::unordered_map<uint16_t, CutThroughBuffer<PREFIX_LENGTH>> cut_through_buffers;
 	std::list<uint16_t> cut_through_reserve_ids = {10, 11, 12, 13, 14, 15, 16, 17, 18, 19};
 public:
 	std::unordered_set<uint16_t> cut_through_used_ids;
-	uint16_t cut_through_send_start(uint64_t length);
+	uint16_t cut_through_send_start(uint64_t length, uint8_t priority = default_priority);
 	int cut_through_send_bytes(uint16_t id, core::Buffer &&bytes);
+	int cut_through_send_bytes(uint16_t id, core::SharedBuffer const &bytes);
 	void cut_through_send_end(uint16_t id);
 	void cut_through_send_skip(uint16_t id);
 	void cut_through_send_flush(uint16_t id);
@@ -188,6 +253,50 @@ int LpfTransport<
 	return 0;
 }
 
+template<
+	typename DelegateType,
+	template<typename> class StreamTransportType,
+	typename SHOULD_CUT_THROUGH,
+	typename PREFIX_LENGTH
+>
+int LpfTransport<
+	DelegateType,
+	StreamTransportType,
+	SHOULD_CUT_THROUGH,
+	PREFIX_LENGTH
+>::did_recv_stream(
+	BaseTransport &transport,
+	core::Buffer &&bytes,
+	uint16_t stream_id
+) {
+	// A stream holding exactly one message is delivered in place without copying
+	if(bytes.size() >= prefix_length && read_prefix(bytes.data()) == bytes.size() - prefix_length) {
+		bytes.cover_unsafe(prefix_length);
+		return did_recv_stf_message(stream_id, std::move(bytes));
+	}
+
+	// Anything else goes through the regular framing
+	return did_recv(transport, std::move(bytes), stream_id);
+}
+
+template<
+	typename DelegateType,
+	template<typename> class StreamTransportType,
+	typename SHOULD_CUT_THROUGH,
+	typename PREFIX_LENGTH
+>
+int LpfTransport<
+	DelegateType,
+	StreamTransportType,
+	SHOULD_CUT_THROUGH,
+	PREFIX_LENGTH
+>::did_recv_datagram(
+	BaseTransport &,
+	core::Buffer &&bytes
+) {
+	return delegate->did_recv(*this, std::move(bytes));
+}
+
 template<
 	typename DelegateType,
 	template<typename> class StreamTransportType,
@@ -203,7 +312,7 @@ void LpfTransport<
 	BaseTransport &,
 	core::Buffer &&bytes
 ) {
-	delegate->did_send(*this, std::move(bytes).cover_unsafe(8));
+	delegate->did_send(*this, std::move(bytes).cover_unsafe(prefix_length));
 }
 
 template<
@@ -225,6 +334,36 @@ void LpfTransport<
 	transport_manager.erase(dst_addr);
 }
 
+template<
+	typename DelegateType,
+	template<typename> class StreamTransportType,
+	typename SHOULD_CUT_THROUGH,
+	typename PREFIX_LENGTH
+>
+void LpfTransport<
+	DelegateType,
+	StreamTransportType,
+	SHOULD_CUT_THROUGH,
+	PREFIX_LENGTH
+>::did_migrate(
+	BaseTransport& transport,
+	core::SocketAddress const &old_addr
+) {
+	dst_addr = transport.dst_addr;
+	transport_manager.rekey(old_addr, dst_addr);
+
+	constexpr bool has_migrate = requires(
+		DelegateType& d,
+		Self& t
+	) {
+		d.did_migrate(t, core::SocketAddress());
+	};
+
+	if constexpr (has_migrate) {
+		delegate->did_migrate(*this, old_addr);
+	}
+}
+
 template<
 	typename DelegateType,
 	template<typename> class StreamTransportType,
@@ -341,14 +480,184 @@ int LpfTransport<
 >::send(
 	core::Buffer &&message
 ) {
-	core::Buffer lpf_message(message.size() + 8);
+	core::Buffer lpf_message(message.size() + prefix_length);
 
-	lpf_message.write_uint64_be_unsafe(0, message.size());
-	lpf_message.write_unsafe(8, message.data(), message.size());
+	write_prefix(lpf_message.data(), message.size());
+	lpf_message.write_unsafe(prefix_length, message.data(), message.size());
 
 	return transport.send(std::move(lpf_message));
 }
 
+template<
+	typename DelegateType,
+	template<typename> class StreamTransportType,
+	typename SHOULD_CUT_THROUGH,
+	typename PREFIX_LENGTH
+>
+int LpfTransport<
+	DelegateType,
+	StreamTransportType,
+	SHOULD_CUT_THROUGH,
+	PREFIX_LENGTH
+>::send(
+	core::SharedBuffer const &message,
+	uint8_t priority,
+	bool fec
+) {
+	if(priority >= num_priorities) {
+		return -1;
+	}
+
+	if(message.size() >= whole_stream_min_size) {
+		auto res = send_whole(message, priority, fec);
+		if(res != -1) {
+			return res;
+		}
+	}
+
+	auto stream_id = priority_stream_id(priority);
+	if(stream_id < 0) {
+		return -1;
+	}
+
+	core::Buffer lpf_header(prefix_length);
+	write_prefix(lpf_header.data(), message.size());
+
+	return transport.send(std::move(lpf_header), message, stream_id);
+}
+
+template<
+	typename DelegateType,
+	template<typename> class StreamTransportType,
+	typename SHOULD_CUT_THROUGH,
+	typename PREFIX_LENGTH
+>
+int LpfTransport<
+	DelegateType,
+	StreamTransportType,
+	SHOULD_CUT_THROUGH,
+	PREFIX_LENGTH
+>::send_whole(
+	core::SharedBuffer const &message [[maybe_unused]],
+	uint8_t priority [[maybe_unused]],
+	bool fec [[maybe_unused]]
+) {
+	constexpr bool has_send_stream = requires(BaseTransport& t) {
+		t.send_stream(core::Buffer(nullptr, 0), core::SharedBuffer(), uint16_t(0), false, uint8_t(0));
+	};
+
+	if constexpr (has_send_stream) {
+		for(uint16_t i = 0; i < max_whole_stream_attempts; i++) {
+			uint16_t stream_id = whole_stream_ids_begin + next_whole_stream_id;
+			next_whole_stream_id = (next_whole_stream_id + 1) % num_whole_stream_ids;
+
+			// The length prefix lets destinations without whole streams read it like the framed streams
+			core::Buffer lpf_header(prefix_length);
+			write_prefix(lpf_header.data(), message.size());
+
+			auto res = transport.send_stream(std::move(lpf_header), message, stream_id, fec, priority);
+			if(res != -1) {
+				return res;
+			}
+		}
+	}
+
+	return -1;
+}
+
+template<
+	typename DelegateType,
+	template<typename> class StreamTransportType,
+	typename SHOULD_CUT_THROUGH,
+	typename PREFIX_LENGTH
+>
+void LpfTransport<
+	DelegateType,
+	StreamTransportType,
+	SHOULD_CUT_THROUGH,
+	PREFIX_LENGTH
+>::write_prefix(uint8_t *out, uint64_t length) {
+	for(uint8_t i = 0; i < prefix_length; i++) {
+		out[i] = length >> (8 * (prefix_length - 1 - i));
+	}
+}
+
+template<
+	typename DelegateType,
+	template<typename> class StreamTransportType,
+	typename SHOULD_CUT_THROUGH,
+	typename PREFIX_LENGTH
+>
+uint64_t LpfTransport<
+	DelegateType,
+	StreamTransportType,
+	SHOULD_CUT_THROUGH,
+	PREFIX_LENGTH
+>::read_prefix(uint8_t const *in) {
+	uint64_t length = 0;
+	for(uint8_t i = 0; i < prefix_length; i++) {
+		length = (length << 8) | in[i];
+	}
+
+	return length;
+}
+
+template<
+	typename DelegateType,
+	template<typename> class StreamTransportType,
+	typename SHOULD_CUT_THROUGH,
+	typename PREFIX_LENGTH
+>
+int LpfTransport<
+	DelegateType,
+	StreamTransportType,
+	SHOULD_CUT_THROUGH,
+	PREFIX_LENGTH
+>::send_datagram(
+	core::SharedBuffer const &message
+) {
+	constexpr bool has_datagram = requires(
+		BaseTransport& t
+	) {
+		t.send_datagram(core::Buffer(nullptr, 0));
+	};
+
+	if constexpr (has_datagram) {
+		core::Buffer bytes(message.size());
+		bytes.write_unsafe(0, message.data(), message.size());
+
+		return transport.send_datagram(std::move(bytes));
+	} else {
+		(void)message;
+		return -1;
+	}
+}
+
+template<
+	typename DelegateType,
+	template<typename> class StreamTransportType,
+	typename SHOULD_CUT_THROUGH,
+	typename PREFIX_LENGTH
+>
+uint16_t LpfTransport<
+	DelegateType,
+	StreamTransportType,
+	SHOULD_CUT_THROUGH,
+	PREFIX_LENGTH
+>::max_datagram_size() {
+	constexpr bool has_datagram = requires(
+		BaseTransport& t
+	) {
+		t.max_datagram_size();
+	};
+
+	if constexpr (has_datagram) {
+		return transport.max_datagram_size();
+	} else {
+		return 0;
+	}
+}
+
 template<
 	typename DelegateType,
 	template<typename> class StreamTransportType,
@@ -379,6 +688,43 @@ int LpfTransport<
 	return 0;
 }
 
+template<
+	typename DelegateType,
+	template<typename> class StreamTransportType,
+	typename SHOULD_CUT_THROUGH,
+	typename PREFIX_LENGTH
+>
+int LpfTransport<
+	DelegateType,
+	StreamTransportType,
+	SHOULD_CUT_THROUGH,
+	PREFIX_LENGTH
+>::cut_through_send(
+	core::SharedBuffer const &message,
+	uint8_t priority,
+	bool fec
+) {
+	// Destinations only cut through on internal transports, whole streams deliver sooner elsewhere
+	if(!should_cut_through || !transport.is_internal()) {
+		return send(message, priority, fec);
+	}
+
+	auto id = cut_through_send_start(message.size(), priority);
+	if(id == 0) {
+		return send(message, priority, fec);
+	}
+
+	auto res = cut_through_send_bytes(id, message);
+
+	if(res < 0) {
+		return res;
+	}
+
+	cut_through_send_end(id);
+
+	return 0;
+}
+
 template<
 	typename DelegateType,
 	template<typename> class StreamTransportType,
@@ -424,6 +770,58 @@ double LpfTransport<
 	return transport.get_rtt();
 }
 
+template<
+	typename DelegateType,
+	template<typename> class StreamTransportType,
+	typename SHOULD_CUT_THROUGH,
+	typename PREFIX_LENGTH
+>
+int LpfTransport<
+	DelegateType,
+	StreamTransportType,
+	SHOULD_CUT_THROUGH,
+	PREFIX_LENGTH
+>::priority_stream_id(uint8_t priority) {
+	if(priority >= num_priorities) {
+		return -1;
+	}
+
+	if(priority == default_priority) {
+		return 0;
+	}
+
+	// Streams 1 to num_priorities, below the cut through streams
+	uint16_t stream_id = 1 + priority;
+	if(set_stream_priority(stream_id, priority) < 0) {
+		return -1;
+	}
+
+	return stream_id;
+}
+
+template<
+	typename DelegateType,
+	template<typename> class StreamTransportType,
+	typename SHOULD_CUT_THROUGH,
+	typename PREFIX_LENGTH
+>
+int LpfTransport<
+	DelegateType,
+	StreamTransportType,
+	SHOULD_CUT_THROUGH,
+	PREFIX_LENGTH
+>::set_stream_priority(uint16_t stream_id [[maybe_unused]], uint8_t priority [[maybe_unused]]) {
+	constexpr bool has_priority = requires(BaseTransport& t) {
+		t.set_priority(uint16_t(0), uint8_t(0));
+	};
+
+	if constexpr (has_priority) {
+		return transport.set_priority(stream_id, priority);
+	} else {
+		return 0;
+	}
+}
+
 template<
 	typename DelegateType,
 	template<typename> class StreamTransportType,
@@ -435,7 +833,11 @@ uint16_t LpfTransport<
 	StreamTransportType,
 	SHOULD_CUT_THROUGH,
 	PREFIX_LENGTH
->::cut_through_send_start(uint64_t length) {
+>::cut_through_send_start(uint64_t length, uint8_t priority) {
+	if(priority >= num_priorities) {
+		return 0;
+	}
+
 	if(cut_through_reserve_ids.size() == 0) {
 		SPDLOG_ERROR(
 			"Lpf {} >>>> {}: Exhausted CTR streams",
@@ -446,6 +848,12 @@ uint16_t LpfTransport<
 	}
 
 	auto id = cut_through_reserve_ids.front();
+
+	// Ids are reused, so the class is set every time
+	if(set_stream_priority(id, priority) < 0) {
+		return 0;
+	}
+
 	cut_through_reserve_ids.pop_front();
 	cut_through_used_ids.insert(id);
 
@@ -456,8 +864,8 @@ uint16_t LpfTransport<
 		id
 	);
 
-	core::Buffer m(8);
-	m.write_uint64_be_unsafe(0, length);
+	core::Buffer m(prefix_length);
+	write_prefix(m.data(), length);
 	auto res = transport.send(std::move(m), id);
 
 	if(res < 0) return 0;
@@ -480,6 +888,21 @@ int LpfTransport<
 	return transport.send(std::move(bytes), id);
 }
 
+template<
+	typename DelegateType,
+	template<typename> class StreamTransportType,
+	typename SHOULD_CUT_THROUGH,
+	typename PREFIX_LENGTH
+>
+int LpfTransport<
+	DelegateType,
+	StreamTransportType,
+	SHOULD_CUT_THROUGH,
+	PREFIX_LENGTH
+>::cut_through_send_bytes(uint16_t id, core::SharedBuffer const &bytes) {
+	return transport.send(core::Buffer(nullptr, 0), bytes, id);
+}
+
 template<
 	typename DelegateType,
 	template<typename> class StreamTransportType,
@@ -3,10 +3,15 @@
 
 #include <marlin/core/Buffer.hpp>
 
+#include <type_traits>
+
 namespace marlin {
 namespace lpf {
 
+template<typename PREFIX_LENGTH = std::integral_constant<uint8_t, 8>>
 class StoreThenForwardBuffer {
+	static constexpr uint8_t prefix_length = PREFIX_LENGTH::value;
+
 	uint8_t *buf = nullptr;
 	uint64_t length = 0;
 	uint64_t size = 0;
@@ -26,16 +31,16 @@ public:
 		if(bytes.size() == 0) return 0;
 
 		if(buf == nullptr) { // Read length
-			if(bytes.size() + size < 8) { // Partial length
+			if(bytes.size() + size < prefix_length) { // Partial length
 				for(size_t i = 0; i < bytes.size(); i++) {
 					length = (length << 8) | bytes.data()[i];
 				}
 				size += bytes.size();
 			} else { // Full length
-				for(size_t i = 0; i < 8 - size; i++) {
+				for(size_t i = 0; i < prefix_length - size; i++) {
 					length = (length << 8) | bytes.data()[i];
 				}
-				bytes.cover_unsafe(8 - size);
+				bytes.cover_unsafe(prefix_length - size);
 
 				if(length > 5000000) { // Abort on big message, DoS prevention
 					SPDLOG_ERROR("Message too big: {}", length);
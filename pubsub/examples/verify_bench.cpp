@@ -0,0 +1,203 @@
+#include <marlin/asyncio/core/WorkerPool.hpp>
+#include <marlin/pubsub/attestation/AttestationRecovery.hpp>
+#include <spdlog/spdlog.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace marlin::core;
+using namespace marlin::asyncio;
+using namespace marlin::pubsub;
+
+// Recovers the signers of stake attestations inline on the loop and on a worker pool, then reports
+// verified messages per second and how long the loop is kept busy per message
+//
+// Usage: verify_bench [messages] [message KB] [threads] [batch]
+
+struct Header {
+	uint8_t const* attestation_data = nullptr;
+	uint64_t attestation_size = 0;
+};
+
+struct Message {
+	uint64_t message_id;
+	uint16_t channel;
+	std::vector<uint8_t> data;
+	uint8_t attestation[81];
+};
+
+struct Job {
+	Message const* message;
+	AttestationRecovery recovery;
+};
+
+static void recover_batch(Job* jobs, size_t count) {
+	thread_local RecoveryContext context;
+
+	for(size_t i = 0; i < count; i++) {
+		auto& message = *jobs[i].message;
+		Header header = {message.attestation, 81};
+		jobs[i].recovery = recover_attestation(
+			context.ctx,
+			message.message_id,
+			message.channel,
+			message.data.data(),
+			message.data.size(),
+			header
+		);
+	}
+}
+
+/// Sign a message the way StakeAttester does
+static void attest(secp256k1_context* ctx, uint8_t const* key, Message& message) {
+	uint64_t timestamp = std::time(nullptr);
+	uint64_t stake_offset = 0;
+	uint64_t message_size = message.data.size();
+
+	for(int i = 0; i < 8; i++) {
+		message.attestation[i] = timestamp >> (56 - 8*i);
+		message.attestation[8+i] = stake_offset >> (56 - 8*i);
+	}
+
+	uint8_t hash[32];
+	CryptoPP::Keccak_256 hasher;
+	hasher.CalculateTruncatedDigest(hash, 32, message.data.data(), message_size);
+
+	hasher.Update((uint8_t*)&message.message_id, 8);
+	hasher.Update((uint8_t*)&message.channel, 2);
+	hasher.Update(message.attestation, 16);
+	hasher.Update((uint8_t*)&message_size, 8);
+	hasher.Update(hash, 32);
+	hasher.TruncatedFinal(hash, 32);
+
+	secp256k1_ecdsa_recoverable_signature sig;
+	secp256k1_ecdsa_sign_recoverable(ctx, &sig, hash, key, nullptr, nullptr);
+
+	int recid;
+	secp256k1_ecdsa_recoverable_signature_serialize_compact(ctx, message.attestation+16, &recid, &sig);
+	message.attestation[80] = (uint8_t)recid;
+}
+
+struct Delegate {
+	/// Address of the signer of all messages
+	uint8_t const* address = nullptr;
+	uint64_t num_verified = 0;
+	uint64_t num_failed = 0;
+
+	void did_recover(Job&& job) {
+		if(job.recovery.is_recovered && std::memcmp(job.recovery.address, address, 20) == 0) {
+			num_verified++;
+		} else {
+			num_failed++;
+		}
+	}
+};
+
+int main(int argc, char** argv) {
+	uint64_t num_messages = argc > 1 ? std::atoll(argv[1]) : 5000;
+	uint64_t message_kb = argc > 2 ? std::atoll(argv[2]) : 100;
+	uint64_t num_threads = argc > 3 ? std::atoll(argv[3]) : 4;
+	uint64_t batch = argc > 4 ? std::atoll(argv[4]) : 32;
+
+	SPDLOG_INFO(
+		"Messages: {}, Size: {} KB, Threads: {}, Batch: {}",
+		num_messages,
+		message_kb,
+		num_threads,
+		batch
+	);
+
+	std::mt19937_64 gen(1);
+	auto* ctx_signer = secp256k1_context_create(SECP256K1_CONTEXT_SIGN);
+
+	uint8_t key[32];
+	do {
+		for(auto& byte : key) {
+			byte = gen();
+		}
+	} while(secp256k1_ec_seckey_verify(ctx_signer, key) != 1);
+
+	// Address recoveries are checked against
+	secp256k1_pubkey pubkey;
+	secp256k1_ec_pubkey_create(ctx_signer, &pubkey, key);
+	uint8_t address[32];
+	CryptoPP::Keccak_256 hasher;
+	hasher.CalculateTruncatedDigest(address, 32, pubkey.data, 64);
+
+	std::vector<Message> messages(num_messages);
+	for(uint64_t i = 0; i < num_messages; i++) {
+		messages[i].message_id = gen();
+		messages[i].channel = 0;
+		messages[i].data.resize(message_kb * 1000);
+		for(auto& byte : messages[i].data) {
+			byte = i;
+		}
+		attest(ctx_signer, key, messages[i]);
+	}
+	secp256k1_context_destroy(ctx_signer);
+
+	using Clock = std::chrono::steady_clock;
+	auto ms = [](Clock::duration d) {
+		return std::chrono::duration<double, std::milli>(d).count();
+	};
+
+	// Inline, the loop does all the work
+	{
+		Delegate d;
+		d.address = address + 12;
+
+		auto start = Clock::now();
+		for(auto& message : messages) {
+			Job job = {&message, {}};
+			recover_batch(&job, 1);
+			d.did_recover(std::move(job));
+		}
+		auto elapsed = ms(Clock::now() - start);
+
+		SPDLOG_INFO(
+			"Inline: {} verified, {} failed, {:.0f} messages/s, loop busy {:.1f} us per message",
+			d.num_verified,
+			d.num_failed,
+			num_messages * 1000 / elapsed,
+			elapsed * 1000 / num_messages
+		);
+	}
+
+	// Worker pool, the loop only queues messages and takes results back
+	{
+		EventLoop loop;
+		loop.make_current();
+
+		Delegate d;
+		d.address = address + 12;
+		auto* pool = new WorkerPool<Job>(num_threads, batch, recover_batch);
+		pool->setup<Delegate, &Delegate::did_recover>(&d);
+
+		auto start = Clock::now();
+		for(auto& message : messages) {
+			pool->submit(Job{&message, {}});
+		}
+		auto queueing = ms(Clock::now() - start);
+
+		while(pool->pending() > 0) {
+			// Waiting is idle time the loop could spend on other peers
+			uv_run(EventLoop::loop(), UV_RUN_ONCE);
+		}
+		auto elapsed = ms(Clock::now() - start);
+
+		SPDLOG_INFO(
+			"Pool: {} verified, {} failed, {:.0f} messages/s, loop busy queueing {:.1f} us per message",
+			d.num_verified,
+			d.num_failed,
+			num_messages * 1000 / elapsed,
+			queueing * 1000 / num_messages
+		);
+
+		delete pool;
+	}
+
+	return 0;
+}
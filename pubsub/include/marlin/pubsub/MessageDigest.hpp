@@ -0,0 +1,75 @@
+#ifndef MARLIN_PUBSUB_MESSAGEDIGEST_HPP
+#define MARLIN_PUBSUB_MESSAGEDIGEST_HPP
+
+#include <stdint.h>
+#include <cstring>
+
+#include <cryptopp/blake2.h>
+#include <cryptopp/keccak.h>
+
+
+namespace marlin {
+namespace pubsub {
+
+/// Digests of a message body, each computed the first time it is asked for
+///
+/// Travels with the message header so that the attester, witnesser, abci and delegate handling a
+/// message on a hop share one pass over its bytes per hash function.
+struct MessageDigest {
+	bool has_keccak256 = false;
+	bool has_blake2b64 = false;
+	uint8_t keccak256_digest[32];
+	uint64_t blake2b64_digest;
+
+	/// Keccak-256 of the message, as used for attestations
+	uint8_t const* keccak256(uint8_t const* data, uint64_t size) {
+		if(!has_keccak256) {
+			CryptoPP::Keccak_256 hasher;
+			hasher.CalculateTruncatedDigest(keccak256_digest, 32, data, size);
+			has_keccak256 = true;
+		}
+
+		return keccak256_digest;
+	}
+
+	/// Record a Keccak-256 computed elsewhere
+	void set_keccak256(uint8_t const* digest) {
+		std::memcpy(keccak256_digest, digest, 32);
+		has_keccak256 = true;
+	}
+
+	/// 64 bit BLAKE2b of the message, as used for message ids
+	uint64_t blake2b64(uint8_t const* data, uint64_t size) {
+		if(!has_blake2b64) {
+			blake2b64_digest = compute_blake2b64(data, size);
+			has_blake2b64 = true;
+		}
+
+		return blake2b64_digest;
+	}
+
+	static uint64_t compute_blake2b64(uint8_t const* data, uint64_t size) {
+		CryptoPP::BLAKE2b blake2b((uint)8);
+		blake2b.Update(data, size);
+		uint64_t digest;
+		blake2b.TruncatedFinal((uint8_t*)&digest, 8);
+
+		return digest;
+	}
+};
+
+/// Keccak-256 of a message, reusing and caching the digest in headers which carry one
+template<typename HeaderType>
+void message_keccak256(HeaderType& header, uint8_t const* data, uint64_t size, uint8_t* out) {
+	if constexpr (requires { header.digest.keccak256(data, size); }) {
+		std::memcpy(out, header.digest.keccak256(data, size), 32);
+	} else {
+		CryptoPP::Keccak_256 hasher;
+		hasher.CalculateTruncatedDigest(out, 32, data, size);
+	}
+}
+
+} // namespace pubsub
+} // namespace marlin
+
+#endif // MARLIN_PUBSUB_MESSAGEDIGEST_HPP
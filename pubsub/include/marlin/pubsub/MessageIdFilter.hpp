@@ -0,0 +1,170 @@
+#ifndef MARLIN_PUBSUB_MESSAGEIDFILTER_HPP
+#define MARLIN_PUBSUB_MESSAGEIDFILTER_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace marlin {
+namespace pubsub {
+
+/// Remembers recently seen message ids in a fixed amount of memory
+///
+/// Ids are kept as fingerprints in a ring of open addressed tables, one per generation. New ids go
+/// into the newest table. Rotating drops the oldest table in one go, ids are forgotten after living
+/// through as many rotations as there are generations. A generation which fills up before it is
+/// rotated out rotates early, so bursts shorten how long ids are remembered instead of growing memory.
+///
+/// Distinct ids can share a fingerprint, which makes an unseen id look seen now and then. The table
+/// load is capped so that this happens at most at the configured rate, budgets too tight for the
+/// fingerprint width bottom out at a load of 1 in 20.
+template<typename FingerprintType = uint32_t>
+class MessageIdFilter {
+	static_assert(std::numeric_limits<FingerprintType>::is_integer && !std::numeric_limits<FingerprintType>::is_signed);
+
+	/// Fingerprints of all generations back to back, 0 marks an empty slot
+	std::vector<FingerprintType> slots;
+	size_t num_generations;
+	/// Slots of a generation, a power of two
+	size_t capacity;
+	/// Ids a generation takes before it rotates early
+	size_t max_size;
+
+	/// Index of the newest generation
+	size_t current = 0;
+	/// Ids in the newest generation
+	size_t current_size = 0;
+
+	uint64_t seed;
+
+	static uint64_t mix(uint64_t x) {
+		// splitmix64 finalizer, ids can be chosen by peers and are not trusted to be random
+		x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9;
+		x = (x ^ (x >> 27)) * 0x94d049bb133111eb;
+		return x ^ (x >> 31);
+	}
+
+	uint64_t hash(uint64_t message_id) const {
+		return mix(message_id ^ seed);
+	}
+
+	static FingerprintType fingerprint(uint64_t hash) {
+		auto fp = FingerprintType(hash >> (64 - std::numeric_limits<FingerprintType>::digits));
+		return fp == 0 ? 1 : fp;
+	}
+
+	bool contains_in(size_t generation, uint64_t hash) const {
+		auto fp = fingerprint(hash);
+		auto* table = slots.data() + generation * capacity;
+
+		for(size_t idx = hash & (capacity - 1);; idx = (idx + 1) & (capacity - 1)) {
+			if(table[idx] == 0) {
+				return false;
+			}
+			if(table[idx] == fp) {
+				return true;
+			}
+		}
+	}
+
+public:
+	/// Largest table load, probes get long past it whatever the budget allows
+	static constexpr double max_load_factor = 0.5;
+
+	/// \param ids_per_generation Ids a generation is sized for
+	/// \param num_generations Generations ids live through
+	/// \param false_positive_rate Rate at which unseen ids may look seen
+	/// \param seed Hash seed, random per node so peers cannot aim ids at the same slots
+	MessageIdFilter(
+		size_t ids_per_generation,
+		size_t num_generations,
+		double false_positive_rate,
+		uint64_t seed
+	) : num_generations(std::max<size_t>(num_generations, 2)), seed(seed) {
+		// A lookup compares against every occupied slot of the probe run in every generation. With
+		// linear probing a miss runs over ((1 / (1 - load))^2 - 1) / 2 of them on average, each
+		// matching with probability 2^-bits.
+		double fingerprints = std::ldexp(1.0, std::numeric_limits<FingerprintType>::digits);
+		double run = 2 * false_positive_rate * fingerprints / this->num_generations;
+		double load = std::clamp(1 - 1 / std::sqrt(1 + run), 0.05, max_load_factor);
+
+		capacity = 16;
+		while(capacity * load < ids_per_generation) {
+			capacity *= 2;
+		}
+		max_size = std::max<size_t>(capacity * load, 1);
+
+		slots.assign(this->num_generations * capacity, 0);
+	}
+
+	MessageIdFilter(MessageIdFilter const&) = delete;
+	MessageIdFilter(MessageIdFilter&&) = default;
+	MessageIdFilter& operator=(MessageIdFilter&&) = default;
+
+	/// Has the id been seen within the retained generations?
+	bool contains(uint64_t message_id) const {
+		auto h = hash(message_id);
+		for(size_t gen = 0; gen < num_generations; gen++) {
+			if(contains_in(gen, h)) {
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	/// Remember the id, false if it was seen already
+	bool insert(uint64_t message_id) {
+		auto h = hash(message_id);
+		for(size_t gen = 0; gen < num_generations; gen++) {
+			if(contains_in(gen, h)) {
+				return false;
+			}
+		}
+
+		if(current_size >= max_size) {
+			rotate();
+		}
+
+		auto fp = fingerprint(h);
+		auto* table = slots.data() + current * capacity;
+		auto idx = h & (capacity - 1);
+		while(table[idx] != 0) {
+			idx = (idx + 1) & (capacity - 1);
+		}
+		table[idx] = fp;
+		current_size++;
+
+		return true;
+	}
+
+	/// Start a new generation in place of the oldest one, forgetting its ids
+	void rotate() {
+		current = (current + 1) % num_generations;
+		std::fill_n(slots.begin() + current * capacity, capacity, 0);
+		current_size = 0;
+	}
+
+	/// Ids in the newest generation
+	size_t size() const {
+		return current_size;
+	}
+
+	/// Ids a generation takes before it rotates early
+	size_t generation_size() const {
+		return max_size;
+	}
+
+	/// Bytes taken by the tables
+	size_t memory() const {
+		return slots.size() * sizeof(FingerprintType);
+	}
+};
+
+} // namespace pubsub
+} // namespace marlin
+
+#endif // MARLIN_PUBSUB_MESSAGEIDFILTER_HPP
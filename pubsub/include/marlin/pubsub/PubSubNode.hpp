@@ -6,6 +6,8 @@
 #define MARLIN_PUBSUB_PUBSUBNODE_HPP
 
 #include <marlin/asyncio/core/Timer.hpp>
+#include <marlin/asyncio/core/ShardChannel.hpp>
+#include <marlin/asyncio/core/WorkerPool.hpp>
 #include <marlin/asyncio/tcp/TcpOutFiber.hpp>
 #include <marlin/core/fibers/DynamicFramingFiber.hpp>
 #include <marlin/core/fibers/SentinelFramingFiber.hpp>
@@ -16,6 +18,7 @@
 #include <marlin/asyncio/tcp/TcpTransportFactory.hpp>
 #include <marlin/stream/StreamTransportFactory.hpp>
 #include <marlin/lpf/LpfTransportFactory.hpp>
+#include <marlin/core/SharedBuffer.hpp>
 
 #include <algorithm>
 #include <map>
@@ -27,6 +30,9 @@
 #include <random>
 #include <unordered_set>
 #include <tuple>
+#include <deque>
+#include <memory>
+#include <variant>
 
 #include <secp256k1_recovery.h>
 #include <cryptopp/keccak.h>
@@ -34,6 +40,8 @@
 #include <rapidjson/document.h>
 
 #include "marlin/pubsub/PubSubTransportSet.hpp"
+#include "marlin/pubsub/MessageIdFilter.hpp"
+#include "marlin/pubsub/MessageDigest.hpp"
 #include "marlin/pubsub/DefaultAbci.hpp"
 #include "marlin/pubsub/attestation/EmptyAttester.hpp"
 #include "marlin/pubsub/witness/EmptyWitnesser.hpp"
@@ -110,7 +118,7 @@ struct StakeRequester {
 		SPDLOG_DEBUG("DNS timer hit: {}", dst.to_string());
 		uv_getaddrinfo_t* req = new uv_getaddrinfo_t();
 		req->data = this;
-		auto res = uv_getaddrinfo(uv_default_loop(), req, [](uv_getaddrinfo_t* req, int, addrinfo* res) {
+		auto res = uv_getaddrinfo(asyncio::EventLoop::loop(), req, [](uv_getaddrinfo_t* req, int, addrinfo* res) {
 			auto& sr = *(StakeRequester*)req->data;
 			if(res != nullptr) {
 				auto addr = core::SocketAddress(*res->ai_addr);
@@ -358,6 +366,23 @@ struct MessageHeader {
 	uint64_t attestation_size = 0;
 	uint8_t const* witness_data = nullptr;
 	uint64_t witness_size = 0;
+	/// Digests of the message body computed so far on this hop
+	MessageDigest digest = {};
+};
+
+/// Signer recovery result of attesters which can verify off the loop, nothing for the others
+template<typename AttesterType>
+struct AttesterRecovery {
+	using type = std::monostate;
+};
+
+template<typename AttesterType>
+requires requires {
+	typename AttesterType::Recovery;
+	typename AttesterType::Verifier;
+}
+struct AttesterRecovery<AttesterType> {
+	using type = typename AttesterType::Recovery;
 };
 
 //! Class containing the Pub-Sub functionality
@@ -383,8 +408,30 @@ private:
 	size_t max_sol_conns;
 	size_t max_unsol_conns;
 	static constexpr uint64_t DefaultMsgIDTimerInterval = 10000;
+	/// Message id timer ticks between message id generations
+	static constexpr uint64_t DefaultMsgIDRotateTicks = 64;
+	static constexpr size_t DefaultMsgIDGenerations = 4;
+	static constexpr size_t DefaultMsgIDsPerGeneration = 1 << 18;
+	static constexpr double DefaultMsgIDFalsePositiveRate = 1e-6;
+	/// Large messages go out with forward error correction unless turned off for their channel
+	static constexpr bool DefaultFec = true;
 	static constexpr uint64_t DefaultPeerSelectTimerInterval = 60000;
 	static constexpr uint64_t DefaultBlacklistTimerInterval = 600000;
+	static constexpr size_t DefaultVerifyThreads = 2;
+	static constexpr size_t DefaultVerifyBatch = 32;
+	/// Messages and bytes queued for verification at once, messages past either are verified inline
+	static constexpr size_t DefaultMaxVerifyJobs = 4096;
+	static constexpr uint64_t DefaultMaxVerifyBytes = 128000000;
+	/// Share of the verification queue a single peer may take
+	static constexpr size_t DefaultMaxPeerVerifyJobs = 256;
+	static constexpr uint64_t DefaultMaxPeerVerifyBytes = 16000000;
+	static constexpr uint64_t DefaultLazyPushTimerInterval = 500;
+	/// Lazy push timer ticks an announced message is served for
+	static constexpr uint64_t DefaultAnnouncedTicks = 60;
+	static constexpr size_t DefaultMaxAnnounced = 64;
+	/// Lazy push timer ticks to wait for a requested message before asking another peer
+	static constexpr uint64_t DefaultWantTicks = 4;
+	static constexpr size_t DefaultMaxWantSources = 8;
 //---------------- Transport types ----------------//
 public:
 	using ClientKey = std::array<uint8_t, 20>;
@@ -457,6 +504,13 @@ public:
 	std::unordered_set<core::SocketAddress> blacklist_addr;
 	// TransportSet unsol_standby_conns;
 
+	/// Priority class of each channel, channels not in here use the default
+	std::unordered_map<uint16_t, uint8_t> channel_priorities;
+	/// Channels whose messages go out as datagrams when they fit, lost ones are not sent again
+	std::unordered_set<uint16_t> loss_tolerant_channels;
+	/// Forward error correction setting of each channel, channels not in here use DefaultFec
+	std::unordered_map<uint16_t, bool> channel_fec;
+
 	void send_SUBSCRIBE(BaseTransport &transport, uint16_t channel);
 	void send_UNSUBSCRIBE(BaseTransport &transport, uint16_t channel);
 
@@ -540,6 +594,11 @@ private:
 	void did_recv_HEARTBEAT(BaseTransport &transport, core::Buffer &&message);
 	void send_HEARTBEAT(BaseTransport &transport);
 
+	int did_recv_IHAVE(BaseTransport &transport, core::Buffer &&message);
+	void send_IHAVE(BaseTransport &transport, uint16_t channel, uint64_t message_id, uint64_t size);
+	int did_recv_IWANT(BaseTransport &transport, core::Buffer &&message);
+	void send_IWANT(BaseTransport &transport, uint64_t message_id);
+
 //---------------- Base layer ----------------//
 public:
 	// Listen delegate
@@ -611,13 +670,27 @@ public:
 		core::SocketAddress const *excluded = nullptr,
 		MessageHeaderType prev_header = {}
 	);
+	/// Send a serialized MESSAGE, shared across all recipients of a fan-out
 	void send_message_with_cut_through_check(
 		BaseTransport *transport,
 		uint16_t channel,
 		uint64_t message_id,
-		const uint8_t *data,
-		uint64_t size,
-		MessageHeaderType prev_header = {}
+		core::SharedBuffer const &message
+	);
+	/// Send messages of the given channel in a priority class, lower classes go out first.
+	/// Returns -1 for classes the transport does not have.
+	int set_channel_priority(uint16_t channel, uint8_t priority);
+	/// Send messages of the given channel which fit in a packet as datagrams, trading reliability for latency
+	void set_channel_loss_tolerant(uint16_t channel, bool loss_tolerant = true);
+	/// Send large messages of the given channel with repair packets, peers rebuild lost packets from
+	/// them instead of waiting a round trip for retransmissions
+	void set_channel_fec(uint16_t channel, bool fec);
+	/// Send a serialized MESSAGE to the peers of this shard
+	void fan_out_message(
+		uint16_t channel,
+		uint64_t message_id,
+		core::SharedBuffer const &message,
+		core::SocketAddress const *excluded
 	);
 
 	void subscribe(ClientKey client_key, core::SocketAddress const &addr, uint8_t const *remote_static_pk);
@@ -649,27 +722,24 @@ private:
 
 //---------------- Message deduplication ----------------//
 public:
+	/// Rate at which unseen message ids may be taken for duplicates and dropped, lower rates take
+	/// more memory. Starts at DefaultMsgIDFalsePositiveRate, ids seen so far are forgotten.
+	void set_message_id_false_positive_rate(double false_positive_rate);
 private:
 	std::uniform_int_distribution<uint64_t> message_id_dist;
 	std::mt19937_64 message_id_gen;
 
 	// Message id history for deduplication
-	std::vector<std::vector<uint64_t>> message_id_events;
-	uint8_t message_id_idx = 0;
-	std::unordered_set<uint64_t> message_id_set;
+	MessageIdFilter<> message_id_filter;
+	uint64_t message_id_ticks = 0;
 
 	asyncio::Timer message_id_timer;
 
 	void message_id_timer_cb() {
-		// Overflow behaviour desirable
-		this->message_id_idx++;
-
-		for (
-			auto iter = this->message_id_events[this->message_id_idx].begin();
-			iter != this->message_id_events[this->message_id_idx].end();
-			iter = this->message_id_events[this->message_id_idx].erase(iter)
-		) {
-			this->message_id_set.erase(*iter);
+		// Ids are remembered for DefaultMsgIDGenerations - 1 to DefaultMsgIDGenerations rotations
+		this->message_id_ticks++;
+		if(this->message_id_ticks % DefaultMsgIDRotateTicks == 0) {
+			this->message_id_filter.rotate();
 		}
 
 		for(auto& [_, conns] : conn_map) {
@@ -696,6 +766,130 @@ private:
 		// );
 	}
 
+//---------------- Sharding ----------------//
+public:
+	/// Serialized MESSAGE handed over by another shard of the same node
+	struct ShardMessage {
+		uint16_t channel;
+		uint64_t message_id;
+		core::SharedBuffer message;
+		bool has_excluded = false;
+		core::SocketAddress excluded;
+	};
+	using ShardChannelType = asyncio::ShardChannel<ShardMessage>;
+
+	/// Receives messages from the other shards, lives on the loop of this node
+	ShardChannelType shard_inbox;
+
+	/// Forward every message sent by this node to the inbox of another shard
+	void add_shard_peer(ShardChannelType &inbox) {
+		shard_peers.push_back(&inbox);
+	}
+private:
+	std::vector<ShardChannelType*> shard_peers;
+
+	void did_recv_shard_message(ShardMessage &&message);
+
+//---------------- Attestation verification ----------------//
+public:
+	/// Can the attester recover signers off the loop?
+	static constexpr bool has_async_verify = !std::is_same_v<
+		typename AttesterRecovery<AttesterType>::type,
+		std::monostate
+	>;
+
+	/// Messages waiting on or undergoing verification
+	size_t get_verify_pending() {
+		return verify_pool ? verify_pool->pending() : 0;
+	}
+private:
+	/// MESSAGE whose attestation is being verified on a worker
+	struct VerifyJob {
+		/// Sender, looked up again once verified as it might have gone away
+		core::SocketAddress addr;
+		uint64_t message_id;
+		uint16_t channel;
+		/// Message data, the header points into it
+		core::Buffer bytes;
+		MessageHeaderType header;
+		typename AttesterRecovery<AttesterType>::type recovery;
+	};
+	using VerifyPoolType = asyncio::WorkerPool<VerifyJob>;
+
+	/// Copies of a message which arrive while one is verified wait for its outcome, at most this many
+	static constexpr size_t MaxParkedCopies = 4;
+
+	std::unique_ptr<VerifyPoolType> verify_pool;
+	/// Messages being verified by id, with copies from other peers to try if verification fails
+	std::unordered_map<uint64_t, std::deque<VerifyJob>> verifying;
+
+	/// Verification work queued on behalf of a peer, waiting copies included
+	struct VerifyCharge {
+		size_t jobs = 0;
+		uint64_t bytes = 0;
+	};
+	std::unordered_map<core::SocketAddress, VerifyCharge> verify_charges;
+	/// Sum of verify_charges
+	VerifyCharge verify_total;
+
+	/// Charge a message to its sender, false if the sender or the node would go over its share
+	bool charge_verify(core::SocketAddress const &addr, uint64_t size);
+	/// Release the charge of a message which is no longer queued
+	void release_verify(core::SocketAddress const &addr, uint64_t size);
+	/// Stop verifying a message, dropping copies still waiting
+	void erase_verifying(uint64_t message_id);
+
+	/// Recover signers of a batch on a worker, the context is kept for the life of the worker
+	static void verify_batch(VerifyJob* jobs, size_t count);
+	void did_verify_MESSAGE(VerifyJob &&job);
+	/// Verify the next waiting copy of a message whose verification did not go through
+	void verify_next_copy(uint64_t message_id);
+
+	/// Relay and deliver a message whose attestation checked out
+	void did_accept_MESSAGE(
+		BaseTransport &transport,
+		core::Buffer &&bytes,
+		uint64_t message_id,
+		uint16_t channel,
+		MessageHeaderType header
+	);
+
+//---------------- Lazy push ----------------//
+public:
+	/// Announce messages of at least threshold bytes to solicited peers instead of sending them, peers
+	/// ask for the ones they still need. eager_fan_out of the peers, picked at random, are sent the
+	/// message outright. Unsolicited peers are always sent messages outright. Peers have to understand
+	/// announcements, 0 turns them off.
+	void set_lazy_push(uint64_t threshold, size_t eager_fan_out);
+private:
+	uint64_t lazy_push_threshold = 0;
+	size_t lazy_push_fan_out = 0;
+
+	/// Message announced to peers, kept until they have asked for it or for DefaultAnnouncedTicks
+	struct AnnouncedMessage {
+		uint16_t channel;
+		core::SharedBuffer message;
+		uint64_t tick;
+		/// Peers it was announced to and not sent to yet
+		std::vector<core::SocketAddress> pending;
+	};
+	std::unordered_map<uint64_t, AnnouncedMessage> announced;
+	/// Announced message ids, oldest first
+	std::deque<uint64_t> announced_order;
+
+	/// Message announced by peers and asked for
+	struct WantedMessage {
+		uint64_t tick;
+		/// Other peers which announced it, asked in turn if it does not show up
+		std::deque<core::SocketAddress> sources;
+	};
+	std::unordered_map<uint64_t, WantedMessage> wanted;
+
+	uint64_t lazy_push_ticks = 0;
+	asyncio::Timer lazy_push_timer;
+
+	void lazy_push_timer_cb();
+
 //---------------- Cut through ----------------//
 public:
 	void cut_through_recv_start(BaseTransport &transport, uint16_t id, uint64_t length);
@@ -1004,7 +1198,7 @@ int PUBSUBNODETYPE::did_recv_MESSAGE(
 	}
 
 	// Send it onward
-	if(message_id_set.find(message_id) == message_id_set.end()) { // Deduplicate message
+	if(!message_id_filter.contains(message_id)) { // Deduplicate message
 		bytes.cover_unsafe(10);
 		MessageHeaderType header = {};
 
@@ -1042,41 +1236,71 @@ int PUBSUBNODETYPE::did_recv_MESSAGE(
 			return -1;
 		}
 
+		if constexpr (has_async_verify) {
+			// Stale attestations are turned away before they take up a worker
+			if(!attester.check_timestamp(header)) {
+				SPDLOG_ERROR("Attestation verification failed");
+				transport.close();
+				return -1;
+			}
+
+			auto iter = verifying.find(message_id);
+			if(iter != verifying.end()) {
+				// Another copy is being verified, this one is only needed if that one fails
+				if(iter->second.size() < MaxParkedCopies && charge_verify(transport.dst_addr, bytes.size())) {
+					iter->second.push_back({transport.dst_addr, message_id, channel, std::move(bytes), header, {}});
+				}
+				return 0;
+			}
+
+			if(charge_verify(transport.dst_addr, bytes.size())) {
+				verifying.try_emplace(message_id);
+				verify_pool->submit({transport.dst_addr, message_id, channel, std::move(bytes), header, {}});
+				return 0;
+			}
+
+			// Over its share of the queue, verified inline so that a flooding peer is held to the verify rate
+		}
+
 		if(!attester.verify(message_id, channel, bytes.data(), bytes.size(), header)) {
 			SPDLOG_ERROR("Attestation verification failed");
 			transport.close();
 			return -1;
 		}
 
-		message_id_set.insert(message_id);
-		message_id_events[message_id_idx].push_back(message_id);
+		did_accept_MESSAGE(transport, std::move(bytes), message_id, channel, header);
+	}
 
-		if constexpr (enable_relay) {
-			if(!transport.is_internal()) {
-				if(is_abci_active) {
-					abci.analyze_block(std::move(bytes), message_id, channel, header, &transport);
-				} else {
-					SPDLOG_ERROR("Abci not active, dropping block");
-				}
-			} else {
-				send_message_on_channel_impl(
-					channel,
-					message_id,
-					bytes.data(),
-					bytes.size(),
-					&transport.dst_addr,
-					header
-				);
+	return 0;
+}
 
-				delegate->did_recv(
-					*this,
-					std::move(bytes),
-					header,
-					channel,
-					message_id
-				);
+template<PUBSUBNODE_TEMPLATE>
+void PUBSUBNODETYPE::did_accept_MESSAGE(
+	BaseTransport &transport,
+	core::Buffer &&bytes,
+	uint64_t message_id,
+	uint16_t channel,
+	MessageHeaderType header
+) {
+	message_id_filter.insert(message_id);
+
+	if constexpr (enable_relay) {
+		if(!transport.is_internal()) {
+			if(is_abci_active) {
+				abci.analyze_block(std::move(bytes), message_id, channel, header, &transport);
+			} else {
+				SPDLOG_ERROR("Abci not active, dropping block");
 			}
 		} else {
+			send_message_on_channel_impl(
+				channel,
+				message_id,
+				bytes.data(),
+				bytes.size(),
+				&transport.dst_addr,
+				header
+			);
+
 			delegate->did_recv(
 				*this,
 				std::move(bytes),
@@ -1085,9 +1309,136 @@ int PUBSUBNODETYPE::did_recv_MESSAGE(
 				message_id
 			);
 		}
+	} else {
+		delegate->did_recv(
+			*this,
+			std::move(bytes),
+			header,
+			channel,
+			message_id
+		);
 	}
+}
 
-	return 0;
+template<PUBSUBNODE_TEMPLATE>
+void PUBSUBNODETYPE::verify_batch(VerifyJob* jobs, size_t count) {
+	if constexpr (has_async_verify) {
+		thread_local typename AttesterType::Verifier verifier;
+
+		for(size_t i = 0; i < count; i++) {
+			auto& job = jobs[i];
+			job.recovery = AttesterType::recover(
+				verifier.ctx,
+				job.message_id,
+				job.channel,
+				job.bytes.data(),
+				job.bytes.size(),
+				job.header
+			);
+		}
+	}
+}
+
+template<PUBSUBNODE_TEMPLATE>
+void PUBSUBNODETYPE::did_verify_MESSAGE(VerifyJob &&job) {
+	if constexpr (has_async_verify) {
+		release_verify(job.addr, job.bytes.size());
+
+		// Got here through another path in the meantime, checking again would count its stake twice
+		if(message_id_filter.contains(job.message_id)) {
+			erase_verifying(job.message_id);
+			return;
+		}
+
+		// Sender went away, its copy cannot be relayed on its behalf
+		auto* transport = f.get_transport(job.addr);
+		if(transport == nullptr) {
+			verify_next_copy(job.message_id);
+			return;
+		}
+
+		if(!attester.verify_recovered(
+			job.message_id,
+			job.channel,
+			job.bytes.size(),
+			job.header,
+			job.recovery
+		)) {
+			SPDLOG_ERROR("Attestation verification failed");
+			transport->close();
+			verify_next_copy(job.message_id);
+			return;
+		}
+
+		erase_verifying(job.message_id);
+		did_accept_MESSAGE(*transport, std::move(job.bytes), job.message_id, job.channel, job.header);
+	}
+}
+
+template<PUBSUBNODE_TEMPLATE>
+void PUBSUBNODETYPE::verify_next_copy(uint64_t message_id) {
+	auto iter = verifying.find(message_id);
+	if(iter == verifying.end()) {
+		return;
+	}
+
+	if(iter->second.empty()) {
+		verifying.erase(iter);
+		return;
+	}
+
+	verify_pool->submit(std::move(iter->second.front()));
+	iter->second.pop_front();
+}
+
+template<PUBSUBNODE_TEMPLATE>
+bool PUBSUBNODETYPE::charge_verify(core::SocketAddress const &addr, uint64_t size) {
+	if(verify_total.jobs >= DefaultMaxVerifyJobs || verify_total.bytes + size > DefaultMaxVerifyBytes) {
+		return false;
+	}
+
+	auto &charge = verify_charges[addr];
+	if(charge.jobs >= DefaultMaxPeerVerifyJobs || charge.bytes + size > DefaultMaxPeerVerifyBytes) {
+		if(charge.jobs == 0) {
+			verify_charges.erase(addr);
+		}
+		return false;
+	}
+
+	charge.jobs++;
+	charge.bytes += size;
+	verify_total.jobs++;
+	verify_total.bytes += size;
+
+	return true;
+}
+
+template<PUBSUBNODE_TEMPLATE>
+void PUBSUBNODETYPE::release_verify(core::SocketAddress const &addr, uint64_t size) {
+	auto iter = verify_charges.find(addr);
+	if(iter != verify_charges.end()) {
+		iter->second.jobs--;
+		iter->second.bytes -= size;
+		if(iter->second.jobs == 0) {
+			verify_charges.erase(iter);
+		}
+	}
+
+	verify_total.jobs--;
+	verify_total.bytes -= size;
+}
+
+template<PUBSUBNODE_TEMPLATE>
+void PUBSUBNODETYPE::erase_verifying(uint64_t message_id) {
+	auto iter = verifying.find(message_id);
+	if(iter == verifying.end()) {
+		return;
+	}
+
+	for(auto &copy : iter->second) {
+		release_verify(copy.addr, copy.bytes.size());
+	}
+	verifying.erase(iter);
 }
 
 template<PUBSUBNODE_TEMPLATE>
@@ -1232,6 +1583,176 @@ void PUBSUBNODETYPE::send_HEARTBEAT(
 	transport.send(std::move(m));
 }
 
+//! Callback on receipt of a message announcement
+/*!
+	\li asks the announcing peer for messages not seen yet
+	\li remembers other peers announcing a message already asked for, in case it does not show up
+*/
+template<PUBSUBNODE_TEMPLATE>
+int PUBSUBNODETYPE::did_recv_IHAVE(
+	BaseTransport &transport,
+	core::Buffer &&bytes
+) {
+	// Bounds check on header
+	if(bytes.size() < 18) {
+		transport.close();
+		return -1;
+	}
+
+	auto message_id = bytes.read_uint64_be_unsafe(0);
+	[[maybe_unused]] auto channel = bytes.read_uint16_be_unsafe(8);
+	[[maybe_unused]] auto size = bytes.read_uint64_be_unsafe(10);
+
+	SPDLOG_DEBUG(
+		"Pubsub {} <<<< {}: IHAVE message id: {}, channel: {}, size: {}",
+		transport.src_addr.to_string(),
+		transport.dst_addr.to_string(),
+		message_id,
+		channel,
+		size
+	);
+
+	if(message_id_filter.contains(message_id) || verifying.count(message_id) > 0) {
+		return 0;
+	}
+
+	auto [iter, res] = wanted.try_emplace(message_id);
+	if(!res) {
+		// Asked someone already
+		if(iter->second.sources.size() < DefaultMaxWantSources) {
+			iter->second.sources.push_back(transport.dst_addr);
+		}
+		return 0;
+	}
+
+	iter->second.tick = lazy_push_ticks;
+	send_IWANT(transport, message_id);
+
+	return 0;
+}
+
+/*!
+	\verbatim
+
+	IHAVE (0x05)
+
+	Announces a message without its data, peers which do not have it yet ask for it with IWANT.
+
+	FORMAT:
+
+	 0               1               2               3
+	 0 1 2 3 4 5 6 7 0 1 2 3 4 5 6 7 0 1 2 3 4 5 6 7 0 1 2 3 4 5 6 7
+	+++++++++++++++++++++++++++++++++
+	|      0x00     |      0x05     |
+	-----------------------------------------------------------------
+	|                                                               |
+	----                        Message ID                       ----
+	|                                                               |
+	-----------------------------------------------------------------
+	|            Channel            |
+	-----------------------------------------------------------------
+	|                                                               |
+	----                       Message Length                    ----
+	|                                                               |
+	+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+	\endverbatim
+*/
+template<PUBSUBNODE_TEMPLATE>
+void PUBSUBNODETYPE::send_IHAVE(
+	BaseTransport &transport,
+	uint16_t channel,
+	uint64_t message_id,
+	uint64_t size
+) {
+	core::Buffer m({5}, 19);
+	m.write_uint64_be_unsafe(1, message_id);
+	m.write_uint16_be_unsafe(9, channel);
+	m.write_uint64_be_unsafe(11, size);
+
+	transport.send(std::move(m));
+}
+
+//! Callback on receipt of a request for an announced message
+/*!
+	Sends the message if it was announced to the peer and not sent to it yet, the peer asks
+	someone else for messages which are not around any more.
+*/
+template<PUBSUBNODE_TEMPLATE>
+int PUBSUBNODETYPE::did_recv_IWANT(
+	BaseTransport &transport,
+	core::Buffer &&bytes
+) {
+	// Bounds check on header
+	if(bytes.size() < 8) {
+		transport.close();
+		return -1;
+	}
+
+	auto message_id = bytes.read_uint64_be_unsafe(0);
+
+	auto iter = announced.find(message_id);
+	if(iter == announced.end()) {
+		return 0;
+	}
+
+	auto& pending = iter->second.pending;
+	auto pending_iter = std::find(pending.begin(), pending.end(), transport.dst_addr);
+	if(pending_iter == pending.end()) {
+		return 0;
+	}
+
+	*pending_iter = pending.back();
+	pending.pop_back();
+
+	SPDLOG_DEBUG(
+		"Pubsub {} <<<< {}: IWANT message id: {}",
+		transport.src_addr.to_string(),
+		transport.dst_addr.to_string(),
+		message_id
+	);
+
+	send_message_with_cut_through_check(&transport, iter->second.channel, message_id, iter->second.message);
+
+	if(pending.empty()) {
+		announced.erase(iter);
+	}
+
+	return 0;
+}
+
+/*!
+	\verbatim
+
+	IWANT (0x06)
+
+	Asks for a message announced with IHAVE, which is then sent as a MESSAGE.
+
+	FORMAT:
+
+	 0               1               2               3
+	 0 1 2 3 4 5 6 7 0 1 2 3 4 5 6 7 0 1 2 3 4 5 6 7 0 1 2 3 4 5 6 7
+	+++++++++++++++++++++++++++++++++
+	|      0x00     |      0x06     |
+	-----------------------------------------------------------------
+	|                                                               |
+	----                        Message ID                       ----
+	|                                                               |
+	+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+	\endverbatim
+*/
+template<PUBSUBNODE_TEMPLATE>
+void PUBSUBNODETYPE::send_IWANT(
+	BaseTransport &transport,
+	uint64_t message_id
+) {
+	core::Buffer m({6}, 9);
+	m.write_uint64_be_unsafe(1, message_id);
+
+	transport.send(std::move(m));
+}
+
 //---------------- PubSub functions end ----------------//
 
 
@@ -1338,6 +1859,12 @@ int PUBSUBNODETYPE::did_recv(
 		// HEARTBEAT, ignore
 		case 4:
 		break;
+		// IHAVE
+		case 5: return this->did_recv_IHAVE(transport, std::move(bytes));
+		break;
+		// IWANT
+		case 6: return this->did_recv_IWANT(transport, std::move(bytes));
+		break;
 	}
 
 	return 0;
@@ -1460,15 +1987,27 @@ PUBSUBNODETYPE::PubSubNode(
 	peer_selection_timer(this),
 	blacklist_timer(this),
 	message_id_gen(std::random_device()()),
-	message_id_events(256),
+	message_id_filter(
+		DefaultMsgIDsPerGeneration,
+		DefaultMsgIDGenerations,
+		DefaultMsgIDFalsePositiveRate,
+		message_id_gen()
+	),
 	message_id_timer(this),
+	lazy_push_timer(this),
 	keys(keys)
 {
+	shard_inbox.template setup<Self, &Self::did_recv_shard_message>(this);
+	if constexpr (has_async_verify) {
+		verify_pool = std::make_unique<VerifyPoolType>(DefaultVerifyThreads, DefaultVerifyBatch, &Self::verify_batch);
+		verify_pool->template setup<Self, &Self::did_verify_MESSAGE>(this);
+	}
 	f.bind(addr);
 	f.listen(*this);
 	message_id_timer.template start<Self, &Self::message_id_timer_cb>(DefaultMsgIDTimerInterval, DefaultMsgIDTimerInterval);
 	peer_selection_timer.template start<Self, &Self::peer_selection_timer_cb>(DefaultPeerSelectTimerInterval, DefaultPeerSelectTimerInterval);
 	blacklist_timer.template start<Self, &Self::blacklist_timer_cb>(DefaultBlacklistTimerInterval, DefaultBlacklistTimerInterval);
+	lazy_push_timer.template start<Self, &Self::lazy_push_timer_cb>(DefaultLazyPushTimerInterval, DefaultLazyPushTimerInterval);
 
 	streq.request({});
 }
@@ -1521,11 +2060,8 @@ void PUBSUBNODETYPE::send_message_on_channel(
 	core::SocketAddress const *excluded,
 	MessageHeaderType prev_header
 ) {
-	if(message_id_set.find(message_id) != message_id_set.end()) { // Deduplicate message
+	if(!message_id_filter.insert(message_id)) { // Deduplicate message
 		return;
-	} else {
-		message_id_set.insert(message_id);
-		message_id_events[message_id_idx].push_back(message_id);
 	}
 
 	send_message_on_channel_impl(channel, message_id, data, size, excluded, prev_header);
@@ -1540,6 +2076,51 @@ void PUBSUBNODETYPE::send_message_on_channel_impl(
 	core::SocketAddress const *excluded,
 	MessageHeaderType prev_header
 ) {
+	// Serialize and attest once, every recipient references the same memory
+	auto message = core::SharedBuffer(create_MESSAGE(
+		channel,
+		message_id,
+		data,
+		size,
+		prev_header
+	));
+
+	// Other shards own disjoint sets of peers, the serialized message is shared with them as is
+	for(auto* inbox : shard_peers) {
+		ShardMessage shard_message = {channel, message_id, message, false, core::SocketAddress()};
+		if(excluded != nullptr) {
+			shard_message.has_excluded = true;
+			shard_message.excluded = *excluded;
+		}
+		inbox->send(std::move(shard_message));
+	}
+
+	fan_out_message(channel, message_id, message, excluded);
+}
+
+template<PUBSUBNODE_TEMPLATE>
+void PUBSUBNODETYPE::did_recv_shard_message(ShardMessage &&message) {
+	if(!message_id_filter.insert(message.message_id)) { // Deduplicate message
+		return;
+	}
+
+	fan_out_message(
+		message.channel,
+		message.message_id,
+		message.message,
+		message.has_excluded ? &message.excluded : nullptr
+	);
+}
+
+template<PUBSUBNODE_TEMPLATE>
+void PUBSUBNODETYPE::fan_out_message(
+	uint16_t channel,
+	uint64_t message_id,
+	core::SharedBuffer const &message,
+	core::SocketAddress const *excluded
+) {
+	std::vector<BaseTransport*> sol_recipients;
+
 	if(conn_map.size() <= 5) {
 		for(auto& [client_key, conns] : conn_map) {
 			SPDLOG_DEBUG("Sending message {} to 0x{:spn}", message_id, spdlog::to_hex(client_key.data(), client_key.data()+client_key.size()));
@@ -1552,7 +2133,7 @@ void PUBSUBNODETYPE::send_message_on_channel_impl(
 				// Exclude given address, usually sender tp prevent loops
 				if(excluded != nullptr && (*it)->dst_addr == *excluded)
 					continue;
-				send_message_with_cut_through_check(*it, channel, message_id, data, size, prev_header);
+				sol_recipients.push_back(*it);
 			}
 		}
 	} else {
@@ -1569,11 +2150,47 @@ void PUBSUBNODETYPE::send_message_on_channel_impl(
 				// Exclude given address, usually sender tp prevent loops
 				if(excluded != nullptr && (*it)->dst_addr == *excluded)
 					continue;
-				send_message_with_cut_through_check(*it, channel, message_id, data, size, prev_header);
+				sol_recipients.push_back(*it);
 			}
 		}
 	}
 
+	if(
+		lazy_push_threshold == 0 ||
+		message.size() < lazy_push_threshold ||
+		sol_recipients.size() <= lazy_push_fan_out
+	) {
+		for(auto* transport : sol_recipients) {
+			send_message_with_cut_through_check(transport, channel, message_id, message);
+		}
+	} else {
+		// Random eager peers keep the message moving at full speed, the others only get it from
+		// here if it has not reached them another way by the time they ask
+		for(size_t i = 0; i < lazy_push_fan_out; i++) {
+			auto pick = i + message_id_gen() % (sol_recipients.size() - i);
+			std::swap(sol_recipients[i], sol_recipients[pick]);
+			send_message_with_cut_through_check(sol_recipients[i], channel, message_id, message);
+		}
+
+		auto [iter, res] = announced.try_emplace(message_id);
+		if(res) {
+			iter->second.channel = channel;
+			iter->second.message = message;
+			iter->second.tick = lazy_push_ticks;
+			announced_order.push_back(message_id);
+		}
+
+		for(size_t i = lazy_push_fan_out; i < sol_recipients.size(); i++) {
+			send_IHAVE(*sol_recipients[i], channel, message_id, message.size());
+			iter->second.pending.push_back(sol_recipients[i]->dst_addr);
+		}
+
+		while(announced.size() > DefaultMaxAnnounced) {
+			announced.erase(announced_order.front());
+			announced_order.pop_front();
+		}
+	}
+
 	for (
 		auto it = unsol_conns.begin();
 		it != unsol_conns.end();
@@ -1582,7 +2199,7 @@ void PUBSUBNODETYPE::send_message_on_channel_impl(
 		// Exclude given address, usually sender tp prevent loops
 		if(excluded != nullptr && (*it)->dst_addr == *excluded)
 			continue;
-		send_message_with_cut_through_check(*it, channel, message_id, data, size, prev_header);
+		send_message_with_cut_through_check(*it, channel, message_id, message);
 	}
 }
 
@@ -1592,9 +2209,7 @@ void PUBSUBNODETYPE::send_message_with_cut_through_check(
 	BaseTransport *transport,
 	uint16_t channel,
 	uint64_t message_id,
-	const uint8_t *data,
-	uint64_t size,
-	MessageHeaderType prev_header
+	core::SharedBuffer const &message
 ) {
 	SPDLOG_DEBUG(
 		"Sending message {} on channel {} to {}",
@@ -1603,16 +2218,18 @@ void PUBSUBNODETYPE::send_message_with_cut_through_check(
 		transport->dst_addr.to_string()
 	);
 
-	if(size > 50000) {
-		auto m = create_MESSAGE(
-			channel,
-			message_id,
-			data,
-			size,
-			prev_header
-		);
+	if(loss_tolerant_channels.count(channel) > 0 && message.size() <= transport->max_datagram_size()) {
+		transport->send_datagram(message);
+		return;
+	}
+
+	auto iter = channel_priorities.find(channel);
+	auto priority = iter == channel_priorities.end() ? BaseTransport::default_priority : iter->second;
+	auto fec_iter = channel_fec.find(channel);
+	auto fec = fec_iter == channel_fec.end() ? DefaultFec : fec_iter->second;
 
-		auto res = transport->cut_through_send(std::move(m));
+	if(message.size() > 50000) {
+		auto res = transport->cut_through_send(message, priority, fec);
 
 		// TODO: Handle better
 		if(res < 0) {
@@ -1620,10 +2237,119 @@ void PUBSUBNODETYPE::send_message_with_cut_through_check(
 			transport->close();
 		}
 	} else {
-		send_MESSAGE(*transport, channel, message_id, data, size, prev_header);
+		transport->send(message, priority, fec);
+	}
+}
+
+template<PUBSUBNODE_TEMPLATE>
+int PUBSUBNODETYPE::set_channel_priority(
+	uint16_t channel,
+	uint8_t priority
+) {
+	if(priority >= BaseTransport::num_priorities) {
+		SPDLOG_ERROR("Invalid priority {} for channel {}", priority, channel);
+		return -1;
+	}
+
+	channel_priorities[channel] = priority;
+
+	return 0;
+}
+
+template<PUBSUBNODE_TEMPLATE>
+void PUBSUBNODETYPE::set_lazy_push(
+	uint64_t threshold,
+	size_t eager_fan_out
+) {
+	lazy_push_threshold = threshold;
+	lazy_push_fan_out = eager_fan_out;
+}
+
+template<PUBSUBNODE_TEMPLATE>
+void PUBSUBNODETYPE::set_message_id_false_positive_rate(
+	double false_positive_rate
+) {
+	message_id_filter = MessageIdFilter<>(
+		DefaultMsgIDsPerGeneration,
+		DefaultMsgIDGenerations,
+		false_positive_rate,
+		message_id_gen()
+	);
+}
+
+template<PUBSUBNODE_TEMPLATE>
+void PUBSUBNODETYPE::lazy_push_timer_cb() {
+	lazy_push_ticks++;
+
+	// Stop serving messages peers had their chance to ask for, ids of ones served in full are
+	// still in the order
+	while(!announced_order.empty()) {
+		auto iter = announced.find(announced_order.front());
+		if(iter != announced.end() && lazy_push_ticks - iter->second.tick < DefaultAnnouncedTicks) {
+			break;
+		}
+
+		if(iter != announced.end()) {
+			announced.erase(iter);
+		}
+		announced_order.pop_front();
+	}
+
+	// Ask the next announcing peer for messages which did not show up
+	for(auto iter = wanted.begin(); iter != wanted.end();) {
+		auto message_id = iter->first;
+		auto& want = iter->second;
+
+		if(message_id_filter.contains(message_id)) {
+			iter = wanted.erase(iter);
+			continue;
+		}
+
+		// Still on its way or being verified
+		if(lazy_push_ticks - want.tick < DefaultWantTicks || verifying.count(message_id) > 0) {
+			iter++;
+			continue;
+		}
+
+		BaseTransport* transport = nullptr;
+		while(transport == nullptr && !want.sources.empty()) {
+			transport = f.get_transport(want.sources.front());
+			want.sources.pop_front();
+		}
+
+		if(transport == nullptr) {
+			// Out of peers to ask, a later announcement starts over
+			iter = wanted.erase(iter);
+			continue;
+		}
+
+		SPDLOG_DEBUG("Asking {} again for message {}", transport->dst_addr.to_string(), message_id);
+		want.tick = lazy_push_ticks;
+		send_IWANT(*transport, message_id);
+		iter++;
+	}
+}
+
+template<PUBSUBNODE_TEMPLATE>
+void PUBSUBNODETYPE::set_channel_loss_tolerant(
+	uint16_t channel,
+	bool loss_tolerant
+) {
+	if(loss_tolerant) {
+		loss_tolerant_channels.insert(channel);
+	} else {
+		loss_tolerant_channels.erase(channel);
 	}
 }
 
+template<PUBSUBNODE_TEMPLATE>
+void PUBSUBNODETYPE::set_channel_fec(
+	uint16_t channel,
+	bool fec
+) {
+	channel_fec[channel] = fec;
+}
+
 template<PUBSUBNODE_TEMPLATE>
 void PUBSUBNODETYPE::subscribe(
 	ClientKey client_key,
@@ -1816,10 +2542,7 @@ int PUBSUBNODETYPE::cut_through_recv_bytes(
 
 		cut_through_header_recv[std::make_pair(&transport, id)] = true;
 
-		if(message_id_set.find(message_id) == message_id_set.end()) { // Deduplicate message
-			message_id_set.insert(message_id);
-			message_id_events[message_id_idx].push_back(message_id);
-		} else {
+		if(!message_id_filter.insert(message_id)) { // Deduplicate message
 			// transport.cut_through_send_skip(id);
 			return 0;
 		}
@@ -0,0 +1,103 @@
+#ifndef MARLIN_PUBSUB_ATTESTATION_ATTESTATIONRECOVERY_HPP
+#define MARLIN_PUBSUB_ATTESTATION_ATTESTATIONRECOVERY_HPP
+
+#include <stdint.h>
+#include <cstring>
+
+#include "marlin/pubsub/MessageDigest.hpp"
+
+#include <secp256k1_recovery.h>
+#include <cryptopp/keccak.h>
+
+
+namespace marlin {
+namespace pubsub {
+
+/// Outcome of hashing a message and recovering the signer of its stake attestation
+struct AttestationRecovery {
+	bool is_recovered = false;
+	uint8_t message_hash[32];
+	secp256k1_ecdsa_recoverable_signature sig;
+	secp256k1_pubkey pubkey;
+	/// Address of the signer
+	uint8_t address[20];
+};
+
+/// Verification context for recovering signers, creating one is expensive so threads keep theirs
+struct RecoveryContext {
+	secp256k1_context* ctx;
+
+	RecoveryContext() {
+		ctx = secp256k1_context_create(SECP256K1_CONTEXT_VERIFY);
+	}
+
+	RecoveryContext(RecoveryContext const&) = delete;
+
+	~RecoveryContext() {
+		secp256k1_context_destroy(ctx);
+	}
+};
+
+/// Hash the message and recover the signer of its stake attestation
+///
+/// Touches nothing but its arguments, any thread can run it with a context of its own. The message
+/// digest is kept in the header when it has room for one.
+template<typename HeaderType>
+AttestationRecovery recover_attestation(
+	secp256k1_context* ctx,
+	uint64_t message_id,
+	uint16_t channel,
+	uint8_t const* message_data,
+	uint64_t message_size,
+	HeaderType& prev_header
+) {
+	AttestationRecovery recovery;
+
+	// Hash message
+	message_keccak256(prev_header, message_data, message_size, recovery.message_hash);
+
+	CryptoPP::Keccak_256 hasher;
+
+	// Hash for signature
+	hasher.Update((uint8_t*)&message_id, 8);  // FIXME: Fix endian
+	hasher.Update((uint8_t*)&channel, 2);  // FIXME: Fix endian
+	hasher.Update(prev_header.attestation_data, 16);
+	hasher.Update((uint8_t*)&message_size, 8);  // FIXME: Fix endian
+	hasher.Update(recovery.message_hash, 32);
+
+	uint8_t hash[32];
+	hasher.TruncatedFinal(hash, 32);
+
+	// Parse signature
+	secp256k1_ecdsa_recoverable_signature_parse_compact(
+		ctx,
+		&recovery.sig,
+		prev_header.attestation_data + 16,
+		prev_header.attestation_data[80]
+	);
+
+	// Verify signature
+	auto res = secp256k1_ecdsa_recover(
+		ctx,
+		&recovery.pubkey,
+		&recovery.sig,
+		hash
+	);
+
+	if(res == 0) {
+		// Recovery failed
+		return recovery;
+	}
+
+	// Get address
+	hasher.CalculateTruncatedDigest(hash, 32, recovery.pubkey.data, 64);
+	std::memcpy(recovery.address, hash+12, 20);
+	recovery.is_recovered = true;
+
+	return recovery;
+}
+
+} // namespace pubsub
+} // namespace marlin
+
+#endif // MARLIN_PUBSUB_ATTESTATION_ATTESTATIONRECOVERY_HPP
@@ -0,0 +1,175 @@
+#ifndef MARLIN_PUBSUB_ATTESTATION_ATTESTATIONSTORE_HPP
+#define MARLIN_PUBSUB_ATTESTATION_ATTESTATIONSTORE_HPP
+
+#include <stdint.h>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <secp256k1_recovery.h>
+
+
+namespace marlin {
+namespace pubsub {
+
+/// Attestations seen from other signers, kept for as long as they can overlap newer ones
+///
+/// Attestations live in fixed size slabs so their addresses stay stable while the stake caches
+/// point at them. They are grouped into per minute generations by timestamp, a generation is
+/// dropped in one go along with its stake cache entries once nothing it holds can overlap an
+/// attestation which would still pass the timestamp check. Memory is bounded by the attestation
+/// rate instead of growing with uptime.
+class AttestationStore {
+public:
+	struct Attestation;
+	/// Stake offset of either end of an attestation -> Attestation
+	using StakeCache = std::map<uint64_t, Attestation*>;
+
+	struct Signer {
+		StakeCache stake_cache;
+		/// Attestations referring to the entry, it goes away with the last of them
+		size_t num_attestations = 0;
+	};
+
+	struct Attestation {
+		uint64_t message_id;
+		uint64_t timestamp;
+		uint64_t stake_offset;
+		uint64_t message_size;
+		uint16_t channel;
+		uint8_t message_hash[32];
+		secp256k1_ecdsa_recoverable_signature sig;
+
+		/// Signer entry in signers, null until added to a stake cache
+		std::pair<std::string const, Signer>* signer;
+	};
+
+	/// Maximum clock skew permitted for attestation timestamps
+	static constexpr uint64_t max_clock_skew = 60;
+	/// Time after which signers reuse their stake
+	static constexpr uint64_t stake_reuse_interval = 60;
+
+	/// Can attestations signed at these times use the same stake?
+	static bool is_reusable(uint64_t timestamp, uint64_t other_timestamp) {
+		return timestamp >= other_timestamp + stake_reuse_interval ||
+			other_timestamp >= timestamp + stake_reuse_interval;
+	}
+
+private:
+	static constexpr uint64_t generation_interval = 60;
+	static constexpr size_t slab_size = 1024;
+
+	std::vector<std::unique_ptr<Attestation[]>> slabs;
+	std::vector<Attestation*> free_list;
+
+	/// Minute -> Attestations with timestamps in it
+	std::map<uint64_t, std::vector<Attestation*>> generations;
+	size_t num_attestations = 0;
+
+	/// Pubkey -> Signer
+	std::unordered_map<std::string, Signer> signers;
+
+	void drop(Attestation* attestation) {
+		if(attestation->signer != nullptr) {
+			auto& [pubkey, signer] = *attestation->signer;
+			auto& stake_cache = signer.stake_cache;
+
+			// Newer attestations might have taken over either end
+			auto iter = stake_cache.find(attestation->stake_offset);
+			if(iter != stake_cache.end() && iter->second == attestation) {
+				stake_cache.erase(iter);
+			}
+			iter = stake_cache.find(attestation->stake_offset + attestation->message_size - 1);
+			if(iter != stake_cache.end() && iter->second == attestation) {
+				stake_cache.erase(iter);
+			}
+
+			if(--signer.num_attestations == 0) {
+				// Copied since the key goes away with the entry
+				signers.erase(std::string(pubkey));
+			}
+		}
+
+		free_list.push_back(attestation);
+		num_attestations--;
+	}
+
+public:
+	AttestationStore() = default;
+	AttestationStore(AttestationStore const&) = delete;
+
+	/// New attestation with the given timestamp, its address is stable until it expires
+	Attestation* create(uint64_t timestamp) {
+		if(free_list.empty()) {
+			auto& slab = slabs.emplace_back(new Attestation[slab_size]);
+			for(size_t i = slab_size; i > 0; i--) {
+				free_list.push_back(slab.get() + i - 1);
+			}
+		}
+
+		auto* attestation = free_list.back();
+		free_list.pop_back();
+
+		attestation->timestamp = timestamp;
+		attestation->signer = nullptr;
+
+		generations[timestamp / generation_interval].push_back(attestation);
+		num_attestations++;
+
+		return attestation;
+	}
+
+	/// Stake cache of a signer, the attestation is removed from it when it expires
+	StakeCache& stake_cache(std::string&& pubkey, Attestation* attestation) {
+		// Nodes of unordered maps keep their address across rehashes
+		auto& entry = *signers.try_emplace(std::move(pubkey)).first;
+		entry.second.num_attestations++;
+		attestation->signer = &entry;
+
+		return entry.second.stake_cache;
+	}
+
+	/// Drop generations which cannot overlap attestations accepted from now on
+	void expire(uint64_t now) {
+		// Accepted attestations are at most max_clock_skew old, anything older than that by the reuse
+		// interval can no longer overlap them
+		auto horizon = max_clock_skew + stake_reuse_interval;
+		if(now < horizon) {
+			return;
+		}
+
+		for(auto iter = generations.begin(); iter != generations.end(); iter = generations.erase(iter)) {
+			// Latest timestamp in the generation
+			auto latest = iter->first * generation_interval + generation_interval - 1;
+			if(latest + horizon >= now) {
+				break;
+			}
+
+			for(auto* attestation : iter->second) {
+				drop(attestation);
+			}
+		}
+	}
+
+	/// Attestations held
+	size_t size() const {
+		return num_attestations;
+	}
+
+	/// Signers with attestations held
+	size_t num_signers() const {
+		return signers.size();
+	}
+
+	/// Attestations the slabs have room for
+	size_t capacity() const {
+		return slabs.size() * slab_size;
+	}
+};
+
+} // namespace pubsub
+} // namespace marlin
+
+#endif // MARLIN_PUBSUB_ATTESTATION_ATTESTATIONSTORE_HPP
@@ -6,6 +6,8 @@
 #include <ctime>
 #include <optional>
 
+#include "marlin/pubsub/MessageDigest.hpp"
+
 #include <secp256k1_recovery.h>
 #include <cryptopp/keccak.h>
 #include <cryptopp/osrng.h>
@@ -61,9 +63,8 @@ struct SigAttester {
 		out.write_uint16_le_unsafe(offset, 67);
 
 		uint8_t hash[32];
-		CryptoPP::Keccak_256 hasher;
 		// Hash message
-		hasher.CalculateTruncatedDigest(hash, 32, message_data, message_size);
+		message_keccak256(prev_header, message_data, message_size, hash);
 
 		// Get key
 		// if(key == nullptr) {
@@ -3,10 +3,13 @@
 
 #include <stdint.h>
 #include <marlin/core/WeakBuffer.hpp>
+#include <cstring>
 #include <ctime>
 #include <optional>
 
 #include "marlin/pubsub/ABCInterface.hpp"
+#include "marlin/pubsub/attestation/AttestationRecovery.hpp"
+#include "marlin/pubsub/attestation/AttestationStore.hpp"
 
 #include <secp256k1_recovery.h>
 #include <cryptopp/keccak.h>
@@ -86,17 +89,27 @@ struct StakeAttester {
 
 //---------------- Other stake management start ----------------//
 
-	struct Attestation {
-		uint64_t message_id;
-		uint64_t timestamp;
-		uint64_t stake_offset;
-		uint64_t message_size;
-		uint16_t channel;
-		uint8_t message_hash[32];
-		secp256k1_ecdsa_recoverable_signature sig;
-	};
-	std::vector<Attestation> attestation_cache;
-	std::unordered_map<std::string, std::map<uint64_t, Attestation*>> stake_caches;
+	using Attestation = AttestationStore::Attestation;
+	AttestationStore attestation_store;
+
+	void send_duplicate_stake_msg(Attestation const& attestation, Attestation const& other) {
+		abci.send_duplicate_stake_msg(
+			attestation.message_id,
+			attestation.channel,
+			attestation.timestamp,
+			attestation.stake_offset,
+			attestation.message_size,
+			attestation.message_hash,
+			attestation.sig.data,
+			other.message_id,
+			other.channel,
+			other.timestamp,
+			other.stake_offset,
+			other.message_size,
+			other.message_hash,
+			other.sig.data
+		);
+	}
 
 //---------------- Other stake management end ----------------//
 
@@ -151,11 +164,11 @@ struct StakeAttester {
 		out.write_uint64_be_unsafe(offset+8, stake_offset);
 
 		uint8_t hash[32];
-		CryptoPP::Keccak_256 hasher;
 		// Hash message
-		hasher.CalculateTruncatedDigest(hash, 32, message_data, message_size);
+		message_keccak256(prev_header, message_data, message_size, hash);
 
 		// Hash for signature
+		CryptoPP::Keccak_256 hasher;
 		hasher.Update((uint8_t*)&message_id, 8);  // FIXME: Fix endian
 		hasher.Update((uint8_t*)&channel, 2);  // FIXME: Fix endian
 		hasher.Update(out.data()+offset, 16);
@@ -200,160 +213,152 @@ struct StakeAttester {
 		return 0;
 	}
 
+//---------------- Verification start ----------------//
+
+	/// Signer recovery, the part of verification which can run on any thread
+	using Recovery = AttestationRecovery;
+	using Verifier = RecoveryContext;
+
+	template<typename HeaderType>
+	static Recovery recover(
+		secp256k1_context* ctx,
+		uint64_t message_id,
+		uint16_t channel,
+		uint8_t const* message_data,
+		uint64_t message_size,
+		HeaderType& prev_header
+	) {
+		return recover_attestation(ctx, message_id, channel, message_data, message_size, prev_header);
+	}
+
+	/// Verify an attestation, the header keeps the message digest for whoever handles the message next
 	template<typename HeaderType>
 	bool verify(
 		uint64_t message_id,
 		uint16_t channel,
 		uint8_t const* message_data,
 		uint64_t message_size,
-		HeaderType prev_header
+		HeaderType& prev_header
 	) {
-		auto& attestation = attestation_cache.emplace_back();
-		attestation.message_id = message_id;
-		attestation.channel = channel;
-		attestation.message_size = message_size;
+		// Stale attestations are turned away before spending any time on them
+		if(!check_timestamp(prev_header)) {
+			return false;
+		}
+
+		return verify_recovered(
+			message_id,
+			channel,
+			message_size,
+			prev_header,
+			recover(ctx_verifier, message_id, channel, message_data, message_size, prev_header)
+		);
+	}
 
-		// Extract data
+	/// Check the timestamp of an attestation against the local clock
+	template<typename HeaderType>
+	bool check_timestamp(HeaderType prev_header) {
 		// TODO: Code smell: const-stripping
 		core::WeakBuffer buf((uint8_t*)prev_header.attestation_data, prev_header.attestation_size);
-		attestation.timestamp = buf.read_uint64_be_unsafe(0);
-		attestation.stake_offset = buf.read_uint64_be_unsafe(8);
+		uint64_t timestamp = buf.read_uint64_be_unsafe(0);
 
 		uint64_t now = std::time(nullptr);
 		// Permit a maximum clock skew of 60 seconds
-		if(now > attestation.timestamp && now - attestation.timestamp > 60) {
+		if(now > timestamp && now - timestamp > 60) {
 			// Too old
 			return false;
-		} else if(now < attestation.timestamp && attestation.timestamp - now > 60) {
+		} else if(now < timestamp && timestamp - now > 60) {
 			// Too new
 			return false;
 		}
 
-		CryptoPP::Keccak_256 hasher;
-		// Hash message
-		hasher.CalculateTruncatedDigest(attestation.message_hash, 32, message_data, message_size);
-
-		// Hash for signature
-		hasher.Update((uint8_t*)&message_id, 8);  // FIXME: Fix endian
-		hasher.Update((uint8_t*)&channel, 2);  // FIXME: Fix endian
-		hasher.Update(prev_header.attestation_data, 16);
-		hasher.Update((uint8_t*)&message_size, 8);  // FIXME: Fix endian
-		hasher.Update(attestation.message_hash, 32);
-
-		uint8_t hash[32];
-		hasher.TruncatedFinal(hash, 32);
-
-		// Parse signature
-		secp256k1_ecdsa_recoverable_signature_parse_compact(
-			ctx_verifier,
-			&attestation.sig,
-			prev_header.attestation_data + 16,
-			prev_header.attestation_data[80]
-		);
+		return true;
+	}
 
-		// Verify signature
-		secp256k1_pubkey pubkey;
-		{
-			auto res = secp256k1_ecdsa_recover(
-				ctx_verifier,
-				&pubkey,
-				&attestation.sig,
-				hash
-			);
-
-			if(res == 0) {
-				// Recovery failed
-				return false;
-			}
+	/// Finish verification once the signer is recovered, checks the attestation against the stake
+	/// of the signer and the attestations seen before
+	template<typename HeaderType>
+	bool verify_recovered(
+		uint64_t message_id,
+		uint16_t channel,
+		uint64_t message_size,
+		HeaderType prev_header,
+		Recovery const& recovery
+	) {
+		// The clock moved on while the signer was being recovered
+		if(!recovery.is_recovered || !check_timestamp(prev_header)) {
+			return false;
 		}
 
-		// Get address
-		hasher.CalculateTruncatedDigest(hash, 32, pubkey.data, 64);
-		// address is in hash[12..31]
+		// TODO: Code smell: const-stripping
+		core::WeakBuffer buf((uint8_t*)prev_header.attestation_data, prev_header.attestation_size);
+		uint64_t timestamp = buf.read_uint64_be_unsafe(0);
+		uint64_t stake_offset = buf.read_uint64_be_unsafe(8);
 
 		// Check if stake_offset is within stake
-		auto stake = abci.get_stake(std::string((char*)hash+12, 20));
-		if(attestation.stake_offset > stake || attestation.stake_offset + attestation.message_size > stake) {
+		auto stake = abci.get_stake(std::string((char*)recovery.address, 20));
+		if(stake_offset > stake || stake_offset + message_size > stake) {
 			return false;
 		}
 
-		// Check for overlaps
-		auto& stake_cache = stake_caches[std::string(pubkey.data, pubkey.data + 64)];
+		attestation_store.expire(std::time(nullptr));
+
+		auto* attestation = attestation_store.create(timestamp);
+		attestation->message_id = message_id;
+		attestation->channel = channel;
+		attestation->stake_offset = stake_offset;
+		attestation->message_size = message_size;
+		std::memcpy(attestation->message_hash, recovery.message_hash, 32);
+		attestation->sig = recovery.sig;
+		auto const& pubkey = recovery.pubkey;
+
+		// Check for overlaps, attestations far enough apart in time may use the same stake
+		auto& stake_cache = attestation_store.stake_cache(
+			std::string(pubkey.data, pubkey.data + 64),
+			attestation
+		);
 
 		auto [iter_begin, res_begin] = stake_cache.try_emplace(
-			attestation.stake_offset,
-			&attestation
+			stake_offset,
+			attestation
 		);
 
 		if(!res_begin) {
-			abci.send_duplicate_stake_msg(
-				attestation.message_id,
-				attestation.channel,
-				attestation.timestamp,
-				attestation.stake_offset,
-				attestation.message_size,
-				attestation.message_hash,
-				attestation.sig.data,
-				iter_begin->second->message_id,
-				iter_begin->second->channel,
-				iter_begin->second->timestamp,
-				iter_begin->second->stake_offset,
-				iter_begin->second->message_size,
-				iter_begin->second->message_hash,
-				iter_begin->second->sig.data
-			);
-			return false;
+			if(!AttestationStore::is_reusable(timestamp, iter_begin->second->timestamp)) {
+				send_duplicate_stake_msg(*attestation, *iter_begin->second);
+				return false;
+			}
+			iter_begin->second = attestation;
 		}
 
 		auto [iter_end, res_end] = stake_cache.try_emplace(
-			attestation.stake_offset + message_size - 1,
-			&attestation
+			stake_offset + message_size - 1,
+			attestation
 		);
 
-		if(!res_end) {
-			abci.send_duplicate_stake_msg(
-				attestation.message_id,
-				attestation.channel,
-				attestation.timestamp,
-				attestation.stake_offset,
-				attestation.message_size,
-				attestation.message_hash,
-				attestation.sig.data,
-				iter_end->second->message_id,
-				iter_end->second->channel,
-				iter_end->second->timestamp,
-				iter_end->second->stake_offset,
-				iter_end->second->message_size,
-				iter_end->second->message_hash,
-				iter_end->second->sig.data
-			);
-			return false;
+		// Both ends are the same offset for single byte messages
+		if(!res_end && iter_end->second != attestation) {
+			if(!AttestationStore::is_reusable(timestamp, iter_end->second->timestamp)) {
+				send_duplicate_stake_msg(*attestation, *iter_end->second);
+				return false;
+			}
+			iter_end->second = attestation;
 		}
 
+		// Attestations ending within this one
 		bool overlap = false;
-		for(iter_begin++; iter_begin != iter_end; iter_begin++) {
-			abci.send_duplicate_stake_msg(
-				attestation.message_id,
-				attestation.channel,
-				attestation.timestamp,
-				attestation.stake_offset,
-				attestation.message_size,
-				attestation.message_hash,
-				attestation.sig.data,
-				iter_begin->second->message_id,
-				iter_begin->second->channel,
-				iter_begin->second->timestamp,
-				iter_begin->second->stake_offset,
-				iter_begin->second->message_size,
-				iter_begin->second->message_hash,
-				iter_begin->second->sig.data
-			);
+		for(auto iter = std::next(iter_begin); iter != stake_cache.end() && iter->first < iter_end->first; iter++) {
+			if(AttestationStore::is_reusable(timestamp, iter->second->timestamp)) {
+				continue;
+			}
+			send_duplicate_stake_msg(*attestation, *iter->second);
 			overlap = true;
 		}
 
 		return !overlap;
 	}
 
+//---------------- Verification end ----------------//
+
 	std::optional<uint64_t> parse_size(core::Buffer&, uint64_t = 0) {
 		return 81;
 	}
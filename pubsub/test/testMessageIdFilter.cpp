@@ -0,0 +1,105 @@
+#include "gtest/gtest.h"
+#include <marlin/pubsub/MessageIdFilter.hpp>
+
+
+using namespace marlin;
+using namespace marlin::pubsub;
+
+TEST(MessageIdFilter, Deduplicate) {
+	MessageIdFilter<> filter(1000, 4, 1e-6, 1);
+
+	EXPECT_FALSE(filter.contains(42));
+	EXPECT_TRUE(filter.insert(42));
+	EXPECT_TRUE(filter.contains(42));
+	EXPECT_FALSE(filter.insert(42));
+	EXPECT_EQ(filter.size(), 1u);
+}
+
+TEST(MessageIdFilter, ExpiryAfterRotations) {
+	MessageIdFilter<> filter(1000, 4, 1e-6, 1);
+	filter.insert(42);
+
+	// Remembered through one rotation less than there are generations
+	for(size_t i = 0; i < 3; i++) {
+		filter.rotate();
+		EXPECT_TRUE(filter.contains(42));
+	}
+
+	filter.rotate();
+	EXPECT_FALSE(filter.contains(42));
+	EXPECT_TRUE(filter.insert(42));
+}
+
+TEST(MessageIdFilter, RotateEarlyWhenFull) {
+	MessageIdFilter<> filter(1000, 4, 1e-6, 1);
+	auto generation_size = filter.generation_size();
+	EXPECT_GE(generation_size, 1000u);
+
+	uint64_t id = 0;
+	for(; id < generation_size; id++) {
+		EXPECT_TRUE(filter.insert(id));
+	}
+	EXPECT_EQ(filter.size(), generation_size);
+
+	// The next id starts a generation of its own
+	EXPECT_TRUE(filter.insert(id++));
+	EXPECT_EQ(filter.size(), 1u);
+	EXPECT_TRUE(filter.contains(0));
+
+	// Filling the remaining generations pushes the first one out
+	for(; id < 4 * generation_size; id++) {
+		EXPECT_TRUE(filter.insert(id));
+	}
+	EXPECT_TRUE(filter.contains(generation_size - 1));
+	EXPECT_TRUE(filter.insert(id++));
+	EXPECT_FALSE(filter.contains(0));
+	EXPECT_FALSE(filter.contains(generation_size - 1));
+	EXPECT_TRUE(filter.contains(generation_size));
+	// Memory stays what it was sized for
+	EXPECT_EQ(filter.memory(), MessageIdFilter<>(1000, 4, 1e-6, 1).memory());
+}
+
+TEST(MessageIdFilter, FalsePositiveRateWithinBudget) {
+	// Narrow fingerprints so that the budget, not the load cap, sizes the tables
+	constexpr double budget = 5e-5;
+	MessageIdFilter<uint16_t> filter(4096, 4, budget, 7);
+	auto generation_size = filter.generation_size();
+	auto capacity = filter.memory() / sizeof(uint16_t) / 4;
+	EXPECT_LT(generation_size, capacity * MessageIdFilter<uint16_t>::max_load_factor);
+
+	// Every generation at its fullest
+	uint64_t id = 0;
+	for(size_t gen = 0; gen < 4; gen++) {
+		for(size_t i = 0; i < generation_size; i++) {
+			filter.insert(id++);
+		}
+		if(gen < 3) {
+			filter.rotate();
+		}
+	}
+
+	constexpr uint64_t num_probes = 4000000;
+	uint64_t false_positives = 0;
+	for(uint64_t i = 0; i < num_probes; i++) {
+		false_positives += filter.contains(id + i);
+	}
+
+	double rate = double(false_positives) / num_probes;
+	// The sizing model holds for large tables, smaller ones run slightly over
+	EXPECT_LE(rate, budget * 1.2);
+	// Sized close to the budget instead of far below it
+	EXPECT_GE(rate, budget / 4);
+}
+
+TEST(MessageIdFilter, TighterBudgetTakesMoreMemory) {
+	MessageIdFilter<uint16_t> loose(4096, 4, 5e-5, 1);
+	MessageIdFilter<uint16_t> tight(4096, 4, 1e-5, 1);
+
+	EXPECT_GT(tight.memory(), loose.memory());
+
+	// Replaced filters start out empty
+	loose.insert(42);
+	loose = MessageIdFilter<uint16_t>(4096, 4, 1e-5, 1);
+	EXPECT_FALSE(loose.contains(42));
+	EXPECT_EQ(loose.memory(), tight.memory());
+}
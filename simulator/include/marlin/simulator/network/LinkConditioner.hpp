@@ -0,0 +1,119 @@
+#ifndef MARLIN_SIMULATOR_NETWORK_LINKCONDITIONER_HPP
+#define MARLIN_SIMULATOR_NETWORK_LINKCONDITIONER_HPP
+
+#include "marlin/core/SocketAddress.hpp"
+
+#include <algorithm>
+#include <map>
+#include <random>
+
+namespace marlin {
+namespace simulator {
+
+/// Conditioner modelling every sender as a bottleneck link with a drop tail queue,
+/// propagation delay and random loss
+class LinkConditioner {
+public:
+	/// Probability of a packet being dropped at random
+	double loss = 0;
+	/// One way propagation delay in ticks
+	uint64_t delay = 1;
+	/// Bottleneck bandwidth in bytes per tick
+	double bandwidth = 1e9;
+	/// Bytes that can be queued at the bottleneck before packets are dropped
+	uint64_t queue_limit = -1;
+	/// Largest datagram which gets through, larger ones are dropped like with the don't fragment bit set
+	uint64_t mtu = -1;
+
+	// Stats
+	/// Packets offered to the link
+	uint64_t num_packets = 0;
+	/// Packets dropped at random
+	uint64_t num_lost = 0;
+	/// Packets dropped because the queue was full
+	uint64_t num_overflow = 0;
+	/// Packets dropped for exceeding the mtu
+	uint64_t num_oversize = 0;
+
+	LinkConditioner(double loss, uint64_t delay, double bandwidth, uint64_t queue_limit, uint64_t seed = 42);
+
+	bool should_drop(
+		uint64_t in_tick,
+		core::SocketAddress const& src,
+		core::SocketAddress const& dst,
+		uint64_t size
+	);
+
+	uint64_t get_out_tick(
+		uint64_t in_tick,
+		core::SocketAddress const& src,
+		core::SocketAddress const& dst,
+		uint64_t size
+	);
+
+private:
+	std::mt19937_64 gen;
+	std::bernoulli_distribution dist;
+	/// Time at which the link of each sender finishes transmitting what is queued
+	std::map<core::SocketAddress, double> busy_until;
+};
+
+
+// Impl
+
+inline LinkConditioner::LinkConditioner(
+	double loss,
+	uint64_t delay,
+	double bandwidth,
+	uint64_t queue_limit,
+	uint64_t seed
+) : loss(loss), delay(delay), bandwidth(bandwidth), queue_limit(queue_limit), gen(seed), dist(loss) {}
+
+inline bool LinkConditioner::should_drop(
+	uint64_t in_tick,
+	core::SocketAddress const& src,
+	core::SocketAddress const&,
+	uint64_t size
+) {
+	num_packets++;
+
+	if(size > mtu) {
+		num_oversize++;
+		return true;
+	}
+
+	if(dist(gen)) {
+		num_lost++;
+		return true;
+	}
+
+	// Drop tail
+	auto iter = busy_until.find(src);
+	if(iter == busy_until.end() || iter->second <= in_tick) {
+		return false;
+	}
+
+	if((iter->second - in_tick) * bandwidth + size > queue_limit) {
+		num_overflow++;
+		return true;
+	}
+
+	return false;
+}
+
+inline uint64_t LinkConditioner::get_out_tick(
+	uint64_t in_tick,
+	core::SocketAddress const& src,
+	core::SocketAddress const&,
+	uint64_t size
+) {
+	auto &busy = busy_until[src];
+	busy = std::max(busy, double(in_tick)) + size / bandwidth;
+
+	return uint64_t(busy) + delay;
+}
+
+} // namespace simulator
+} // namespace marlin
+
+#endif // MARLIN_SIMULATOR_NETWORK_LINKCONDITIONER_HPP
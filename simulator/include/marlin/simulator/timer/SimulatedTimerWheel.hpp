@@ -0,0 +1,82 @@
+/*! \file SimulatedTimerWheel.hpp
+*/
+
+#ifndef MARLIN_SIMULATOR_TIMER_SIMULATEDTIMERWHEEL_HPP
+#define MARLIN_SIMULATOR_TIMER_SIMULATEDTIMERWHEEL_HPP
+
+#include <marlin/core/TimerWheel.hpp>
+#include "marlin/simulator/core/Simulator.hpp"
+#include "marlin/simulator/timer/TimerEvent.hpp"
+
+
+namespace marlin {
+namespace simulator {
+
+// Timing wheel holding all simulated timers, driven by a single event in the simulator queue
+class SimulatedTimerWheel {
+private:
+	using Self = SimulatedTimerWheel;
+
+	core::TimerWheel wheel;
+	Event<Simulator>* next_event = nullptr;
+	uint64_t next_tick = core::TimerWheel::never;
+
+	void event_cb() {
+		next_event = nullptr;
+		next_tick = core::TimerWheel::never;
+
+		wheel.advance(Simulator::default_instance.current_tick());
+		arm();
+	}
+
+	void arm() {
+		auto next = wheel.next_expiry();
+		if(next >= next_tick) {
+			return;
+		}
+
+		// Lagging wheels catch up at the current tick, simulations cannot move backward
+		auto now = Simulator::default_instance.current_tick();
+		if(next < now) {
+			next = now;
+		}
+
+		if(next_event != nullptr) {
+			Simulator::default_instance.remove_event(next_event);
+		}
+
+		next_tick = next;
+		next_event = new TimerEvent<Simulator, Self, &Self::event_cb>(next, *this);
+		Simulator::default_instance.add_event(next_event);
+	}
+
+public:
+	static SimulatedTimerWheel default_instance;
+
+	void schedule(core::TimerWheel::Node* node, uint64_t timeout) {
+		auto now = Simulator::default_instance.current_tick();
+
+		// Catch up if the wheel sat idle
+		if(wheel.size() == 0) {
+			wheel.advance(now);
+		}
+
+		wheel.schedule(node, now + timeout);
+		arm();
+	}
+
+	void cancel(core::TimerWheel::Node* node) {
+		wheel.cancel(node);
+
+		if(wheel.size() == 0 && next_event != nullptr) {
+			Simulator::default_instance.remove_event(next_event);
+			next_event = nullptr;
+			next_tick = core::TimerWheel::never;
+		}
+	}
+};
+
+} // namespace simulator
+} // namespace marlin
+
+#endif // MARLIN_SIMULATOR_TIMER_SIMULATEDTIMERWHEEL_HPP
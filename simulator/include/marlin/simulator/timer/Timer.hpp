@@ -6,14 +6,14 @@
 
 #include <type_traits>
 #include "marlin/simulator/core/Simulator.hpp"
-#include "marlin/simulator/timer/TimerEvent.hpp"
+#include "marlin/simulator/timer/SimulatedTimerWheel.hpp"
 
 
 namespace marlin {
 namespace simulator {
 
 
-// Simulated timer, hardcoded Simulator instance as event manager
+// Simulated timer, backed by the default simulated timing wheel
 class Timer {
 private:
 	using Self = Timer;
@@ -21,32 +21,36 @@ private:
 	void* data = nullptr;
 
 	template<typename DelegateType, void (DelegateType::*callback)()>
-	void timer_cb() {
-		next_event = nullptr;
-		(((DelegateType*)(delegate))->*callback)();
-
-		if(repeat > 0) {
-			start<DelegateType, callback>(repeat, repeat);
-		}
+	static void timer_cb(core::TimerWheel::Node* node) {
+		auto& timer = *(Self*)node->owner;
+		timer.restart();
+		(((DelegateType*)(timer.delegate))->*callback)();
 	}
 
 	template<typename DelegateType, typename DataType, void (DelegateType::*callback)(DataType&)>
-	void timer_cb() {
-		next_event = nullptr;
-		(((DelegateType*)(delegate))->*callback)(*(DataType*)data);
+	static void timer_cb(core::TimerWheel::Node* node) {
+		auto& timer = *(Self*)node->owner;
+		timer.restart();
+		(((DelegateType*)(timer.delegate))->*callback)(*(DataType*)timer.data);
+	}
 
+	void restart() {
 		if(repeat > 0) {
-			start<DelegateType, DataType, callback>(repeat, repeat);
+			SimulatedTimerWheel::default_instance.schedule(&node, repeat);
 		}
 	}
 
 	uint64_t repeat = 0;
-	Event<Simulator>* next_event = nullptr;
+	core::TimerWheel::Node node;
 public:
 	void* delegate;
 
 	template<typename DelegateType>
-	Timer(DelegateType* delegate) : delegate(delegate) {}
+	Timer(DelegateType* delegate) : delegate(delegate) {
+		node.owner = this;
+	}
+
+	Timer(Timer const&) = delete;
 
 	template<typename DataType>
 	void set_data(DataType* data) {
@@ -55,42 +59,21 @@ public:
 
 	template<typename DelegateType, void (DelegateType::*callback)()>
 	void start(uint64_t timeout, uint64_t repeat) {
-		stop();
 		this->repeat = repeat;
-		next_event = new TimerEvent<
-			Simulator,
-			Self,
-			&Self::timer_cb<DelegateType, callback>
-		>(
-			Simulator::default_instance.current_tick() + timeout,
-			*this
-		);
-
-		Simulator::default_instance.add_event(next_event);
+		node.callback = timer_cb<DelegateType, callback>;
+		SimulatedTimerWheel::default_instance.schedule(&node, timeout);
 	}
 
 	template<typename DelegateType, typename DataType, void (DelegateType::*callback)(DataType&)>
 	void start(uint64_t timeout, uint64_t repeat) {
-		stop();
 		this->repeat = repeat;
-		next_event = new TimerEvent<
-			Simulator,
-			Self,
-			&Self::timer_cb<DelegateType, DataType, callback>
-		>(
-			Simulator::default_instance.current_tick() + timeout,
-			*this
-		);
-
-		Simulator::default_instance.add_event(next_event);
+		node.callback = timer_cb<DelegateType, DataType, callback>;
+		SimulatedTimerWheel::default_instance.schedule(&node, timeout);
 	}
 
 	void stop() {
 		repeat = 0;
-		if(next_event != nullptr){
-			Simulator::default_instance.remove_event(next_event);
-			next_event = nullptr;
-		}
+		SimulatedTimerWheel::default_instance.cancel(&node);
 	}
 
 	~Timer() {
@@ -38,6 +38,8 @@ public:
 	core::SocketAddress dst_addr;
 
 	bool internal = false;
+	/// The simulated network never fragments, datagrams over the link MTU are dropped
+	bool dont_fragment = false;
 
 	DelegateType* delegate = nullptr;
 
@@ -60,6 +62,7 @@ public:
 	);
 
 	bool is_internal();
+	bool is_dont_fragment() const;
 };
 
 
@@ -180,6 +183,19 @@ bool SimulatedTransport<
 	return internal;
 }
 
+template<
+	typename EventManager,
+	typename NetworkInterfaceType,
+	typename DelegateType
+>
+bool SimulatedTransport<
+	EventManager,
+	NetworkInterfaceType,
+	DelegateType
+>::is_dont_fragment() const {
+	return dont_fragment;
+}
+
 } // namespace simulator
 } // namespace marlin
 
@@ -42,6 +42,7 @@ private:
 
 	ListenDelegateType* delegate;
 	bool is_listening = false;
+	bool dont_fragment = false;
 	std::pair<TransportType*, int> dial_impl(core::SocketAddress const& addr, ListenDelegateType& delegate);
 public:
 	core::SocketAddress addr;
@@ -53,6 +54,8 @@ public:
 
 	int bind(core::SocketAddress const& addr);
 	int listen(ListenDelegateType& delegate);
+	/// Let transports probe the path MTU, the simulated network never fragments anyway
+	int enable_dont_fragment();
 
 	template<typename... Args>
 	int dial(core::SocketAddress const& addr, ListenDelegateType& delegate, Args&&... args);
@@ -121,6 +124,22 @@ int SimulatedTransportFactory<
 	return interface.bind(*this, addr.get_port());
 }
 
+template<
+	typename EventManager,
+	typename NetworkInterfaceType,
+	typename ListenDelegateType,
+	typename TransportDelegateType
+>
+int SimulatedTransportFactory<
+	EventManager,
+	NetworkInterfaceType,
+	ListenDelegateType,
+	TransportDelegateType
+>::enable_dont_fragment() {
+	dont_fragment = true;
+	return 0;
+}
+
 template<
 	typename EventManager,
 	typename NetworkInterfaceType,
@@ -152,6 +171,7 @@ int SimulatedTransportFactory<
 	);
 
 	if(res) {
+		transport->dont_fragment = dont_fragment;
 		delegate.did_create_transport(*transport);
 	}
 
@@ -212,6 +232,7 @@ void SimulatedTransportFactory<
 				this->transport_manager,
 				this->manager
 			).first;
+			transport->dont_fragment = dont_fragment;
 			delegate->did_create_transport(*transport);
 		} else {
 			return;
@@ -1,10 +1,12 @@
 #include "marlin/simulator/core/Simulator.hpp"
+#include "marlin/simulator/timer/SimulatedTimerWheel.hpp"
 
 
 namespace marlin {
 namespace simulator {
 
 Simulator Simulator::default_instance = Simulator();
+SimulatedTimerWheel SimulatedTimerWheel::default_instance;
 
 Simulator::Simulator() {}
 
@@ -0,0 +1,203 @@
+#define MARLIN_ASYNCIO_SIMULATOR
+
+#include <marlin/simulator/core/Simulator.hpp>
+#include <marlin/simulator/transport/SimulatedTransportFactory.hpp>
+#include <marlin/simulator/network/Network.hpp>
+#include <marlin/simulator/network/LinkConditioner.hpp>
+#include <marlin/stream/StreamTransportFactory.hpp>
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+using namespace marlin::core;
+using namespace marlin::asyncio;
+using namespace marlin::simulator;
+using namespace marlin::stream;
+
+// Sends a bulk transfer to a destination whose application processes data slower than the link
+// delivers it. The application pauses the transport when its own backlog fills up, flow control
+// then holds the source back, and the report shows how much either side ended up buffering.
+//
+// Usage: backpressure_simulated [MB] [app rate KB/s] [rtt ms]
+
+using NetworkType = Network<LinkConditioner>;
+using NetworkInterfaceType = NetworkInterface<NetworkType>;
+
+template<typename Delegate>
+using SimTransportType = SimulatedTransport<
+	Simulator,
+	NetworkInterfaceType,
+	Delegate
+>;
+template<typename ListenDelegate, typename TransportDelegate>
+using SimTransportFactoryType = SimulatedTransportFactory<
+	Simulator,
+	NetworkInterfaceType,
+	ListenDelegate,
+	TransportDelegate
+>;
+
+uint8_t static_sk[crypto_box_SECRETKEYBYTES];
+uint8_t static_pk[crypto_box_PUBLICKEYBYTES];
+
+struct Delegate {
+	using TransportType = StreamTransport<Delegate, SimTransportType>;
+	using TransportFactoryType = StreamTransportFactory<
+		Delegate,
+		Delegate,
+		SimTransportFactoryType,
+		SimTransportType
+	>;
+
+	TransportFactoryType* client = nullptr;
+	SocketAddress server_addr;
+	uint64_t total = 0;
+	/// Bytes the application processes every 10 ms
+	uint64_t app_quantum = 0;
+	/// Application backlog past which the transport is paused
+	static constexpr uint64_t max_backlog = 1000000;
+
+	TransportType* client_transport = nullptr;
+	TransportType* server_transport = nullptr;
+	uint64_t num_sent = 0;
+	uint64_t num_acked = 0;
+	/// Bytes kept queued at the source
+	static constexpr uint64_t max_queued = 10000000;
+
+	uint64_t backlog = 0;
+	uint64_t processed = 0;
+	uint64_t num_pauses = 0;
+	/// Peak bytes held by the destination transport
+	uint64_t peak_buffered = 0;
+	uint64_t done_tick = 0;
+
+	Timer dial_timer;
+	Timer app_timer;
+
+	Delegate() : dial_timer(this), app_timer(this) {}
+
+	void dial_timer_cb() {
+		client->dial(server_addr, *this, static_pk);
+	}
+
+	void app_timer_cb() {
+		auto quantum = std::min(backlog, app_quantum);
+		backlog -= quantum;
+		processed += quantum;
+
+		if(server_transport != nullptr) {
+			peak_buffered = std::max(peak_buffered, server_transport->get_recv_buffered());
+
+			if(backlog < max_backlog / 2) {
+				server_transport->resume_recv();
+			}
+		}
+
+		if(processed == total) {
+			done_tick = Simulator::default_instance.current_tick();
+			app_timer.stop();
+			client_transport->close();
+		}
+	}
+
+	int did_recv(TransportType &transport, Buffer &&bytes, uint16_t) {
+		backlog += bytes.size();
+		if(backlog >= max_backlog) {
+			num_pauses++;
+			transport.pause_recv();
+		}
+
+		return 0;
+	}
+
+	/// Keep the source busy, flow control decides how much of it leaves
+	void queue_more() {
+		while(num_sent < total && num_sent - num_acked < max_queued) {
+			Buffer buf(std::min<uint64_t>(100000, total - num_sent));
+			std::memset(buf.data(), 0, buf.size());
+			num_sent += buf.size();
+			client_transport->send(std::move(buf));
+		}
+	}
+
+	void did_send(TransportType &, Buffer &&bytes) {
+		num_acked += bytes.size();
+		queue_more();
+	}
+
+	void did_dial(TransportType &transport) {
+		client_transport = &transport;
+		queue_more();
+	}
+
+	void did_close(TransportType &, uint16_t) {}
+
+	bool should_accept(SocketAddress const &) {
+		return true;
+	}
+
+	void did_create_transport(TransportType &transport) {
+		if(transport.src_addr == server_addr) {
+			server_transport = &transport;
+		}
+		transport.setup(this, static_sk);
+	}
+
+	void did_recv_flush_stream(TransportType &, uint16_t, uint64_t, uint64_t) {}
+
+	void did_recv_skip_stream(TransportType &, uint16_t) {}
+
+	void did_recv_flush_conf(TransportType &, uint16_t) {}
+
+	void report() {
+		SPDLOG_INFO(
+			"Processed {} of {} bytes in {} ms, paused {} times",
+			processed,
+			total,
+			done_tick,
+			num_pauses
+		);
+		SPDLOG_INFO("Peak bytes held by the destination transport: {}", peak_buffered);
+	}
+};
+
+int main(int argc, char** argv) {
+	uint64_t mb = argc > 1 ? std::atoll(argv[1]) : 100;
+	uint64_t app_rate = argc > 2 ? std::atoll(argv[2]) : 5000;
+	uint64_t rtt = argc > 3 ? std::atoll(argv[3]) : 50;
+
+	SPDLOG_INFO("Transfer: {} MB, App rate: {} KB/s, RTT: {} ms", mb, app_rate, rtt);
+
+	crypto_box_keypair(static_pk, static_sk);
+
+	// 100 MB/s link, far faster than the application
+	LinkConditioner link(0, rtt / 2, 100000, 100000 * rtt);
+	NetworkType network(link);
+
+	auto client_addr = SocketAddress::from_string("192.168.0.2:8000");
+
+	Delegate d;
+	d.server_addr = SocketAddress::from_string("192.168.0.1:8000");
+	d.total = mb * 1000000;
+	d.app_quantum = app_rate * 10;
+
+	Delegate::TransportFactoryType s(network.get_or_create_interface(d.server_addr), Simulator::default_instance);
+	Delegate::TransportFactoryType c(network.get_or_create_interface(client_addr), Simulator::default_instance);
+
+	s.bind(d.server_addr);
+	s.listen(d);
+	d.client = &c;
+	c.bind(client_addr);
+
+	// Packets sent before the loop runs are lost
+	d.dial_timer.template start<Delegate, &Delegate::dial_timer_cb>(0, 0);
+	d.app_timer.template start<Delegate, &Delegate::app_timer_cb>(10, 10);
+
+	auto res = EventLoop::run();
+
+	d.report();
+
+	return res;
+}
@@ -0,0 +1,209 @@
+#define MARLIN_ASYNCIO_SIMULATOR
+
+#include <marlin/simulator/core/Simulator.hpp>
+#include <marlin/simulator/transport/SimulatedTransportFactory.hpp>
+#include <marlin/simulator/network/Network.hpp>
+#include <marlin/simulator/network/LinkConditioner.hpp>
+#include <marlin/stream/StreamTransportFactory.hpp>
+#include <marlin/stream/congestion/BbrCongestionControl.hpp>
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <cstdlib>
+
+using namespace marlin::core;
+using namespace marlin::asyncio;
+using namespace marlin::simulator;
+using namespace marlin::stream;
+
+// Compares goodput of congestion control policies over a lossy long haul link
+//
+// Usage: cc_simulated [loss] [rtt ms] [bandwidth Mbps] [transfer MB] [queue ms] [mtu]
+
+using NetworkType = Network<LinkConditioner>;
+using NetworkInterfaceType = NetworkInterface<NetworkType>;
+
+template<typename Delegate>
+using SimTransportType = SimulatedTransport<
+	Simulator,
+	NetworkInterfaceType,
+	Delegate
+>;
+template<typename ListenDelegate, typename TransportDelegate>
+using SimTransportFactoryType = SimulatedTransportFactory<
+	Simulator,
+	NetworkInterfaceType,
+	ListenDelegate,
+	TransportDelegate
+>;
+
+uint8_t static_sk[crypto_box_SECRETKEYBYTES];
+uint8_t static_pk[crypto_box_PUBLICKEYBYTES];
+
+constexpr size_t chunk_size = 100000;
+
+template<typename CongestionControl>
+struct Delegate {
+	using TransportType = StreamTransport<Delegate, SimTransportType, CongestionControl>;
+	using TransportFactoryType = StreamTransportFactory<
+		Delegate,
+		Delegate,
+		SimTransportFactoryType,
+		SimTransportType,
+		CongestionControl
+	>;
+
+	char const* name;
+	uint64_t total = 0;
+	uint64_t received = 0;
+	uint64_t start_tick = 0;
+	uint64_t end_tick = 0;
+	uint16_t pmtu = 0;
+	TransportType* sender = nullptr;
+
+	// Closing from inside did_recv would free the stream being read,
+	// waiting a bit also lets the final acks out so the sender does not time out
+	TransportType* done_transport = nullptr;
+	Timer close_timer;
+
+	Delegate() : close_timer(this) {}
+
+	void close_timer_cb() {
+		done_transport->close();
+	}
+
+	int did_recv(TransportType &transport, Buffer &&packet, uint16_t) {
+		received += packet.size();
+		if(received == total) {
+			end_tick = Simulator::default_instance.current_tick();
+			pmtu = sender->get_pmtu();
+			done_transport = &transport;
+			close_timer.template start<Delegate, &Delegate::close_timer_cb>(100, 0);
+		}
+
+		return 0;
+	}
+
+	void did_send(TransportType &, Buffer &&) {}
+
+	void did_dial(TransportType &transport) {
+		sender = &transport;
+		start_tick = Simulator::default_instance.current_tick();
+
+		for(uint64_t sent = 0; sent < total; sent += chunk_size) {
+			Buffer buf(chunk_size);
+			std::memset(buf.data(), 0, chunk_size);
+			transport.send(std::move(buf));
+		}
+	}
+
+	void did_close(TransportType &, uint16_t) {}
+
+	bool should_accept(SocketAddress const &) {
+		return true;
+	}
+
+	void did_create_transport(TransportType &transport) {
+		transport.setup(this, static_sk);
+	}
+
+	void did_recv_flush_stream(TransportType &, uint16_t, uint64_t, uint64_t) {}
+
+	void did_recv_skip_stream(TransportType &, uint16_t) {}
+
+	void did_recv_flush_conf(TransportType &, uint16_t) {}
+
+	void report() {
+		if(end_tick == 0) {
+			SPDLOG_INFO("{}: incomplete, {} of {} bytes", name, received, total);
+			return;
+		}
+
+		auto ms = end_tick - start_tick;
+		SPDLOG_INFO("{}: {} bytes in {} ms, {:.2f} Mbps, PMTU {}", name, total, ms, received * 8.0 / ms / 1000, pmtu);
+	}
+};
+
+template<typename CongestionControl>
+struct Scenario {
+	using DelegateType = Delegate<CongestionControl>;
+
+	LinkConditioner &link;
+	NetworkType network;
+	typename DelegateType::TransportFactoryType s, c;
+	DelegateType d;
+
+	Scenario(char const* name, LinkConditioner &conditioner, uint64_t total) :
+		link(conditioner),
+		network(conditioner),
+		s(network.get_or_create_interface(SocketAddress::from_string("192.168.0.1:0")), Simulator::default_instance),
+		c(network.get_or_create_interface(SocketAddress::from_string("192.168.0.2:0")), Simulator::default_instance) {
+		d.name = name;
+		d.total = total;
+
+		s.bind(SocketAddress::from_string("192.168.0.1:8000"));
+		s.enable_pmtud();
+		s.listen(d);
+		c.bind(SocketAddress::from_string("192.168.0.2:8000"));
+		c.enable_pmtud();
+		c.dial(SocketAddress::from_string("192.168.0.1:8000"), d, static_pk);
+	}
+
+	void report() {
+		d.report();
+		SPDLOG_INFO(
+			"{}: {} packets, {} lost at random, {} dropped at the bottleneck queue, {} over the mtu, {:.2f}% loss",
+			d.name,
+			link.num_packets,
+			link.num_lost,
+			link.num_overflow,
+			link.num_oversize,
+			(link.num_lost + link.num_overflow) * 100.0 / std::max<uint64_t>(link.num_packets, 1)
+		);
+	}
+};
+
+int main(int argc, char** argv) {
+	double loss = argc > 1 ? std::atof(argv[1]) : 0.01;
+	uint64_t rtt = argc > 2 ? std::atoll(argv[2]) : 150;
+	double mbps = argc > 3 ? std::atof(argv[3]) : 100;
+	uint64_t total = (argc > 4 ? std::atoll(argv[4]) : 20) * 1000000;
+	total = (total + chunk_size - 1) / chunk_size * chunk_size;
+	// Defaults to a queue of one bdp, shallow buffers expose bursty senders
+	uint64_t queue_ms = argc > 5 ? std::atoll(argv[5]) : rtt;
+	// Ethernet by default
+	uint64_t mtu = argc > 6 ? std::atoll(argv[6]) : 1500;
+
+	// Bytes per ms
+	double bandwidth = mbps * 1000 / 8;
+	uint64_t queue_limit = bandwidth * queue_ms;
+
+	SPDLOG_INFO(
+		"Loss: {}, RTT: {} ms, Bandwidth: {} Mbps, Transfer: {} bytes, Queue: {} ms, MTU: {}",
+		loss,
+		rtt,
+		mbps,
+		total,
+		queue_ms,
+		mtu
+	);
+
+	crypto_box_keypair(static_pk, static_sk);
+
+	// Each scenario gets its own link so they do not compete
+	LinkConditioner cubic_link(loss, rtt / 2, bandwidth, queue_limit);
+	LinkConditioner bbr_link(loss, rtt / 2, bandwidth, queue_limit);
+	// Without IPv4 and UDP headers
+	cubic_link.mtu = mtu - 28;
+	bbr_link.mtu = mtu - 28;
+
+	Scenario<CubicCongestionControl> cubic("cubic", cubic_link, total);
+	Scenario<BbrCongestionControl> bbr("bbr", bbr_link, total);
+
+	auto res = EventLoop::run();
+
+	cubic.report();
+	bbr.report();
+
+	return res;
+}
@@ -0,0 +1,206 @@
+#define MARLIN_ASYNCIO_SIMULATOR
+
+#include <marlin/simulator/core/Simulator.hpp>
+#include <marlin/simulator/transport/SimulatedTransportFactory.hpp>
+#include <marlin/simulator/network/Network.hpp>
+#include <marlin/simulator/network/LinkConditioner.hpp>
+#include <marlin/stream/StreamTransportFactory.hpp>
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+using namespace marlin::core;
+using namespace marlin::asyncio;
+using namespace marlin::simulator;
+using namespace marlin::stream;
+
+// Sends an update every 20 ms over a lossy link, either on a stream or as datagrams,
+// then reports how many arrived and how late
+//
+// Usage: datagram_simulated [datagram|stream] [updates] [loss] [rtt ms]
+
+using NetworkType = Network<LinkConditioner>;
+using NetworkInterfaceType = NetworkInterface<NetworkType>;
+
+template<typename Delegate>
+using SimTransportType = SimulatedTransport<
+	Simulator,
+	NetworkInterfaceType,
+	Delegate
+>;
+template<typename ListenDelegate, typename TransportDelegate>
+using SimTransportFactoryType = SimulatedTransportFactory<
+	Simulator,
+	NetworkInterfaceType,
+	ListenDelegate,
+	TransportDelegate
+>;
+
+uint8_t static_sk[crypto_box_SECRETKEYBYTES];
+uint8_t static_pk[crypto_box_PUBLICKEYBYTES];
+
+struct Delegate {
+	using TransportType = StreamTransport<Delegate, SimTransportType>;
+	using TransportFactoryType = StreamTransportFactory<
+		Delegate,
+		Delegate,
+		SimTransportFactoryType,
+		SimTransportType
+	>;
+
+	TransportFactoryType* client = nullptr;
+	SocketAddress server_addr;
+	bool use_datagrams = true;
+	uint64_t num_updates = 0;
+
+	TransportType* client_transport = nullptr;
+	uint64_t num_sent = 0;
+	/// Time from sending to receiving each update which arrived
+	std::vector<uint64_t> latencies;
+
+	Timer send_timer;
+	Timer dial_timer;
+	Timer close_timer;
+
+	Delegate() : send_timer(this), dial_timer(this), close_timer(this) {}
+
+	void send_timer_cb() {
+		if(num_sent == num_updates) {
+			send_timer.stop();
+			// Give stragglers time to arrive
+			close_timer.template start<Delegate, &Delegate::close_timer_cb>(2000, 0);
+			return;
+		}
+
+		// Updates carry the time they were sent
+		Buffer buf(1000);
+		std::memset(buf.data(), 0, buf.size());
+		buf.write_uint64_le_unsafe(0, Simulator::default_instance.current_tick());
+
+		if(use_datagrams) {
+			client_transport->send_datagram(std::move(buf));
+		} else {
+			client_transport->send(std::move(buf));
+		}
+		num_sent++;
+	}
+
+	void dial_timer_cb() {
+		client->dial(server_addr, *this, static_pk);
+	}
+
+	void close_timer_cb() {
+		client_transport->close();
+	}
+
+	void did_recv_update(Buffer &&bytes) {
+		auto sent_tick = bytes.read_uint64_le_unsafe(0);
+		latencies.push_back(Simulator::default_instance.current_tick() - sent_tick);
+	}
+
+	int did_recv(TransportType &, Buffer &&bytes, uint16_t) {
+		did_recv_update(std::move(bytes));
+		return 0;
+	}
+
+	void did_recv_datagram(TransportType &, Buffer &&bytes) {
+		did_recv_update(std::move(bytes));
+	}
+
+	void did_send(TransportType &, Buffer &&) {}
+
+	void did_dial(TransportType &transport) {
+		client_transport = &transport;
+		send_timer.template start<Delegate, &Delegate::send_timer_cb>(0, 20);
+	}
+
+	void did_close(TransportType &, uint16_t) {}
+
+	bool should_accept(SocketAddress const &) {
+		return true;
+	}
+
+	void did_create_transport(TransportType &transport) {
+		transport.setup(this, static_sk);
+	}
+
+	void did_recv_flush_stream(TransportType &, uint16_t, uint64_t, uint64_t) {}
+
+	void did_recv_skip_stream(TransportType &, uint16_t) {}
+
+	void did_recv_flush_conf(TransportType &, uint16_t) {}
+
+	void report() {
+		if(latencies.empty()) {
+			SPDLOG_INFO("Updates: {} sent, none received", num_sent);
+			return;
+		}
+
+		std::sort(latencies.begin(), latencies.end());
+
+		uint64_t total = 0;
+		for(auto latency : latencies) {
+			total += latency;
+		}
+
+		SPDLOG_INFO(
+			"Updates: {} sent, {} received",
+			num_sent,
+			latencies.size()
+		);
+		SPDLOG_INFO(
+			"Latency: mean {} ms, median {} ms, p99 {} ms, max {} ms",
+			total / latencies.size(),
+			latencies[latencies.size() / 2],
+			latencies[latencies.size() * 99 / 100],
+			latencies.back()
+		);
+	}
+};
+
+int main(int argc, char** argv) {
+	bool use_datagrams = argc > 1 ? std::strcmp(argv[1], "stream") != 0 : true;
+	uint64_t num_updates = argc > 2 ? std::atoll(argv[2]) : 500;
+	double loss = argc > 3 ? std::atof(argv[3]) : 0.02;
+	uint64_t rtt = argc > 4 ? std::atoll(argv[4]) : 100;
+
+	SPDLOG_INFO(
+		"Mode: {}, Updates: {}, Loss: {}, RTT: {} ms",
+		use_datagrams ? "datagram" : "stream",
+		num_updates,
+		loss,
+		rtt
+	);
+
+	crypto_box_keypair(static_pk, static_sk);
+
+	LinkConditioner link(loss, rtt / 2, 12500, 12500 * rtt);
+	NetworkType network(link);
+
+	auto client_addr = SocketAddress::from_string("192.168.0.2:8000");
+
+	Delegate d;
+	d.server_addr = SocketAddress::from_string("192.168.0.1:8000");
+	d.use_datagrams = use_datagrams;
+	d.num_updates = num_updates;
+
+	Delegate::TransportFactoryType s(network.get_or_create_interface(d.server_addr), Simulator::default_instance);
+	Delegate::TransportFactoryType c(network.get_or_create_interface(client_addr), Simulator::default_instance);
+
+	s.bind(d.server_addr);
+	s.listen(d);
+	d.client = &c;
+	c.bind(client_addr);
+
+	// Packets sent before the loop runs are lost
+	d.dial_timer.template start<Delegate, &Delegate::dial_timer_cb>(0, 0);
+
+	auto res = EventLoop::run();
+
+	d.report();
+
+	return res;
+}
@@ -0,0 +1,234 @@
+#define MARLIN_ASYNCIO_SIMULATOR
+
+#include <marlin/simulator/core/Simulator.hpp>
+#include <marlin/simulator/transport/SimulatedTransportFactory.hpp>
+#include <marlin/simulator/network/Network.hpp>
+#include <marlin/simulator/network/LinkConditioner.hpp>
+#include <marlin/stream/StreamTransportFactory.hpp>
+#include <marlin/stream/congestion/BbrCongestionControl.hpp>
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+using namespace marlin::core;
+using namespace marlin::asyncio;
+using namespace marlin::simulator;
+using namespace marlin::stream;
+
+// Compares completion times of whole streams with and without forward error correction over a lossy link,
+// blocks are sent one at a time on fresh streams like block propagation does
+//
+// Usage: fec_simulated [loss] [rtt ms] [bandwidth Mbps] [block KB] [blocks] [interval ms]
+
+using NetworkType = Network<LinkConditioner>;
+using NetworkInterfaceType = NetworkInterface<NetworkType>;
+
+template<typename Delegate>
+using SimTransportType = SimulatedTransport<
+	Simulator,
+	NetworkInterfaceType,
+	Delegate
+>;
+template<typename ListenDelegate, typename TransportDelegate>
+using SimTransportFactoryType = SimulatedTransportFactory<
+	Simulator,
+	NetworkInterfaceType,
+	ListenDelegate,
+	TransportDelegate
+>;
+
+uint8_t static_sk[crypto_box_SECRETKEYBYTES];
+uint8_t static_pk[crypto_box_PUBLICKEYBYTES];
+
+struct Delegate {
+	// Loss does not throttle bbr, so completion times show the cost of recovering lost packets
+	using TransportType = StreamTransport<Delegate, SimTransportType, BbrCongestionControl>;
+	using TransportFactoryType = StreamTransportFactory<
+		Delegate,
+		Delegate,
+		SimTransportFactoryType,
+		SimTransportType,
+		BbrCongestionControl
+	>;
+
+	char const* name;
+	bool fec = false;
+	uint64_t block_size = 0;
+	uint64_t num_blocks = 0;
+	uint64_t interval = 0;
+
+	TransportType* sender = nullptr;
+	/// Send and completion ticks of each block, indexed by stream id - 1
+	std::vector<uint64_t> send_ticks;
+	std::vector<uint64_t> recv_ticks;
+	uint64_t num_received = 0;
+
+	Timer block_timer;
+	TransportType* done_transport = nullptr;
+	Timer close_timer;
+
+	Delegate() : block_timer(this), close_timer(this) {}
+
+	void block_timer_cb() {
+		auto idx = send_ticks.size();
+		send_ticks.push_back(Simulator::default_instance.current_tick());
+
+		Buffer buf(block_size);
+		std::memset(buf.data(), 0, block_size);
+		sender->send_stream(std::move(buf), idx + 1, fec);
+
+		if(send_ticks.size() == num_blocks) {
+			block_timer.stop();
+		}
+	}
+
+	void close_timer_cb() {
+		done_transport->close();
+	}
+
+	int did_recv(TransportType &, Buffer &&, uint16_t) {
+		return 0;
+	}
+
+	void did_recv_stream(TransportType &transport, Buffer &&, uint16_t stream_id) {
+		recv_ticks[stream_id - 1] = Simulator::default_instance.current_tick();
+		num_received++;
+
+		// Lets the final acks out before closing
+		if(num_received == num_blocks) {
+			done_transport = &transport;
+			close_timer.template start<Delegate, &Delegate::close_timer_cb>(100, 0);
+		}
+	}
+
+	void did_send(TransportType &, Buffer &&) {}
+
+	void did_dial(TransportType &transport) {
+		sender = &transport;
+		recv_ticks.resize(num_blocks, 0);
+		block_timer.template start<Delegate, &Delegate::block_timer_cb>(0, interval);
+	}
+
+	void did_close(TransportType &, uint16_t) {}
+
+	bool should_accept(SocketAddress const &) {
+		return true;
+	}
+
+	void did_create_transport(TransportType &transport) {
+		transport.setup(this, static_sk);
+	}
+
+	void did_recv_flush_stream(TransportType &, uint16_t, uint64_t, uint64_t) {}
+
+	void did_recv_skip_stream(TransportType &, uint16_t) {}
+
+	void did_recv_flush_conf(TransportType &, uint16_t) {}
+
+	void report() {
+		if(num_received < num_blocks) {
+			SPDLOG_INFO("{}: incomplete, {} of {} blocks", name, num_received, num_blocks);
+			return;
+		}
+
+		std::vector<uint64_t> times;
+		for(size_t i = 0; i < num_blocks; i++) {
+			times.push_back(recv_ticks[i] - send_ticks[i]);
+		}
+		std::sort(times.begin(), times.end());
+
+		auto percentile = [&](double p) {
+			return times[std::min<size_t>(times.size() * p, times.size() - 1)];
+		};
+		SPDLOG_INFO(
+			"{}: {} blocks, completion p50 {} ms, p90 {} ms, p99 {} ms, max {} ms",
+			name,
+			num_blocks,
+			percentile(0.5),
+			percentile(0.9),
+			percentile(0.99),
+			times.back()
+		);
+	}
+};
+
+struct Scenario {
+	LinkConditioner &link;
+	NetworkType network;
+	Delegate::TransportFactoryType s, c;
+	Delegate d;
+
+	Scenario(
+		char const* name,
+		bool fec,
+		LinkConditioner &conditioner,
+		uint64_t block_size,
+		uint64_t num_blocks,
+		uint64_t interval
+	) : link(conditioner),
+		network(conditioner),
+		s(network.get_or_create_interface(SocketAddress::from_string("192.168.0.1:0")), Simulator::default_instance),
+		c(network.get_or_create_interface(SocketAddress::from_string("192.168.0.2:0")), Simulator::default_instance) {
+		d.name = name;
+		d.fec = fec;
+		d.block_size = block_size;
+		d.num_blocks = num_blocks;
+		d.interval = interval;
+
+		s.bind(SocketAddress::from_string("192.168.0.1:8000"));
+		s.listen(d);
+		c.bind(SocketAddress::from_string("192.168.0.2:8000"));
+		c.dial(SocketAddress::from_string("192.168.0.1:8000"), d, static_pk);
+	}
+
+	void report() {
+		d.report();
+		SPDLOG_INFO(
+			"{}: {} packets, {} lost at random, {} dropped at the bottleneck queue",
+			d.name,
+			link.num_packets,
+			link.num_lost,
+			link.num_overflow
+		);
+	}
+};
+
+int main(int argc, char** argv) {
+	double loss = argc > 1 ? std::atof(argv[1]) : 0.01;
+	uint64_t rtt = argc > 2 ? std::atoll(argv[2]) : 100;
+	double mbps = argc > 3 ? std::atof(argv[3]) : 100;
+	uint64_t block_size = (argc > 4 ? std::atoll(argv[4]) : 200) * 1000;
+	uint64_t num_blocks = argc > 5 ? std::atoll(argv[5]) : 200;
+	uint64_t interval = argc > 6 ? std::atoll(argv[6]) : 250;
+
+	// Bytes per ms
+	double bandwidth = mbps * 1000 / 8;
+
+	SPDLOG_INFO(
+		"Loss: {}, RTT: {} ms, Bandwidth: {} Mbps, Block: {} bytes, Blocks: {}, Interval: {} ms",
+		loss,
+		rtt,
+		mbps,
+		block_size,
+		num_blocks,
+		interval
+	);
+
+	crypto_box_keypair(static_pk, static_sk);
+
+	// Each scenario gets its own link so they do not compete, queues of one bdp
+	LinkConditioner plain_link(loss, rtt / 2, bandwidth, bandwidth * rtt);
+	LinkConditioner fec_link(loss, rtt / 2, bandwidth, bandwidth * rtt);
+
+	Scenario plain("plain", false, plain_link, block_size, num_blocks, interval);
+	Scenario fec("fec", true, fec_link, block_size, num_blocks, interval);
+
+	auto res = EventLoop::run();
+
+	plain.report();
+	fec.report();
+
+	return res;
+}
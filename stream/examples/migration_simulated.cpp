@@ -0,0 +1,261 @@
+#define MARLIN_ASYNCIO_SIMULATOR
+
+#include <marlin/simulator/core/Simulator.hpp>
+#include <marlin/simulator/transport/SimulatedTransportFactory.hpp>
+#include <marlin/simulator/network/Network.hpp>
+#include <marlin/simulator/network/LinkConditioner.hpp>
+#include <marlin/stream/StreamTransportFactory.hpp>
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+using namespace marlin::core;
+using namespace marlin::asyncio;
+using namespace marlin::simulator;
+using namespace marlin::stream;
+
+// Sends a message every 20 ms from a client behind a NAT which rebinds to a new port midway,
+// then reports how the connection and the flow of messages fared
+//
+// Usage: migration_simulated [messages] [rebind at ms] [rtt ms]
+
+using NetworkType = Network<LinkConditioner>;
+using NetworkInterfaceType = NetworkInterface<NetworkType>;
+
+template<typename Delegate>
+using SimTransportType = SimulatedTransport<
+	Simulator,
+	NetworkInterfaceType,
+	Delegate
+>;
+template<typename ListenDelegate, typename TransportDelegate>
+using SimTransportFactoryType = SimulatedTransportFactory<
+	Simulator,
+	NetworkInterfaceType,
+	ListenDelegate,
+	TransportDelegate
+>;
+
+uint8_t static_sk[crypto_box_SECRETKEYBYTES];
+uint8_t static_pk[crypto_box_PUBLICKEYBYTES];
+
+/// Maps the client to an outside port of its own address, rebinding moves it to the next port
+struct Nat : public NetworkInterfaceType::NetworkListenerType {
+	NetworkInterfaceType &interface;
+	SocketAddress client_addr;
+	SocketAddress server_addr;
+
+	/// Port the client sends to
+	uint16_t inside_port = 8000;
+	/// Port the server sees the client at
+	uint16_t outside_port = 20000;
+
+	Nat(
+		NetworkInterfaceType &interface,
+		SocketAddress const &client_addr,
+		SocketAddress const &server_addr
+	) : interface(interface), client_addr(client_addr), server_addr(server_addr) {
+		interface.bind(*this, inside_port);
+		interface.bind(*this, outside_port);
+	}
+
+	void did_recv(
+		NetworkInterfaceType &,
+		uint16_t port,
+		SocketAddress const &,
+		Buffer &&packet
+	) override {
+		auto addr = interface.addr;
+		if(port == inside_port) {
+			addr.set_port(outside_port);
+			interface.send(Simulator::default_instance, addr, server_addr, std::move(packet));
+		} else if(port == outside_port) {
+			addr.set_port(inside_port);
+			interface.send(Simulator::default_instance, addr, client_addr, std::move(packet));
+		}
+	}
+
+	void did_close() override {}
+
+	void rebind() {
+		interface.close(outside_port);
+		outside_port++;
+		interface.bind(*this, outside_port);
+
+		SPDLOG_INFO("NAT rebound the client to port {}", outside_port);
+	}
+};
+
+struct Delegate {
+	using TransportType = StreamTransport<Delegate, SimTransportType>;
+	using TransportFactoryType = StreamTransportFactory<
+		Delegate,
+		Delegate,
+		SimTransportFactoryType,
+		SimTransportType
+	>;
+
+	TransportFactoryType* client = nullptr;
+	SocketAddress server_addr;
+	SocketAddress nat_addr;
+	Nat* nat = nullptr;
+	uint64_t num_messages = 0;
+
+	TransportType* client_transport = nullptr;
+	uint64_t num_sent = 0;
+	/// Receive ticks of messages at the server
+	std::vector<uint64_t> recv_ticks;
+	/// Connections seen by the server
+	uint64_t num_server_connections = 0;
+	uint64_t num_migrations = 0;
+	/// Connections the client lost and had to dial again
+	uint64_t num_redials = 0;
+
+	Timer send_timer;
+	Timer rebind_timer;
+	Timer dial_timer;
+
+	Delegate() : send_timer(this), rebind_timer(this), dial_timer(this) {}
+
+	void send_timer_cb() {
+		if(num_sent == num_messages) {
+			send_timer.stop();
+			auto* transport = client_transport;
+			client_transport = nullptr;
+			transport->close();
+			return;
+		}
+
+		Buffer buf(1000);
+		std::memset(buf.data(), 0, buf.size());
+		client_transport->send(std::move(buf));
+		num_sent++;
+	}
+
+	void rebind_timer_cb() {
+		nat->rebind();
+	}
+
+	void dial_timer_cb() {
+		client->dial(nat_addr, *this, static_pk);
+	}
+
+	int did_recv(TransportType &transport, Buffer &&, uint16_t) {
+		if(transport.src_addr == server_addr) {
+			recv_ticks.push_back(Simulator::default_instance.current_tick());
+		}
+
+		return 0;
+	}
+
+	void did_send(TransportType &, Buffer &&) {}
+
+	void did_dial(TransportType &transport) {
+		client_transport = &transport;
+		send_timer.template start<Delegate, &Delegate::send_timer_cb>(0, 20);
+	}
+
+	void did_close(TransportType &transport, uint16_t) {
+		if(&transport != client_transport) {
+			return;
+		}
+
+		// Redial once the old transport is gone if the connection was lost before all messages went out
+		client_transport = nullptr;
+		send_timer.stop();
+		if(num_sent < num_messages) {
+			num_redials++;
+			dial_timer.template start<Delegate, &Delegate::dial_timer_cb>(0, 0);
+		}
+	}
+
+	void did_migrate(TransportType &transport, SocketAddress const &old_addr) {
+		num_migrations++;
+		SPDLOG_INFO(
+			"Server: connection moved from {} to {}",
+			old_addr.to_string(),
+			transport.dst_addr.to_string()
+		);
+	}
+
+	bool should_accept(SocketAddress const &) {
+		return true;
+	}
+
+	void did_create_transport(TransportType &transport) {
+		if(transport.src_addr == server_addr) {
+			num_server_connections++;
+		}
+		transport.setup(this, static_sk);
+	}
+
+	void did_recv_flush_stream(TransportType &, uint16_t, uint64_t, uint64_t) {}
+
+	void did_recv_skip_stream(TransportType &, uint16_t) {}
+
+	void did_recv_flush_conf(TransportType &, uint16_t) {}
+
+	void report() {
+		uint64_t max_gap = 0;
+		for(size_t i = 1; i < recv_ticks.size(); i++) {
+			max_gap = std::max(max_gap, recv_ticks[i] - recv_ticks[i - 1]);
+		}
+
+		SPDLOG_INFO(
+			"Messages: {} sent, {} received, longest gap {} ms",
+			num_sent,
+			recv_ticks.size(),
+			max_gap
+		);
+		SPDLOG_INFO(
+			"Server: {} transports created, {} migrations, client: {} redials",
+			num_server_connections,
+			num_migrations,
+			num_redials
+		);
+	}
+};
+
+int main(int argc, char** argv) {
+	uint64_t num_messages = argc > 1 ? std::atoll(argv[1]) : 200;
+	uint64_t rebind_at = argc > 2 ? std::atoll(argv[2]) : 2000;
+	uint64_t rtt = argc > 3 ? std::atoll(argv[3]) : 100;
+
+	SPDLOG_INFO("Messages: {}, Rebind at: {} ms, RTT: {} ms", num_messages, rebind_at, rtt);
+
+	crypto_box_keypair(static_pk, static_sk);
+
+	// Every packet crosses two links through the NAT
+	LinkConditioner link(0, rtt / 4, 12500, 12500 * rtt);
+	NetworkType network(link);
+
+	auto client_addr = SocketAddress::from_string("192.168.0.2:8000");
+	auto nat_addr = SocketAddress::from_string("192.168.0.3:8000");
+
+	Delegate d;
+	d.server_addr = SocketAddress::from_string("192.168.0.1:8000");
+	d.nat_addr = nat_addr;
+	d.num_messages = num_messages;
+
+	Nat nat(network.get_or_create_interface(nat_addr), client_addr, d.server_addr);
+	d.nat = &nat;
+
+	Delegate::TransportFactoryType s(network.get_or_create_interface(d.server_addr), Simulator::default_instance);
+	Delegate::TransportFactoryType c(network.get_or_create_interface(client_addr), Simulator::default_instance);
+
+	s.bind(d.server_addr);
+	s.listen(d);
+	d.client = &c;
+	c.bind(client_addr);
+	c.dial(nat_addr, d, static_pk);
+
+	d.rebind_timer.template start<Delegate, &Delegate::rebind_timer_cb>(rebind_at, 0);
+
+	auto res = EventLoop::run();
+
+	d.report();
+
+	return res;
+}
@@ -0,0 +1,171 @@
+#define MARLIN_ASYNCIO_SIMULATOR
+
+#include <marlin/simulator/core/Simulator.hpp>
+#include <marlin/simulator/transport/SimulatedTransportFactory.hpp>
+#include <marlin/simulator/network/Network.hpp>
+#include <marlin/simulator/network/LinkConditioner.hpp>
+#include <marlin/stream/StreamTransportFactory.hpp>
+#include <spdlog/spdlog.h>
+
+#include <cstdlib>
+#include <vector>
+
+using namespace marlin::core;
+using namespace marlin::asyncio;
+using namespace marlin::simulator;
+using namespace marlin::stream;
+
+// Measures how long the first message of a connection takes to arrive when the client
+// dials the same server over and over, the first dial does the full handshake and
+// the others resume with the session ticket of the previous connection
+//
+// Usage: resume_simulated [dials] [rtt ms] [loss]
+
+using NetworkType = Network<LinkConditioner>;
+using NetworkInterfaceType = NetworkInterface<NetworkType>;
+
+template<typename Delegate>
+using SimTransportType = SimulatedTransport<
+	Simulator,
+	NetworkInterfaceType,
+	Delegate
+>;
+template<typename ListenDelegate, typename TransportDelegate>
+using SimTransportFactoryType = SimulatedTransportFactory<
+	Simulator,
+	NetworkInterfaceType,
+	ListenDelegate,
+	TransportDelegate
+>;
+
+uint8_t static_sk[crypto_box_SECRETKEYBYTES];
+uint8_t static_pk[crypto_box_PUBLICKEYBYTES];
+
+struct Delegate {
+	using TransportType = StreamTransport<Delegate, SimTransportType>;
+	using TransportFactoryType = StreamTransportFactory<
+		Delegate,
+		Delegate,
+		SimTransportFactoryType,
+		SimTransportType
+	>;
+
+	TransportFactoryType* client = nullptr;
+	SocketAddress server_addr;
+	uint64_t num_dials = 0;
+
+	/// Dial and first message ticks of each connection
+	std::vector<uint64_t> dial_ticks;
+	std::vector<uint64_t> recv_ticks;
+
+	TransportType* done_transport = nullptr;
+	Timer close_timer;
+	Timer dial_timer;
+
+	Delegate() : close_timer(this), dial_timer(this) {}
+
+	void dial() {
+		dial_ticks.push_back(Simulator::default_instance.current_tick());
+		client->dial(server_addr, *this, static_pk);
+	}
+
+	void dial_timer_cb() {
+		dial();
+	}
+
+	void close_timer_cb() {
+		done_transport->close();
+	}
+
+	int did_recv(TransportType &transport, Buffer &&message, uint16_t) {
+		if(transport.src_addr == server_addr) {
+			// Server, echo the first message back
+			recv_ticks.push_back(Simulator::default_instance.current_tick());
+			transport.send(std::move(message));
+		} else {
+			// Client, the echo means the ticket of this connection is in, start over
+			done_transport = &transport;
+			close_timer.template start<Delegate, &Delegate::close_timer_cb>(10, 0);
+		}
+
+		return 0;
+	}
+
+	void did_send(TransportType &, Buffer &&) {}
+
+	void did_dial(TransportType &transport) {
+		Buffer buf(1000);
+		std::memset(buf.data(), 0, buf.size());
+		transport.send(std::move(buf));
+	}
+
+	void did_close(TransportType &transport, uint16_t) {
+		// Redial once the old transport is gone
+		if(transport.src_addr != server_addr && dial_ticks.size() < num_dials) {
+			dial_timer.template start<Delegate, &Delegate::dial_timer_cb>(1000, 0);
+		}
+	}
+
+	bool should_accept(SocketAddress const &) {
+		return true;
+	}
+
+	void did_create_transport(TransportType &transport) {
+		transport.setup(this, static_sk);
+	}
+
+	void did_recv_flush_stream(TransportType &, uint16_t, uint64_t, uint64_t) {}
+
+	void did_recv_skip_stream(TransportType &, uint16_t) {}
+
+	void did_recv_flush_conf(TransportType &, uint16_t) {}
+
+	void report() {
+		for(size_t i = 0; i < dial_ticks.size(); i++) {
+			if(i >= recv_ticks.size()) {
+				SPDLOG_INFO("Dial {}: first message lost", i);
+				continue;
+			}
+
+			SPDLOG_INFO(
+				"Dial {} ({}): first message after {} ms",
+				i,
+				i == 0 ? "first dial" : "redial",
+				recv_ticks[i] - dial_ticks[i]
+			);
+		}
+	}
+};
+
+int main(int argc, char** argv) {
+	uint64_t num_dials = argc > 1 ? std::atoll(argv[1]) : 5;
+	uint64_t rtt = argc > 2 ? std::atoll(argv[2]) : 100;
+	double loss = argc > 3 ? std::atof(argv[3]) : 0;
+
+	SPDLOG_INFO("Dials: {}, RTT: {} ms, Loss: {}", num_dials, rtt, loss);
+
+	crypto_box_keypair(static_pk, static_sk);
+
+	LinkConditioner link(loss, rtt / 2, 12500, 12500 * rtt);
+	NetworkType network(link);
+
+	Delegate d;
+	d.server_addr = SocketAddress::from_string("192.168.0.1:8000");
+	d.num_dials = num_dials;
+
+	Delegate::TransportFactoryType s(network.get_or_create_interface(SocketAddress::from_string("192.168.0.1:0")), Simulator::default_instance);
+	Delegate::TransportFactoryType c(network.get_or_create_interface(SocketAddress::from_string("192.168.0.2:0")), Simulator::default_instance);
+	d.client = &c;
+
+	s.bind(d.server_addr);
+	s.listen(d);
+	c.bind(SocketAddress::from_string("192.168.0.2:8000"));
+	// Dial from inside the event loop like the redials
+	d.dial_timer.template start<Delegate, &Delegate::dial_timer_cb>(0, 0);
+
+	auto res = EventLoop::run();
+
+	d.report();
+
+	return res;
+}
@@ -166,9 +166,9 @@ struct DATAWrapper {
 	MARLIN_MESSAGES_UINT16_FIELD(length, 28);
 	MARLIN_MESSAGES_PAYLOAD_FIELD(30);
 
-	/// Construct a DATA/FIN message with a given payload size
-	DATAWrapper(size_t payload_size, bool is_fin) : base(30 + payload_size) {
-		base.set_payload({0, static_cast<uint8_t>(is_fin)});
+	/// Construct a DATA/FIN message with a given payload size, whole stream DATA uses types 13 and 14
+	DATAWrapper(size_t payload_size, bool is_fin, bool is_whole = false) : base(30 + payload_size) {
+		base.set_payload({0, static_cast<uint8_t>(is_fin + (is_whole ? 13 : 0))});
 	}
 
 	/// Validate the DATA/FIN message
@@ -178,7 +178,14 @@ struct DATAWrapper {
 
 	/// Check if the FIN bit is set
 	bool is_fin_set() const {
-		return base.payload_buffer().read_uint8_unsafe(1) == 1;
+		auto type = base.payload_buffer().read_uint8_unsafe(1);
+		return type == 1 || type == 14;
+	}
+
+	/// Check if the stream is to be delivered whole
+	bool is_whole_set() const {
+		auto type = base.payload_buffer().read_uint8_unsafe(1);
+		return type == 13 || type == 14;
 	}
 };
 
@@ -399,6 +406,229 @@ struct CLOSECONFWrapper {
 	}
 };
 
+/// PROBE message template, padded to the size being probed
+template<typename BaseMessageType>
+struct PROBEWrapper {
+	MARLIN_MESSAGES_BASE(PROBEWrapper);
+	MARLIN_MESSAGES_UINT32_FIELD(src_conn_id, 6, 2);
+	MARLIN_MESSAGES_UINT32_FIELD(dst_conn_id, 2, 6);
+	MARLIN_MESSAGES_UINT64_FIELD(packet_number, 10);
+	MARLIN_MESSAGES_PAYLOAD_FIELD(18);
+
+	/// Construct a PROBE message with a given padding size
+	PROBEWrapper(size_t payload_size) : base(18 + payload_size) {
+		base.set_payload({0, 15});
+	}
+
+	/// Validate the PROBE message
+	[[nodiscard]] bool validate(size_t payload_size) const {
+		return base.payload_buffer().size() >= 18 + payload_size;
+	}
+};
+
+/// REPAIR message template, XOR parity of a group of DATA fragments.
+/// Not acked and not retransmitted, so it carries no packet number.
+template<typename BaseMessageType>
+struct REPAIRWrapper {
+	MARLIN_MESSAGES_BASE(REPAIRWrapper);
+	MARLIN_MESSAGES_UINT32_FIELD(src_conn_id, 6, 2);
+	MARLIN_MESSAGES_UINT32_FIELD(dst_conn_id, 2, 6);
+	MARLIN_MESSAGES_UINT16_FIELD(stream_id, 10);
+	MARLIN_MESSAGES_UINT64_FIELD(offset, 12);
+	MARLIN_MESSAGES_UINT32_FIELD(length, 20);
+	MARLIN_MESSAGES_PAYLOAD_FIELD(24);
+
+	/// Construct a REPAIR message with a given payload size, groups ending the stream use type 17
+	REPAIRWrapper(size_t payload_size, bool is_fin) : base(24 + payload_size) {
+		base.set_payload({0, static_cast<uint8_t>(16 + is_fin)});
+	}
+
+	/// Validate the REPAIR message
+	[[nodiscard]] bool validate(size_t payload_size) const {
+		return base.payload_buffer().size() >= 24 + payload_size;
+	}
+
+	/// Check if the group ends the stream
+	bool is_fin_set() const {
+		return base.payload_buffer().read_uint8_unsafe(1) == 17;
+	}
+};
+
+/// TICKET message template, a session ticket and its secret encrypted for the client,
+/// followed by the tag and the nonce
+template<typename BaseMessageType>
+struct TICKETWrapper {
+	MARLIN_MESSAGES_BASE(TICKETWrapper);
+	MARLIN_MESSAGES_UINT32_FIELD(src_conn_id, 6, 2);
+	MARLIN_MESSAGES_UINT32_FIELD(dst_conn_id, 2, 6);
+	MARLIN_MESSAGES_PAYLOAD_FIELD(10);
+
+	/// Construct a TICKET message to hold the given payload size
+	TICKETWrapper(size_t payload_size) : base(10 + payload_size) {
+		base.set_payload({0, 18});
+	}
+
+	/// Validate the TICKET message
+	[[nodiscard]] bool validate(size_t payload_size) const {
+		return base.payload_buffer().size() >= 10 + payload_size;
+	}
+};
+
+/// RESUME message template, a DIAL payload followed by a session ticket and a random value.
+/// Sent instead of DIAL when resuming, DATA can follow right away.
+template<typename BaseMessageType>
+struct RESUMEWrapper {
+	MARLIN_MESSAGES_BASE(RESUMEWrapper);
+	MARLIN_MESSAGES_UINT32_FIELD(src_conn_id, 6, 2);
+	MARLIN_MESSAGES_UINT32_FIELD(dst_conn_id, 2, 6);
+	MARLIN_MESSAGES_PAYLOAD_FIELD(10);
+
+	/// Construct a RESUME message to hold the given payload size
+	RESUMEWrapper(size_t payload_size) : base(10 + payload_size) {
+		base.set_payload({0, 19});
+	}
+
+	/// Validate the RESUME message
+	[[nodiscard]] bool validate(size_t payload_size) const {
+		return base.payload_buffer().size() >= 10 + payload_size;
+	}
+};
+
+/// RESUMECONF message template, a tag proving the resumed keys followed by the nonce
+template<typename BaseMessageType>
+struct RESUMECONFWrapper {
+	MARLIN_MESSAGES_BASE(RESUMECONFWrapper);
+	MARLIN_MESSAGES_UINT32_FIELD(src_conn_id, 6, 2);
+	MARLIN_MESSAGES_UINT32_FIELD(dst_conn_id, 2, 6);
+	MARLIN_MESSAGES_PAYLOAD_FIELD(10);
+
+	/// Construct a RESUMECONF message to hold the given payload size
+	RESUMECONFWrapper(size_t payload_size) : base(10 + payload_size) {
+		base.set_payload({0, 20});
+	}
+
+	/// Validate the RESUMECONF message
+	[[nodiscard]] bool validate(size_t payload_size) const {
+		return base.payload_buffer().size() >= 10 + payload_size;
+	}
+};
+
+/// PATHCHALLENGE message template, random data the peer has to echo from its new address
+template<typename BaseMessageType>
+struct PATHCHALLENGEWrapper {
+	MARLIN_MESSAGES_BASE(PATHCHALLENGEWrapper);
+	MARLIN_MESSAGES_UINT32_FIELD(src_conn_id, 6, 2);
+	MARLIN_MESSAGES_UINT32_FIELD(dst_conn_id, 2, 6);
+	MARLIN_MESSAGES_PAYLOAD_FIELD(10);
+
+	/// Construct a PATHCHALLENGE message to hold the given payload size
+	PATHCHALLENGEWrapper(size_t payload_size) : base(10 + payload_size) {
+		base.set_payload({0, 21});
+	}
+
+	/// Validate the PATHCHALLENGE message
+	[[nodiscard]] bool validate(size_t payload_size) const {
+		return base.payload_buffer().size() >= 10 + payload_size;
+	}
+};
+
+/// PATHRESPONSE message template, the echoed challenge followed by a tag over it and the nonce
+template<typename BaseMessageType>
+struct PATHRESPONSEWrapper {
+	MARLIN_MESSAGES_BASE(PATHRESPONSEWrapper);
+	MARLIN_MESSAGES_UINT32_FIELD(src_conn_id, 6, 2);
+	MARLIN_MESSAGES_UINT32_FIELD(dst_conn_id, 2, 6);
+	MARLIN_MESSAGES_PAYLOAD_FIELD(10);
+
+	/// Construct a PATHRESPONSE message to hold the given payload size
+	PATHRESPONSEWrapper(size_t payload_size) : base(10 + payload_size) {
+		base.set_payload({0, 22});
+	}
+
+	/// Validate the PATHRESPONSE message
+	[[nodiscard]] bool validate(size_t payload_size) const {
+		return base.payload_buffer().size() >= 10 + payload_size;
+	}
+};
+
+/// DATAGRAM message template
+template<typename BaseMessageType>
+struct DATAGRAMWrapper {
+	MARLIN_MESSAGES_BASE(DATAGRAMWrapper);
+	MARLIN_MESSAGES_UINT32_FIELD(src_conn_id, 6, 2);
+	MARLIN_MESSAGES_UINT32_FIELD(dst_conn_id, 2, 6);
+	MARLIN_MESSAGES_UINT64_FIELD(packet_number, 10);
+	MARLIN_MESSAGES_PAYLOAD_FIELD(18);
+
+	/// Construct a DATAGRAM message with a given payload size
+	DATAGRAMWrapper(size_t payload_size) : base(18 + payload_size) {
+		base.set_payload({0, 23});
+	}
+
+	/// Validate the DATAGRAM message
+	[[nodiscard]] bool validate(size_t payload_size) const {
+		return base.payload_buffer().size() >= 18 + payload_size;
+	}
+};
+
+/// MAXDATA message template
+template<typename BaseMessageType>
+struct MAXDATAWrapper {
+	MARLIN_MESSAGES_BASE(MAXDATAWrapper);
+	MARLIN_MESSAGES_UINT32_FIELD(src_conn_id, 6, 2);
+	MARLIN_MESSAGES_UINT32_FIELD(dst_conn_id, 2, 6);
+	MARLIN_MESSAGES_UINT64_FIELD(max_data, 10);
+
+	/// Construct a MAXDATA message
+	MAXDATAWrapper() : base(18) {
+		base.set_payload({0, 24});
+	}
+
+	/// Validate the MAXDATA message
+	[[nodiscard]] bool validate() const {
+		return base.payload_buffer().size() >= 18;
+	}
+};
+
+/// MAXSTREAMDATA message template
+template<typename BaseMessageType>
+struct MAXSTREAMDATAWrapper {
+	MARLIN_MESSAGES_BASE(MAXSTREAMDATAWrapper);
+	MARLIN_MESSAGES_UINT32_FIELD(src_conn_id, 6, 2);
+	MARLIN_MESSAGES_UINT32_FIELD(dst_conn_id, 2, 6);
+	MARLIN_MESSAGES_UINT16_FIELD(stream_id, 10);
+	MARLIN_MESSAGES_UINT64_FIELD(max_offset, 12);
+
+	/// Construct a MAXSTREAMDATA message
+	MAXSTREAMDATAWrapper() : base(20) {
+		base.set_payload({0, 25});
+	}
+
+	/// Validate the MAXSTREAMDATA message
+	[[nodiscard]] bool validate() const {
+		return base.payload_buffer().size() >= 20;
+	}
+};
+
+/// BLOCKED message template
+template<typename BaseMessageType>
+struct BLOCKEDWrapper {
+	MARLIN_MESSAGES_BASE(BLOCKEDWrapper);
+	MARLIN_MESSAGES_UINT32_FIELD(src_conn_id, 6, 2);
+	MARLIN_MESSAGES_UINT32_FIELD(dst_conn_id, 2, 6);
+	MARLIN_MESSAGES_UINT16_FIELD(stream_id, 10);
+
+	/// Construct a BLOCKED message
+	BLOCKEDWrapper() : base(12) {
+		base.set_payload({0, 26});
+	}
+
+	/// Validate the BLOCKED message
+	[[nodiscard]] bool validate() const {
+		return base.payload_buffer().size() >= 12;
+	}
+};
+
 #undef MARLIN_MESSAGES_UINT16_FIELD
 #undef MARLIN_MESSAGES_UINT32_FIELD
 #undef MARLIN_MESSAGES_UINT64_FIELD
@@ -21,6 +21,9 @@
 #include "protocol/SendStream.hpp"
 #include "protocol/RecvStream.hpp"
 #include "protocol/AckRanges.hpp"
+#include "protocol/SentPackets.hpp"
+#include "congestion/CubicCongestionControl.hpp"
+#include "congestion/Pacer.hpp"
 #include "Messages.hpp"
 
 namespace marlin {
@@ -28,8 +31,6 @@ namespace stream {
 
 /// Timeout when no acks are received, used by the TLP timer
 #define DEFAULT_TLP_INTERVAL 1000
-/// Bytes that can be sent in a given batch, used by the packet pacing mechanism
-#define DEFAULT_PACING_LIMIT 400000
 /// Bytes that can be sent in a single packet to prevent fragmentation, accounts for header overheads
 #define DEFAULT_FRAGMENT_SIZE 1350
 
@@ -163,13 +164,10 @@ private:
 	/// Packet number of last sent packet.
 	/// Strictly increasing, retransmitted packets have different packet number than the original
 	uint64_t last_sent_packet = -1;
-	/// List of sent packets which have not been acked yet
-	std::map<uint64_t, SentPacketInfo> sent_packets;
-
-	/// List of packets marked as lost.
-	/// Can happen if packets sent much later were acknowledged.
-	/// Can happen if an ack is not received for a long time.
-	std::map<uint64_t, SentPacketInfo> lost_packets;
+	/// Sent packets which have not been acked yet, either in flight or marked as lost.
+	/// Packets are marked lost if packets sent much later were acknowledged
+	/// or if an ack is not received for a long time.
+	SentPackets sent_packets;
 
 	// RTT estimate
 	/// RTT estimate of connection
@@ -177,11 +175,7 @@ private:
 
 	// Congestion control
 	uint64_t bytes_in_flight = 0;
-	uint64_t k = 0;
-	uint64_t w_max = 0;
-	uint64_t congestion_window = 100000;
-	uint64_t ssthresh = -1;
-	uint64_t congestion_start = 0;
+	CubicCongestionControl cc;
 	uint64_t largest_acked = 0;
 	uint64_t largest_sent_time = 0;
 
@@ -200,17 +194,25 @@ private:
 	/// Packets are paced using the pacing timer.
 	void send_pending_data();
 	/// Send any lost data if possible
-	int send_lost_data(uint64_t initial_bytes_in_flight);
+	int send_lost_data();
 	/// Send any new data if possible
-	int send_new_data(SendStream &stream, uint64_t initial_bytes_in_flight);
+	int send_new_data(SendStream &stream);
 
 	// Pacing
-	/// Timer to enforce packet pacing
+	/// Timer to wake up for the next paced departure
 	asyncio::Timer pacing_timer;
 	/// Is the pacing timer active?
 	bool is_pacing_timer_active = false;
+	/// Departure schedule at the congestion control pacing rate
+	Pacer pacer;
+	/// Start of the current burst, packets departing up to it are sent
+	uint64_t pacing_now = 0;
 	/// Pacing timer callback to send a new batch of packets
 	void pacing_timer_cb();
+	/// Take the next departure slot for a packet, false if it has to wait for a later burst
+	bool pace(uint64_t length);
+	/// Start the pacing timer for the next departure
+	void schedule_pacing();
 
 	// TLP (Tail Loss Probe)
 	/// Timer to detect no acks for a long time
@@ -223,6 +225,8 @@ private:
 	// ACKs
 	/// Stores ranges of packet numbers that have and haven't been seen
 	AckRanges ack_ranges;
+	/// Seen ranges per ACK frame, 171 runs fill a packet
+	static constexpr size_t ack_frame_ranges = 86;
 	/// Timer to batch acks for multiple packets
 	asyncio::Timer ack_timer;
 	/// Is the ack timer active?
@@ -363,16 +367,11 @@ void StreamFiber<ExtFabric>::reset() {
 
 	last_sent_packet = -1;
 	sent_packets.clear();
-	lost_packets.clear();
 
 	rtt = -1;
 
 	bytes_in_flight = 0;
-	k = 0;
-	w_max = 0;
-	congestion_window = 100000;
-	ssthresh = -1;
-	congestion_start = 0;
+	cc = CubicCongestionControl();
 	largest_acked = 0;
 	largest_sent_time = 0;
 
@@ -381,6 +380,7 @@ void StreamFiber<ExtFabric>::reset() {
 
 	pacing_timer.stop();
 	is_pacing_timer_active = false;
+	pacer = Pacer();
 
 	tlp_timer.stop();
 	tlp_interval = DEFAULT_TLP_INTERVAL;
@@ -473,25 +473,22 @@ void StreamFiber<ExtFabric>::send_pending_data() {
 }
 
 template<typename ExtFabric>
-int StreamFiber<ExtFabric>::send_lost_data(
-	uint64_t initial_bytes_in_flight
-) {
+int StreamFiber<ExtFabric>::send_lost_data() {
 	for(
-		auto iter = lost_packets.begin();
-		iter != lost_packets.end();
-		iter = lost_packets.erase(iter)
+		auto pn = sent_packets.next_lost(sent_packets.begin());
+		pn != sent_packets.end();
+		pn = sent_packets.next_lost(pn)
 	) {
-		if(bytes_in_flight - initial_bytes_in_flight >= DEFAULT_PACING_LIMIT) {
-			// Pacing limit hit, reschedule timer
-			is_pacing_timer_active = true;
-			pacing_timer.template start<SelfType, &SelfType::pacing_timer_cb>(1, 0);
-			return -1;
+		// Copy, sending grows the packet ring
+		auto sent_packet = sent_packets.at(pn);
+		if(bytes_in_flight + sent_packet.length > cc.window()) {
+			return -2;
 		}
 
-		auto &sent_packet = iter->second;
-		if(bytes_in_flight > congestion_window - sent_packet.length) {
-			return -2;
+		if(!pace(sent_packet.length)) {
+			return -1;
 		}
+		sent_packets.erase(pn);
 
 		send_DATA(
 			*sent_packet.stream,
@@ -511,8 +508,7 @@ int StreamFiber<ExtFabric>::send_lost_data(
 
 template<typename ExtFabric>
 int StreamFiber<ExtFabric>::send_new_data(
-	SendStream &stream,
-	uint64_t initial_bytes_in_flight
+	SendStream &stream
 ) {
 	for(
 		;
@@ -523,16 +519,16 @@ int StreamFiber<ExtFabric>::send_new_data(
 
 		for(
 			uint64_t i = data_item.sent_offset;
-			i < data_item.data.size();
+			i < data_item.size();
 			i+=DEFAULT_FRAGMENT_SIZE
 		) {
-			auto remaining_bytes = data_item.data.size() - data_item.sent_offset;
+			auto remaining_bytes = data_item.size() - data_item.sent_offset;
 			uint16_t dsize = remaining_bytes > DEFAULT_FRAGMENT_SIZE ? DEFAULT_FRAGMENT_SIZE : remaining_bytes;
 
-			if(this->bytes_in_flight > this->congestion_window - dsize)
+			if(this->bytes_in_flight + dsize > this->cc.window())
 				return -2;
 
-			if(this->bytes_in_flight - initial_bytes_in_flight > DEFAULT_PACING_LIMIT) {
+			if(!pace(dsize)) {
 				return -1;
 			}
 
@@ -557,9 +553,13 @@ template<typename ExtFabric>
 void StreamFiber<ExtFabric>::pacing_timer_cb() {
 	this->is_pacing_timer_active = false;
 
-	auto initial_bytes_in_flight = this->bytes_in_flight;
+	pacer.set_rate(cc.pacing_rate());
+	pacing_now = asyncio::EventLoop::now_ns();
 
-	auto res = this->send_lost_data(initial_bytes_in_flight);
+	auto res = this->send_lost_data();
+	if(res == -1) {
+		schedule_pacing();
+	}
 	if(res < 0) {
 		return;
 	}
@@ -572,14 +572,12 @@ void StreamFiber<ExtFabric>::pacing_timer_cb() {
 	) {
 		auto &stream = **iter;
 
-		int res = this->send_new_data(stream, initial_bytes_in_flight);
+		int res = this->send_new_data(stream);
 		if(res == 0) { // Idle stream, move to next stream
 			this->send_queue_ids.erase(stream.stream_id);
 			iter = this->send_queue.erase(iter);
 		} else if(res == -1) { // Pacing limit hit, reschedule timer
-			// Pacing limit hit, reschedule timer
-			this->is_pacing_timer_active = true;
-			pacing_timer.template start<SelfType, &SelfType::pacing_timer_cb>(1, 0);
+			schedule_pacing();
 			return;
 		} else { // Congestion window exhausted, break
 			return;
@@ -587,6 +585,27 @@ void StreamFiber<ExtFabric>::pacing_timer_cb() {
 	}
 }
 
+template<typename ExtFabric>
+void StreamFiber<ExtFabric>::schedule_pacing() {
+	// Wake up for the next departure, timers have millisecond resolution
+	auto wait = pacer.departure_time(pacing_now) - pacing_now;
+	auto timeout = std::max<uint64_t>((wait + 999999) / 1000000, 1);
+
+	this->is_pacing_timer_active = true;
+	pacing_timer.template start<SelfType, &SelfType::pacing_timer_cb>(timeout, 0);
+}
+
+template<typename ExtFabric>
+bool StreamFiber<ExtFabric>::pace(uint64_t length) {
+	auto departure = pacer.departure_time(pacing_now);
+	if(departure > pacing_now) {
+		return false;
+	}
+	pacer.on_send(departure, length);
+
+	return true;
+}
+
 //---------------- Pacing functions end ----------------//
 
 
@@ -594,63 +613,49 @@ void StreamFiber<ExtFabric>::pacing_timer_cb() {
 
 template<typename ExtFabric>
 void StreamFiber<ExtFabric>::tlp_timer_cb() {
-	if(this->sent_packets.size() == 0 && this->lost_packets.size() == 0 && this->send_queue.size() == 0) {
+	if(this->sent_packets.empty() && this->send_queue.size() == 0) {
 		// Idle connection, stop timer
 		tlp_timer.stop();
 		this->tlp_interval = DEFAULT_TLP_INTERVAL;
 		return;
 	}
 
-	SPDLOG_DEBUG("TLP timer: {}, {}, {}", this->sent_packets.size(), this->lost_packets.size(), this->send_queue.size() == 0);
+	SPDLOG_DEBUG("TLP timer: {}, {}, {}", this->sent_packets.num_in_flight(), this->sent_packets.num_lost(), this->send_queue.size() == 0);
 
-	auto sent_iter = this->sent_packets.cbegin();
+	uint64_t last_lost = this->sent_packets.end();
+	uint64_t lost_bytes = 0;
 
 	// Retry lost packets
 	// No condition necessary, all are considered lost if tail probe fails
-	while(sent_iter != this->sent_packets.cend()) {
-		this->bytes_in_flight -= sent_iter->second.length;
-		sent_iter->second.stream->bytes_in_flight -= sent_iter->second.length;
-		this->lost_packets[sent_iter->first] = sent_iter->second;
+	for(
+		auto pn = this->sent_packets.next_in_flight(this->sent_packets.begin());
+		pn != this->sent_packets.end();
+		pn = this->sent_packets.next_in_flight(pn + 1)
+	) {
+		auto &sent_packet = this->sent_packets.at(pn);
+		this->bytes_in_flight -= sent_packet.length;
+		sent_packet.stream->bytes_in_flight -= sent_packet.length;
+		this->sent_packets.mark_lost(pn);
 
-		sent_iter++;
+		last_lost = pn;
+		lost_bytes += sent_packet.length;
 	}
 
-	if(sent_iter == this->sent_packets.cbegin()) {
+	if(last_lost == this->sent_packets.end()) {
 		// No lost packets, ignore
-	} else {
-		// Lost packets, congestion event
-		auto last_iter = std::prev(sent_iter);
-		auto &sent_packet = last_iter->second;
-		if(sent_packet.sent_time > this->congestion_start) {
-			// New congestion event
-			SPDLOG_DEBUG(
-				"Stream transport {{ Src: {}, Dst: {} }}: Timer congestion event: {}",
-				this->src_addr.to_string(),
-				this->dst_addr.to_string(),
-				this->congestion_window
-			);
-			this->congestion_start = asyncio::EventLoop::now();
-
-			if(this->congestion_window < this->w_max) {
-				// Fast convergence
-				this->w_max = this->congestion_window;
-				this->congestion_window *= 0.6;
-			} else {
-				this->w_max = this->congestion_window;
-				this->congestion_window *= 0.75;
-			}
-
-			if(this->congestion_window < 10000) {
-				this->congestion_window = 10000;
-			}
-
-			this->ssthresh = this->congestion_window;
-
-			this->k = std::cbrt(this->w_max / 16)*1000;
-		}
-
-		// Pop lost packets from sent
-		this->sent_packets.erase(this->sent_packets.cbegin(), sent_iter);
+	} else if(this->cc.on_loss(
+		asyncio::EventLoop::now(),
+		this->sent_packets.at(last_lost),
+		lost_bytes,
+		this->bytes_in_flight
+	)) {
+		// New congestion event
+		SPDLOG_DEBUG(
+			"Stream transport {{ Src: {}, Dst: {} }}: Timer congestion event: {}",
+			this->src_addr.to_string(),
+			this->dst_addr.to_string(),
+			this->cc.window()
+		);
 	}
 
 	// New packets
@@ -1179,7 +1184,7 @@ void StreamFiber<ExtFabric>::send_DATA(
 
 	// Figure out better way
 	packet.uncover_unsafe(30);
-	packet.write_unsafe(30, data_item.data.data()+offset, length);
+	data_item.read_unsafe(offset, packet.data() + 30, length);
 	packet.write_unsafe(30 + length + crypto_aead_aes256gcm_ABYTES, nonce, 12);
 
 	if constexpr (is_encrypted) {
@@ -1197,17 +1202,15 @@ void StreamFiber<ExtFabric>::send_DATA(
 		sodium_increment(nonce, 12);
 	}
 
-	this->sent_packets.emplace(
-		std::piecewise_construct,
-		std::forward_as_tuple(this->last_sent_packet),
-		std::forward_as_tuple(
-			asyncio::EventLoop::now(),
-			&stream,
-			&data_item,
-			offset,
-			length
-		)
+	SentPacketInfo sent_packet(
+		asyncio::EventLoop::now(),
+		&stream,
+		&data_item,
+		offset,
+		length
 	);
+	this->cc.on_send(sent_packet.sent_time, sent_packet, this->bytes_in_flight);
+	this->sent_packets.add(this->last_sent_packet, sent_packet);
 
 	this->ext_fabric.template inner_call<"send"_tag>(*this, std::move(packet), dst_addr);
 
@@ -1391,18 +1394,24 @@ void StreamFiber<ExtFabric>::did_recv_DATA(
 
 template<typename ExtFabric>
 void StreamFiber<ExtFabric>::send_ACK() {
-	size_t size = ack_ranges.ranges.size() > 171 ? 171 : ack_ranges.ranges.size();
-
-	this->ext_fabric.template inner_call<"send"_tag>(
-		*this,
-		ACK(size)
-		.set_src_conn_id(src_conn_id)
-		.set_dst_conn_id(dst_conn_id)
-		.set_packet_number(ack_ranges.largest)
-		.set_size(size)
-		.set_ranges(ack_ranges.ranges.begin(), ack_ranges.ranges.end()),
-		dst_addr
-	);
+	// Runs from a given seen range go out together in an ACK, up to what fits in a packet.
+	// Older frames go first so their packets are acked before the newest frame can declare them lost.
+	auto num_frames = (ack_ranges.size() + ack_frame_ranges - 1) / ack_frame_ranges;
+	for(size_t frame = num_frames; frame-- > 0;) {
+		auto idx = frame * ack_frame_ranges;
+		size_t size = ack_ranges.num_runs(idx, ack_frame_ranges);
+
+		this->ext_fabric.template inner_call<"send"_tag>(
+			*this,
+			ACK(size)
+			.set_src_conn_id(src_conn_id)
+			.set_dst_conn_id(dst_conn_id)
+			.set_packet_number(ack_ranges.range(idx).high)
+			.set_size(size)
+			.set_ranges(ack_ranges.runs_begin(idx), ack_ranges.runs_end()),
+			dst_addr
+		);
+	}
 }
 
 template<typename ExtFabric>
@@ -1438,8 +1447,9 @@ void StreamFiber<ExtFabric>::did_recv_ACK(
 	uint64_t largest = packet.packet_number();
 
 	// New largest acked packet
-	if(largest > largest_acked && sent_packets.find(largest) != sent_packets.end()) {
-		auto &sent_packet = sent_packets[largest];
+	auto *largest_packet = sent_packets.in_flight(largest);
+	if(largest > largest_acked && largest_packet != nullptr) {
+		auto &sent_packet = *largest_packet;
 
 		// Update largest packet details
 		largest_acked = largest;
@@ -1455,7 +1465,7 @@ void StreamFiber<ExtFabric>::did_recv_ACK(
 
 	uint64_t high = largest;
 	bool gap = false;
-	bool is_app_limited = (bytes_in_flight < 0.8 * congestion_window);
+	bool is_app_limited = (bytes_in_flight < 0.8 * cc.window());
 
 	for(
 		auto iter = packet.ranges_begin();
@@ -1472,17 +1482,14 @@ void StreamFiber<ExtFabric>::did_recv_ACK(
 			continue;
 		}
 
-		// Get packets within range [low+1, high]
-		auto low_iter = sent_packets.lower_bound(low + 1);
-		auto high_iter = sent_packets.upper_bound(high);
-
-		// Iterate acked packets
+		// Iterate acked packets within range [low+1, high]
 		for(
-			;
-			low_iter != high_iter;
-			low_iter = sent_packets.erase(low_iter)
+			auto pn = sent_packets.next_in_flight(low + 1);
+			pn != sent_packets.end() && pn <= high;
+			pn = sent_packets.next_in_flight(pn)
 		) {
-			auto &sent_packet = low_iter->second;
+			auto sent_packet = sent_packets.at(pn);
+			sent_packets.erase(pn);
 			auto &stream = *sent_packet.stream;
 
 			auto sent_offset = sent_packet.data_item->stream_offset + sent_packet.offset;
@@ -1518,7 +1525,7 @@ void StreamFiber<ExtFabric>::did_recv_ACK(
 					iter != stream.data_queue.end();
 					iter = stream.data_queue.erase(iter)
 				) {
-					if(stream.acked_offset < iter->stream_offset + iter->data.size()) {
+					if(stream.acked_offset < iter->stream_offset + iter->size()) {
 						// Still not fully acked, skip erase and abort
 						fully_acked = false;
 						break;
@@ -1542,28 +1549,8 @@ void StreamFiber<ExtFabric>::did_recv_ACK(
 			stream.bytes_in_flight -= sent_packet.length;
 			bytes_in_flight -= sent_packet.length;
 
-			SPDLOG_TRACE("Times: {}, {}", sent_packet.sent_time, congestion_start);
-
 			// Congestion control
-			// Check if not in congestion recovery and not application limited
-			if(sent_packet.sent_time > congestion_start && !is_app_limited) {
-				if(congestion_window < ssthresh) {
-					// Slow start, exponential increase
-					congestion_window += sent_packet.length;
-				} else {
-					// Congestion avoidance, CUBIC
-					// auto k = k;
-					// auto t = now - congestion_start;
-					// congestion_window = w_max + 4 * std::pow(0.001 * (t - k), 3);
-
-					// if(congestion_window < 10000) {
-					// 	congestion_window = 10000;
-					// }
-
-					// Congestion avoidance, NEW RENO
-					congestion_window += 1500 * sent_packet.length / congestion_window;
-				}
-			}
+			cc.on_ack(now, sent_packet, bytes_in_flight, is_app_limited);
 
 			// Check stream finish
 			if (stream.state == SendStream::State::Sent &&
@@ -1583,70 +1570,53 @@ void StreamFiber<ExtFabric>::did_recv_ACK(
 		high = low;
 	}
 
-	auto sent_iter = sent_packets.begin();
+	uint64_t last_lost = sent_packets.end();
+	uint64_t lost_bytes = 0;
 
 	// Determine lost packets
-	while(sent_iter != sent_packets.end()) {
+	for(
+		auto pn = sent_packets.next_in_flight(sent_packets.begin());
+		pn != sent_packets.end();
+		pn = sent_packets.next_in_flight(pn + 1)
+	) {
+		auto &sent_packet = sent_packets.at(pn);
+
 		// Condition for packet in flight to be considered lost
 		// 1. more than 20 packets before largest acked - disabled for now
 		// 2. more than 25ms before before largest acked
-		if (/*sent_iter->first + 20 < largest_acked ||*/
-			largest_sent_time > sent_iter->second.sent_time + 50) {
+		if (/*pn + 20 < largest_acked ||*/
+			largest_sent_time > sent_packet.sent_time + 50) {
 			SPDLOG_TRACE(
 				"Stream transport {{ Src: {}, Dst: {} }}: Lost packet: {}, {}, {}",
 				src_addr.to_string(),
 				dst_addr.to_string(),
-				sent_iter->first,
+				pn,
 				largest_sent_time,
-				sent_iter->second.sent_time
+				sent_packet.sent_time
 			);
 
-			bytes_in_flight -= sent_iter->second.length;
-			sent_iter->second.stream->bytes_in_flight -= sent_iter->second.length;
-			lost_packets[sent_iter->first] = sent_iter->second;
+			bytes_in_flight -= sent_packet.length;
+			sent_packet.stream->bytes_in_flight -= sent_packet.length;
+			sent_packets.mark_lost(pn);
 
-			sent_iter++;
+			last_lost = pn;
+			lost_bytes += sent_packet.length;
 		} else {
 			break;
 		}
 	}
 
-	if(sent_iter == sent_packets.begin()) {
+	if(last_lost == sent_packets.end()) {
 		// No lost packets, ignore
-	} else {
-		// Lost packets, congestion event
-		auto last_iter = std::prev(sent_iter);
-		auto &sent_packet = last_iter->second;
-
-		if(sent_packet.sent_time > congestion_start) {
-			// New congestion event
-			SPDLOG_DEBUG(
-				"Stream transport {{ Src: {}, Dst: {} }}: Congestion event: {}, {}",
-				src_addr.to_string(),
-				dst_addr.to_string(),
-				congestion_window,
-				last_iter->first
-			);
-			congestion_start = now;
-
-			if(congestion_window < w_max) {
-				// Fast convergence
-				w_max = congestion_window;
-				congestion_window *= 0.6;
-			} else {
-				w_max = congestion_window;
-				congestion_window *= 0.75;
-			}
-
-			if(congestion_window < 10000) {
-				congestion_window = 10000;
-			}
-			ssthresh = congestion_window;
-			k = std::cbrt(w_max / 16)*1000;
-		}
-
-		// Pop lost packets from sent
-		sent_packets.erase(sent_packets.begin(), sent_iter);
+	} else if(cc.on_loss(now, sent_packets.at(last_lost), lost_bytes, bytes_in_flight)) {
+		// Lost packets, new congestion event
+		SPDLOG_DEBUG(
+			"Stream transport {{ Src: {}, Dst: {} }}: Congestion event: {}, {}",
+			src_addr.to_string(),
+			dst_addr.to_string(),
+			cc.window(),
+			last_lost
+		);
 	}
 
 	// New packets
@@ -2011,7 +1981,11 @@ int StreamFiber<ExtFabric>::did_recv(
 		// DATA
 		case 0:
 		// DATA + FIN
-		case 1: did_recv_DATA(std::move(packet));
+		case 1:
+		// DATA, whole stream
+		case 13:
+		// DATA + FIN, whole stream
+		case 14: did_recv_DATA(std::move(packet));
 		break;
 		// ACK
 		case 2: did_recv_ACK(std::move(packet));
@@ -2087,6 +2061,12 @@ int StreamFiber<ExtFabric>::did_send(
 		// FLUSHCONF
 		case 9: SPDLOG_TRACE("FLUSHCONF >>> {}", dst_addr.to_string());
 		break;
+		// DATA, whole stream
+		case 13: SPDLOG_TRACE("DATA WHOLE >>> {}", dst_addr.to_string());
+		break;
+		// DATA + FIN, whole stream
+		case 14: SPDLOG_TRACE("DATA WHOLE + FIN >>> {}", dst_addr.to_string());
+		break;
 		// UNKNOWN
 		default: SPDLOG_TRACE("UNKNOWN >>> {}", dst_addr.to_string());
 		break;
@@ -2157,7 +2137,7 @@ int StreamFiber<ExtFabric>::send(
 	}
 
 	// Handle idle connection
-	if(sent_packets.size() == 0 && lost_packets.size() == 0 && send_queue.size() == 0) {
+	if(sent_packets.empty() && send_queue.size() == 0) {
 		tlp_timer.template start<SelfType, &SelfType::tlp_timer_cb>(tlp_interval, 0);
 	}
 
@@ -2297,28 +2277,19 @@ void StreamFiber<ExtFabric>::flush_stream(
 ) {
 	auto &stream = get_or_create_send_stream(stream_id);
 
-	// Remove previously sent packets
-	auto sent_iter = sent_packets.cbegin();
-	while(sent_iter != sent_packets.cend()) {
-		if(sent_iter->second.stream->stream_id != stream.stream_id) {
-			sent_iter++;
-			continue;
-		}
-
-		bytes_in_flight -= sent_iter->second.length;
-		sent_iter = sent_packets.erase(sent_iter);
-	}
-
-	// Remove lost packets
-	auto lost_iter = lost_packets.cbegin();
-	while(lost_iter != lost_packets.cend()) {
-		if(lost_iter->second.stream->stream_id != stream.stream_id) {
-			lost_iter++;
+	// Remove previously sent and lost packets
+	for(
+		auto pn = sent_packets.begin();
+		pn != sent_packets.end();
+		pn++
+	) {
+		auto *sent_packet = sent_packets.find(pn);
+		if(sent_packet == nullptr || sent_packet->stream->stream_id != stream.stream_id) {
 			continue;
 		}
 
-		bytes_in_flight -= lost_iter->second.length;
-		lost_iter = lost_packets.erase(lost_iter);
+		bytes_in_flight -= sent_packet->length;
+		sent_packets.erase(pn);
 	}
 
 	stream.data_queue.clear();
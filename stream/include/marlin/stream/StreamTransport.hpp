@@ -3,22 +3,36 @@
 
 #include <spdlog/spdlog.h>
 #include <spdlog/fmt/bin_to_hex.h>
-#include <unordered_set>
+#include <algorithm>
+#include <cstring>
+#include <deque>
 #include <unordered_map>
 #include <random>
 #include <utility>
+#include <vector>
 
 #include <sodium.h>
 
 #include <marlin/core/SocketAddress.hpp>
 #include <marlin/core/Buffer.hpp>
+#include <marlin/core/BufferChain.hpp>
 #include <marlin/asyncio/core/EventLoop.hpp>
 #include <marlin/asyncio/core/Timer.hpp>
 #include <marlin/core/TransportManager.hpp>
 
 #include "protocol/SendStream.hpp"
+#include "protocol/SendQueue.hpp"
 #include "protocol/RecvStream.hpp"
 #include "protocol/AckRanges.hpp"
+#include "protocol/SentPackets.hpp"
+#include "protocol/PmtuDiscovery.hpp"
+#include "protocol/Fec.hpp"
+#include "protocol/SessionTickets.hpp"
+#include "protocol/ConnectionIds.hpp"
+#include "protocol/FlowControl.hpp"
+#include "protocol/ClosedStreams.hpp"
+#include "congestion/CubicCongestionControl.hpp"
+#include "congestion/Pacer.hpp"
 #include "Messages.hpp"
 
 namespace marlin {
@@ -26,10 +40,6 @@ namespace stream {
 
 /// Timeout when no acks are received, used by the TLP timer
 #define DEFAULT_TLP_INTERVAL 1000
-/// Bytes that can be sent in a given batch, used by the packet pacing mechanism
-#define DEFAULT_PACING_LIMIT 400000
-/// Bytes that can be sent in a single packet to prevent fragmentation, accounts for header overheads
-#define DEFAULT_FRAGMENT_SIZE 1350
 
 /// @brief Transport class which provides stream semantics.
 ///
@@ -38,17 +48,28 @@ namespace stream {
 /// Features:
 /// \li In-order delivery
 /// \li Reliable delivery
-/// \li Congestion control
+/// \li Congestion control, pluggable through the CongestionControl policy
+/// \li Per packet pacing at the congestion control rate, with kernel departure times where available
+/// \li Path MTU discovery over datagram transports which do not fragment
+/// \li Forward error correction for whole streams, opted into per stream
 /// \li Transport layer encryption (disabled by default)
-/// \li Stream multiplexing
+/// \li 0-RTT resumption with single use session tickets
+/// \li Connections follow peers to new addresses, such as after a NAT rebinding, once the address is validated
+/// \li Flow control on streams and connections, receivers bound what they buffer and can push back
+/// \li Unreliable datagrams alongside streams, congestion controlled but never retransmitted
+/// \li Stream multiplexing, with strict priority classes and weighted fair queueing within a class
 /// \li No head-of-line blocking
-template<typename DelegateType, template<typename> class DatagramTransport>
+template<
+	typename DelegateType,
+	template<typename> class DatagramTransport,
+	typename CongestionControl = CubicCongestionControl
+>
 class StreamTransport {
 private:
 	static constexpr bool is_encrypted = false;
 
 	/// Self type
-	using Self = StreamTransport<DelegateType, DatagramTransport>;
+	using Self = StreamTransport<DelegateType, DatagramTransport, CongestionControl>;
 	/// Base transport type
 	using BaseTransport = DatagramTransport<Self>;
 	/// Base message type
@@ -76,9 +97,31 @@ private:
 	using CLOSE = CLOSEWrapper<BaseMessageType>;
 	/// CLOSECONF message type
 	using CLOSECONF = CLOSECONFWrapper<BaseMessageType>;
+	/// PROBE message type
+	using PROBE = PROBEWrapper<BaseMessageType>;
+	/// REPAIR message type
+	using REPAIR = REPAIRWrapper<BaseMessageType>;
+	/// TICKET message type
+	using TICKET = TICKETWrapper<BaseMessageType>;
+	/// RESUME message type
+	using RESUME = RESUMEWrapper<BaseMessageType>;
+	/// RESUMECONF message type
+	using RESUMECONF = RESUMECONFWrapper<BaseMessageType>;
+	/// PATHCHALLENGE message type
+	using PATHCHALLENGE = PATHCHALLENGEWrapper<BaseMessageType>;
+	/// PATHRESPONSE message type
+	using PATHRESPONSE = PATHRESPONSEWrapper<BaseMessageType>;
+	/// DATAGRAM message type
+	using DATAGRAM = DATAGRAMWrapper<BaseMessageType>;
+	/// MAXDATA message type
+	using MAXDATA = MAXDATAWrapper<BaseMessageType>;
+	/// MAXSTREAMDATA message type
+	using MAXSTREAMDATA = MAXSTREAMDATAWrapper<BaseMessageType>;
+	/// BLOCKED message type
+	using BLOCKED = BLOCKEDWrapper<BaseMessageType>;
 
 	/// Base transport instance
-	BaseTransport &transport;
+	BaseTransport *transport;
 	/// Transport manager of self
 	core::TransportManager<Self> &transport_manager;
 
@@ -89,6 +132,8 @@ private:
 	enum struct ConnectionState {
 		Listen,
 		DialSent,
+		/// Dialled with a session ticket, DATA can be sent until the RESUME is confirmed
+		ResumeSent,
 		DialRcvd,
 		Established,
 		Closing
@@ -110,11 +155,41 @@ private:
 	/// Timer callback for handling DIAL timeouts
 	void dial_timer_cb();
 
+	// Resumption
+	/// Was the connection keyed from a session ticket?
+	bool is_resumed = false;
+	/// Was the delegate told of the dial when resuming, it is not told again if the handshake falls back
+	bool did_dial_early = false;
+	/// Ticket sent in RESUME, kept for retries
+	uint8_t resume_ticket[SessionTickets::ticket_size];
+	/// Random value the resumed keys are derived with, kept for retries
+	uint8_t resume_random[SessionTickets::random_size];
+
+	// Migration
+	/// Set the src conn id, keeping the transport findable by it through conn_ids
+	void set_src_conn_id(uint32_t src_conn_id);
+	/// Address of the peer being validated, packets with the ids of this connection came from there
+	core::SocketAddress path_candidate_addr;
+	/// Random data the peer has to echo from the candidate address
+	uint8_t path_challenge[8];
+	/// When the challenge was last sent, 0 if none is outstanding
+	uint64_t path_challenge_time = 0;
+	/// Handle a packet of this connection received by the transport of another address
+	void did_recv_from_candidate(Self &candidate, BaseMessageType &&packet);
+	/// Move onto the validated address of the candidate, the candidate is closed along with the old address
+	void migrate(Self &candidate);
+
 	// Streams
 	/// List of streams on which we send data
 	std::unordered_map<uint16_t, SendStream> send_streams;
 	/// List of streams from which we recv data
 	std::unordered_map<uint16_t, RecvStream> recv_streams;
+	/// Streams open for receiving at once, data opening more is dropped until some finish
+	static constexpr size_t max_recv_streams = 4096;
+	/// Whole streams fully acked, their ids are held back until the destination forgets them
+	ClosedStreams closed_send_streams;
+	/// Whole streams delivered, late retransmissions to them are acked and dropped
+	ClosedStreams closed_recv_streams;
 
 	/// Helper function to get a send stream of given stream id, creating one if needed
 	SendStream &get_or_create_send_stream(uint16_t stream_id);
@@ -125,13 +200,10 @@ private:
 	/// Packet number of last sent packet.
 	/// Strictly increasing, retransmitted packets have different packet number than the original
 	uint64_t last_sent_packet = -1;
-	/// List of sent packets which have not been acked yet
-	std::map<uint64_t, SentPacketInfo> sent_packets;
-
-	/// List of packets marked as lost.
-	/// Can happen if packets sent much later were acknowledged.
-	/// Can happen if an ack is not received for a long time.
-	std::map<uint64_t, SentPacketInfo> lost_packets;
+	/// Sent packets which have not been acked yet, either in flight or marked as lost.
+	/// Packets are marked lost if packets sent much later were acknowledged
+	/// or if an ack is not received for a long time.
+	SentPackets sent_packets;
 
 	// RTT estimate
 	/// RTT estimate of connection
@@ -139,19 +211,15 @@ private:
 
 	// Congestion control
 	uint64_t bytes_in_flight = 0;
-	uint64_t k = 0;
-	uint64_t w_max = 0;
-	uint64_t congestion_window = 100000;
-	uint64_t ssthresh = -1;
-	uint64_t congestion_start = 0;
+	CongestionControl cc;
 	uint64_t largest_acked = 0;
 	uint64_t largest_sent_time = 0;
 
 	// Send
-	/// List of stream ids with data ready to be sent
-	std::unordered_set<uint16_t> send_queue_ids;
-	/// List of send streams with data ready to be sent
-	std::list<SendStream *> send_queue;
+	/// Send streams with data ready to be sent, in the order they are served
+	SendQueue send_queue;
+	/// Fresh send stream set up to carry a whole stream of the given size, nullptr if the id is taken
+	SendStream *get_whole_send_stream(uint16_t stream_id, uint64_t size, bool fec);
 
 	/// Add the given stream to the list of streams with data ready to be sent
 	bool register_send_intent(SendStream &stream);
@@ -162,17 +230,40 @@ private:
 	/// Packets are paced using the pacing timer.
 	void send_pending_data();
 	/// Send any lost data if possible
-	int send_lost_data(uint64_t initial_bytes_in_flight);
-	/// Send any new data if possible
-	int send_new_data(SendStream &stream, uint64_t initial_bytes_in_flight);
+	int send_lost_data();
+	/// Send new data if possible until at least quantum bytes are sent,
+	/// returns 1 if the stream has more to send and 0 if it has nothing left
+	int send_new_data(SendStream &stream, uint64_t quantum);
+
+	// Datagrams
+	/// Datagrams waiting for room in the congestion window or for a departure slot
+	std::deque<core::Buffer> datagram_queue;
+	/// Datagrams beyond this many waiting are dropped, late ones are of little use to their senders
+	static constexpr size_t max_queued_datagrams = 64;
+	/// Send queued datagrams if possible
+	int send_queued_datagrams();
 
 	// Pacing
-	/// Timer to enforce packet pacing
+	/// Timer to wake up for the next paced departure
 	asyncio::Timer pacing_timer;
 	/// Is the pacing timer active?
 	bool is_pacing_timer_active = false;
+	/// Departure schedule at the congestion control pacing rate
+	Pacer pacer;
+	/// Start of the current burst
+	uint64_t pacing_now = 0;
+	/// Packets departing up to this time are sent in the current burst
+	uint64_t pacing_horizon = 0;
+	/// How far ahead packets are handed to datagram transports which honour departure times
+	static constexpr uint64_t send_time_horizon = 2000000;
 	/// Pacing timer callback to send a new batch of packets
 	void pacing_timer_cb();
+	/// Send lost and new packets until the pacing horizon or congestion window is hit
+	void send_burst();
+	/// Take the next departure slot for a packet, false if it has to wait for a later burst
+	bool pace(uint64_t length);
+	/// Start the pacing timer for the next departure after the current horizon
+	void schedule_pacing();
 
 	// TLP (Tail Loss Probe)
 	/// Timer to detect no acks for a long time
@@ -182,9 +273,41 @@ private:
 	/// Timer callback for handling tlp timeouts
 	void tlp_timer_cb();
 
+	// Path MTU discovery
+	/// Bytes of a DATA packet besides stream data, header followed by tag and nonce
+	static constexpr uint16_t data_overhead = 30 + crypto_aead_aes256gcm_ABYTES + 12;
+	/// Bytes of a DATAGRAM packet besides the datagram
+	static constexpr uint16_t datagram_overhead = 18 + crypto_aead_aes256gcm_ABYTES + 12;
+	/// Size of the DATA or DATAGRAM packet a sent packet record stands for
+	static uint64_t packet_size(SentPacketInfo const &sent_packet);
+	/// Probing state, DATA packets are sized to its MTU
+	PmtuDiscovery pmtud;
+	/// Timer for probe timeouts and search restarts
+	asyncio::Timer pmtud_timer;
+	/// Searches are not restarted on idle connections, sending data resumes them
+	bool is_pmtud_idle = false;
+	/// Start probing if the datagram transport never fragments, probes would pass regardless of the path MTU otherwise
+	void start_pmtud();
+	/// Timer callback to time out the outstanding probe and send the next one
+	void pmtud_timer_cb();
+	/// Stream bytes which fit in a DATA packet
+	uint16_t fragment_size() const;
+
+	// Forward error correction
+	/// Loss estimate which sizes repair groups
+	FecRate fec_rate;
+	/// Rebuild a missing fragment of a whole stream from a repair group, kept for later if several are missing
+	void recover_whole(RecvStream &stream, FecGroup &&group);
+	/// Hand a fully assembled whole stream to the delegate
+	void deliver_whole(RecvStream &stream);
+
 	// ACKs
 	/// Stores ranges of packet numbers that have and haven't been seen
 	AckRanges ack_ranges;
+	/// Bytes of an ACK packet besides its runs
+	static constexpr uint16_t ack_overhead = 20;
+	/// Seen ranges per ACK frame, as many as have their runs fit in a packet of the current path MTU
+	size_t ack_frame_ranges() const;
 	/// Timer to batch acks for multiple packets
 	asyncio::Timer ack_timer;
 	/// Is the ack timer active?
@@ -192,6 +315,32 @@ private:
 	/// Timer callback for sending an ack
 	void ack_timer_cb();
 
+	// Flow control
+	/// Total new stream bytes the destination takes
+	uint64_t max_data = RecvWindow::connection_window;
+	/// Total new stream bytes sent
+	uint64_t data_sent = 0;
+	/// Is sending waiting for more credit on the connection?
+	bool is_data_blocked = false;
+	/// Timer to ask for credit again while blocked, in case updates were lost
+	asyncio::Timer blocked_timer;
+	/// Timer interval for the blocked timer, 0 if it is not active
+	uint64_t blocked_timer_interval = 0;
+	/// Timer callback for asking for credit again
+	void blocked_timer_cb();
+	/// Ask the destination for credit, retrying until it arrives
+	void on_blocked(uint16_t stream_id);
+	/// Resume sending once credit arrives
+	void on_unblocked();
+	/// Credit extended to the source across streams
+	RecvWindow recv_window = RecvWindow(RecvWindow::connection_window);
+	/// Is handing data to the delegate paused?
+	bool is_recv_paused = false;
+	/// Hand queued data which is next in order to the delegate until a gap or a pause, then grant credit for it
+	void read_recv_packets(RecvStream &stream, uint64_t old_read_offset);
+	/// Grant connection credit for bytes the delegate consumed
+	void consume(uint64_t bytes);
+
 	// Protocol
 	void send_DIAL();
 	void did_recv_DIAL(DIAL &&packet);
@@ -231,6 +380,39 @@ private:
 	void send_CLOSECONF(uint32_t src_conn_id, uint32_t dst_conn_id);
 	void did_recv_CLOSECONF(CLOSECONF &&packet);
 
+	void send_PROBE(uint16_t size);
+	void did_recv_PROBE(PROBE &&packet);
+
+	void send_REPAIR(SendStream &stream, bool is_fin);
+	void did_recv_REPAIR(REPAIR &&packet);
+
+	void send_TICKET();
+	void did_recv_TICKET(TICKET &&packet);
+
+	void send_RESUME();
+	void did_recv_RESUME(RESUME &&packet);
+
+	void send_RESUMECONF();
+	void did_recv_RESUMECONF(RESUMECONF &&packet);
+
+	void send_PATHCHALLENGE(Self &candidate);
+	void did_recv_PATHCHALLENGE(PATHCHALLENGE &&packet);
+
+	void send_PATHRESPONSE(uint8_t const* challenge);
+	void did_recv_PATHRESPONSE(Self &candidate, PATHRESPONSE &&packet);
+
+	void send_DATAGRAM(core::Buffer &&bytes);
+	void did_recv_DATAGRAM(DATAGRAM &&packet);
+
+	void send_MAXDATA();
+	void did_recv_MAXDATA(MAXDATA &&packet);
+
+	void send_MAXSTREAMDATA(uint16_t stream_id, uint64_t max_offset);
+	void did_recv_MAXSTREAMDATA(MAXSTREAMDATA &&packet);
+
+	void send_BLOCKED(uint16_t stream_id);
+	void did_recv_BLOCKED(BLOCKED &&packet);
+
 public:
 	/// Delegate calls from base transport
 	void did_dial(BaseTransport &transport, uint8_t const* remote_static_pk);
@@ -248,6 +430,10 @@ public:
 
 	/// Delegate to notify of any events
 	DelegateType *delegate = nullptr;
+	/// Session tickets shared by the transports of a factory, connections are not resumed without them
+	SessionTickets *tickets = nullptr;
+	/// Connection ids shared by the transports of a factory, connections do not migrate without them
+	ConnectionIds<Self> *conn_ids = nullptr;
 
 	/// Constructor
 	StreamTransport(
@@ -257,10 +443,41 @@ public:
 		core::TransportManager<Self> &transport_manager
 	);
 
+	/// Number of priority classes streams can be sent in
+	static constexpr uint8_t num_priorities = SendStream::num_priorities;
+	/// Priority class of streams not given one
+	static constexpr uint8_t default_priority = SendStream::default_priority;
+
 	/// Setup function that can be called to set the delegate and the private key
 	void setup(DelegateType *delegate, uint8_t const* static_sk);
 	/// Queues the given buffer for transmission
 	int send(core::Buffer &&bytes, uint16_t stream_id = 0);
+	/// Queues the given header followed by the given shared buffer for transmission.
+	/// The shared buffer is referenced instead of copied, did_send only returns the header.
+	int send(core::Buffer &&header, core::SharedBuffer const &bytes, uint16_t stream_id = 0);
+	/// Queues the given buffer as the entire content of a fresh stream and finishes it.
+	/// Delegates implementing did_recv_stream receive it whole in a single buffer.
+	/// Ids of whole streams are held back for ClosedStreams::expiry once acked, -1 until then.
+	/// With fec, repair packets let the destination rebuild lost fragments without waiting for retransmissions.
+	int send_stream(core::Buffer &&bytes, uint16_t stream_id, bool fec = false);
+	/// Queues the given header followed by the given shared buffer as the entire content of a fresh stream
+	/// of the given priority class and finishes it. The shared buffer is referenced instead of copied.
+	int send_stream(
+		core::Buffer &&header,
+		core::SharedBuffer const &bytes,
+		uint16_t stream_id,
+		bool fec = false,
+		uint8_t priority = SendStream::default_priority
+	);
+	/// Sets the priority class and weight of a stream for as long as it lives.
+	/// Lower classes are always served first, streams of a class share bandwidth in proportion to their weights.
+	int set_priority(uint16_t stream_id, uint8_t priority, uint16_t weight = SendStream::default_weight);
+	/// Sends the given buffer in a packet of its own which is never retransmitted.
+	/// Datagrams wait their turn in the congestion window and are dropped if too many are waiting.
+	/// Delegates implementing did_recv_datagram receive the ones which get through, in any order.
+	int send_datagram(core::Buffer &&bytes);
+	/// Largest buffer send_datagram takes, follows the path MTU
+	uint16_t max_datagram_size();
 
 	/// Close reason
 	uint16_t close_reason = 0;
@@ -273,6 +490,10 @@ public:
 	bool is_active();
 	/// Get the RTT estimate of the connection
 	double get_rtt();
+	/// Get the path MTU in use, as a datagram payload size
+	uint16_t get_pmtu();
+	/// Get the stream bytes up to the highest received offsets not handed to the delegate yet
+	uint64_t get_recv_buffered();
 
 	/// Timer callback for SKIPSTREAM timeout
 	void skip_timer_cb(RecvStream& stream);
@@ -287,6 +508,12 @@ public:
 	/// Can be used to skip sending data that we sent partially but can't send anymore
 	void flush_stream(uint16_t stream_id);
 
+	/// Stops handing received data to the delegate, the source stalls once it used up its credit.
+	/// Delegates which fall behind can call it from did_recv to push back on the source.
+	void pause_recv();
+	/// Hands over data held back while paused and lets the source continue
+	void resume_recv();
+
 	bool is_internal();
 
 private:
@@ -317,13 +544,17 @@ public:
 
 // Impl
 
-template<typename DelegateType, template<typename> class DatagramTransport>
-void StreamTransport<DelegateType, DatagramTransport>::reset() {
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+void StreamTransport<DelegateType, DatagramTransport, CongestionControl>::reset() {
 	// Reset transport
 	conn_state = ConnectionState::Listen;
-	src_conn_id = 0;
+	set_src_conn_id(0);
 	dst_conn_id = 0;
 	dialled = false;
+	is_resumed = false;
+	did_dial_early = false;
+	path_candidate_addr = core::SocketAddress();
+	path_challenge_time = 0;
 	state_timer.stop();
 	state_timer_interval = 0;
 
@@ -337,40 +568,124 @@ void StreamTransport<DelegateType, DatagramTransport>::reset() {
 		stream.state_timer.stop();
 	}
 	recv_streams.clear();
+	closed_send_streams.clear();
+	closed_recv_streams.clear();
 
 	last_sent_packet = -1;
 	sent_packets.clear();
-	lost_packets.clear();
 
 	rtt = -1;
 
 	bytes_in_flight = 0;
-	k = 0;
-	w_max = 0;
-	congestion_window = 100000;
-	ssthresh = -1;
-	congestion_start = 0;
+	cc = CongestionControl();
 	largest_acked = 0;
 	largest_sent_time = 0;
 
-	send_queue_ids.clear();
 	send_queue.clear();
+	datagram_queue.clear();
 
 	pacing_timer.stop();
 	is_pacing_timer_active = false;
+	pacer = Pacer();
 
 	tlp_timer.stop();
 	tlp_interval = DEFAULT_TLP_INTERVAL;
 
+	pmtud_timer.stop();
+	pmtud = PmtuDiscovery();
+	is_pmtud_idle = false;
+
+	fec_rate = FecRate();
+
 	ack_ranges = AckRanges();
 	ack_timer.stop();
 	ack_timer_active = false;
+
+	max_data = RecvWindow::connection_window;
+	data_sent = 0;
+	is_data_blocked = false;
+	blocked_timer.stop();
+	blocked_timer_interval = 0;
+	recv_window = RecvWindow(RecvWindow::connection_window);
+	is_recv_paused = false;
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+void StreamTransport<DelegateType, DatagramTransport, CongestionControl>::set_src_conn_id(uint32_t src_conn_id) {
+	if(conn_ids != nullptr) {
+		conn_ids->remove(this->src_conn_id, this);
+		conn_ids->add(src_conn_id, this);
+	}
+
+	this->src_conn_id = src_conn_id;
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+void StreamTransport<DelegateType, DatagramTransport, CongestionControl>::did_recv_from_candidate(
+	Self &candidate,
+	BaseMessageType &&packet
+) {
+	// Only established connections move, the id of the other side has to match as well
+	if(conn_state != ConnectionState::Established || packet.payload_buffer().read_uint32_le_unsafe(2) != dst_conn_id) {
+		return;
+	}
+
+	if(packet.payload_buffer().read_uint8_unsafe(1) == 22) {
+		did_recv_PATHRESPONSE(candidate, std::move(packet));
+		return;
+	}
+
+	// Challenge the new address, repeating it if unanswered for a while
+	auto now = asyncio::EventLoop::now();
+	uint64_t interval = rtt < 0 ? DEFAULT_TLP_INTERVAL : std::max(2 * rtt, 100.0);
+	if(candidate.dst_addr != path_candidate_addr || path_challenge_time == 0 || now - path_challenge_time >= interval) {
+		send_PATHCHALLENGE(candidate);
+	}
+
+	// Keep the connection going, replies take the old address until the new one is validated
+	did_recv(*transport, std::move(packet));
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+void StreamTransport<DelegateType, DatagramTransport, CongestionControl>::migrate(Self &candidate) {
+	auto old_addr = dst_addr;
+	auto new_addr = candidate.dst_addr;
+
+	SPDLOG_DEBUG(
+		"Stream transport {{ Src: {}, Dst: {} }}: Migrating to {}",
+		src_addr.to_string(),
+		dst_addr.to_string(),
+		new_addr.to_string()
+	);
+
+	// Trade base transports, the candidate closes along with the old address
+	std::swap(transport, candidate.transport);
+	transport->setup(this);
+	candidate.transport->setup(&candidate);
+
+	candidate.reset();
+	candidate.transport->close();
+
+	dst_addr = new_addr;
+	transport_manager.rekey(old_addr, new_addr);
+
+	// Delegates keeping track of addresses follow along
+	constexpr bool has_migrate = requires(
+		DelegateType& d,
+		Self& t
+	) {
+		d.did_migrate(t, core::SocketAddress());
+	};
+
+	if constexpr (has_migrate) {
+		delegate->did_migrate(*this, old_addr);
+	}
 }
 
 // Impl
 
-template<typename DelegateType, template<typename> class DatagramTransport>
-void StreamTransport<DelegateType, DatagramTransport>::dial_timer_cb() {
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+void StreamTransport<DelegateType, DatagramTransport, CongestionControl>::dial_timer_cb() {
 	if(this->state_timer_interval >= 64000) { // Abort on too many retries
 		this->state_timer_interval = 0;
 		SPDLOG_DEBUG(
@@ -379,11 +694,15 @@ void StreamTransport<DelegateType, DatagramTransport>::dial_timer_cb() {
 			this->dst_addr.to_string()
 		);
 		reset();
-		transport.close();
+		transport->close();
 		return;
 	}
 
-	this->send_DIAL();
+	if(conn_state == ConnectionState::ResumeSent) {
+		this->send_RESUME();
+	} else {
+		this->send_DIAL();
+	}
 	this->state_timer_interval *= 2;
 	this->state_timer.template start<Self, &Self::dial_timer_cb>(
 		this->state_timer_interval,
@@ -394,8 +713,8 @@ void StreamTransport<DelegateType, DatagramTransport>::dial_timer_cb() {
 //---------------- Stream functions begin ----------------//
 
 
-template<typename DelegateType, template<typename> class DatagramTransport>
-SendStream &StreamTransport<DelegateType, DatagramTransport>::get_or_create_send_stream(
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+SendStream &StreamTransport<DelegateType, DatagramTransport, CongestionControl>::get_or_create_send_stream(
 	uint16_t stream_id
 ) {
 	auto iter = send_streams.try_emplace(
@@ -408,8 +727,8 @@ SendStream &StreamTransport<DelegateType, DatagramTransport>::get_or_create_send
 }
 
 
-template<typename DelegateType, template<typename> class DatagramTransport>
-RecvStream &StreamTransport<DelegateType, DatagramTransport>::get_or_create_recv_stream(
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+RecvStream &StreamTransport<DelegateType, DatagramTransport, CongestionControl>::get_or_create_recv_stream(
 	uint16_t stream_id
 ) {
 	auto iter = recv_streams.try_emplace(
@@ -427,55 +746,62 @@ RecvStream &StreamTransport<DelegateType, DatagramTransport>::get_or_create_recv
 //---------------- Send functions end ----------------//
 
 
-template<typename DelegateType, template<typename> class DatagramTransport>
-bool StreamTransport<DelegateType, DatagramTransport>::register_send_intent(
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+bool StreamTransport<DelegateType, DatagramTransport, CongestionControl>::register_send_intent(
 	SendStream &stream
 ) {
-	if(send_queue_ids.find(stream.stream_id) != send_queue_ids.end()) {
+	// Blocked streams rejoin once the destination grants more credit
+	if(stream.is_blocked) {
 		return false;
 	}
 
-	send_queue.push_back(&stream);
-	send_queue_ids.insert(stream.stream_id);
-
-	return true;
+	return send_queue.push(stream);
 }
 
-template<typename DelegateType, template<typename> class DatagramTransport>
-void StreamTransport<DelegateType, DatagramTransport>::send_pending_data() {
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+void StreamTransport<DelegateType, DatagramTransport, CongestionControl>::send_pending_data() {
 	if(is_pacing_timer_active == false) {
 		is_pacing_timer_active = true;
 		pacing_timer.template start<Self, &Self::pacing_timer_cb>(0, 0);
 	}
 }
 
-template<typename DelegateType, template<typename> class DatagramTransport>
-int StreamTransport<DelegateType, DatagramTransport>::send_lost_data(
-	uint64_t initial_bytes_in_flight
-) {
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+int StreamTransport<DelegateType, DatagramTransport, CongestionControl>::send_lost_data() {
 	for(
-		auto iter = lost_packets.begin();
-		iter != lost_packets.end();
-		iter = lost_packets.erase(iter)
+		auto pn = sent_packets.next_lost(sent_packets.begin());
+		pn != sent_packets.end();
+		pn = sent_packets.next_lost(pn)
 	) {
-		if(bytes_in_flight - initial_bytes_in_flight >= DEFAULT_PACING_LIMIT) {
-			// Pacing limit hit, reschedule timer
-			is_pacing_timer_active = true;
-			pacing_timer.template start<Self, &Self::pacing_timer_cb>(1, 0);
-			return -1;
+		// Copy, sending grows the packet ring
+		auto sent_packet = sent_packets.at(pn);
+
+		// Datagrams are not retransmitted
+		if(sent_packet.stream == nullptr) {
+			sent_packets.erase(pn);
+			continue;
 		}
 
-		auto &sent_packet = iter->second;
-		if(bytes_in_flight > congestion_window - sent_packet.length) {
+		if(bytes_in_flight + sent_packet.length > cc.window()) {
 			return -2;
 		}
 
-		send_DATA(
-			*sent_packet.stream,
-			*sent_packet.data_item,
-			sent_packet.offset,
-			sent_packet.length
-		);
+		if(!pace(sent_packet.length)) {
+			return -1;
+		}
+		sent_packets.erase(pn);
+
+		// Split packets sent before the MTU dropped
+		auto fragment = fragment_size();
+		for(uint64_t i = 0; i < sent_packet.length; i += fragment) {
+			uint16_t dsize = std::min<uint64_t>(fragment, sent_packet.length - i);
+			send_DATA(
+				*sent_packet.stream,
+				*sent_packet.data_item,
+				sent_packet.offset + i,
+				dsize
+			);
+		}
 
 		sent_packet.stream->bytes_in_flight += sent_packet.length;
 		bytes_in_flight += sent_packet.length;
@@ -486,30 +812,81 @@ int StreamTransport<DelegateType, DatagramTransport>::send_lost_data(
 	return 0;
 }
 
-template<typename DelegateType, template<typename> class DatagramTransport>
-int StreamTransport<DelegateType, DatagramTransport>::send_new_data(
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+int StreamTransport<DelegateType, DatagramTransport, CongestionControl>::send_queued_datagrams() {
+	while(!datagram_queue.empty()) {
+		auto &bytes = datagram_queue.front();
+		auto length = bytes.size();
+
+		// Packets may have shrunk since it was queued
+		if(length > max_datagram_size()) {
+			datagram_queue.pop_front();
+			continue;
+		}
+
+		if(bytes_in_flight + length > cc.window()) {
+			return -2;
+		}
+
+		if(!pace(length)) {
+			return -1;
+		}
+
+		send_DATAGRAM(std::move(bytes));
+		datagram_queue.pop_front();
+
+		bytes_in_flight += length;
+	}
+
+	return 0;
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+int StreamTransport<DelegateType, DatagramTransport, CongestionControl>::send_new_data(
 	SendStream &stream,
-	uint64_t initial_bytes_in_flight
+	uint64_t quantum
 ) {
+	uint64_t sent = 0;
+
 	for(
 		;
 		stream.next_item_iterator != stream.data_queue.end();
 		stream.next_item_iterator++
 	) {
 		auto &data_item = *stream.next_item_iterator;
+		auto fragment = fragment_size();
 
 		for(
 			uint64_t i = data_item.sent_offset;
-			i < data_item.data.size();
-			i+=DEFAULT_FRAGMENT_SIZE
+			i < data_item.size();
+			i+=fragment
 		) {
-			auto remaining_bytes = data_item.data.size() - data_item.sent_offset;
-			uint16_t dsize = remaining_bytes > DEFAULT_FRAGMENT_SIZE ? DEFAULT_FRAGMENT_SIZE : remaining_bytes;
+			auto remaining_bytes = data_item.size() - data_item.sent_offset;
+			uint16_t dsize = remaining_bytes > fragment ? fragment : remaining_bytes;
+
+			// Fragments of a repair group are equally sized, a new MTU starts a new group
+			if(stream.fec.size() > 0 && stream.fec.fragment() != fragment) {
+				send_REPAIR(stream, false);
+			}
+
+			// Flow control, packets wait for credit instead of going out in pieces
+			if(stream.sent_offset + dsize > stream.max_offset) {
+				stream.is_blocked = true;
+				on_blocked(stream.stream_id);
+				return 2;
+			}
+			if(this->data_sent + dsize > this->max_data) {
+				if(!this->is_data_blocked) {
+					this->is_data_blocked = true;
+					on_blocked(stream.stream_id);
+				}
+				return -3;
+			}
 
-			if(this->bytes_in_flight > this->congestion_window - dsize)
+			if(this->bytes_in_flight + dsize > this->cc.window())
 				return -2;
 
-			if(this->bytes_in_flight - initial_bytes_in_flight > DEFAULT_PACING_LIMIT) {
+			if(!pace(dsize)) {
 				return -1;
 			}
 
@@ -518,7 +895,37 @@ int StreamTransport<DelegateType, DatagramTransport>::send_new_data(
 			stream.bytes_in_flight += dsize;
 			stream.sent_offset += dsize;
 			this->bytes_in_flight += dsize;
+			this->data_sent += dsize;
 			data_item.sent_offset += dsize;
+
+			if(stream.is_fec) {
+				// Whole streams are a single item, fragments can span its header and shared data
+				uint16_t head = i < data_item.data.size() ? std::min<uint64_t>(dsize, data_item.data.size() - i) : 0;
+				stream.fec.add(
+					data_item.stream_offset + i,
+					head > 0 ? data_item.data.data() + i : nullptr,
+					head,
+					head < dsize ? data_item.shared_data.data() + (i + head - data_item.data.size()) : nullptr,
+					dsize - head,
+					fragment
+				);
+
+				// Groups do not span data items so their fragments stay contiguous
+				bool is_last = data_item.sent_offset == data_item.size();
+				if(stream.fec.size() >= fec_rate.group_size() || is_last) {
+					send_REPAIR(stream, stream.done_queueing && stream.sent_offset >= stream.queue_offset);
+				}
+			}
+
+			// Turn over, moving past a finished item like the loop would
+			sent += dsize;
+			if(sent >= quantum) {
+				if(data_item.sent_offset == data_item.size()) {
+					stream.next_item_iterator++;
+				}
+
+				return stream.next_item_iterator == stream.data_queue.end() ? 0 : 1;
+			}
 		}
 	}
 
@@ -530,33 +937,91 @@ int StreamTransport<DelegateType, DatagramTransport>::send_new_data(
 
 //---------------- Pacing functions begin ----------------//
 
-template<typename DelegateType, template<typename> class DatagramTransport>
-void StreamTransport<DelegateType, DatagramTransport>::pacing_timer_cb() {
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+void StreamTransport<DelegateType, DatagramTransport, CongestionControl>::pacing_timer_cb() {
 	this->is_pacing_timer_active = false;
 
-	auto initial_bytes_in_flight = this->bytes_in_flight;
+	// Hand the whole burst to the datagram transport at once if it can batch sends
+	constexpr bool has_batch_send = requires(
+		BaseTransport& t
+	) {
+		t.batch_send_start();
+		t.batch_send_end();
+	};
+
+	if constexpr (has_batch_send) {
+		transport->batch_send_start();
+		send_burst();
+		transport->batch_send_end();
+	} else {
+		send_burst();
+	}
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+void StreamTransport<DelegateType, DatagramTransport, CongestionControl>::send_burst() {
+	constexpr bool has_send_time = requires(
+		BaseTransport& t
+	) {
+		t.is_send_time_enabled();
+		t.set_send_time(uint64_t(0));
+	};
+	constexpr bool has_packet_size = requires(
+		CongestionControl& c
+	) {
+		c.set_packet_size(uint64_t(0));
+	};
+
+	// Windows are kept at a few packets at the least, packets grow with the path MTU
+	if constexpr (has_packet_size) {
+		cc.set_packet_size(fragment_size());
+	}
+
+	pacer.set_rate(cc.pacing_rate());
+	pacing_now = asyncio::EventLoop::now_ns();
+	pacing_horizon = pacing_now;
+
+	// The kernel holds packets until their departure time, hand over the next few at once
+	if constexpr (has_send_time) {
+		if(transport->is_send_time_enabled()) {
+			pacing_horizon += send_time_horizon;
+		}
+	}
 
-	auto res = this->send_lost_data(initial_bytes_in_flight);
+	auto res = this->send_lost_data();
+	if(res == -1) {
+		schedule_pacing();
+	}
 	if(res < 0) {
 		return;
 	}
 
-	// New packets
-	for(
-		auto iter = this->send_queue.begin();
-		iter != this->send_queue.end();
-		// Empty
-	) {
-		auto &stream = **iter;
+	// Datagrams ahead of new stream data, they lose their value by waiting
+	res = this->send_queued_datagrams();
+	if(res == -1) {
+		schedule_pacing();
+	}
+	if(res < 0) {
+		return;
+	}
+
+	// New packets, a packet at a time from the stream the queue puts first
+	auto quantum = fragment_size();
+	while(!this->send_queue.empty()) {
+		auto &stream = this->send_queue.front();
+		auto sent_offset = stream.sent_offset;
 
-		int res = this->send_new_data(stream, initial_bytes_in_flight);
+		int res = this->send_new_data(stream, quantum);
 		if(res == 0) { // Idle stream, move to next stream
-			this->send_queue_ids.erase(stream.stream_id);
-			iter = this->send_queue.erase(iter);
-		} else if(res == -1) { // Pacing limit hit, reschedule timer
-			// Pacing limit hit, reschedule timer
-			this->is_pacing_timer_active = true;
-			pacing_timer.template start<Self, &Self::pacing_timer_cb>(1, 0);
+			this->send_queue.pop();
+		} else if(res == 1) { // Turn over, charge the stream and pick the next one
+			this->send_queue.on_send(stream.sent_offset - sent_offset);
+		} else if(res == 2) { // Out of stream credit, leaves the queue until more is granted
+			this->send_queue.pop();
+		} else if(res == -3) { // Out of connection credit
+			return;
+		} else if(res == -1) { // Pacing horizon hit, reschedule timer
+			schedule_pacing();
 			return;
 		} else { // Congestion window exhausted, break
 			return;
@@ -564,70 +1029,108 @@ void StreamTransport<DelegateType, DatagramTransport>::pacing_timer_cb() {
 	}
 }
 
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+void StreamTransport<DelegateType, DatagramTransport, CongestionControl>::schedule_pacing() {
+	// Wake up once the next departure is within the horizon, timers have millisecond resolution
+	auto wait = pacer.departure_time(pacing_now) - pacing_horizon;
+	auto timeout = std::max<uint64_t>((wait + 999999) / 1000000, 1);
+
+	this->is_pacing_timer_active = true;
+	pacing_timer.template start<Self, &Self::pacing_timer_cb>(timeout, 0);
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+bool StreamTransport<DelegateType, DatagramTransport, CongestionControl>::pace(uint64_t length) {
+	constexpr bool has_send_time = requires(
+		BaseTransport& t
+	) {
+		t.is_send_time_enabled();
+		t.set_send_time(uint64_t(0));
+	};
+
+	auto departure = pacer.departure_time(pacing_now);
+	if(departure > pacing_horizon) {
+		return false;
+	}
+	pacer.on_send(departure, length);
+
+	if constexpr (has_send_time) {
+		if(transport->is_send_time_enabled()) {
+			transport->set_send_time(departure);
+		}
+	}
+
+	return true;
+}
+
 //---------------- Pacing functions end ----------------//
 
 
 //---------------- TLP functions begin ----------------//
 
-template<typename DelegateType, template<typename> class DatagramTransport>
-void StreamTransport<DelegateType, DatagramTransport>::tlp_timer_cb() {
-	if(this->sent_packets.size() == 0 && this->lost_packets.size() == 0 && this->send_queue.size() == 0) {
-		// Idle connection, stop timer
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+void StreamTransport<DelegateType, DatagramTransport, CongestionControl>::tlp_timer_cb() {
+	if(
+		this->sent_packets.empty() &&
+		(this->send_queue.size() == 0 || this->is_data_blocked) &&
+		this->datagram_queue.empty()
+	) {
+		// Idle connection, or waiting on credit which the blocked timer takes care of, stop timer
 		tlp_timer.stop();
 		this->tlp_interval = DEFAULT_TLP_INTERVAL;
 		return;
 	}
 
-	SPDLOG_DEBUG("TLP timer: {}, {}, {}", this->sent_packets.size(), this->lost_packets.size(), this->send_queue.size() == 0);
+	SPDLOG_DEBUG("TLP timer: {}, {}, {}", this->sent_packets.num_in_flight(), this->sent_packets.num_lost(), this->send_queue.size() == 0);
 
-	auto sent_iter = this->sent_packets.cbegin();
+	uint64_t last_lost = this->sent_packets.end();
+	uint64_t lost_bytes = 0;
+	uint64_t largest_lost = 0;
 
 	// Retry lost packets
 	// No condition necessary, all are considered lost if tail probe fails
-	while(sent_iter != this->sent_packets.cend()) {
-		this->bytes_in_flight -= sent_iter->second.length;
-		sent_iter->second.stream->bytes_in_flight -= sent_iter->second.length;
-		this->lost_packets[sent_iter->first] = sent_iter->second;
+	for(
+		auto pn = this->sent_packets.next_in_flight(this->sent_packets.begin());
+		pn != this->sent_packets.end();
+		pn = this->sent_packets.next_in_flight(pn + 1)
+	) {
+		auto &sent_packet = this->sent_packets.at(pn);
+		this->bytes_in_flight -= sent_packet.length;
+		if(sent_packet.stream != nullptr) {
+			sent_packet.stream->bytes_in_flight -= sent_packet.length;
+		}
+		this->sent_packets.mark_lost(pn);
 
-		sent_iter++;
+		last_lost = pn;
+		lost_bytes += sent_packet.length;
+		largest_lost = std::max<uint64_t>(largest_lost, packet_size(sent_packet));
 	}
 
-	if(sent_iter == this->sent_packets.cbegin()) {
-		// No lost packets, ignore
-	} else {
-		// Lost packets, congestion event
-		auto last_iter = std::prev(sent_iter);
-		auto &sent_packet = last_iter->second;
-		if(sent_packet.sent_time > this->congestion_start) {
-			// New congestion event
-			SPDLOG_DEBUG(
-				"Stream transport {{ Src: {}, Dst: {} }}: Timer congestion event: {}",
-				this->src_addr.to_string(),
-				this->dst_addr.to_string(),
-				this->congestion_window
-			);
-			this->congestion_start = asyncio::EventLoop::now();
-
-			if(this->congestion_window < this->w_max) {
-				// Fast convergence
-				this->w_max = this->congestion_window;
-				this->congestion_window *= 0.6;
-			} else {
-				this->w_max = this->congestion_window;
-				this->congestion_window *= 0.75;
-			}
-
-			if(this->congestion_window < 10000) {
-				this->congestion_window = 10000;
-			}
-
-			this->ssthresh = this->congestion_window;
-
-			this->k = std::cbrt(this->w_max / 16)*1000;
-		}
+	if(pmtud.on_timeout(largest_lost, asyncio::EventLoop::now())) {
+		SPDLOG_INFO(
+			"Stream transport {{ Src: {}, Dst: {} }}: PMTU black hole, falling back to {}",
+			this->src_addr.to_string(),
+			this->dst_addr.to_string(),
+			pmtud.get_plpmtu()
+		);
+		pmtud_timer.template start<Self, &Self::pmtud_timer_cb>(0, 0);
+	}
 
-		// Pop lost packets from sent
-		this->sent_packets.erase(this->sent_packets.cbegin(), sent_iter);
+	if(last_lost == this->sent_packets.end()) {
+		// No lost packets, ignore
+	} else if(this->cc.on_loss(
+		asyncio::EventLoop::now(),
+		this->sent_packets.at(last_lost),
+		lost_bytes,
+		this->bytes_in_flight
+	)) {
+		// New congestion event
+		SPDLOG_DEBUG(
+			"Stream transport {{ Src: {}, Dst: {} }}: Timer congestion event: {}",
+			this->src_addr.to_string(),
+			this->dst_addr.to_string(),
+			this->cc.window()
+		);
 	}
 
 	// New packets
@@ -641,17 +1144,83 @@ void StreamTransport<DelegateType, DatagramTransport>::tlp_timer_cb() {
 		// Abort on too many retries
 		SPDLOG_DEBUG("Lost peer: {}", this->dst_addr.to_string());
 		reset();
-		transport.close();
+		transport->close();
 	}
 }
 
 //---------------- TLP functions end ----------------//
 
 
+//---------------- PMTUD functions begin ----------------//
+
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+void StreamTransport<DelegateType, DatagramTransport, CongestionControl>::start_pmtud() {
+	constexpr bool has_dont_fragment = requires(
+		BaseTransport& t
+	) {
+		t.is_dont_fragment();
+	};
+
+	if constexpr (has_dont_fragment) {
+		if(transport->is_dont_fragment()) {
+			pmtud_timer.template start<Self, &Self::pmtud_timer_cb>(0, 0);
+		}
+	}
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+void StreamTransport<DelegateType, DatagramTransport, CongestionControl>::pmtud_timer_cb() {
+	auto now = asyncio::EventLoop::now();
+
+	if(pmtud.is_probing()) {
+		// Not acked in time
+		pmtud.on_probe_lost(now);
+	}
+
+	auto size = pmtud.next_probe_size(now);
+	if(size != 0) {
+		send_PROBE(size);
+
+		// Allow for the ack delay, and for losses when the rtt is not known yet
+		uint64_t timeout = rtt < 0 ? DEFAULT_TLP_INTERVAL : std::max(2 * rtt + 25, 100.0);
+		pmtud_timer.template start<Self, &Self::pmtud_timer_cb>(timeout, 0);
+		return;
+	}
+
+	// Nothing to gain from larger packets while idle, the timer would keep the connection around forever
+	if(sent_packets.empty() && send_queue.size() == 0) {
+		is_pmtud_idle = true;
+		return;
+	}
+
+	// Search complete or failed, try again later
+	auto next = pmtud.next_probe_time();
+	pmtud_timer.template start<Self, &Self::pmtud_timer_cb>(next > now ? next - now : 1, 0);
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+uint16_t StreamTransport<DelegateType, DatagramTransport, CongestionControl>::fragment_size() const {
+	return pmtud.get_plpmtu() - data_overhead;
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+uint64_t StreamTransport<DelegateType, DatagramTransport, CongestionControl>::packet_size(SentPacketInfo const &sent_packet) {
+	return sent_packet.length + (sent_packet.stream == nullptr ? datagram_overhead : data_overhead);
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+size_t StreamTransport<DelegateType, DatagramTransport, CongestionControl>::ack_frame_ranges() const {
+	// n ranges take at most 2n-1 runs of 8 bytes each
+	return ((pmtud.get_plpmtu() - ack_overhead) / 8 + 1) / 2;
+}
+
+//---------------- PMTUD functions end ----------------//
+
+
 //---------------- ACK functions begin ----------------//
 
-template<typename DelegateType, template<typename> class DatagramTransport>
-void StreamTransport<DelegateType, DatagramTransport>::ack_timer_cb() {
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+void StreamTransport<DelegateType, DatagramTransport, CongestionControl>::ack_timer_cb() {
 	send_ACK();
 
 	ack_timer_active = false;
@@ -660,10 +1229,119 @@ void StreamTransport<DelegateType, DatagramTransport>::ack_timer_cb() {
 //---------------- ACK functions end ----------------//
 
 
+//---------------- Flow control functions begin ----------------//
+
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+void StreamTransport<DelegateType, DatagramTransport, CongestionControl>::read_recv_packets(
+	RecvStream &stream,
+	uint64_t old_read_offset
+) {
+	// Read any out of order data, the delegate may pause in between
+	auto iter = stream.recv_packets.begin();
+	while(iter != stream.recv_packets.end() && !is_recv_paused) {
+		// Short circuit if data can't be read immediately
+		if(iter->second.offset > stream.read_offset) {
+			break;
+		}
+
+		auto offset = iter->second.offset;
+		auto length = iter->second.length;
+
+		// Check new data
+		if(offset + length > stream.read_offset) {
+			// Cover bytes which have already been read
+			iter->second.packet.cover_unsafe(stream.read_offset - offset);
+
+			// Read bytes and update offset
+			SPDLOG_DEBUG("Out of order: {}, {}, {:spn}", offset, length, spdlog::to_hex(iter->second.packet.data(), iter->second.packet.data() + iter->second.packet.size()));
+			auto res = delegate->did_recv(*this, std::move(iter->second).packet, stream.stream_id);
+			if(res < 0) {
+				return;
+			}
+
+			stream.read_offset = offset + length;
+		}
+
+		// Next iter
+		iter = stream.recv_packets.erase(iter);
+	}
+
+	consume(stream.read_offset - old_read_offset);
+
+	// Check all data read
+	if(stream.check_read()) {
+		stream.state = RecvStream::State::Read;
+		recv_streams.erase(stream.stream_id);
+		return;
+	}
+
+	stream.window.on_consume(stream.read_offset);
+	if(stream.window.update()) {
+		send_MAXSTREAMDATA(stream.stream_id, stream.window.get_limit());
+	}
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+void StreamTransport<DelegateType, DatagramTransport, CongestionControl>::consume(uint64_t bytes) {
+	recv_window.on_consume(recv_window.get_consumed() + bytes);
+	if(recv_window.update()) {
+		send_MAXDATA();
+	}
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+void StreamTransport<DelegateType, DatagramTransport, CongestionControl>::on_blocked(uint16_t stream_id) {
+	send_BLOCKED(stream_id);
+
+	if(blocked_timer_interval == 0) {
+		blocked_timer_interval = 1000;
+		blocked_timer.template start<Self, &Self::blocked_timer_cb>(blocked_timer_interval, 0);
+	}
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+void StreamTransport<DelegateType, DatagramTransport, CongestionControl>::on_unblocked() {
+	// Tail loss timer stops when waiting on credit with nothing in flight
+	if(sent_packets.empty()) {
+		tlp_timer.template start<Self, &Self::tlp_timer_cb>(tlp_interval, 0);
+	}
+
+	send_pending_data();
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+void StreamTransport<DelegateType, DatagramTransport, CongestionControl>::blocked_timer_cb() {
+	bool is_blocked = false;
+
+	if(is_data_blocked && !send_queue.empty()) {
+		send_BLOCKED(send_queue.front().stream_id);
+		is_blocked = true;
+	}
+
+	for(auto& [stream_id, stream] : send_streams) {
+		if(stream.is_blocked) {
+			send_BLOCKED(stream_id);
+			is_blocked = true;
+		}
+	}
+
+	if(!is_blocked) {
+		blocked_timer_interval = 0;
+		return;
+	}
+
+	// A slow destination can hold credit back for long, keep asking without giving up
+	blocked_timer_interval = std::min<uint64_t>(2 * blocked_timer_interval, 8000);
+	blocked_timer.template start<Self, &Self::blocked_timer_cb>(blocked_timer_interval, 0);
+}
+
+//---------------- Flow control functions end ----------------//
+
+
 //---------------- Protocol functions begin ----------------//
 
-template<typename DelegateType, template<typename> class DatagramTransport>
-void StreamTransport<DelegateType, DatagramTransport>::send_DIAL() {
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+void StreamTransport<DelegateType, DatagramTransport, CongestionControl>::send_DIAL() {
 	SPDLOG_DEBUG(
 		"Stream transport {{ Src: {}, Dst: {} }}: DIAL >>>> {:spn}",
 		src_addr.to_string(),
@@ -674,12 +1352,15 @@ void StreamTransport<DelegateType, DatagramTransport>::send_DIAL() {
 	constexpr size_t pt_len = crypto_box_PUBLICKEYBYTES + crypto_kx_PUBLICKEYBYTES;
 	constexpr size_t ct_len = pt_len + crypto_box_SEALBYTES;
 
+	// Sealing writes its ephemeral key ahead of the ciphertext, so it cannot work in place
+	uint8_t pt[pt_len];
+	std::memcpy(pt, static_pk, crypto_box_PUBLICKEYBYTES);
+	std::memcpy(pt + crypto_box_PUBLICKEYBYTES, ephemeral_pk, crypto_kx_PUBLICKEYBYTES);
+
 	uint8_t buf[ct_len];
-	std::memcpy(buf, static_pk, crypto_box_PUBLICKEYBYTES);
-	std::memcpy(buf + crypto_box_PUBLICKEYBYTES, ephemeral_pk, crypto_kx_PUBLICKEYBYTES);
-	crypto_box_seal(buf, buf, pt_len, remote_static_pk);
+	crypto_box_seal(buf, pt, pt_len, remote_static_pk);
 
-	transport.send(
+	transport->send(
 		DIAL(ct_len)
 		.set_src_conn_id(this->src_conn_id)
 		.set_dst_conn_id(this->dst_conn_id)
@@ -687,8 +1368,8 @@ void StreamTransport<DelegateType, DatagramTransport>::send_DIAL() {
 	);
 }
 
-template<typename DelegateType, template<typename> class DatagramTransport>
-void StreamTransport<DelegateType, DatagramTransport>::did_recv_DIAL(
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+void StreamTransport<DelegateType, DatagramTransport, CongestionControl>::did_recv_DIAL(
 	DIAL &&packet
 ) {
 	constexpr size_t pt_len = (crypto_box_PUBLICKEYBYTES + crypto_kx_PUBLICKEYBYTES);
@@ -748,7 +1429,7 @@ void StreamTransport<DelegateType, DatagramTransport>::did_recv_DIAL(
 		crypto_aead_aes256gcm_beforenm(&tx_ctx, tx);
 
 		this->dst_conn_id = packet.dst_conn_id();
-		this->src_conn_id = (uint32_t)std::random_device()();
+		set_src_conn_id((uint32_t)std::random_device()());
 
 		send_DIALCONF();
 
@@ -757,6 +1438,8 @@ void StreamTransport<DelegateType, DatagramTransport>::did_recv_DIAL(
 		break;
 	}
 
+	// Simultaneous open, a resumption in progress gives way to the full handshake
+	case ConnectionState::ResumeSent:
 	case ConnectionState::DialSent: {
 		if(packet.src_conn_id() != 0) { // Should have empty source
 			SPDLOG_DEBUG(
@@ -798,6 +1481,7 @@ void StreamTransport<DelegateType, DatagramTransport>::did_recv_DIAL(
 		crypto_aead_aes256gcm_beforenm(&tx_ctx, tx);
 
 		this->dst_conn_id = packet.dst_conn_id();
+		is_resumed = false;
 
 		state_timer.stop();
 		state_timer_interval = 0;
@@ -826,15 +1510,15 @@ void StreamTransport<DelegateType, DatagramTransport>::did_recv_DIAL(
 	}
 }
 
-template<typename DelegateType, template<typename> class DatagramTransport>
-void StreamTransport<DelegateType, DatagramTransport>::send_DIALCONF() {
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+void StreamTransport<DelegateType, DatagramTransport, CongestionControl>::send_DIALCONF() {
 	constexpr size_t pt_len = crypto_kx_PUBLICKEYBYTES;
 	constexpr size_t ct_len = pt_len + crypto_box_SEALBYTES;
 
 	uint8_t buf[ct_len];
 	crypto_box_seal(buf, ephemeral_pk, pt_len, remote_static_pk);
 
-	transport.send(
+	transport->send(
 		DIALCONF(ct_len)
 		.set_src_conn_id(this->src_conn_id)
 		.set_dst_conn_id(this->dst_conn_id)
@@ -842,8 +1526,8 @@ void StreamTransport<DelegateType, DatagramTransport>::send_DIALCONF() {
 	);
 }
 
-template<typename DelegateType, template<typename> class DatagramTransport>
-void StreamTransport<DelegateType, DatagramTransport>::did_recv_DIALCONF(
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+void StreamTransport<DelegateType, DatagramTransport, CongestionControl>::did_recv_DIALCONF(
 	DIALCONF &&packet
 ) {
 	constexpr size_t pt_len = crypto_kx_PUBLICKEYBYTES;
@@ -854,6 +1538,8 @@ void StreamTransport<DelegateType, DatagramTransport>::did_recv_DIALCONF(
 	}
 
 	switch(conn_state) {
+	// Refused resumption falls back to the full handshake, early DATA is retransmitted under the new keys
+	case ConnectionState::ResumeSent:
 	case ConnectionState::DialSent: {
 		auto src_conn_id = packet.src_conn_id();
 		if(src_conn_id != this->src_conn_id) {
@@ -899,12 +1585,14 @@ void StreamTransport<DelegateType, DatagramTransport>::did_recv_DIALCONF(
 		state_timer_interval = 0;
 
 		this->dst_conn_id = packet.dst_conn_id();
+		is_resumed = false;
 
 		send_CONF();
 
 		conn_state = ConnectionState::Established;
+		start_pmtud();
 
-		if(dialled) {
+		if(dialled && !did_dial_early) {
 			delegate->did_dial(*this);
 		}
 
@@ -938,8 +1626,9 @@ void StreamTransport<DelegateType, DatagramTransport>::did_recv_DIALCONF(
 		send_CONF();
 
 		conn_state = ConnectionState::Established;
+		start_pmtud();
 
-		if(dialled) {
+		if(dialled && !did_dial_early) {
 			delegate->did_dial(*this);
 		}
 
@@ -987,17 +1676,17 @@ void StreamTransport<DelegateType, DatagramTransport>::did_recv_DIALCONF(
 	}
 }
 
-template<typename DelegateType, template<typename> class DatagramTransport>
-void StreamTransport<DelegateType, DatagramTransport>::send_CONF() {
-	transport.send(
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+void StreamTransport<DelegateType, DatagramTransport, CongestionControl>::send_CONF() {
+	transport->send(
 		CONF()
 		.set_src_conn_id(this->src_conn_id)
 		.set_dst_conn_id(this->dst_conn_id)
 	);
 }
 
-template<typename DelegateType, template<typename> class DatagramTransport>
-void StreamTransport<DelegateType, DatagramTransport>::did_recv_CONF(
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+void StreamTransport<DelegateType, DatagramTransport, CongestionControl>::did_recv_CONF(
 	CONF &&packet
 ) {
 	if(!packet.validate()) {
@@ -1024,8 +1713,10 @@ void StreamTransport<DelegateType, DatagramTransport>::did_recv_CONF(
 		}
 
 		conn_state = ConnectionState::Established;
+		start_pmtud();
+		send_TICKET();
 
-		if(dialled) {
+		if(dialled && !did_dial_early) {
 			delegate->did_dial(*this);
 		}
 
@@ -1054,7 +1745,8 @@ void StreamTransport<DelegateType, DatagramTransport>::did_recv_CONF(
 	}
 
 	case ConnectionState::Listen:
-	case ConnectionState::DialSent: {
+	case ConnectionState::DialSent:
+	case ConnectionState::ResumeSent: {
 		// Shouldn't receive CONF in these states, unrecoverable
 		SPDLOG_DEBUG(
 			"Stream transport {{ Src: {}, Dst: {} }}: CONF: Unexpected",
@@ -1073,20 +1765,20 @@ void StreamTransport<DelegateType, DatagramTransport>::did_recv_CONF(
 	}
 }
 
-template<typename DelegateType, template<typename> class DatagramTransport>
-void StreamTransport<DelegateType, DatagramTransport>::send_RST(
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+void StreamTransport<DelegateType, DatagramTransport, CongestionControl>::send_RST(
 	uint32_t src_conn_id,
 	uint32_t dst_conn_id
 ) {
-	transport.send(
+	transport->send(
 		RST()
 		.set_src_conn_id(src_conn_id)
 		.set_dst_conn_id(dst_conn_id)
 	);
 }
 
-template<typename DelegateType, template<typename> class DatagramTransport>
-void StreamTransport<DelegateType, DatagramTransport>::did_recv_RST(
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+void StreamTransport<DelegateType, DatagramTransport, CongestionControl>::did_recv_RST(
 	RST &&packet
 ) {
 	if(!packet.validate()) {
@@ -1096,22 +1788,27 @@ void StreamTransport<DelegateType, DatagramTransport>::did_recv_RST(
 	auto src_conn_id = packet.src_conn_id();
 	auto dst_conn_id = packet.dst_conn_id();
 	if(src_conn_id == this->src_conn_id && dst_conn_id == this->dst_conn_id) {
+		if(conn_state == ConnectionState::ResumeSent) {
+			// Early DATA overtaking its RESUME gets reset, the RESUME retry settles it
+			return;
+		}
+
 		SPDLOG_DEBUG(
 			"Stream transport {{ Src: {}, Dst: {} }}: RST",
 			src_addr.to_string(),
 			dst_addr.to_string()
 		);
 		reset();
-		transport.close();
+		transport->close();
 	} else if (conn_state == ConnectionState::Listen) {
 		// Remove idle connection, usually happens if multiple RST are sent
 		reset();
-		transport.close();
+		transport->close();
 	}
 }
 
-template<typename DelegateType, template<typename> class DatagramTransport>
-void StreamTransport<DelegateType, DatagramTransport>::send_DATA(
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+void StreamTransport<DelegateType, DatagramTransport, CongestionControl>::send_DATA(
 	SendStream &stream,
 	DataItem &data_item,
 	uint64_t offset,
@@ -1122,56 +1819,90 @@ void StreamTransport<DelegateType, DatagramTransport>::send_DATA(
 	bool is_fin = (stream.done_queueing &&
 		data_item.stream_offset + offset + length >= stream.queue_offset);
 
-	auto packet = DATA(12 + length + crypto_aead_aes256gcm_ABYTES, is_fin)
-					.set_src_conn_id(src_conn_id)
-					.set_dst_conn_id(dst_conn_id)
-					.set_packet_number(this->last_sent_packet)
-					.set_stream_id(stream.stream_id)
-					.set_offset(data_item.stream_offset + offset)
-					.set_length(length)
-					.payload_buffer();
+	SentPacketInfo sent_packet(
+		asyncio::EventLoop::now(),
+		&stream,
+		&data_item,
+		offset,
+		length
+	);
+	this->cc.on_send(sent_packet.sent_time, sent_packet, this->bytes_in_flight);
+	this->sent_packets.add(this->last_sent_packet, sent_packet);
 
-	// Figure out better way
-	packet.uncover_unsafe(30);
-	packet.write_unsafe(30, data_item.data.data()+offset, length);
-	packet.write_unsafe(30 + length + crypto_aead_aes256gcm_ABYTES, nonce, 12);
+	constexpr bool has_chain_send = requires(
+		BaseTransport& t
+	) {
+		t.send(core::BufferChain());
+	};
+
+	if constexpr (!is_encrypted && has_chain_send) {
+		// Only the owned part of the fragment is copied next to the header,
+		// shared data goes out as a separate segment without copying
+		auto owned_length = data_item.owned_length(offset, length);
+
+		auto packet = DATA(owned_length, is_fin, stream.whole)
+						.set_src_conn_id(src_conn_id)
+						.set_dst_conn_id(dst_conn_id)
+						.set_packet_number(this->last_sent_packet)
+						.set_stream_id(stream.stream_id)
+						.set_offset(data_item.stream_offset + offset)
+						.set_length(length)
+						.payload_buffer();
+
+		packet.uncover_unsafe(30);
+		data_item.read_unsafe(offset, packet.data() + 30, owned_length);
+
+		// Tag followed by nonce
+		core::Buffer trailer(crypto_aead_aes256gcm_ABYTES + 12);
+		trailer.write_unsafe(crypto_aead_aes256gcm_ABYTES, nonce, 12);
+
+		core::BufferChain chain(std::move(packet));
+		if(owned_length < length) {
+			chain.append(data_item.shared_slice(offset + owned_length, length - owned_length));
+		}
+		chain.append(std::move(trailer));
 
-	if constexpr (is_encrypted) {
-		crypto_aead_aes256gcm_encrypt_afternm(
-			packet.data() + 18,
-			nullptr,
-			packet.data() + 18,
-			12 + length,
-			packet.data() + 2,
-			16,
-			nullptr,
-			nonce,
-			&tx_ctx
-		);
-		sodium_increment(nonce, 12);
-	}
-
-	this->sent_packets.emplace(
-		std::piecewise_construct,
-		std::forward_as_tuple(this->last_sent_packet),
-		std::forward_as_tuple(
-			asyncio::EventLoop::now(),
-			&stream,
-			&data_item,
-			offset,
-			length
-		)
-	);
+		transport->send(std::move(chain));
+	} else {
+		auto packet = DATA(12 + length + crypto_aead_aes256gcm_ABYTES, is_fin, stream.whole)
+						.set_src_conn_id(src_conn_id)
+						.set_dst_conn_id(dst_conn_id)
+						.set_packet_number(this->last_sent_packet)
+						.set_stream_id(stream.stream_id)
+						.set_offset(data_item.stream_offset + offset)
+						.set_length(length)
+						.payload_buffer();
+
+		// Encryption needs the plaintext in place, copy into the pooled packet buffer
+		packet.uncover_unsafe(30);
+		data_item.read_unsafe(offset, packet.data() + 30, length);
+		packet.write_unsafe(30 + length + crypto_aead_aes256gcm_ABYTES, nonce, 12);
+
+		if constexpr (is_encrypted) {
+			crypto_aead_aes256gcm_encrypt_afternm(
+				packet.data() + 18,
+				nullptr,
+				packet.data() + 18,
+				12 + length,
+				packet.data() + 2,
+				16,
+				nullptr,
+				nonce,
+				&tx_ctx
+			);
+			sodium_increment(nonce, 12);
+		}
 
-	transport.send(std::move(packet));
+		transport->send(std::move(packet));
+	}
 
 	if(is_fin && stream.state != SendStream::State::Acked) {
 		stream.state = SendStream::State::Sent;
 	}
 }
 
-template<typename DelegateType, template<typename> class DatagramTransport>
-void StreamTransport<DelegateType, DatagramTransport>::did_recv_DATA(
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+void StreamTransport<DelegateType, DatagramTransport, CongestionControl>::did_recv_DATA(
 	DATA &&packet
 ) {
 	if(!packet.validate(12 + crypto_aead_aes256gcm_ABYTES)) {
@@ -1215,6 +1946,10 @@ void StreamTransport<DelegateType, DatagramTransport>::did_recv_DATA(
 				this->src_conn_id,
 				this->dst_conn_id
 			);
+			// Early DATA of a refused resumption, the dialler retransmits it once the handshake completes
+			if(conn_state == ConnectionState::DialRcvd) {
+				return;
+			}
 			send_RST(src_conn_id, dst_conn_id);
 			return;
 		}
@@ -1224,10 +1959,19 @@ void StreamTransport<DelegateType, DatagramTransport>::did_recv_DATA(
 
 	if(conn_state == ConnectionState::DialRcvd) {
 		conn_state = ConnectionState::Established;
+		start_pmtud();
+		send_TICKET();
 
-		if(dialled) {
+		if(dialled && !did_dial_early) {
 			delegate->did_dial(*this);
 		}
+	} else if(conn_state == ConnectionState::ResumeSent) {
+		// DATA under the resumed keys confirms the resumption as well as RESUMECONF
+		state_timer.stop();
+		state_timer_interval = 0;
+
+		conn_state = ConnectionState::Established;
+		start_pmtud();
 	} else if(conn_state != ConnectionState::Established) {
 		return;
 	}
@@ -1235,6 +1979,34 @@ void StreamTransport<DelegateType, DatagramTransport>::did_recv_DATA(
 	auto offset = packet.offset();
 	auto length = packet.length();
 	auto packet_number = packet.packet_number();
+	auto is_whole = packet.is_whole_set();
+
+	if(recv_streams.find(packet.stream_id()) == recv_streams.end()) {
+		// Retransmission of a whole stream which was delivered already, say of a fragment rebuilt from a
+		// repair group. Acked so the source stops sending it but kept away from a fresh stream on the id.
+		if(is_whole && closed_recv_streams.contains(packet.stream_id(), asyncio::EventLoop::now())) {
+			closed_recv_streams.close(packet.stream_id(), asyncio::EventLoop::now());
+
+			ack_ranges.add_packet_number(packet_number);
+			if(!ack_timer_active) {
+				ack_timer_active = true;
+				ack_timer.template start<Self, &Self::ack_timer_cb>(25, 0);
+			}
+
+			return;
+		}
+
+		// Left unacked, the source sends it again once streams have finished
+		if(recv_streams.size() >= max_recv_streams) {
+			SPDLOG_DEBUG(
+				"Stream transport {{ Src: {}, Dst: {} }}: DATA: Too many streams: {}",
+				src_addr.to_string(),
+				dst_addr.to_string(),
+				packet.stream_id()
+			);
+			return;
+		}
+	}
 
 	auto &stream = get_or_create_recv_stream(packet.stream_id());
 
@@ -1264,6 +2036,23 @@ void StreamTransport<DelegateType, DatagramTransport>::did_recv_DATA(
 		return;
 	}
 
+	// Flow control, data past the stream or connection credit given to the source is refused.
+	// Late retransmissions of delivered whole streams were dropped above and take no credit.
+	auto end = offset + length;
+	auto growth = stream.window.growth(end);
+	if(!stream.window.can_recv(end) || !recv_window.can_recv(recv_window.get_received() + growth)) {
+		SPDLOG_DEBUG(
+			"Stream transport {{ Src: {}, Dst: {} }}: DATA: Flow control violation: {}, {}",
+			src_addr.to_string(),
+			dst_addr.to_string(),
+			stream.stream_id,
+			end
+		);
+		return;
+	}
+	stream.window.on_recv(end);
+	recv_window.on_recv(recv_window.get_received() + growth);
+
 	// Add to ack range
 	ack_ranges.add_packet_number(packet_number);
 
@@ -1273,13 +2062,50 @@ void StreamTransport<DelegateType, DatagramTransport>::did_recv_DATA(
 		ack_timer.template start<Self, &Self::ack_timer_cb>(25, 0);
 	}
 
+	constexpr bool has_recv_stream = requires(
+		DelegateType& d,
+		Self& t
+	) {
+		d.did_recv_stream(t, core::Buffer(nullptr, 0), uint16_t(0));
+	};
+
+	if constexpr (has_recv_stream) {
+		// Only streams with nothing delivered yet switch to reassembly
+		if(is_whole && !stream.whole && stream.read_offset == 0 && stream.recv_packets.empty()) {
+			stream.whole = true;
+		}
+
+		if(stream.whole) {
+			if(!stream.assemble(offset, p)) {
+				SPDLOG_DEBUG("Whole stream overflow: {}, {}, {}", stream.stream_id, offset, length);
+				return;
+			}
+
+			if(stream.check_assembled()) {
+				deliver_whole(stream);
+				return;
+			}
+
+			// The fragment might leave a single one missing in a stored repair group
+			auto group = stream.fec_groups.upper_bound(offset);
+			if(group != stream.fec_groups.begin() && std::prev(group)->second.end() > offset) {
+				auto node = stream.fec_groups.extract(std::prev(group));
+				recover_whole(stream, std::move(node.mapped()));
+			}
+
+			return;
+		}
+	}
+
 	// Short circuit on no new data
 	if(offset + length <= stream.read_offset) {
 		return;
 	}
 
-	// Check if data can be read immediately
-	if(offset <= stream.read_offset) {
+	// Check if data can be read immediately, data waits in the queue while paused
+	if(offset <= stream.read_offset && !is_recv_paused) {
+		auto old_read_offset = stream.read_offset;
+
 		// Cover bytes which have already been read
 		p.cover_unsafe(stream.read_offset - offset);
 
@@ -1290,41 +2116,7 @@ void StreamTransport<DelegateType, DatagramTransport>::did_recv_DATA(
 		}
 		stream.read_offset = offset + length;
 
-		// Read any out of order data
-		auto iter = stream.recv_packets.begin();
-		while(iter != stream.recv_packets.end()) {
-			// Short circuit if data can't be read immediately
-			if(iter->second.offset > stream.read_offset) {
-				break;
-			}
-
-			auto offset = iter->second.offset;
-			auto length = iter->second.length;
-
-			// Check new data
-			if(offset + length > stream.read_offset) {
-				// Cover bytes which have already been read
-				iter->second.packet.cover_unsafe(stream.read_offset - offset);
-
-				// Read bytes and update offset
-				SPDLOG_DEBUG("Out of order: {}, {}, {:spn}", offset, length, spdlog::to_hex(iter->second.packet.data(), iter->second.packet.data() + iter->second.packet.size()));
-				auto res = delegate->did_recv(*this, std::move(iter->second).packet, stream.stream_id);
-				if(res < 0) {
-					return;
-				}
-
-				stream.read_offset = offset + length;
-			}
-
-			// Next iter
-			iter = stream.recv_packets.erase(iter);
-		}
-
-		// Check all data read
-		if(stream.check_read()) {
-			stream.state = RecvStream::State::Read;
-			recv_streams.erase(stream.stream_id);
-		}
+		read_recv_packets(stream, old_read_offset);
 	} else {
 		// Queue packet for later processing
 		SPDLOG_DEBUG("Queue for later: {}, {}, {:spn}", offset, length, spdlog::to_hex(p.data(), p.data() + p.size()));
@@ -1343,29 +2135,36 @@ void StreamTransport<DelegateType, DatagramTransport>::did_recv_DATA(
 	}
 }
 
-template<typename DelegateType, template<typename> class DatagramTransport>
-void StreamTransport<DelegateType, DatagramTransport>::send_ACK() {
-	size_t size = ack_ranges.ranges.size() > 171 ? 171 : ack_ranges.ranges.size();
-
-	transport.send(
-		ACK(size)
-		.set_src_conn_id(src_conn_id)
-		.set_dst_conn_id(dst_conn_id)
-		.set_packet_number(ack_ranges.largest)
-		.set_size(size)
-		.set_ranges(ack_ranges.ranges.begin(), ack_ranges.ranges.end())
-	);
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+void StreamTransport<DelegateType, DatagramTransport, CongestionControl>::send_ACK() {
+	// Runs from a given seen range go out together in an ACK, up to what fits in a packet.
+	// Older frames go first so their packets are acked before the newest frame can declare them lost.
+	auto frame_ranges = ack_frame_ranges();
+	auto num_frames = (ack_ranges.size() + frame_ranges - 1) / frame_ranges;
+	for(size_t frame = num_frames; frame-- > 0;) {
+		auto idx = frame * frame_ranges;
+		size_t size = ack_ranges.num_runs(idx, frame_ranges);
+
+		transport->send(
+			ACK(size)
+			.set_src_conn_id(src_conn_id)
+			.set_dst_conn_id(dst_conn_id)
+			.set_packet_number(ack_ranges.range(idx).high)
+			.set_size(size)
+			.set_ranges(ack_ranges.runs_begin(idx), ack_ranges.runs_end())
+		);
+	}
 }
 
-template<typename DelegateType, template<typename> class DatagramTransport>
-void StreamTransport<DelegateType, DatagramTransport>::did_recv_ACK(
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+void StreamTransport<DelegateType, DatagramTransport, CongestionControl>::did_recv_ACK(
 	ACK &&packet
 ) {
 	if(!packet.validate()) {
 		return;
 	}
 
-	if(conn_state != ConnectionState::Established) {
+	if(conn_state != ConnectionState::Established && conn_state != ConnectionState::ResumeSent) {
 		return;
 	}
 
@@ -1390,8 +2189,9 @@ void StreamTransport<DelegateType, DatagramTransport>::did_recv_ACK(
 	uint64_t largest = packet.packet_number();
 
 	// New largest acked packet
-	if(largest > largest_acked && sent_packets.find(largest) != sent_packets.end()) {
-		auto &sent_packet = sent_packets[largest];
+	auto *largest_packet = sent_packets.in_flight(largest);
+	if(largest > largest_acked && largest_packet != nullptr) {
+		auto &sent_packet = *largest_packet;
 
 		// Update largest packet details
 		largest_acked = largest;
@@ -1407,7 +2207,7 @@ void StreamTransport<DelegateType, DatagramTransport>::did_recv_ACK(
 
 	uint64_t high = largest;
 	bool gap = false;
-	bool is_app_limited = (bytes_in_flight < 0.8 * congestion_window);
+	bool is_app_limited = (bytes_in_flight < 0.8 * cc.window());
 
 	for(
 		auto iter = packet.ranges_begin();
@@ -1424,17 +2224,39 @@ void StreamTransport<DelegateType, DatagramTransport>::did_recv_ACK(
 			continue;
 		}
 
-		// Get packets within range [low+1, high]
-		auto low_iter = sent_packets.lower_bound(low + 1);
-		auto high_iter = sent_packets.upper_bound(high);
+		// Probe got through, move on to the next size
+		// low + 1 since low wraps around for ranges starting at packet 0
+		auto probe_pn = pmtud.probe_packet_number();
+		if(pmtud.is_probing() && low + 1 <= probe_pn && probe_pn <= high) {
+			pmtud.on_probe_acked();
+			SPDLOG_DEBUG(
+				"Stream transport {{ Src: {}, Dst: {} }}: PMTU: {}",
+				src_addr.to_string(),
+				dst_addr.to_string(),
+				pmtud.get_plpmtu()
+			);
+			pmtud_timer.template start<Self, &Self::pmtud_timer_cb>(0, 0);
+		}
 
-		// Iterate acked packets
+		// Iterate acked packets within range [low+1, high]
 		for(
-			;
-			low_iter != high_iter;
-			low_iter = sent_packets.erase(low_iter)
+			auto pn = sent_packets.next_in_flight(low + 1);
+			pn != sent_packets.end() && pn <= high;
+			pn = sent_packets.next_in_flight(pn)
 		) {
-			auto &sent_packet = low_iter->second;
+			auto sent_packet = sent_packets.at(pn);
+			sent_packets.erase(pn);
+
+			pmtud.on_packet_acked(pn, packet_size(sent_packet));
+			fec_rate.on_packet_acked();
+
+			// Datagrams only count towards congestion control
+			if(sent_packet.stream == nullptr) {
+				bytes_in_flight -= sent_packet.length;
+				cc.on_ack(now, sent_packet, bytes_in_flight, is_app_limited);
+				continue;
+			}
+
 			auto &stream = *sent_packet.stream;
 
 			auto sent_offset = sent_packet.data_item->stream_offset + sent_packet.offset;
@@ -1470,7 +2292,7 @@ void StreamTransport<DelegateType, DatagramTransport>::did_recv_ACK(
 					iter != stream.data_queue.end();
 					iter = stream.data_queue.erase(iter)
 				) {
-					if(stream.acked_offset < iter->stream_offset + iter->data.size()) {
+					if(stream.acked_offset < iter->stream_offset + iter->size()) {
 						// Still not fully acked, skip erase and abort
 						fully_acked = false;
 						break;
@@ -1493,28 +2315,8 @@ void StreamTransport<DelegateType, DatagramTransport>::did_recv_ACK(
 			stream.bytes_in_flight -= sent_packet.length;
 			bytes_in_flight -= sent_packet.length;
 
-			SPDLOG_TRACE("Times: {}, {}", sent_packet.sent_time, congestion_start);
-
 			// Congestion control
-			// Check if not in congestion recovery and not application limited
-			if(sent_packet.sent_time > congestion_start && !is_app_limited) {
-				if(congestion_window < ssthresh) {
-					// Slow start, exponential increase
-					congestion_window += sent_packet.length;
-				} else {
-					// Congestion avoidance, CUBIC
-					// auto k = k;
-					// auto t = now - congestion_start;
-					// congestion_window = w_max + 4 * std::pow(0.001 * (t - k), 3);
-
-					// if(congestion_window < 10000) {
-					// 	congestion_window = 10000;
-					// }
-
-					// Congestion avoidance, NEW RENO
-					congestion_window += 1500 * sent_packet.length / congestion_window;
-				}
-			}
+			cc.on_ack(now, sent_packet, bytes_in_flight, is_app_limited);
 
 			// Check stream finish
 			if (stream.state == SendStream::State::Sent &&
@@ -1524,80 +2326,80 @@ void StreamTransport<DelegateType, DatagramTransport>::did_recv_ACK(
 				// TODO: Call delegate to inform
 				SPDLOG_DEBUG("Acked: {}", stream.stream_id);
 
-				// Remove stream
+				// Remove stream, the id of a whole stream is held back until the destination forgets it
+				if(stream.whole) {
+					closed_send_streams.close(stream.stream_id, now);
+				}
 				send_streams.erase(stream.stream_id);
 
-				return;
+				// Rest of the ack still applies, streams finish on almost every ack once each message is a stream
+				continue;
 			}
 		}
 
 		high = low;
 	}
 
-	auto sent_iter = sent_packets.begin();
+	uint64_t last_lost = sent_packets.end();
+	uint64_t lost_bytes = 0;
 
 	// Determine lost packets
-	while(sent_iter != sent_packets.end()) {
+	for(
+		auto pn = sent_packets.next_in_flight(sent_packets.begin());
+		pn != sent_packets.end();
+		pn = sent_packets.next_in_flight(pn + 1)
+	) {
+		auto &sent_packet = sent_packets.at(pn);
+
 		// Condition for packet in flight to be considered lost
 		// 1. more than 20 packets before largest acked - disabled for now
 		// 2. more than 25ms before before largest acked
-		if (/*sent_iter->first + 20 < largest_acked ||*/
-			largest_sent_time > sent_iter->second.sent_time + 50) {
+		if (/*pn + 20 < largest_acked ||*/
+			largest_sent_time > sent_packet.sent_time + 50) {
 			SPDLOG_TRACE(
 				"Stream transport {{ Src: {}, Dst: {} }}: Lost packet: {}, {}, {}",
-				transport.src_addr.to_string(),
-				transport.dst_addr.to_string(),
-				sent_iter->first,
+				transport->src_addr.to_string(),
+				transport->dst_addr.to_string(),
+				pn,
 				largest_sent_time,
-				sent_iter->second.sent_time
+				sent_packet.sent_time
 			);
 
-			bytes_in_flight -= sent_iter->second.length;
-			sent_iter->second.stream->bytes_in_flight -= sent_iter->second.length;
-			lost_packets[sent_iter->first] = sent_iter->second;
-
-			sent_iter++;
+			bytes_in_flight -= sent_packet.length;
+			if(sent_packet.stream != nullptr) {
+				sent_packet.stream->bytes_in_flight -= sent_packet.length;
+			}
+			sent_packets.mark_lost(pn);
+
+			last_lost = pn;
+			lost_bytes += sent_packet.length;
+			fec_rate.on_packet_lost();
+
+			if(pmtud.on_packet_lost(pn, packet_size(sent_packet), now)) {
+				SPDLOG_INFO(
+					"Stream transport {{ Src: {}, Dst: {} }}: PMTU black hole, falling back to {}",
+					src_addr.to_string(),
+					dst_addr.to_string(),
+					pmtud.get_plpmtu()
+				);
+				pmtud_timer.template start<Self, &Self::pmtud_timer_cb>(0, 0);
+			}
 		} else {
 			break;
 		}
 	}
 
-	if(sent_iter == sent_packets.begin()) {
+	if(last_lost == sent_packets.end()) {
 		// No lost packets, ignore
-	} else {
-		// Lost packets, congestion event
-		auto last_iter = std::prev(sent_iter);
-		auto &sent_packet = last_iter->second;
-
-		if(sent_packet.sent_time > congestion_start) {
-			// New congestion event
-			SPDLOG_DEBUG(
-				"Stream transport {{ Src: {}, Dst: {} }}: Congestion event: {}, {}",
-				transport.src_addr.to_string(),
-				transport.dst_addr.to_string(),
-				congestion_window,
-				last_iter->first
-			);
-			congestion_start = now;
-
-			if(congestion_window < w_max) {
-				// Fast convergence
-				w_max = congestion_window;
-				congestion_window *= 0.6;
-			} else {
-				w_max = congestion_window;
-				congestion_window *= 0.75;
-			}
-
-			if(congestion_window < 10000) {
-				congestion_window = 10000;
-			}
-			ssthresh = congestion_window;
-			k = std::cbrt(w_max / 16)*1000;
-		}
-
-		// Pop lost packets from sent
-		sent_packets.erase(sent_packets.begin(), sent_iter);
+	} else if(cc.on_loss(now, sent_packets.at(last_lost), lost_bytes, bytes_in_flight)) {
+		// Lost packets, new congestion event
+		SPDLOG_DEBUG(
+			"Stream transport {{ Src: {}, Dst: {} }}: Congestion event: {}, {}",
+			transport->src_addr.to_string(),
+			transport->dst_addr.to_string(),
+			cc.window(),
+			last_lost
+		);
 	}
 
 	// New packets
@@ -1607,12 +2409,12 @@ void StreamTransport<DelegateType, DatagramTransport>::did_recv_ACK(
 	tlp_timer.template start<Self, &Self::tlp_timer_cb>(tlp_interval, 0);
 }
 
-template<typename DelegateType, template<typename> class DatagramTransport>
-void StreamTransport<DelegateType, DatagramTransport>::send_SKIPSTREAM(
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+void StreamTransport<DelegateType, DatagramTransport, CongestionControl>::send_SKIPSTREAM(
 	uint16_t stream_id,
 	uint64_t offset
 ) {
-	transport.send(
+	transport->send(
 		SKIPSTREAM()
 		.set_src_conn_id(src_conn_id)
 		.set_dst_conn_id(dst_conn_id)
@@ -1621,8 +2423,8 @@ void StreamTransport<DelegateType, DatagramTransport>::send_SKIPSTREAM(
 	);
 }
 
-template<typename DelegateType, template<typename> class DatagramTransport>
-void StreamTransport<DelegateType, DatagramTransport>::did_recv_SKIPSTREAM(
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+void StreamTransport<DelegateType, DatagramTransport, CongestionControl>::did_recv_SKIPSTREAM(
 	SKIPSTREAM &&packet
 ) {
 	if(!packet.validate()) {
@@ -1666,12 +2468,12 @@ void StreamTransport<DelegateType, DatagramTransport>::did_recv_SKIPSTREAM(
 	flush_stream(stream_id);
 }
 
-template<typename DelegateType, template<typename> class DatagramTransport>
-void StreamTransport<DelegateType, DatagramTransport>::send_FLUSHSTREAM(
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+void StreamTransport<DelegateType, DatagramTransport, CongestionControl>::send_FLUSHSTREAM(
 	uint16_t stream_id,
 	uint64_t offset
 ) {
-	transport.send(
+	transport->send(
 		FLUSHSTREAM()
 		.set_src_conn_id(src_conn_id)
 		.set_dst_conn_id(dst_conn_id)
@@ -1680,8 +2482,8 @@ void StreamTransport<DelegateType, DatagramTransport>::send_FLUSHSTREAM(
 	);
 }
 
-template<typename DelegateType, template<typename> class DatagramTransport>
-void StreamTransport<DelegateType, DatagramTransport>::did_recv_FLUSHSTREAM(
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+void StreamTransport<DelegateType, DatagramTransport, CongestionControl>::did_recv_FLUSHSTREAM(
 	FLUSHSTREAM &&packet
 ) {
 	if(!packet.validate()) {
@@ -1732,16 +2534,23 @@ void StreamTransport<DelegateType, DatagramTransport>::did_recv_FLUSHSTREAM(
 	stream.read_offset = offset;
 	stream.wait_flush = false;
 
+	// Skipped data frees up credit like consumed data
+	consume(offset - old_offset);
+	stream.window.on_consume(offset);
+	if(stream.window.update()) {
+		send_MAXSTREAMDATA(stream_id, stream.window.get_limit());
+	}
+
 	delegate->did_recv_flush_stream(*this, stream_id, offset, old_offset);
 
 	send_FLUSHCONF(stream_id);
 }
 
-template<typename DelegateType, template<typename> class DatagramTransport>
-void StreamTransport<DelegateType, DatagramTransport>::send_FLUSHCONF(
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+void StreamTransport<DelegateType, DatagramTransport, CongestionControl>::send_FLUSHCONF(
 	uint16_t stream_id
 ) {
-	transport.send(
+	transport->send(
 		FLUSHCONF()
 		.set_src_conn_id(src_conn_id)
 		.set_dst_conn_id(dst_conn_id)
@@ -1749,8 +2558,8 @@ void StreamTransport<DelegateType, DatagramTransport>::send_FLUSHCONF(
 	);
 }
 
-template<typename DelegateType, template<typename> class DatagramTransport>
-void StreamTransport<DelegateType, DatagramTransport>::did_recv_FLUSHCONF(
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+void StreamTransport<DelegateType, DatagramTransport, CongestionControl>::did_recv_FLUSHCONF(
 	FLUSHCONF &&packet
 ) {
 	if(!packet.validate()) {
@@ -1787,9 +2596,9 @@ void StreamTransport<DelegateType, DatagramTransport>::did_recv_FLUSHCONF(
 	delegate->did_recv_flush_conf(*this, stream_id);
 }
 
-template<typename DelegateType, template<typename> class DatagramTransport>
-void StreamTransport<DelegateType, DatagramTransport>::send_CLOSE(uint16_t reason) {
-	transport.send(
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+void StreamTransport<DelegateType, DatagramTransport, CongestionControl>::send_CLOSE(uint16_t reason) {
+	transport->send(
 		CLOSE()
 		.set_src_conn_id(src_conn_id)
 		.set_dst_conn_id(dst_conn_id)
@@ -1797,15 +2606,15 @@ void StreamTransport<DelegateType, DatagramTransport>::send_CLOSE(uint16_t reaso
 	);
 }
 
-template<typename DelegateType, template<typename> class DatagramTransport>
-void StreamTransport<DelegateType, DatagramTransport>::did_recv_CLOSE(
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+void StreamTransport<DelegateType, DatagramTransport, CongestionControl>::did_recv_CLOSE(
 	CLOSE &&packet
 ) {
 	if(!packet.validate()) {
 		return;
 	}
 
-	SPDLOG_TRACE("CLOSE <<< {}: {}", dst_addr.to_string(), packet.stream_id());
+	SPDLOG_TRACE("CLOSE <<< {}: {}", dst_addr.to_string(), packet.reason());
 
 	auto src_conn_id = packet.src_conn_id();
 	auto dst_conn_id = packet.dst_conn_id();
@@ -1825,7 +2634,7 @@ void StreamTransport<DelegateType, DatagramTransport>::did_recv_CLOSE(
 		if(conn_state == ConnectionState::Listen) {
 			// Close idle connections
 			reset();
-			transport.close();
+			transport->close();
 		}
 		return;
 	}
@@ -1835,37 +2644,37 @@ void StreamTransport<DelegateType, DatagramTransport>::did_recv_CLOSE(
 	if(conn_state == ConnectionState::Established || conn_state == ConnectionState::Closing) {
 		send_CLOSECONF(src_conn_id, dst_conn_id);
 		reset();
-		transport.close(packet.reason());
+		transport->close(packet.reason());
 	} else if(conn_state == ConnectionState::Listen) {
 		// Close idle connections
 		reset();
-		transport.close();
+		transport->close();
 	} else {
 		// Ignore in other states
 	}
 }
 
-template<typename DelegateType, template<typename> class DatagramTransport>
-void StreamTransport<DelegateType, DatagramTransport>::send_CLOSECONF(
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+void StreamTransport<DelegateType, DatagramTransport, CongestionControl>::send_CLOSECONF(
 	uint32_t src_conn_id,
 	uint32_t dst_conn_id
 ) {
-	transport.send(
+	transport->send(
 		CLOSECONF()
 		.set_src_conn_id(src_conn_id)
 		.set_dst_conn_id(dst_conn_id)
 	);
 }
 
-template<typename DelegateType, template<typename> class DatagramTransport>
-void StreamTransport<DelegateType, DatagramTransport>::did_recv_CLOSECONF(
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+void StreamTransport<DelegateType, DatagramTransport, CongestionControl>::did_recv_CLOSECONF(
 	CLOSECONF &&packet
 ) {
 	if(!packet.validate()) {
 		return;
 	}
 
-	SPDLOG_TRACE("CLOSECONF <<< {}: {}", dst_addr.to_string(), packet.stream_id());
+	SPDLOG_TRACE("CLOSECONF <<< {}", dst_addr.to_string());
 
 	state_timer.stop();
 
@@ -1886,118 +2695,1267 @@ void StreamTransport<DelegateType, DatagramTransport>::did_recv_CLOSECONF(
 	}
 
 	reset();
-	transport.close();
+	transport->close();
 }
 
-//---------------- Protocol functions end ----------------//
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+void StreamTransport<DelegateType, DatagramTransport, CongestionControl>::send_PROBE(
+	uint16_t size
+) {
+	this->last_sent_packet++;
+	pmtud.on_probe_sent(this->last_sent_packet);
 
+	// Padding, followed by tag and nonce like DATA
+	auto padding = size - 18 - crypto_aead_aes256gcm_ABYTES - 12;
+	auto packet = PROBE(padding + crypto_aead_aes256gcm_ABYTES + 12)
+					.set_src_conn_id(src_conn_id)
+					.set_dst_conn_id(dst_conn_id)
+					.set_packet_number(this->last_sent_packet)
+					.payload_buffer();
 
-//---------------- Delegate functions begin ----------------//
+	packet.uncover_unsafe(18);
+	std::memset(packet.data() + 18, 0, padding + crypto_aead_aes256gcm_ABYTES);
+	packet.write_unsafe(18 + padding + crypto_aead_aes256gcm_ABYTES, nonce, 12);
 
-//! Callback function when trying to establish a connection with a peer. Sends a DIAL packet to initiate the handshake
-template<typename DelegateType, template<typename> class DatagramTransport>
-void StreamTransport<DelegateType, DatagramTransport>::did_dial(
-	BaseTransport &,
-	uint8_t const* remote_static_pk
+	if constexpr (is_encrypted) {
+		crypto_aead_aes256gcm_encrypt_afternm(
+			packet.data() + 18,
+			nullptr,
+			packet.data() + 18,
+			padding,
+			packet.data() + 2,
+			16,
+			nullptr,
+			nonce,
+			&tx_ctx
+		);
+		sodium_increment(nonce, 12);
+	}
+
+	SPDLOG_DEBUG("PROBE >>> {}: {}, {}", dst_addr.to_string(), this->last_sent_packet, size);
+
+	transport->send(std::move(packet));
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+void StreamTransport<DelegateType, DatagramTransport, CongestionControl>::did_recv_PROBE(
+	PROBE &&packet
 ) {
-	if(conn_state != ConnectionState::Listen) {
+	if(!packet.validate(crypto_aead_aes256gcm_ABYTES + 12)) {
 		return;
 	}
 
-	if (remote_static_pk != nullptr) {
-		std::memcpy(this->remote_static_pk, remote_static_pk, crypto_box_PUBLICKEYBYTES);
+	auto src_conn_id = packet.src_conn_id();
+	auto dst_conn_id = packet.dst_conn_id();
+	if(src_conn_id != this->src_conn_id || dst_conn_id != this->dst_conn_id) { // Wrong connection id, send RST
+		SPDLOG_DEBUG(
+			"Stream transport {{ Src: {}, Dst: {} }}: PROBE: Connection id mismatch: {}, {}, {}, {}",
+			src_addr.to_string(),
+			dst_addr.to_string(),
+			src_conn_id,
+			this->src_conn_id,
+			dst_conn_id,
+			this->dst_conn_id
+		);
+		send_RST(src_conn_id, dst_conn_id);
+		return;
 	}
 
-	// Begin handshake
-	dialled = true;
+	if(conn_state != ConnectionState::Established) {
+		return;
+	}
 
-	state_timer_interval = 1000;
-	state_timer.template start<Self, &Self::dial_timer_cb>(state_timer_interval, 0);
+	if constexpr (is_encrypted) {
+		auto res = crypto_aead_aes256gcm_decrypt_afternm(
+			packet.payload(),
+			nullptr,
+			nullptr,
+			packet.payload(),
+			packet.payload_buffer().size() - 12,
+			packet.payload() - 16,
+			16,
+			packet.payload() + packet.payload_buffer().size() - 12,
+			&rx_ctx
+		);
 
-	src_conn_id = (uint32_t)std::random_device()();
-	send_DIAL();
-	conn_state = ConnectionState::DialSent;
+		if(res < 0) {
+			return;
+		}
+	}
+
+	SPDLOG_TRACE("PROBE <<< {}: {}", dst_addr.to_string(), packet.packet_number());
+
+	// Only needs an ack
+	ack_ranges.add_packet_number(packet.packet_number());
+
+	if(!ack_timer_active) {
+		ack_timer_active = true;
+		ack_timer.template start<Self, &Self::ack_timer_cb>(25, 0);
+	}
 }
 
-template<typename DelegateType, template<typename> class DatagramTransport>
-void StreamTransport<DelegateType, DatagramTransport>::did_close(
-	BaseTransport &,
-	uint16_t reason
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+void StreamTransport<DelegateType, DatagramTransport, CongestionControl>::send_REPAIR(
+	SendStream &stream,
+	bool is_fin
 ) {
-	delegate->did_close(*this, reason);
-	transport_manager.erase(dst_addr);
-}
+	// Leaves along with the DATA packet ending the group, without pacing or counting it in flight.
+	// Taking pacing slots would slow data down below the delivery rate the congestion control measures.
+	auto group = stream.fec.take(is_fin);
+	auto fragment = group.fragment();
 
-//! Receives the packet and processes them
-/*!
-	Determines the type of packet by reading the first byte and redirects the packet to appropriate function for further processing
+	auto packet = REPAIR(fragment + crypto_aead_aes256gcm_ABYTES + 12, group.is_fin)
+					.set_src_conn_id(src_conn_id)
+					.set_dst_conn_id(dst_conn_id)
+					.set_stream_id(stream.stream_id)
+					.set_offset(group.offset)
+					.set_length(group.length)
+					.payload_buffer();
 
-	\li \b byte :	\b type
-	\li 0		:	DATA
-	\li 1		:	DATA + FIN
-	\li 2		:	ACK
-	\li 3		:	DIAL
-	\li 4		:	DIALCONF
-	\li 5		:	CONF
-	\li 6		:	RST
-*/
-template<typename DelegateType, template<typename> class DatagramTransport>
-void StreamTransport<DelegateType, DatagramTransport>::did_recv(
-	BaseTransport &,
-	BaseMessageType &&packet
-) {
-	auto type = packet.payload_buffer().read_uint8(1);
-	if(type == std::nullopt || packet.payload_buffer().read_uint8_unsafe(0) != 0) {
-		return;
-	}
+	packet.uncover_unsafe(24);
+	packet.write_unsafe(24, group.parity.data(), fragment);
+	packet.write_unsafe(24 + fragment + crypto_aead_aes256gcm_ABYTES, nonce, 12);
 
-	switch(type.value()) {
-		// DATA
-		case 0:
-		// DATA + FIN
-		case 1: did_recv_DATA(std::move(packet));
-		break;
-		// ACK
-		case 2: did_recv_ACK(std::move(packet));
-		break;
-		// DIAL
-		case 3: did_recv_DIAL(std::move(packet));
-		break;
-		// DIALCONF
-		case 4: did_recv_DIALCONF(std::move(packet));
-		break;
-		// CONF
-		case 5: did_recv_CONF(std::move(packet));
-		break;
-		// RST
-		case 6: did_recv_RST(std::move(packet));
-		break;
-		// SKIPSTREAM
-		case 7: did_recv_SKIPSTREAM(std::move(packet));
-		break;
-		// FLUSHSTREAM
-		case 8: did_recv_FLUSHSTREAM(std::move(packet));
-		break;
-		// FLUSHCONF
-		case 9: did_recv_FLUSHCONF(std::move(packet));
-		break;
-		// UNKNOWN
-		default: SPDLOG_TRACE("UNKNOWN <<< {}", dst_addr.to_string());
-		break;
+	if constexpr (is_encrypted) {
+		crypto_aead_aes256gcm_encrypt_afternm(
+			packet.data() + 10,
+			nullptr,
+			packet.data() + 10,
+			14 + fragment,
+			packet.data() + 2,
+			8,
+			nullptr,
+			nonce,
+			&tx_ctx
+		);
+		sodium_increment(nonce, 12);
 	}
+
+	SPDLOG_TRACE("REPAIR >>> {}: {}, {}", dst_addr.to_string(), group.offset, group.length);
+
+	transport->send(std::move(packet));
 }
 
-template<typename DelegateType, template<typename> class DatagramTransport>
-void StreamTransport<DelegateType, DatagramTransport>::did_send(
-	BaseTransport &,
-	core::Buffer &&packet
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+void StreamTransport<DelegateType, DatagramTransport, CongestionControl>::did_recv_REPAIR(
+	REPAIR &&packet
 ) {
-	auto type = packet.read_uint8(1);
-	if(type == std::nullopt) {
+	if(!packet.validate(crypto_aead_aes256gcm_ABYTES + 12)) {
 		return;
 	}
 
-	switch(type.value()) {
+	auto src_conn_id = packet.src_conn_id();
+	auto dst_conn_id = packet.dst_conn_id();
+	if(src_conn_id != this->src_conn_id || dst_conn_id != this->dst_conn_id) { // Wrong connection id, send RST
+		SPDLOG_DEBUG(
+			"Stream transport {{ Src: {}, Dst: {} }}: REPAIR: Connection id mismatch: {}, {}, {}, {}",
+			src_addr.to_string(),
+			dst_addr.to_string(),
+			src_conn_id,
+			this->src_conn_id,
+			dst_conn_id,
+			this->dst_conn_id
+		);
+		send_RST(src_conn_id, dst_conn_id);
+		return;
+	}
+
+	if(conn_state != ConnectionState::Established) {
+		return;
+	}
+
+	if constexpr (is_encrypted) {
+		auto res = crypto_aead_aes256gcm_decrypt_afternm(
+			packet.payload() - 14,
+			nullptr,
+			nullptr,
+			packet.payload() - 14,
+			packet.payload_buffer().size() + 2,
+			packet.payload() - 22,
+			8,
+			packet.payload() + packet.payload_buffer().size() - 12,
+			&rx_ctx
+		);
+
+		if(res < 0) {
+			return;
+		}
+	}
+
+	SPDLOG_TRACE("REPAIR <<< {}: {}, {}", dst_addr.to_string(), packet.offset(), packet.length());
+
+	constexpr bool has_recv_stream = requires(
+		DelegateType& d,
+		Self& t
+	) {
+		d.did_recv_stream(t, core::Buffer(nullptr, 0), uint16_t(0));
+	};
+
+	if constexpr (has_recv_stream) {
+		// Only whole streams keep received fragments around to rebuild others from, groups of
+		// delivered streams are dropped here along with those of streams not seen yet
+		auto iter = recv_streams.find(packet.stream_id());
+		if(iter == recv_streams.end() || !iter->second.whole || iter->second.wait_flush) {
+			return;
+		}
+
+		FecGroup group;
+		group.offset = packet.offset();
+		group.length = packet.length();
+		group.is_fin = packet.is_fin_set();
+		group.parity = std::move(packet).payload_buffer();
+		group.parity.truncate_unsafe(crypto_aead_aes256gcm_ABYTES + 12);
+
+		if(group.fragment() == 0 || group.count() > FecRate::max_group_size) {
+			return;
+		}
+
+		recover_whole(iter->second, std::move(group));
+	}
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+void StreamTransport<DelegateType, DatagramTransport, CongestionControl>::recover_whole(
+	RecvStream &stream,
+	FecGroup &&group
+) {
+	// Set stream size if the group ends the stream
+	if(group.is_fin && stream.state == RecvStream::State::Recv) {
+		stream.size = group.end();
+		stream.state = RecvStream::State::SizeKnown;
+	}
+
+	uint64_t offset = 0;
+	core::Buffer fragment(nullptr, 0);
+	auto missing = stream.recover(group, offset, fragment);
+	if(missing == 0) {
+		return;
+	}
+
+	if(missing > 1) {
+		// Retried as more fragments of the group arrive
+		if(stream.fec_groups.size() < RecvStream::max_fec_groups) {
+			stream.fec_groups.insert_or_assign(group.offset, std::move(group));
+		}
+		return;
+	}
+
+	if(!stream.assemble(offset, fragment)) {
+		SPDLOG_DEBUG("Whole stream overflow: {}, {}, {}", stream.stream_id, offset, fragment.size());
+		return;
+	}
+
+	SPDLOG_DEBUG("Recovered fragment: {}, {}, {}", stream.stream_id, offset, fragment.size());
+
+	if(stream.check_assembled()) {
+		deliver_whole(stream);
+	}
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+void StreamTransport<DelegateType, DatagramTransport, CongestionControl>::deliver_whole(
+	RecvStream &stream
+) {
+	// Held until resumed
+	if(is_recv_paused) {
+		return;
+	}
+
+	auto stream_id = stream.stream_id;
+	auto data = std::move(stream.assembly);
+	data.truncate_unsafe(data.size() - stream.size);
+
+	stream.read_offset = stream.size;
+	stream.state = RecvStream::State::Read;
+	consume(stream.size);
+	recv_streams.erase(stream_id);
+	closed_recv_streams.close(stream_id, asyncio::EventLoop::now());
+
+	delegate->did_recv_stream(*this, std::move(data), stream_id);
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+void StreamTransport<DelegateType, DatagramTransport, CongestionControl>::send_TICKET() {
+	// Handed out by the side which was dialled, for the dialler to come back with
+	if(dialled || tickets == nullptr) {
+		return;
+	}
+
+	constexpr size_t pt_len = SessionTickets::secret_size + SessionTickets::ticket_size;
+
+	auto packet = TICKET(pt_len + crypto_aead_aes256gcm_ABYTES + 12)
+					.set_src_conn_id(src_conn_id)
+					.set_dst_conn_id(dst_conn_id)
+					.payload_buffer();
+
+	packet.uncover_unsafe(10);
+	tickets->issue(
+		remote_static_pk,
+		packet.data() + 10 + SessionTickets::secret_size,
+		packet.data() + 10,
+		asyncio::EventLoop::now()
+	);
+	packet.write_unsafe(10 + pt_len + crypto_aead_aes256gcm_ABYTES, nonce, 12);
+
+	// Encrypted even if DATA is not, the secret keys resumed connections
+	crypto_aead_aes256gcm_encrypt_afternm(
+		packet.data() + 10,
+		nullptr,
+		packet.data() + 10,
+		pt_len,
+		packet.data() + 2,
+		8,
+		nullptr,
+		nonce,
+		&tx_ctx
+	);
+	sodium_increment(nonce, 12);
+
+	transport->send(std::move(packet));
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+void StreamTransport<DelegateType, DatagramTransport, CongestionControl>::did_recv_TICKET(
+	TICKET &&packet
+) {
+	constexpr size_t pt_len = SessionTickets::secret_size + SessionTickets::ticket_size;
+
+	if(!packet.validate(pt_len + crypto_aead_aes256gcm_ABYTES + 12)) {
+		return;
+	}
+
+	auto src_conn_id = packet.src_conn_id();
+	auto dst_conn_id = packet.dst_conn_id();
+	if(src_conn_id != this->src_conn_id || dst_conn_id != this->dst_conn_id) {
+		SPDLOG_DEBUG(
+			"Stream transport {{ Src: {}, Dst: {} }}: TICKET: Connection id mismatch: {}, {}, {}, {}",
+			src_addr.to_string(),
+			dst_addr.to_string(),
+			src_conn_id,
+			this->src_conn_id,
+			dst_conn_id,
+			this->dst_conn_id
+		);
+		return;
+	}
+
+	if(!dialled || tickets == nullptr || !is_active()) {
+		return;
+	}
+
+	auto res = crypto_aead_aes256gcm_decrypt_afternm(
+		packet.payload(),
+		nullptr,
+		nullptr,
+		packet.payload(),
+		pt_len + crypto_aead_aes256gcm_ABYTES,
+		packet.payload() - 8,
+		8,
+		packet.payload() + pt_len + crypto_aead_aes256gcm_ABYTES,
+		&rx_ctx
+	);
+
+	if(res < 0) {
+		SPDLOG_DEBUG(
+			"Stream transport {{ Src: {}, Dst: {} }}: TICKET: Decryption failure",
+			src_addr.to_string(),
+			dst_addr.to_string()
+		);
+		return;
+	}
+
+	tickets->store(
+		dst_addr,
+		remote_static_pk,
+		packet.payload() + SessionTickets::secret_size,
+		packet.payload(),
+		asyncio::EventLoop::now()
+	);
+	sodium_memzero(packet.payload(), SessionTickets::secret_size);
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+void StreamTransport<DelegateType, DatagramTransport, CongestionControl>::send_RESUME() {
+	SPDLOG_DEBUG(
+		"Stream transport {{ Src: {}, Dst: {} }}: RESUME >>>> {:spn}",
+		src_addr.to_string(),
+		dst_addr.to_string(),
+		spdlog::to_hex(remote_static_pk, remote_static_pk+crypto_box_PUBLICKEYBYTES)
+	);
+
+	constexpr size_t pt_len = crypto_box_PUBLICKEYBYTES + crypto_kx_PUBLICKEYBYTES;
+	constexpr size_t dial_len = pt_len + crypto_box_SEALBYTES;
+	constexpr size_t ct_len = dial_len + SessionTickets::ticket_size + SessionTickets::random_size;
+
+	// Same as DIAL, for the other side to fall back to a full handshake with
+	uint8_t pt[pt_len];
+	std::memcpy(pt, static_pk, crypto_box_PUBLICKEYBYTES);
+	std::memcpy(pt + crypto_box_PUBLICKEYBYTES, ephemeral_pk, crypto_kx_PUBLICKEYBYTES);
+
+	uint8_t buf[ct_len];
+	crypto_box_seal(buf, pt, pt_len, remote_static_pk);
+
+	std::memcpy(buf + dial_len, resume_ticket, SessionTickets::ticket_size);
+	std::memcpy(buf + dial_len + SessionTickets::ticket_size, resume_random, SessionTickets::random_size);
+
+	transport->send(
+		RESUME(ct_len)
+		.set_src_conn_id(this->src_conn_id)
+		.set_dst_conn_id(this->dst_conn_id)
+		.set_payload(buf, ct_len)
+	);
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+void StreamTransport<DelegateType, DatagramTransport, CongestionControl>::did_recv_RESUME(
+	RESUME &&packet
+) {
+	constexpr size_t pt_len = crypto_box_PUBLICKEYBYTES + crypto_kx_PUBLICKEYBYTES;
+	constexpr size_t dial_len = pt_len + crypto_box_SEALBYTES;
+	constexpr size_t ct_len = dial_len + SessionTickets::ticket_size + SessionTickets::random_size;
+
+	if(!packet.validate(ct_len)) {
+		return;
+	}
+
+	switch(conn_state) {
+	case ConnectionState::Listen: {
+		if(packet.src_conn_id() == 0 || packet.dst_conn_id() == 0) { // Dialler picks both ids
+			SPDLOG_DEBUG(
+				"Stream transport {{ Src: {}, Dst: {} }}: RESUME: Should have both ids: {}, {}",
+				src_addr.to_string(),
+				dst_addr.to_string(),
+				packet.src_conn_id(),
+				packet.dst_conn_id()
+			);
+			return;
+		}
+
+		uint8_t pt[pt_len];
+		auto res = crypto_box_seal_open(pt, packet.payload(), dial_len, static_pk, static_sk);
+		if (res < 0) {
+			SPDLOG_DEBUG(
+				"Stream transport {{ Src: {}, Dst: {} }}: RESUME: Unseal failure: {}",
+				src_addr.to_string(),
+				dst_addr.to_string(),
+				res
+			);
+			return;
+		}
+
+		std::memcpy(remote_static_pk, pt, crypto_box_PUBLICKEYBYTES);
+		std::memcpy(remote_ephemeral_pk, pt + crypto_box_PUBLICKEYBYTES, crypto_kx_PUBLICKEYBYTES);
+
+		set_src_conn_id(packet.src_conn_id());
+		this->dst_conn_id = packet.dst_conn_id();
+
+		// Tickets are single use, a replayed RESUME gets a full handshake it cannot complete
+		uint8_t secret[SessionTickets::secret_size];
+		if(tickets != nullptr && tickets->redeem(
+			packet.payload() + dial_len,
+			remote_static_pk,
+			secret,
+			asyncio::EventLoop::now()
+		)) {
+			SessionTickets::derive_keys(
+				secret,
+				packet.payload() + dial_len + SessionTickets::ticket_size,
+				false,
+				rx,
+				tx
+			);
+			sodium_memzero(secret, SessionTickets::secret_size);
+
+			randombytes_buf(nonce, crypto_aead_aes256gcm_NPUBBYTES);
+			crypto_aead_aes256gcm_beforenm(&rx_ctx, rx);
+			crypto_aead_aes256gcm_beforenm(&tx_ctx, tx);
+
+			is_resumed = true;
+
+			send_RESUMECONF();
+
+			conn_state = ConnectionState::Established;
+			start_pmtud();
+			send_TICKET();
+
+			break;
+		}
+
+		SPDLOG_DEBUG(
+			"Stream transport {{ Src: {}, Dst: {} }}: RESUME: Ticket refused, full handshake",
+			src_addr.to_string(),
+			dst_addr.to_string()
+		);
+
+		auto *kdf = (std::memcmp(ephemeral_pk, remote_ephemeral_pk, crypto_box_PUBLICKEYBYTES) > 0) ? &crypto_kx_server_session_keys : &crypto_kx_client_session_keys;
+
+		if ((*kdf)(rx, tx, ephemeral_pk, ephemeral_sk, remote_ephemeral_pk) != 0) {
+			SPDLOG_DEBUG(
+				"Stream transport {{ Src: {}, Dst: {} }}: RESUME: Key derivation failure",
+				src_addr.to_string(),
+				dst_addr.to_string()
+			);
+			return;
+		}
+
+		randombytes_buf(nonce, crypto_aead_aes256gcm_NPUBBYTES);
+		crypto_aead_aes256gcm_beforenm(&rx_ctx, rx);
+		crypto_aead_aes256gcm_beforenm(&tx_ctx, tx);
+
+		send_DIALCONF();
+
+		conn_state = ConnectionState::DialRcvd;
+
+		break;
+	}
+
+	case ConnectionState::DialRcvd:
+	case ConnectionState::Established: {
+		// Retried RESUME, repeat the answer
+		// Otherwise send existing ids like for DIAL and wait for dst to RST if this connection is stale
+		if(is_resumed && packet.src_conn_id() == this->src_conn_id && packet.dst_conn_id() == this->dst_conn_id) {
+			send_RESUMECONF();
+		} else {
+			send_DIALCONF();
+		}
+
+		break;
+	}
+
+	case ConnectionState::DialSent:
+	case ConnectionState::ResumeSent:
+	case ConnectionState::Closing: {
+		// Ignore, simultaneous open settles on the DIAL or RESUME sent from here
+		break;
+	}
+	}
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+void StreamTransport<DelegateType, DatagramTransport, CongestionControl>::send_RESUMECONF() {
+	auto packet = RESUMECONF(crypto_aead_aes256gcm_ABYTES + 12)
+					.set_src_conn_id(src_conn_id)
+					.set_dst_conn_id(dst_conn_id)
+					.payload_buffer();
+
+	packet.uncover_unsafe(10);
+	packet.write_unsafe(10 + crypto_aead_aes256gcm_ABYTES, nonce, 12);
+
+	// Tag over the header alone, proves the ticket was accepted
+	crypto_aead_aes256gcm_encrypt_afternm(
+		packet.data() + 10,
+		nullptr,
+		nullptr,
+		0,
+		packet.data() + 2,
+		8,
+		nullptr,
+		nonce,
+		&tx_ctx
+	);
+	sodium_increment(nonce, 12);
+
+	transport->send(std::move(packet));
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+void StreamTransport<DelegateType, DatagramTransport, CongestionControl>::did_recv_RESUMECONF(
+	RESUMECONF &&packet
+) {
+	if(!packet.validate(crypto_aead_aes256gcm_ABYTES + 12)) {
+		return;
+	}
+
+	// Retries of an accepted RESUME get answered again, only the first one counts
+	if(conn_state != ConnectionState::ResumeSent) {
+		return;
+	}
+
+	auto src_conn_id = packet.src_conn_id();
+	auto dst_conn_id = packet.dst_conn_id();
+	if(src_conn_id != this->src_conn_id || dst_conn_id != this->dst_conn_id) {
+		SPDLOG_DEBUG(
+			"Stream transport {{ Src: {}, Dst: {} }}: RESUMECONF: Connection id mismatch: {}, {}, {}, {}",
+			src_addr.to_string(),
+			dst_addr.to_string(),
+			src_conn_id,
+			this->src_conn_id,
+			dst_conn_id,
+			this->dst_conn_id
+		);
+		return;
+	}
+
+	auto res = crypto_aead_aes256gcm_decrypt_afternm(
+		nullptr,
+		nullptr,
+		nullptr,
+		packet.payload(),
+		crypto_aead_aes256gcm_ABYTES,
+		packet.payload() - 8,
+		8,
+		packet.payload() + crypto_aead_aes256gcm_ABYTES,
+		&rx_ctx
+	);
+
+	if(res < 0) {
+		SPDLOG_DEBUG(
+			"Stream transport {{ Src: {}, Dst: {} }}: RESUMECONF: Decryption failure",
+			src_addr.to_string(),
+			dst_addr.to_string()
+		);
+		return;
+	}
+
+	state_timer.stop();
+	state_timer_interval = 0;
+
+	conn_state = ConnectionState::Established;
+	start_pmtud();
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+void StreamTransport<DelegateType, DatagramTransport, CongestionControl>::send_PATHCHALLENGE(Self &candidate) {
+	// Same challenge until answered, a late answer to an earlier one is as good
+	if(candidate.dst_addr != path_candidate_addr || path_challenge_time == 0) {
+		path_candidate_addr = candidate.dst_addr;
+		randombytes_buf(path_challenge, sizeof(path_challenge));
+	}
+	path_challenge_time = asyncio::EventLoop::now();
+
+	SPDLOG_DEBUG(
+		"Stream transport {{ Src: {}, Dst: {} }}: PATHCHALLENGE >>>> {}",
+		src_addr.to_string(),
+		dst_addr.to_string(),
+		path_candidate_addr.to_string()
+	);
+
+	candidate.transport->send(
+		PATHCHALLENGE(sizeof(path_challenge))
+		.set_src_conn_id(src_conn_id)
+		.set_dst_conn_id(dst_conn_id)
+		.set_payload(path_challenge, sizeof(path_challenge))
+	);
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+void StreamTransport<DelegateType, DatagramTransport, CongestionControl>::did_recv_PATHCHALLENGE(
+	PATHCHALLENGE &&packet
+) {
+	if(!packet.validate(8)) {
+		return;
+	}
+
+	auto src_conn_id = packet.src_conn_id();
+	auto dst_conn_id = packet.dst_conn_id();
+	if(src_conn_id != this->src_conn_id || dst_conn_id != this->dst_conn_id) {
+		SPDLOG_DEBUG(
+			"Stream transport {{ Src: {}, Dst: {} }}: PATHCHALLENGE: Connection id mismatch: {}, {}, {}, {}",
+			src_addr.to_string(),
+			dst_addr.to_string(),
+			src_conn_id,
+			this->src_conn_id,
+			dst_conn_id,
+			this->dst_conn_id
+		);
+		return;
+	}
+
+	if(!is_active()) {
+		return;
+	}
+
+	send_PATHRESPONSE(packet.payload());
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+void StreamTransport<DelegateType, DatagramTransport, CongestionControl>::send_PATHRESPONSE(uint8_t const* challenge) {
+	auto packet = PATHRESPONSE(8 + crypto_aead_aes256gcm_ABYTES + 12)
+					.set_src_conn_id(src_conn_id)
+					.set_dst_conn_id(dst_conn_id)
+					.payload_buffer();
+
+	packet.uncover_unsafe(10);
+	packet.write_unsafe(10, challenge, 8);
+	packet.write_unsafe(18 + crypto_aead_aes256gcm_ABYTES, nonce, 12);
+
+	// Tag over the ids and the challenge, an address is only taken on the word of the peer
+	crypto_aead_aes256gcm_encrypt_afternm(
+		packet.data() + 18,
+		nullptr,
+		nullptr,
+		0,
+		packet.data() + 2,
+		16,
+		nullptr,
+		nonce,
+		&tx_ctx
+	);
+	sodium_increment(nonce, 12);
+
+	transport->send(std::move(packet));
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+void StreamTransport<DelegateType, DatagramTransport, CongestionControl>::did_recv_PATHRESPONSE(
+	Self &candidate,
+	PATHRESPONSE &&packet
+) {
+	if(!packet.validate(8 + crypto_aead_aes256gcm_ABYTES + 12)) {
+		return;
+	}
+
+	if(conn_state != ConnectionState::Established) {
+		return;
+	}
+
+	auto src_conn_id = packet.src_conn_id();
+	auto dst_conn_id = packet.dst_conn_id();
+	if(src_conn_id != this->src_conn_id || dst_conn_id != this->dst_conn_id) {
+		SPDLOG_DEBUG(
+			"Stream transport {{ Src: {}, Dst: {} }}: PATHRESPONSE: Connection id mismatch: {}, {}, {}, {}",
+			src_addr.to_string(),
+			dst_addr.to_string(),
+			src_conn_id,
+			this->src_conn_id,
+			dst_conn_id,
+			this->dst_conn_id
+		);
+		return;
+	}
+
+	// Only an answer from the challenged address validates it
+	if(
+		path_challenge_time == 0 ||
+		candidate.dst_addr != path_candidate_addr ||
+		sodium_memcmp(packet.payload(), path_challenge, 8) != 0
+	) {
+		return;
+	}
+
+	auto res = crypto_aead_aes256gcm_decrypt_afternm(
+		nullptr,
+		nullptr,
+		nullptr,
+		packet.payload() + 8,
+		crypto_aead_aes256gcm_ABYTES,
+		packet.payload() - 8,
+		16,
+		packet.payload() + 8 + crypto_aead_aes256gcm_ABYTES,
+		&rx_ctx
+	);
+
+	if(res < 0) {
+		SPDLOG_DEBUG(
+			"Stream transport {{ Src: {}, Dst: {} }}: PATHRESPONSE: Decryption failure",
+			src_addr.to_string(),
+			dst_addr.to_string()
+		);
+		return;
+	}
+
+	path_candidate_addr = core::SocketAddress();
+	path_challenge_time = 0;
+
+	if(&candidate != this) {
+		migrate(candidate);
+	}
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+void StreamTransport<DelegateType, DatagramTransport, CongestionControl>::send_DATAGRAM(
+	core::Buffer &&bytes
+) {
+	this->last_sent_packet++;
+
+	// Recorded without a stream, acks and losses only reach congestion control
+	SentPacketInfo sent_packet(
+		asyncio::EventLoop::now(),
+		nullptr,
+		nullptr,
+		0,
+		bytes.size()
+	);
+	this->cc.on_send(sent_packet.sent_time, sent_packet, this->bytes_in_flight);
+	this->sent_packets.add(this->last_sent_packet, sent_packet);
+
+	auto length = bytes.size();
+	auto packet = DATAGRAM(length + crypto_aead_aes256gcm_ABYTES + 12)
+					.set_src_conn_id(src_conn_id)
+					.set_dst_conn_id(dst_conn_id)
+					.set_packet_number(this->last_sent_packet)
+					.payload_buffer();
+
+	packet.uncover_unsafe(18);
+	packet.write_unsafe(18, bytes.data(), length);
+	packet.write_unsafe(18 + length + crypto_aead_aes256gcm_ABYTES, nonce, 12);
+
+	if constexpr (is_encrypted) {
+		crypto_aead_aes256gcm_encrypt_afternm(
+			packet.data() + 18,
+			nullptr,
+			packet.data() + 18,
+			length,
+			packet.data() + 2,
+			16,
+			nullptr,
+			nonce,
+			&tx_ctx
+		);
+		sodium_increment(nonce, 12);
+	}
+
+	transport->send(std::move(packet));
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+void StreamTransport<DelegateType, DatagramTransport, CongestionControl>::did_recv_DATAGRAM(
+	DATAGRAM &&packet
+) {
+	if(!packet.validate(crypto_aead_aes256gcm_ABYTES + 12)) {
+		return;
+	}
+
+	// Datagrams are not worth holding on to until the handshake completes
+	if(conn_state != ConnectionState::Established) {
+		return;
+	}
+
+	auto src_conn_id = packet.src_conn_id();
+	auto dst_conn_id = packet.dst_conn_id();
+	if(src_conn_id != this->src_conn_id || dst_conn_id != this->dst_conn_id) { // Wrong connection id, send RST
+		SPDLOG_DEBUG(
+			"Stream transport {{ Src: {}, Dst: {} }}: DATAGRAM: Connection id mismatch: {}, {}, {}, {}",
+			src_addr.to_string(),
+			dst_addr.to_string(),
+			src_conn_id,
+			this->src_conn_id,
+			dst_conn_id,
+			this->dst_conn_id
+		);
+		send_RST(src_conn_id, dst_conn_id);
+		return;
+	}
+
+	if constexpr (is_encrypted) {
+		auto res = crypto_aead_aes256gcm_decrypt_afternm(
+			packet.payload(),
+			nullptr,
+			nullptr,
+			packet.payload(),
+			packet.payload_buffer().size() - 12,
+			packet.payload() - 16,
+			16,
+			packet.payload() + packet.payload_buffer().size() - 12,
+			&rx_ctx
+		);
+
+		if(res < 0) {
+			SPDLOG_DEBUG(
+				"Stream transport {{ Src: {}, Dst: {} }}: DATAGRAM: Decryption failure: {}, {}",
+				src_addr.to_string(),
+				dst_addr.to_string(),
+				this->src_conn_id,
+				this->dst_conn_id
+			);
+			send_RST(src_conn_id, dst_conn_id);
+			return;
+		}
+	}
+
+	auto packet_number = packet.packet_number();
+
+	SPDLOG_TRACE("DATAGRAM <<< {}: {}", dst_addr.to_string(), packet_number);
+
+	// Acked like DATA so that the sender can tell losses from congestion
+	ack_ranges.add_packet_number(packet_number);
+
+	if(!ack_timer_active) {
+		ack_timer_active = true;
+		ack_timer.template start<Self, &Self::ack_timer_cb>(25, 0);
+	}
+
+	constexpr bool has_recv_datagram = requires(
+		DelegateType& d,
+		Self& t
+	) {
+		d.did_recv_datagram(t, core::Buffer(nullptr, 0));
+	};
+
+	if constexpr (has_recv_datagram) {
+		auto p = std::move(packet).payload_buffer();
+		p.truncate_unsafe(crypto_aead_aes256gcm_ABYTES + 12);
+
+		delegate->did_recv_datagram(*this, std::move(p));
+	}
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+void StreamTransport<DelegateType, DatagramTransport, CongestionControl>::send_MAXDATA() {
+	transport->send(
+		MAXDATA()
+		.set_src_conn_id(src_conn_id)
+		.set_dst_conn_id(dst_conn_id)
+		.set_max_data(recv_window.get_limit())
+	);
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+void StreamTransport<DelegateType, DatagramTransport, CongestionControl>::did_recv_MAXDATA(
+	MAXDATA &&packet
+) {
+	if(!packet.validate()) {
+		return;
+	}
+
+	SPDLOG_TRACE("MAXDATA <<< {}: {}", dst_addr.to_string(), packet.max_data());
+
+	auto src_conn_id = packet.src_conn_id();
+	auto dst_conn_id = packet.dst_conn_id();
+	if(src_conn_id != this->src_conn_id || dst_conn_id != this->dst_conn_id) { // Wrong connection id, send RST
+		SPDLOG_DEBUG(
+			"Stream transport {{ Src: {}, Dst: {} }}: MAXDATA: Connection id mismatch: {}, {}, {}, {}",
+			src_addr.to_string(),
+			dst_addr.to_string(),
+			src_conn_id,
+			this->src_conn_id,
+			dst_conn_id,
+			this->dst_conn_id
+		);
+		send_RST(src_conn_id, dst_conn_id);
+		return;
+	}
+
+	if(conn_state != ConnectionState::Established) {
+		return;
+	}
+
+	auto limit = packet.max_data();
+	if(limit <= max_data) {
+		return;
+	}
+	max_data = limit;
+
+	if(is_data_blocked) {
+		is_data_blocked = false;
+		on_unblocked();
+	}
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+void StreamTransport<DelegateType, DatagramTransport, CongestionControl>::send_MAXSTREAMDATA(
+	uint16_t stream_id,
+	uint64_t max_offset
+) {
+	transport->send(
+		MAXSTREAMDATA()
+		.set_src_conn_id(src_conn_id)
+		.set_dst_conn_id(dst_conn_id)
+		.set_stream_id(stream_id)
+		.set_max_offset(max_offset)
+	);
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+void StreamTransport<DelegateType, DatagramTransport, CongestionControl>::did_recv_MAXSTREAMDATA(
+	MAXSTREAMDATA &&packet
+) {
+	if(!packet.validate()) {
+		return;
+	}
+
+	SPDLOG_TRACE("MAXSTREAMDATA <<< {}: {}, {}", dst_addr.to_string(), packet.stream_id(), packet.max_offset());
+
+	auto src_conn_id = packet.src_conn_id();
+	auto dst_conn_id = packet.dst_conn_id();
+	if(src_conn_id != this->src_conn_id || dst_conn_id != this->dst_conn_id) { // Wrong connection id, send RST
+		SPDLOG_DEBUG(
+			"Stream transport {{ Src: {}, Dst: {} }}: MAXSTREAMDATA: Connection id mismatch: {}, {}, {}, {}",
+			src_addr.to_string(),
+			dst_addr.to_string(),
+			src_conn_id,
+			this->src_conn_id,
+			dst_conn_id,
+			this->dst_conn_id
+		);
+		send_RST(src_conn_id, dst_conn_id);
+		return;
+	}
+
+	if(conn_state != ConnectionState::Established) {
+		return;
+	}
+
+	// Credit for streams which are done is of no use
+	auto iter = send_streams.find(packet.stream_id());
+	if(iter == send_streams.end()) {
+		return;
+	}
+	auto &stream = iter->second;
+
+	auto limit = packet.max_offset();
+	if(limit <= stream.max_offset) {
+		return;
+	}
+	stream.max_offset = limit;
+
+	if(stream.is_blocked) {
+		stream.is_blocked = false;
+		register_send_intent(stream);
+		on_unblocked();
+	}
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+void StreamTransport<DelegateType, DatagramTransport, CongestionControl>::send_BLOCKED(
+	uint16_t stream_id
+) {
+	transport->send(
+		BLOCKED()
+		.set_src_conn_id(src_conn_id)
+		.set_dst_conn_id(dst_conn_id)
+		.set_stream_id(stream_id)
+	);
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+void StreamTransport<DelegateType, DatagramTransport, CongestionControl>::did_recv_BLOCKED(
+	BLOCKED &&packet
+) {
+	if(!packet.validate()) {
+		return;
+	}
+
+	SPDLOG_TRACE("BLOCKED <<< {}: {}", dst_addr.to_string(), packet.stream_id());
+
+	auto src_conn_id = packet.src_conn_id();
+	auto dst_conn_id = packet.dst_conn_id();
+	if(src_conn_id != this->src_conn_id || dst_conn_id != this->dst_conn_id) { // Wrong connection id, send RST
+		SPDLOG_DEBUG(
+			"Stream transport {{ Src: {}, Dst: {} }}: BLOCKED: Connection id mismatch: {}, {}, {}, {}",
+			src_addr.to_string(),
+			dst_addr.to_string(),
+			src_conn_id,
+			this->src_conn_id,
+			dst_conn_id,
+			this->dst_conn_id
+		);
+		send_RST(src_conn_id, dst_conn_id);
+		return;
+	}
+
+	if(conn_state != ConnectionState::Established) {
+		return;
+	}
+
+	// Answer with the current limits, earlier updates might have been lost
+	send_MAXDATA();
+
+	auto iter = recv_streams.find(packet.stream_id());
+	if(iter != recv_streams.end()) {
+		send_MAXSTREAMDATA(iter->first, iter->second.window.get_limit());
+	}
+}
+
+//---------------- Protocol functions end ----------------//
+
+
+//---------------- Delegate functions begin ----------------//
+
+//! Callback function when trying to establish a connection with a peer. Sends a DIAL packet to initiate the handshake
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+void StreamTransport<DelegateType, DatagramTransport, CongestionControl>::did_dial(
+	BaseTransport &,
+	uint8_t const* remote_static_pk
+) {
+	if(conn_state != ConnectionState::Listen) {
+		return;
+	}
+
+	if (remote_static_pk != nullptr) {
+		std::memcpy(this->remote_static_pk, remote_static_pk, crypto_box_PUBLICKEYBYTES);
+	}
+
+	// Begin handshake
+	dialled = true;
+
+	state_timer_interval = 1000;
+	state_timer.template start<Self, &Self::dial_timer_cb>(state_timer_interval, 0);
+
+	set_src_conn_id((uint32_t)std::random_device()());
+
+	uint8_t secret[SessionTickets::secret_size];
+	if(tickets != nullptr && tickets->take(
+		dst_addr,
+		this->remote_static_pk,
+		resume_ticket,
+		secret,
+		asyncio::EventLoop::now()
+	)) {
+		// Keyed from the ticket, so DATA can follow the RESUME without waiting for an answer.
+		// The dialler picks the conn id of the other side as well, DATA needs both.
+		dst_conn_id = (uint32_t)std::random_device()();
+		randombytes_buf(resume_random, SessionTickets::random_size);
+		SessionTickets::derive_keys(secret, resume_random, true, rx, tx);
+		sodium_memzero(secret, SessionTickets::secret_size);
+
+		randombytes_buf(nonce, crypto_aead_aes256gcm_NPUBBYTES);
+		crypto_aead_aes256gcm_beforenm(&rx_ctx, rx);
+		crypto_aead_aes256gcm_beforenm(&tx_ctx, tx);
+
+		is_resumed = true;
+		did_dial_early = true;
+
+		send_RESUME();
+		conn_state = ConnectionState::ResumeSent;
+
+		delegate->did_dial(*this);
+		return;
+	}
+
+	send_DIAL();
+	conn_state = ConnectionState::DialSent;
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+void StreamTransport<DelegateType, DatagramTransport, CongestionControl>::did_close(
+	BaseTransport &,
+	uint16_t reason
+) {
+	set_src_conn_id(0);
+	delegate->did_close(*this, reason);
+	transport_manager.erase(dst_addr);
+}
+
+//! Receives the packet and processes them
+/*!
+	Determines the type of packet by reading the first byte and redirects the packet to appropriate function for further processing
+
+	\li \b byte :	\b type
+	\li 0		:	DATA
+	\li 1		:	DATA + FIN
+	\li 2		:	ACK
+	\li 3		:	DIAL
+	\li 4		:	DIALCONF
+	\li 5		:	CONF
+	\li 6		:	RST
+*/
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+void StreamTransport<DelegateType, DatagramTransport, CongestionControl>::did_recv(
+	BaseTransport &,
+	BaseMessageType &&packet
+) {
+	auto type = packet.payload_buffer().read_uint8(1);
+	if(type == std::nullopt || packet.payload_buffer().read_uint8_unsafe(0) != 0) {
+		return;
+	}
+
+	// Packets of an established connection arriving from another address, say after a NAT rebinding,
+	// go to that connection which validates the address before moving onto it
+	if(
+		conn_state == ConnectionState::Listen && conn_ids != nullptr &&
+		type.value() != 3 && type.value() != 19 && packet.payload_buffer().size() >= 10
+	) {
+		auto *owner = conn_ids->get(packet.payload_buffer().read_uint32_le_unsafe(6));
+		if(owner != nullptr && owner != this) {
+			// Do not touch this transport afterwards, moving the connection closes it
+			owner->did_recv_from_candidate(*this, std::move(packet));
+			return;
+		}
+	}
+
+	switch(type.value()) {
+		// DATA
+		case 0:
+		// DATA + FIN
+		case 1:
+		// DATA, whole stream
+		case 13:
+		// DATA + FIN, whole stream
+		case 14: did_recv_DATA(std::move(packet));
+		break;
+		// PROBE
+		case 15: did_recv_PROBE(std::move(packet));
+		break;
+		// REPAIR
+		case 16:
+		// REPAIR + FIN
+		case 17: did_recv_REPAIR(std::move(packet));
+		break;
+		// TICKET
+		case 18: did_recv_TICKET(std::move(packet));
+		break;
+		// RESUME
+		case 19: did_recv_RESUME(std::move(packet));
+		break;
+		// RESUMECONF
+		case 20: did_recv_RESUMECONF(std::move(packet));
+		break;
+		// PATHCHALLENGE
+		case 21: did_recv_PATHCHALLENGE(std::move(packet));
+		break;
+		// PATHRESPONSE
+		case 22: did_recv_PATHRESPONSE(*this, std::move(packet));
+		break;
+		// DATAGRAM
+		case 23: did_recv_DATAGRAM(std::move(packet));
+		break;
+		// MAXDATA
+		case 24: did_recv_MAXDATA(std::move(packet));
+		break;
+		// MAXSTREAMDATA
+		case 25: did_recv_MAXSTREAMDATA(std::move(packet));
+		break;
+		// BLOCKED
+		case 26: did_recv_BLOCKED(std::move(packet));
+		break;
+		// ACK
+		case 2: did_recv_ACK(std::move(packet));
+		break;
+		// DIAL
+		case 3: did_recv_DIAL(std::move(packet));
+		break;
+		// DIALCONF
+		case 4: did_recv_DIALCONF(std::move(packet));
+		break;
+		// CONF
+		case 5: did_recv_CONF(std::move(packet));
+		break;
+		// RST
+		case 6: did_recv_RST(std::move(packet));
+		break;
+		// SKIPSTREAM
+		case 7: did_recv_SKIPSTREAM(std::move(packet));
+		break;
+		// FLUSHSTREAM
+		case 8: did_recv_FLUSHSTREAM(std::move(packet));
+		break;
+		// FLUSHCONF
+		case 9: did_recv_FLUSHCONF(std::move(packet));
+		break;
+		// CLOSECONF
+		case 11: did_recv_CLOSECONF(std::move(packet));
+		break;
+		// CLOSE
+		case 12: did_recv_CLOSE(std::move(packet));
+		break;
+		// UNKNOWN
+		default: SPDLOG_TRACE("UNKNOWN <<< {}", dst_addr.to_string());
+		break;
+	}
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+void StreamTransport<DelegateType, DatagramTransport, CongestionControl>::did_send(
+	BaseTransport &,
+	core::Buffer &&packet
+) {
+	auto type = packet.read_uint8(1);
+	if(type == std::nullopt) {
+		return;
+	}
+
+	switch(type.value()) {
 		// DATA
 		case 0: SPDLOG_TRACE("DATA >>> {}", dst_addr.to_string());
 		break;
@@ -2028,6 +3986,54 @@ void StreamTransport<DelegateType, DatagramTransport>::did_send(
 		// FLUSHCONF
 		case 9: SPDLOG_TRACE("FLUSHCONF >>> {}", dst_addr.to_string());
 		break;
+		// CLOSECONF
+		case 11: SPDLOG_TRACE("CLOSECONF >>> {}", dst_addr.to_string());
+		break;
+		// CLOSE
+		case 12: SPDLOG_TRACE("CLOSE >>> {}", dst_addr.to_string());
+		break;
+		// DATA, whole stream
+		case 13: SPDLOG_TRACE("DATA WHOLE >>> {}", dst_addr.to_string());
+		break;
+		// DATA + FIN, whole stream
+		case 14: SPDLOG_TRACE("DATA WHOLE + FIN >>> {}", dst_addr.to_string());
+		break;
+		// PROBE
+		case 15: SPDLOG_TRACE("PROBE >>> {}", dst_addr.to_string());
+		break;
+		// REPAIR
+		case 16: SPDLOG_TRACE("REPAIR >>> {}", dst_addr.to_string());
+		break;
+		// REPAIR + FIN
+		case 17: SPDLOG_TRACE("REPAIR + FIN >>> {}", dst_addr.to_string());
+		break;
+		// TICKET
+		case 18: SPDLOG_TRACE("TICKET >>> {}", dst_addr.to_string());
+		break;
+		// RESUME
+		case 19: SPDLOG_TRACE("RESUME >>> {}", dst_addr.to_string());
+		break;
+		// RESUMECONF
+		case 20: SPDLOG_TRACE("RESUMECONF >>> {}", dst_addr.to_string());
+		break;
+		// PATHCHALLENGE
+		case 21: SPDLOG_TRACE("PATHCHALLENGE >>> {}", dst_addr.to_string());
+		break;
+		// PATHRESPONSE
+		case 22: SPDLOG_TRACE("PATHRESPONSE >>> {}", dst_addr.to_string());
+		break;
+		// DATAGRAM
+		case 23: SPDLOG_TRACE("DATAGRAM >>> {}", dst_addr.to_string());
+		break;
+		// MAXDATA
+		case 24: SPDLOG_TRACE("MAXDATA >>> {}", dst_addr.to_string());
+		break;
+		// MAXSTREAMDATA
+		case 25: SPDLOG_TRACE("MAXSTREAMDATA >>> {}", dst_addr.to_string());
+		break;
+		// BLOCKED
+		case 26: SPDLOG_TRACE("BLOCKED >>> {}", dst_addr.to_string());
+		break;
 		// UNKNOWN
 		default: SPDLOG_TRACE("UNKNOWN >>> {}", dst_addr.to_string());
 		break;
@@ -2036,18 +4042,20 @@ void StreamTransport<DelegateType, DatagramTransport>::did_send(
 
 //---------------- Delegate functions end ----------------//
 
-template<typename DelegateType, template<typename> class DatagramTransport>
-StreamTransport<DelegateType, DatagramTransport>::StreamTransport(
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+StreamTransport<DelegateType, DatagramTransport, CongestionControl>::StreamTransport(
 	core::SocketAddress const &src_addr,
 	core::SocketAddress const &dst_addr,
 	BaseTransport &transport,
-	core::TransportManager<StreamTransport<DelegateType, DatagramTransport>> &transport_manager
-) : transport(transport),
+	core::TransportManager<StreamTransport<DelegateType, DatagramTransport, CongestionControl>> &transport_manager
+) : transport(&transport),
 	transport_manager(transport_manager),
 	state_timer(this),
 	pacing_timer(this),
 	tlp_timer(this),
+	pmtud_timer(this),
 	ack_timer(this),
+	blocked_timer(this),
 	src_addr(src_addr),
 	dst_addr(dst_addr),
 	delegate(nullptr) {
@@ -2057,8 +4065,8 @@ StreamTransport<DelegateType, DatagramTransport>::StreamTransport(
 }
 
 
-template<typename DelegateType, template<typename> class DatagramTransport>
-void StreamTransport<DelegateType, DatagramTransport>::setup(
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+void StreamTransport<DelegateType, DatagramTransport, CongestionControl>::setup(
 	DelegateType *delegate,
 	uint8_t const* static_sk
 ) {
@@ -2069,16 +4077,165 @@ void StreamTransport<DelegateType, DatagramTransport>::setup(
 
 	crypto_kx_keypair(this->ephemeral_pk, this->ephemeral_sk);
 
-	transport.setup(this);
+	transport->setup(this);
+}
+
+
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+int StreamTransport<DelegateType, DatagramTransport, CongestionControl>::send(
+	core::Buffer &&bytes,
+	uint16_t stream_id
+) {
+	return send(std::move(bytes), core::SharedBuffer(), stream_id);
 }
 
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+SendStream *StreamTransport<DelegateType, DatagramTransport, CongestionControl>::get_whole_send_stream(
+	uint16_t stream_id,
+	uint64_t size,
+	bool fec
+) {
+	// Destination drops larger whole streams, they would never complete
+	if(size > RecvStream::max_whole_size) {
+		return nullptr;
+	}
+
+	// Late retransmissions of a recent whole stream on the id would be taken for this one
+	if(send_streams.find(stream_id) == send_streams.end() &&
+		closed_send_streams.contains(stream_id, asyncio::EventLoop::now())) {
+		return nullptr;
+	}
+	auto &stream = get_or_create_send_stream(stream_id);
+
+	// Whole streams carry a single message from the start
+	if(stream.queue_offset != 0 || stream.done_queueing) {
+		return nullptr;
+	}
+
+	// Flags have to be set before the first fragment can go out
+	stream.whole = true;
+	stream.is_fec = fec;
+	stream.done_queueing = true;
 
-template<typename DelegateType, template<typename> class DatagramTransport>
-int StreamTransport<DelegateType, DatagramTransport>::send(
+	return &stream;
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+int StreamTransport<DelegateType, DatagramTransport, CongestionControl>::send_stream(
 	core::Buffer &&bytes,
+	uint16_t stream_id,
+	bool fec
+) {
+	if (!is_active()) {
+		return -2;
+	}
+
+	if(get_whole_send_stream(stream_id, bytes.size(), fec) == nullptr) {
+		return -1;
+	}
+
+	return send(std::move(bytes), core::SharedBuffer(), stream_id);
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+int StreamTransport<DelegateType, DatagramTransport, CongestionControl>::send_stream(
+	core::Buffer &&header,
+	core::SharedBuffer const &bytes,
+	uint16_t stream_id,
+	bool fec,
+	uint8_t priority
+) {
+	if (!is_active()) {
+		return -2;
+	}
+
+	if(priority >= SendStream::num_priorities) {
+		return -1;
+	}
+
+	auto *stream = get_whole_send_stream(stream_id, header.size() + bytes.size(), fec);
+	if(stream == nullptr) {
+		return -1;
+	}
+
+	// Fresh streams are not queued yet, the class can be set in place
+	stream->priority = priority;
+
+	return send(std::move(header), bytes, stream_id);
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+int StreamTransport<DelegateType, DatagramTransport, CongestionControl>::set_priority(
+	uint16_t stream_id,
+	uint8_t priority,
+	uint16_t weight
+) {
+	if(priority >= SendStream::num_priorities || weight == 0) {
+		return -1;
+	}
+
+	auto &stream = get_or_create_send_stream(stream_id);
+	if(stream.priority == priority && stream.weight == weight) {
+		return 0;
+	}
+
+	// The queue is ordered by priority, take the stream out while changing it
+	bool is_queued = send_queue.erase(stream);
+	stream.priority = priority;
+	stream.weight = weight;
+	if(is_queued) {
+		send_queue.push(stream);
+	}
+
+	return 0;
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+int StreamTransport<DelegateType, DatagramTransport, CongestionControl>::send_datagram(
+	core::Buffer &&bytes
+) {
+	if (!is_active()) {
+		return -2;
+	}
+
+	if(bytes.size() > max_datagram_size()) {
+		return -1;
+	}
+
+	// Loss tolerant senders prefer fresh datagrams to a backlog of stale ones
+	if(datagram_queue.size() >= max_queued_datagrams) {
+		SPDLOG_DEBUG("Datagram queue overflow");
+		return -3;
+	}
+
+	// Handle idle connection
+	if(sent_packets.empty() && send_queue.size() == 0 && datagram_queue.empty()) {
+		tlp_timer.template start<Self, &Self::tlp_timer_cb>(tlp_interval, 0);
+
+		if(is_pmtud_idle) {
+			is_pmtud_idle = false;
+			pmtud_timer.template start<Self, &Self::pmtud_timer_cb>(0, 0);
+		}
+	}
+
+	datagram_queue.push_back(std::move(bytes));
+	send_pending_data();
+
+	return 0;
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+uint16_t StreamTransport<DelegateType, DatagramTransport, CongestionControl>::max_datagram_size() {
+	return pmtud.get_plpmtu() - datagram_overhead;
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+int StreamTransport<DelegateType, DatagramTransport, CongestionControl>::send(
+	core::Buffer &&header,
+	core::SharedBuffer const &bytes,
 	uint16_t stream_id
 ) {
-	if (conn_state != ConnectionState::Established) {
+	if (!is_active()) {
 		return -2;
 	}
 	auto &stream = get_or_create_send_stream(stream_id);
@@ -2093,14 +4250,15 @@ int StreamTransport<DelegateType, DatagramTransport>::send(
 		return -1;
 	}
 
-	auto size = bytes.size();
+	auto size = header.size() + bytes.size();
 
 	// Check idle stream
 	bool idle = stream.next_item_iterator == stream.data_queue.end();
 
 	// Add data to send queue
 	stream.data_queue.emplace_back(
-		std::move(bytes),
+		std::move(header),
+		bytes,
 		stream.queue_offset
 	);
 
@@ -2112,8 +4270,13 @@ int StreamTransport<DelegateType, DatagramTransport>::send(
 	}
 
 	// Handle idle connection
-	if(sent_packets.size() == 0 && lost_packets.size() == 0 && send_queue.size() == 0) {
+	if(sent_packets.empty() && send_queue.size() == 0) {
 		tlp_timer.template start<Self, &Self::tlp_timer_cb>(tlp_interval, 0);
+
+		if(is_pmtud_idle) {
+			is_pmtud_idle = false;
+			pmtud_timer.template start<Self, &Self::pmtud_timer_cb>(0, 0);
+		}
 	}
 
 	register_send_intent(stream);
@@ -2122,8 +4285,8 @@ int StreamTransport<DelegateType, DatagramTransport>::send(
 	return 0;
 }
 
-template<typename DelegateType, template<typename> class DatagramTransport>
-void StreamTransport<DelegateType, DatagramTransport>::close(uint16_t reason) {
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+void StreamTransport<DelegateType, DatagramTransport, CongestionControl>::close(uint16_t reason) {
 	// Preserve conn ids so retries work
 	auto src_conn_id = this->src_conn_id;
 	auto dst_conn_id = this->dst_conn_id;
@@ -2140,8 +4303,8 @@ void StreamTransport<DelegateType, DatagramTransport>::close(uint16_t reason) {
 	state_timer.template start<Self, &Self::close_timer_cb>(state_timer_interval, 0);
 }
 
-template<typename DelegateType, template<typename> class DatagramTransport>
-void StreamTransport<DelegateType, DatagramTransport>::close_timer_cb() {
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+void StreamTransport<DelegateType, DatagramTransport, CongestionControl>::close_timer_cb() {
 	if(state_timer_interval >= 8000) { // Abort on too many retries
 		SPDLOG_DEBUG(
 			"Stream transport {{ Src: {}, Dst: {} }}: Close timeout",
@@ -2149,7 +4312,7 @@ void StreamTransport<DelegateType, DatagramTransport>::close_timer_cb() {
 			this->dst_addr.to_string()
 		);
 		reset();
-		transport.close();
+		transport->close();
 		return;
 	}
 
@@ -2159,22 +4322,32 @@ void StreamTransport<DelegateType, DatagramTransport>::close_timer_cb() {
 	state_timer.template start<Self, &Self::close_timer_cb>(state_timer_interval, 0);
 }
 
-template<typename DelegateType, template<typename> class DatagramTransport>
-bool StreamTransport<DelegateType, DatagramTransport>::is_active() {
-	if(conn_state == ConnectionState::Established) {
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+bool StreamTransport<DelegateType, DatagramTransport, CongestionControl>::is_active() {
+	// Resuming connections take DATA before the handshake completes
+	if(conn_state == ConnectionState::Established || conn_state == ConnectionState::ResumeSent) {
 		return true;
 	}
 
 	return false;
 }
 
-template<typename DelegateType, template<typename> class DatagramTransport>
-double StreamTransport<DelegateType, DatagramTransport>::get_rtt() {
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+double StreamTransport<DelegateType, DatagramTransport, CongestionControl>::get_rtt() {
 	return rtt;
 }
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+uint16_t StreamTransport<DelegateType, DatagramTransport, CongestionControl>::get_pmtu() {
+	return pmtud.get_plpmtu();
+}
 
-template<typename DelegateType, template<typename> class DatagramTransport>
-void StreamTransport<DelegateType, DatagramTransport>::skip_timer_cb(RecvStream& stream) {
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+uint64_t StreamTransport<DelegateType, DatagramTransport, CongestionControl>::get_recv_buffered() {
+	return recv_window.buffered();
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+void StreamTransport<DelegateType, DatagramTransport, CongestionControl>::skip_timer_cb(RecvStream& stream) {
 	if(stream.state_timer_interval >= 64000) { // Abort on too many retries
 		stream.state_timer_interval = 0;
 		SPDLOG_DEBUG(
@@ -2184,7 +4357,7 @@ void StreamTransport<DelegateType, DatagramTransport>::skip_timer_cb(RecvStream&
 			stream.stream_id
 		);
 		reset();
-		transport.close();
+		transport->close();
 		return;
 	}
 
@@ -2203,8 +4376,8 @@ void StreamTransport<DelegateType, DatagramTransport>::skip_timer_cb(RecvStream&
 	stream.state_timer.template start<Self, RecvStream, &Self::skip_timer_cb>(stream.state_timer_interval, 0);
 }
 
-template<typename DelegateType, template<typename> class DatagramTransport>
-void StreamTransport<DelegateType, DatagramTransport>::skip_stream(
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+void StreamTransport<DelegateType, DatagramTransport, CongestionControl>::skip_stream(
 	uint16_t stream_id
 ) {
 	auto &stream = get_or_create_recv_stream(stream_id);
@@ -2225,8 +4398,8 @@ void StreamTransport<DelegateType, DatagramTransport>::skip_stream(
 	stream.state_timer.template start<Self, RecvStream, &Self::skip_timer_cb>(stream.state_timer_interval, 0);
 }
 
-template<typename DelegateType, template<typename> class DatagramTransport>
-void StreamTransport<DelegateType, DatagramTransport>::flush_timer_cb(SendStream& stream) {
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+void StreamTransport<DelegateType, DatagramTransport, CongestionControl>::flush_timer_cb(SendStream& stream) {
 	if(stream.state_timer_interval >= 64000) { // Abort on too many retries
 		stream.state_timer_interval = 0;
 		SPDLOG_DEBUG(
@@ -2236,7 +4409,7 @@ void StreamTransport<DelegateType, DatagramTransport>::flush_timer_cb(SendStream
 			stream.stream_id
 		);
 		reset();
-		transport.close();
+		transport->close();
 		return;
 	}
 
@@ -2246,34 +4419,25 @@ void StreamTransport<DelegateType, DatagramTransport>::flush_timer_cb(SendStream
 	stream.state_timer.template start<Self, SendStream, &Self::flush_timer_cb>(stream.state_timer_interval, 0);
 }
 
-template<typename DelegateType, template<typename> class DatagramTransport>
-void StreamTransport<DelegateType, DatagramTransport>::flush_stream(
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+void StreamTransport<DelegateType, DatagramTransport, CongestionControl>::flush_stream(
 	uint16_t stream_id
 ) {
 	auto &stream = get_or_create_send_stream(stream_id);
 
-	// Remove previously sent packets
-	auto sent_iter = sent_packets.cbegin();
-	while(sent_iter != sent_packets.cend()) {
-		if(sent_iter->second.stream->stream_id != stream.stream_id) {
-			sent_iter++;
-			continue;
-		}
-
-		bytes_in_flight -= sent_iter->second.length;
-		sent_iter = sent_packets.erase(sent_iter);
-	}
-
-	// Remove lost packets
-	auto lost_iter = lost_packets.cbegin();
-	while(lost_iter != lost_packets.cend()) {
-		if(lost_iter->second.stream->stream_id != stream.stream_id) {
-			lost_iter++;
+	// Remove previously sent and lost packets
+	for(
+		auto pn = sent_packets.begin();
+		pn != sent_packets.end();
+		pn++
+	) {
+		auto *sent_packet = sent_packets.find(pn);
+		if(sent_packet == nullptr || sent_packet->stream != &stream) {
 			continue;
 		}
 
-		bytes_in_flight -= lost_iter->second.length;
-		lost_iter = lost_packets.erase(lost_iter);
+		bytes_in_flight -= sent_packet->length;
+		sent_packets.erase(pn);
 	}
 
 	stream.data_queue.clear();
@@ -2289,18 +4453,70 @@ void StreamTransport<DelegateType, DatagramTransport>::flush_stream(
 	stream.state_timer.template start<Self, SendStream, &Self::flush_timer_cb>(stream.state_timer_interval, 0);
 }
 
-template<typename DelegateType, template<typename> class DatagramTransport>
-bool StreamTransport<DelegateType, DatagramTransport>::is_internal() {
-	return transport.is_internal();
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+void StreamTransport<DelegateType, DatagramTransport, CongestionControl>::pause_recv() {
+	is_recv_paused = true;
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+void StreamTransport<DelegateType, DatagramTransport, CongestionControl>::resume_recv() {
+	if(!is_recv_paused) {
+		return;
+	}
+	is_recv_paused = false;
+
+	// Streams go away as they are read fully, walk over a copy of their ids
+	std::vector<uint16_t> stream_ids;
+	stream_ids.reserve(recv_streams.size());
+	for(auto& [stream_id, _] : recv_streams) {
+		(void)_;
+		stream_ids.push_back(stream_id);
+	}
+
+	for(auto stream_id : stream_ids) {
+		// The delegate might pause again
+		if(is_recv_paused) {
+			return;
+		}
+
+		auto iter = recv_streams.find(stream_id);
+		if(iter == recv_streams.end()) {
+			continue;
+		}
+		auto &stream = iter->second;
+
+		constexpr bool has_recv_stream = requires(
+			DelegateType& d,
+			Self& t
+		) {
+			d.did_recv_stream(t, core::Buffer(nullptr, 0), uint16_t(0));
+		};
+
+		if constexpr (has_recv_stream) {
+			if(stream.whole) {
+				if(stream.check_assembled()) {
+					deliver_whole(stream);
+				}
+				continue;
+			}
+		}
+
+		read_recv_packets(stream, stream.read_offset);
+	}
+}
+
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+bool StreamTransport<DelegateType, DatagramTransport, CongestionControl>::is_internal() {
+	return transport->is_internal();
 }
 
-template<typename DelegateType, template<typename> class DatagramTransport>
-uint8_t const* StreamTransport<DelegateType, DatagramTransport>::get_static_pk() {
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+uint8_t const* StreamTransport<DelegateType, DatagramTransport, CongestionControl>::get_static_pk() {
 	return static_pk;
 }
 
-template<typename DelegateType, template<typename> class DatagramTransport>
-uint8_t const* StreamTransport<DelegateType, DatagramTransport>::get_remote_static_pk() {
+template<typename DelegateType, template<typename> class DatagramTransport, typename CongestionControl>
+uint8_t const* StreamTransport<DelegateType, DatagramTransport, CongestionControl>::get_remote_static_pk() {
 	return remote_static_pk;
 }
 
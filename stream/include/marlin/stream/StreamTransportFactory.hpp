@@ -15,7 +15,8 @@ template<
 	typename ListenDelegate,
 	typename TransportDelegate,
 	template<typename, typename> class DatagramTransportFactory,
-	template<typename> class DatagramTransport
+	template<typename> class DatagramTransport,
+	typename CongestionControl = CubicCongestionControl
 >
 class StreamTransportFactory : public core::SugaredTransportFactoryScaffold<
 	ListenDelegate,
@@ -23,7 +24,8 @@ class StreamTransportFactory : public core::SugaredTransportFactoryScaffold<
 	DatagramTransportFactory,
 	DatagramTransport,
 	StreamTransportFactory,
-	StreamTransport
+	StreamTransport,
+	CongestionControl
 > {
 public:
 	using TransportFactoryScaffoldType = core::SugaredTransportFactoryScaffold<
@@ -32,11 +34,20 @@ public:
 		DatagramTransportFactory,
 		DatagramTransport,
 		StreamTransportFactory,
-		StreamTransport
+		StreamTransport,
+		CongestionControl
 	>;
 private:
 	using TransportFactoryScaffoldType::base_factory;
 	using TransportFactoryScaffoldType::transport_manager;
+	using TransportFactoryScaffoldType::delegate;
+
+	using TransportType = StreamTransport<TransportDelegate, DatagramTransport, CongestionControl>;
+
+	/// Session tickets of peers dialled and handed out to peers, lets redials skip the handshake
+	SessionTickets tickets;
+	/// Transports by connection id, lets connections follow peers to new addresses
+	ConnectionIds<TransportType> conn_ids;
 
 public:
 	using TransportFactoryScaffoldType::addr;
@@ -48,6 +59,35 @@ public:
 	using TransportFactoryScaffoldType::dial;
 
 	using TransportFactoryScaffoldType::get_transport;
+
+	/// Creates transports sharing the session tickets and connection ids of the factory
+	void did_create_transport(DatagramTransport<TransportType> &base_transport) {
+		auto* transport = transport_manager.get_or_create(
+			base_transport.dst_addr,
+			base_transport.src_addr,
+			base_transport.dst_addr,
+			base_transport,
+			transport_manager
+		).first;
+		transport->tickets = &tickets;
+		transport->conn_ids = &conn_ids;
+		delegate->did_create_transport(*transport);
+	}
+
+	/// Opt into segmentation offload of the datagram factory, lets pacing bursts go out as GSO super datagrams
+	int enable_offload() {
+		return base_factory.enable_offload();
+	}
+
+	/// Opt into kernel pacing of the datagram factory, paced packets are handed over ahead of time with departure times
+	int enable_txtime() {
+		return base_factory.enable_txtime();
+	}
+
+	/// Opt into path MTU discovery, the datagram factory stops fragmenting and transports probe for larger packets
+	int enable_pmtud() {
+		return base_factory.enable_dont_fragment();
+	}
 };
 
 } // namespace stream
@@ -0,0 +1,299 @@
+#ifndef MARLIN_STREAM_CONGESTION_BBRCONGESTIONCONTROL_HPP
+#define MARLIN_STREAM_CONGESTION_BBRCONGESTIONCONTROL_HPP
+
+#include "../protocol/SendStream.hpp"
+
+#include <algorithm>
+
+namespace marlin {
+namespace stream {
+
+/// @brief Model based congestion control in the style of BBRv2
+///
+/// Paces at the bottleneck bandwidth and bounds inflight by the bandwidth delay product,
+/// both measured from delivery rate and RTT samples. Random loss is ignored unless the
+/// loss rate of a round trip crosses a threshold, in which case inflight is capped
+/// like BBRv2 does, and the cap is probed upwards again on loss free rounds.
+///
+/// All times are in milliseconds and rates in bytes per millisecond.
+class BbrCongestionControl {
+public:
+	enum class Mode {
+		Startup,
+		Drain,
+		ProbeBw,
+		ProbeRtt
+	};
+
+	static constexpr uint64_t initial_window = 100000;
+	/// Full packets kept in flight at the least
+	static constexpr uint64_t min_window_packets = 4;
+	/// RTT assumed for pacing until the first bandwidth sample, in milliseconds
+	static constexpr uint64_t initial_rtt = 100;
+	/// Loss rate in a round above which inflight gets capped
+	static constexpr double loss_threshold = 0.02;
+	/// Multiplicative decrease of the inflight cap
+	static constexpr double beta = 0.7;
+
+private:
+	static constexpr double startup_gain = 2.77;
+	static constexpr double cwnd_gain = 2;
+	static constexpr size_t bw_rounds = 10;
+	static constexpr uint64_t min_rtt_expiry = 10000;
+	static constexpr uint64_t probe_rtt_duration = 200;
+	static constexpr size_t num_cycle_phases = 8;
+
+	Mode mode = Mode::Startup;
+	double pacing_gain = startup_gain;
+
+	// Delivery rate sampling
+	/// Total bytes acked
+	uint64_t delivered = 0;
+	/// Time delivered was last updated
+	uint64_t delivered_time = 0;
+
+	// Round trips, a round ends when a packet sent after the round started is acked
+	uint64_t round_count = 0;
+	uint64_t next_round_delivered = 0;
+
+	/// Max delivery rate of each of the last few rounds
+	uint64_t bw_samples[bw_rounds] = {};
+	uint64_t max_bw = 0;
+
+	uint64_t min_rtt = -1;
+	uint64_t min_rtt_stamp = 0;
+
+	// Startup exit, the pipe is full when bandwidth stops growing
+	uint64_t full_bw = 0;
+	size_t full_bw_count = 0;
+	bool filled_pipe = false;
+
+	// Bandwidth probing
+	size_t cycle_index = 0;
+	uint64_t cycle_stamp = 0;
+
+	uint64_t probe_rtt_done = 0;
+
+	/// Stream bytes in a full packet
+	uint64_t packet_size = 1350;
+
+	// Loss response
+	uint64_t inflight_hi = -1;
+	uint64_t round_lost = 0;
+	uint64_t round_delivered = 0;
+	bool round_loss_capped = false;
+
+	static double cycle_gain(size_t idx) {
+		constexpr double gains[num_cycle_phases] = {1.25, 0.75, 1, 1, 1, 1, 1, 1};
+		return gains[idx];
+	}
+
+	uint64_t bdp(double gain) const {
+		return gain * max_bw * min_rtt;
+	}
+
+	uint64_t min_window() const {
+		return min_window_packets * packet_size;
+	}
+
+	bool has_model() const {
+		return max_bw > 0 && min_rtt != uint64_t(-1);
+	}
+
+	void start_round() {
+		round_count++;
+		next_round_delivered = delivered;
+
+		// Loss free rounds while probing raise the cap again
+		if(mode == Mode::ProbeBw && !round_loss_capped && inflight_hi != uint64_t(-1)) {
+			inflight_hi += inflight_hi / 4;
+
+			// No longer binding
+			if(has_model() && inflight_hi > bdp(cwnd_gain)) {
+				inflight_hi = -1;
+			}
+		}
+		round_lost = 0;
+		round_delivered = delivered;
+		round_loss_capped = false;
+
+		bw_samples[round_count % bw_rounds] = 0;
+	}
+
+	void update_bw(uint64_t rate, bool is_app_limited) {
+		// App limited samples only count if they raise the estimate
+		if(is_app_limited && rate <= max_bw) {
+			return;
+		}
+
+		auto &sample = bw_samples[round_count % bw_rounds];
+		sample = std::max(sample, rate);
+		max_bw = *std::max_element(bw_samples, bw_samples + bw_rounds);
+	}
+
+	void check_full_pipe(bool is_app_limited) {
+		if(filled_pipe || is_app_limited) {
+			return;
+		}
+
+		if(max_bw >= full_bw + full_bw / 4) {
+			full_bw = max_bw;
+			full_bw_count = 0;
+			return;
+		}
+
+		if(++full_bw_count >= 3) {
+			filled_pipe = true;
+		}
+	}
+
+	void enter_probe_bw(uint64_t now) {
+		mode = Mode::ProbeBw;
+		// Start in a cruising phase
+		cycle_index = 2;
+		cycle_stamp = now;
+		pacing_gain = cycle_gain(cycle_index);
+	}
+
+	void update_mode(uint64_t now, uint64_t bytes_in_flight, bool new_round) {
+		if(mode == Mode::Startup && filled_pipe) {
+			mode = Mode::Drain;
+			pacing_gain = 1 / startup_gain;
+		}
+
+		if(mode == Mode::Drain && bytes_in_flight <= bdp(1)) {
+			enter_probe_bw(now);
+		}
+
+		if(mode == Mode::ProbeBw && now - cycle_stamp > min_rtt) {
+			// Each phase lasts a min rtt
+			cycle_index = (cycle_index + 1) % num_cycle_phases;
+			cycle_stamp = now;
+			pacing_gain = cycle_gain(cycle_index);
+		}
+
+		// Refresh the min rtt estimate by draining the queue every so often
+		if(mode != Mode::ProbeRtt && now - min_rtt_stamp > min_rtt_expiry) {
+			mode = Mode::ProbeRtt;
+			pacing_gain = 1;
+			probe_rtt_done = now + std::max(probe_rtt_duration, min_rtt);
+			// Take a fresh sample
+			min_rtt = -1;
+		}
+
+		if(mode == Mode::ProbeRtt && now >= probe_rtt_done && new_round) {
+			min_rtt_stamp = now;
+			if(filled_pipe) {
+				enter_probe_bw(now);
+			} else {
+				mode = Mode::Startup;
+				pacing_gain = startup_gain;
+			}
+		}
+	}
+
+public:
+	Mode get_mode() const {
+		return mode;
+	}
+
+	/// Bottleneck bandwidth estimate in bytes per millisecond
+	uint64_t get_bw() const {
+		return max_bw;
+	}
+
+	uint64_t window() const {
+		if(mode == Mode::ProbeRtt) {
+			return min_window();
+		}
+
+		uint64_t window = has_model() ? bdp(cwnd_gain) : initial_window;
+		if(!filled_pipe) {
+			window = std::max(window, initial_window);
+		}
+
+		return std::max(std::min(window, inflight_hi), min_window());
+	}
+
+	uint64_t pacing_rate() const {
+		if(max_bw == 0) {
+			return startup_gain * initial_window / initial_rtt;
+		}
+
+		return pacing_gain * max_bw;
+	}
+
+	void set_packet_size(uint64_t size) {
+		packet_size = size;
+	}
+
+	void on_send(uint64_t now, SentPacketInfo &packet, uint64_t bytes_in_flight) {
+		// Restarting from idle, the idle period is not part of any delivery rate
+		if(bytes_in_flight == 0) {
+			delivered_time = now;
+		}
+
+		packet.delivered = delivered;
+		packet.delivered_time = delivered_time;
+	}
+
+	void on_ack(
+		uint64_t now,
+		SentPacketInfo const &packet,
+		uint64_t bytes_in_flight,
+		bool is_app_limited
+	) {
+		delivered += packet.length;
+		delivered_time = now;
+
+		bool new_round = false;
+		if(packet.delivered >= next_round_delivered) {
+			start_round();
+			new_round = true;
+		}
+
+		// Delivery rate over the interval the packet was in flight
+		auto interval = std::max<uint64_t>(now - packet.delivered_time, 1);
+		update_bw((delivered - packet.delivered) / interval, is_app_limited);
+
+		auto rtt = now - packet.sent_time;
+		if(rtt < min_rtt) {
+			min_rtt = rtt;
+			min_rtt_stamp = now;
+		}
+
+		if(new_round) {
+			check_full_pipe(is_app_limited);
+		}
+		update_mode(now, bytes_in_flight, new_round);
+	}
+
+	bool on_loss(
+		uint64_t,
+		SentPacketInfo const &,
+		uint64_t lost_bytes,
+		uint64_t bytes_in_flight
+	) {
+		round_lost += lost_bytes;
+
+		// Random loss below the threshold is not a congestion signal
+		auto round_bytes = delivered - round_delivered + round_lost;
+		if(round_loss_capped || round_lost < min_window() || round_lost <= loss_threshold * round_bytes) {
+			return false;
+		}
+		round_loss_capped = true;
+
+		// Heavy loss ends startup
+		filled_pipe = true;
+
+		auto target = std::max(bytes_in_flight + lost_bytes, has_model() ? bdp(1) : 0);
+		inflight_hi = std::max<uint64_t>(beta * std::min(target, inflight_hi), min_window());
+
+		return true;
+	}
+};
+
+} // namespace stream
+} // namespace marlin
+
+#endif // MARLIN_STREAM_CONGESTION_BBRCONGESTIONCONTROL_HPP
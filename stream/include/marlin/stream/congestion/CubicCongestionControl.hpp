@@ -0,0 +1,126 @@
+#ifndef MARLIN_STREAM_CONGESTION_CUBICCONGESTIONCONTROL_HPP
+#define MARLIN_STREAM_CONGESTION_CUBICCONGESTIONCONTROL_HPP
+
+#include "../protocol/SendStream.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace marlin {
+namespace stream {
+
+/// @brief Loss based congestion control, the default policy of stream transports
+///
+/// Slow start followed by NEW RENO increase, with a CUBIC style multiplicative decrease on loss.
+/// Paces the window over a smoothed RTT, twice as fast during slow start so the window can grow.
+///
+/// Congestion control policies provide:
+/// \li window() - bytes allowed in flight
+/// \li pacing_rate() - bytes that can be sent per millisecond
+/// \li on_send() - called for every sent packet before it is recorded, can stamp the packet
+/// \li on_ack() - called for every newly acked packet
+/// \li on_loss() - called once for every batch of packets declared lost, returns true on a new congestion event
+/// \li set_packet_size() - optional, stream bytes in a full packet, changes with the path MTU
+class CubicCongestionControl {
+private:
+	uint64_t k = 0;
+	uint64_t w_max = 0;
+	uint64_t congestion_window = 100000;
+	uint64_t ssthresh = -1;
+	/// Time of the last congestion event, losses of packets sent before it are ignored
+	uint64_t congestion_start = 0;
+	/// Smoothed RTT from acked packets
+	double rtt = -1;
+	/// Stream bytes in a full packet
+	uint64_t packet_size = 1350;
+
+public:
+	/// RTT assumed for pacing until the first sample, in milliseconds
+	static constexpr double initial_rtt = 100;
+
+	uint64_t window() const {
+		return congestion_window;
+	}
+
+	uint64_t pacing_rate() const {
+		double gain = congestion_window < ssthresh ? 2 : 1.25;
+		double srtt = rtt < 0 ? initial_rtt : std::max(rtt, 1.0);
+		return std::max(gain * congestion_window / srtt, 1.0);
+	}
+
+	void set_packet_size(uint64_t size) {
+		packet_size = size;
+	}
+
+	void on_send(uint64_t, SentPacketInfo &, uint64_t) {}
+
+	void on_ack(
+		uint64_t now,
+		SentPacketInfo const &packet,
+		uint64_t,
+		bool is_app_limited
+	) {
+		if(rtt < 0) {
+			rtt = now - packet.sent_time;
+		} else {
+			rtt = 0.875 * rtt + 0.125 * (now - packet.sent_time);
+		}
+
+		// Check if not in congestion recovery and not application limited
+		if(packet.sent_time <= congestion_start || is_app_limited) {
+			return;
+		}
+
+		if(congestion_window < ssthresh) {
+			// Slow start, exponential increase
+			congestion_window += packet.length;
+		} else {
+			// Congestion avoidance, CUBIC
+			// auto k = k;
+			// auto t = now - congestion_start;
+			// congestion_window = w_max + 4 * std::pow(0.001 * (t - k), 3);
+
+			// if(congestion_window < 10000) {
+			// 	congestion_window = 10000;
+			// }
+
+			// Congestion avoidance, NEW RENO
+			congestion_window += std::max<uint64_t>(1500, packet_size) * packet.length / congestion_window;
+		}
+	}
+
+	bool on_loss(
+		uint64_t now,
+		SentPacketInfo const &largest_lost,
+		uint64_t,
+		uint64_t
+	) {
+		if(largest_lost.sent_time <= congestion_start) {
+			return false;
+		}
+
+		// New congestion event
+		congestion_start = now;
+
+		if(congestion_window < w_max) {
+			// Fast convergence
+			w_max = congestion_window;
+			congestion_window *= 0.6;
+		} else {
+			w_max = congestion_window;
+			congestion_window *= 0.75;
+		}
+
+		// Keep a few packets in flight, jumbo packets would not fit otherwise
+		congestion_window = std::max<uint64_t>(congestion_window, std::max<uint64_t>(10000, 4 * packet_size));
+		ssthresh = congestion_window;
+		k = std::cbrt(w_max / 16)*1000;
+
+		return true;
+	}
+};
+
+} // namespace stream
+} // namespace marlin
+
+#endif // MARLIN_STREAM_CONGESTION_CUBICCONGESTIONCONTROL_HPP
@@ -0,0 +1,64 @@
+#ifndef MARLIN_STREAM_CONGESTION_PACER_HPP
+#define MARLIN_STREAM_CONGESTION_PACER_HPP
+
+#include <stdint.h>
+#include <algorithm>
+
+namespace marlin {
+namespace stream {
+
+/// @brief Spreads packets evenly at a given rate by giving each one a departure time
+///
+/// Departures follow an ideal schedule where each packet occupies length / rate of time.
+/// A sender which falls behind the schedule, after idling or a late timer, may catch up
+/// by at most max_credit worth of bytes so bursts stay bounded.
+///
+/// Times are in nanoseconds and rates in bytes per millisecond.
+class Pacer {
+public:
+	/// Time a late sender is allowed to catch up by, one timer tick
+	static constexpr uint64_t max_credit = 1000000;
+
+private:
+	uint64_t rate = 0;
+	/// Departure time of the next packet on the ideal schedule
+	uint64_t next_departure = 0;
+
+public:
+	/// Bytes per millisecond
+	void set_rate(uint64_t rate) {
+		this->rate = rate;
+	}
+
+	uint64_t get_rate() const {
+		return rate;
+	}
+
+	/// Departure time of the next packet
+	uint64_t departure_time(uint64_t now) const {
+		if(now > max_credit) {
+			return std::max(next_departure, now - max_credit);
+		}
+
+		return next_departure;
+	}
+
+	/// Advance the schedule past a packet leaving at departure
+	void on_send(uint64_t departure, uint64_t length) {
+		if(rate == 0) {
+			next_departure = departure;
+			return;
+		}
+
+		next_departure = departure + length * 1000000 / rate;
+	}
+
+	void reset() {
+		next_departure = 0;
+	}
+};
+
+} // namespace stream
+} // namespace marlin
+
+#endif // MARLIN_STREAM_CONGESTION_PACER_HPP
@@ -1,106 +1,186 @@
 #ifndef MARLIN_STREAM_ACK_RANGES_HPP
 #define MARLIN_STREAM_ACK_RANGES_HPP
 
-#include <list>
+#include <algorithm>
+#include <iterator>
+#include <vector>
 #include <spdlog/spdlog.h>
 
 namespace marlin {
 namespace stream {
 
-/// Stores ranges of packet numbers that have and haven't been seen
+/// Stores ranges of packet numbers that have been seen
+///
+/// Ranges are kept sorted in a vector, new packets usually extend the newest range
+/// at the back and reordered ones are placed with a binary search.
 class AckRanges {
 public:
-	/// Alternating ranges of seen and not seen packet numbers
-	std::list<uint64_t> ranges;
-	/// Largest seen packet number
-	uint64_t largest;
+	/// Inclusive range of seen packet numbers
+	struct Range {
+		uint64_t low;
+		uint64_t high;
+	};
+
+	/// Maximum number of seen ranges tracked, oldest ranges are dropped beyond this
+	static constexpr size_t max_ranges = 512;
+
+	/// Iterates alternating lengths of seen and not seen runs, from a seen range downwards
+	class RunIterator {
+	private:
+		std::vector<Range> const* ranges = nullptr;
+		/// Index into ranges, counting from the back
+		size_t idx = 0;
+		bool gap = false;
+
+		Range const& range(size_t i) const {
+			return (*ranges)[ranges->size() - 1 - i];
+		}
+	public:
+		using difference_type = std::ptrdiff_t;
+		using value_type = uint64_t;
+		using pointer = uint64_t const*;
+		using reference = uint64_t;
+		using iterator_category = std::input_iterator_tag;
+
+		RunIterator(std::vector<Range> const* ranges, size_t idx) : ranges(ranges), idx(idx) {}
+
+		uint64_t operator*() const {
+			if(gap) {
+				return range(idx).low - range(idx + 1).high - 1;
+			}
 
+			return range(idx).high - range(idx).low + 1;
+		}
+
+		RunIterator& operator++() {
+			if(gap) {
+				idx++;
+			}
+			gap = !gap;
+
+			// Runs end with the last seen range
+			if(gap && idx + 1 == ranges->size()) {
+				idx++;
+				gap = false;
+			}
+
+			return *this;
+		}
+
+		bool operator==(RunIterator const& other) const {
+			return idx == other.idx && gap == other.gap;
+		}
+
+		bool operator!=(RunIterator const& other) const {
+			return !(*this == other);
+		}
+	};
+
+private:
+	/// Disjoint, non adjacent seen ranges in increasing order
+	std::vector<Range> ranges;
+
+public:
 	/// Mark a packet number as seen
 	void add_packet_number(uint64_t num) {
 		// Initial
 		if(ranges.size() == 0) {
-			ranges.push_back(1);
-
-			largest = num;
+			ranges.push_back({num, num});
 			return;
 		}
 
-		// Check beginning
-		if(num > largest) {
-			if(num == largest + 1) {
-				ranges.front()++;
+		// Newest range, the common case
+		auto &newest = ranges.back();
+		if(num > newest.high) {
+			if(num == newest.high + 1) {
+				newest.high++;
 			} else {
-				ranges.push_front(num - largest - 1);
-				ranges.push_front(1);
+				ranges.push_back({num, num});
+				trim();
 			}
 
-			largest = num;
 			return;
 		}
 
-		uint64_t high = largest;
-		bool gap = false;
-		for(auto iter = ranges.begin(); iter != ranges.end(); iter++) {
-			uint64_t low = high - *iter;
-			// Check if contained in range (low,high]
-			if(high >= num && num >= low + 1) {
-				if(!gap) {
-					// Already in range, ignore
-					return;
-				}
-
-				auto next_iter = std::next(iter);
-				auto prev_iter = std::prev(iter);
-
-				if(num == high) {
-					// End of previous range
-					(*prev_iter)++;
-					(*iter)--;
-
-					// Merge if possible
-					if(*iter == 0) {
-						*prev_iter += *next_iter;
-						ranges.erase(next_iter);
-						ranges.erase(iter);
-					}
-				} else if(num == low + 1) {
-					// Start of next range
-					(*next_iter)++;
-					(*iter)--;
-
-					// Merge if possible
-					if(*iter == 0) {
-						*prev_iter += *next_iter;
-						ranges.erase(next_iter);
-						ranges.erase(iter);
-					}
-				} else {
-					// Middle of gap, create new range and gap
-					*iter = num - (low + 1);
-					ranges.insert(iter, high-num);
-					ranges.insert(iter, 1);
-				}
+		// First range starting after num
+		auto next = std::upper_bound(
+			ranges.begin(),
+			ranges.end(),
+			num,
+			[](uint64_t num, Range const& range) {
+				return num < range.low;
+			}
+		);
 
+		bool joins_prev = false;
+		if(next != ranges.begin()) {
+			auto &prev = *std::prev(next);
+			if(num <= prev.high) {
+				// Already in range, ignore
 				return;
 			}
 
-			high = low;
-			gap = !gap;
+			joins_prev = (prev.high + 1 == num);
 		}
-
-		// At end
-		if(high == num) {
-			ranges.back()++;
+		// num is below next->low here, so next exists
+		bool joins_next = (next->low == num + 1);
+
+		if(joins_prev && joins_next) {
+			// Fills a gap, merge
+			std::prev(next)->high = next->high;
+			ranges.erase(next);
+		} else if(joins_prev) {
+			std::prev(next)->high = num;
+		} else if(joins_next) {
+			next->low = num;
 		} else {
-			ranges.push_back(high - num);
-			ranges.push_back(1);
+			ranges.insert(next, {num, num});
+			trim();
 		}
+	}
 
-		if(ranges.size() > 1001) {
-			SPDLOG_ERROR("AckRange resized: {}", num);
-			ranges.resize(1001);
+	/// Drop the oldest ranges beyond max_ranges
+	void trim() {
+		if(ranges.size() > max_ranges) {
+			SPDLOG_ERROR("AckRange resized: {}", ranges.front().high);
+			ranges.erase(ranges.begin(), ranges.begin() + (ranges.size() - max_ranges));
 		}
 	}
+
+	/// Largest seen packet number
+	uint64_t largest() const {
+		return ranges.back().high;
+	}
+
+	/// Number of seen ranges
+	size_t size() const {
+		return ranges.size();
+	}
+
+	bool empty() const {
+		return ranges.empty();
+	}
+
+	/// Seen range by index, newest first
+	Range const& range(size_t idx) const {
+		return ranges[ranges.size() - 1 - idx];
+	}
+
+	/// Runs starting with the seen range at idx, newest first
+	RunIterator runs_begin(size_t idx = 0) const {
+		return RunIterator(&ranges, idx);
+	}
+
+	/// End of runs
+	RunIterator runs_end() const {
+		return RunIterator(&ranges, ranges.size());
+	}
+
+	/// Number of runs starting with the seen range at idx, limited to the first count seen ranges
+	size_t num_runs(size_t idx = 0, size_t count = max_ranges) const {
+		auto left = ranges.size() - idx;
+		return 2 * (count < left ? count : left) - 1;
+	}
 };
 
 } // namespace stream
@@ -0,0 +1,75 @@
+#ifndef MARLIN_STREAM_CLOSEDSTREAMS_HPP
+#define MARLIN_STREAM_CLOSEDSTREAMS_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <deque>
+#include <unordered_map>
+#include <utility>
+
+namespace marlin {
+namespace stream {
+
+/// Ids of recently closed streams, each forgotten once it has been quiet for the expiry
+///
+/// Receivers record whole streams as they are delivered so that late retransmissions of them,
+/// say of a fragment rebuilt from a repair group, are not taken for a new stream on the same id.
+/// Senders record whole streams once fully acked and hold their ids back for as long, the
+/// receiver saw the last packet of the stream before the ack so its record is gone by then.
+class ClosedStreams {
+	/// Stream id -> Time last closed or refreshed
+	std::unordered_map<uint16_t, uint64_t> closed;
+	/// Times and ids in the order recorded, stale entries are skipped over when expiring
+	std::deque<std::pair<uint64_t, uint16_t>> order;
+
+	void expire(uint64_t now) {
+		while(!order.empty() && order.front().first + expiry <= now) {
+			auto [time, stream_id] = order.front();
+			order.pop_front();
+
+			auto iter = closed.find(stream_id);
+			if(iter != closed.end() && iter->second == time) {
+				closed.erase(iter);
+			}
+		}
+	}
+
+public:
+	/// Time for which ids are remembered, in ms
+	static constexpr uint64_t expiry = 10000;
+
+	/// Record the stream as closed at the given time, refreshes the record if already closed
+	void close(uint16_t stream_id, uint64_t now) {
+		expire(now);
+
+		closed.insert_or_assign(stream_id, now);
+		order.emplace_back(now, stream_id);
+	}
+
+	/// Was the stream closed within the expiry?
+	bool contains(uint16_t stream_id, uint64_t now) {
+		expire(now);
+
+		return closed.find(stream_id) != closed.end();
+	}
+
+	/// Forget the stream
+	void erase(uint16_t stream_id) {
+		closed.erase(stream_id);
+	}
+
+	void clear() {
+		closed.clear();
+		order.clear();
+	}
+
+	/// Number of streams remembered
+	size_t size() const {
+		return closed.size();
+	}
+};
+
+} // namespace stream
+} // namespace marlin
+
+#endif // MARLIN_STREAM_CLOSEDSTREAMS_HPP
@@ -0,0 +1,61 @@
+#ifndef MARLIN_STREAM_CONNECTIONIDS_HPP
+#define MARLIN_STREAM_CONNECTIONIDS_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <unordered_map>
+
+namespace marlin {
+namespace stream {
+
+/// Transports of a factory by their own connection id
+///
+/// Transports are otherwise found by the address of the peer. Packets carrying the id of a
+/// connection that arrive from another address, say after a NAT rebinding, can still be
+/// handed to the right connection through this. Ids are random, a transport whose id is
+/// already taken is not registered and cannot be found by it.
+template<typename TransportType>
+class ConnectionIds {
+	std::unordered_map<uint32_t, TransportType*> transports;
+
+public:
+	ConnectionIds() = default;
+	ConnectionIds(ConnectionIds const&) = delete;
+
+	/// Register the transport under the given id, false if the id is taken
+	bool add(uint32_t conn_id, TransportType* transport) {
+		if(conn_id == 0) {
+			return false;
+		}
+
+		return transports.try_emplace(conn_id, transport).second;
+	}
+
+	/// Unregister the transport if it is the one registered under the given id
+	void remove(uint32_t conn_id, TransportType* transport) {
+		auto iter = transports.find(conn_id);
+		if(iter != transports.end() && iter->second == transport) {
+			transports.erase(iter);
+		}
+	}
+
+	/// Transport registered under the given id, nullptr if none
+	TransportType* get(uint32_t conn_id) const {
+		auto iter = transports.find(conn_id);
+		if(iter == transports.end()) {
+			return nullptr;
+		}
+
+		return iter->second;
+	}
+
+	/// Number of registered transports
+	size_t size() const {
+		return transports.size();
+	}
+};
+
+} // namespace stream
+} // namespace marlin
+
+#endif // MARLIN_STREAM_CONNECTIONIDS_HPP
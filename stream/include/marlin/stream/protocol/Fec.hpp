@@ -0,0 +1,154 @@
+#ifndef MARLIN_STREAM_FEC_HPP
+#define MARLIN_STREAM_FEC_HPP
+
+#include <marlin/core/Buffer.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <stdint.h>
+
+namespace marlin {
+namespace stream {
+
+/// XOR parity over a group of consecutive fragments of a stream
+///
+/// Fragments are fragment bytes each, except the last which may be shorter
+/// and is zero padded in the parity. Any single missing fragment is the parity
+/// XOR the other fragments.
+struct FecGroup {
+	/// Stream offset of the first fragment
+	uint64_t offset = 0;
+	/// Bytes covered by the group
+	uint32_t length = 0;
+	/// Does the group end the stream?
+	bool is_fin = false;
+	/// XOR of the fragments, its size is the fragment size
+	core::Buffer parity = core::Buffer(nullptr, 0);
+
+	/// Stream offset of the end of the group
+	uint64_t end() const {
+		return offset + length;
+	}
+
+	/// Size of all fragments but the last
+	uint16_t fragment() const {
+		return parity.size();
+	}
+
+	/// Number of fragments in the group
+	uint32_t count() const {
+		return parity.size() == 0 ? 0 : (length + parity.size() - 1) / parity.size();
+	}
+
+	/// Stream offset of the given fragment
+	uint64_t fragment_offset(uint32_t idx) const {
+		return offset + uint64_t(idx) * parity.size();
+	}
+
+	/// Size of the given fragment
+	uint16_t fragment_length(uint32_t idx) const {
+		return std::min<uint64_t>(parity.size(), end() - fragment_offset(idx));
+	}
+};
+
+/// Builds repair groups out of fragments as they are sent
+class FecEncoder {
+	FecGroup group;
+	uint8_t num_fragments = 0;
+
+public:
+	/// Fragments in the current group
+	uint8_t size() const {
+		return num_fragments;
+	}
+
+	/// Fragment size of the current group
+	uint16_t fragment() const {
+		return group.fragment();
+	}
+
+	/// XOR a fragment into the current group, starting a new group if there is none.
+	/// The fragment has to directly follow the group, and be the fragment size or its last.
+	void add(uint64_t offset, uint8_t const* data, uint16_t length, uint16_t fragment) {
+		add(offset, data, length, nullptr, 0, fragment);
+	}
+
+	/// XOR a fragment made up of two pieces, such as a header followed by shared data, into the current group
+	void add(
+		uint64_t offset,
+		uint8_t const* head,
+		uint16_t head_length,
+		uint8_t const* tail,
+		uint16_t tail_length,
+		uint16_t fragment
+	) {
+		if(num_fragments == 0) {
+			group.offset = offset;
+			group.length = 0;
+			group.is_fin = false;
+			group.parity = core::Buffer(fragment);
+			std::memset(group.parity.data(), 0, fragment);
+		}
+
+		auto* parity = group.parity.data();
+		for(uint16_t i = 0; i < head_length; i++) {
+			parity[i] ^= head[i];
+		}
+		for(uint16_t i = 0; i < tail_length; i++) {
+			parity[head_length + i] ^= tail[i];
+		}
+
+		group.length += head_length + tail_length;
+		num_fragments++;
+	}
+
+	/// Take the current group to send its repair packet, fragments added after this start a new one
+	FecGroup take(bool is_fin) {
+		group.is_fin = is_fin;
+		num_fragments = 0;
+
+		return std::move(group);
+	}
+};
+
+/// Sizes repair groups from an estimate of the packet loss rate
+///
+/// One repair packet recovers a group with a single loss. Groups are sized
+/// to expect about a quarter of a lost packet each, so groups with more than one
+/// loss stay rare while the overhead shrinks on clean paths.
+class FecRate {
+	double loss_rate = 0.01;
+
+public:
+	/// Weight of a single packet in the loss estimate
+	static constexpr double gain = 1.0 / 1024;
+	/// Smallest group, a repair packet for every 4 DATA packets
+	static constexpr uint8_t min_group_size = 4;
+	/// Largest group, a repair packet for every 32 DATA packets
+	static constexpr uint8_t max_group_size = 32;
+
+	/// Update the estimate with an acked packet
+	void on_packet_acked() {
+		loss_rate -= gain * loss_rate;
+	}
+
+	/// Update the estimate with a lost packet
+	void on_packet_lost() {
+		loss_rate += gain * (1 - loss_rate);
+	}
+
+	/// Fraction of packets being lost
+	double get_loss_rate() const {
+		return loss_rate;
+	}
+
+	/// DATA packets per repair packet
+	uint8_t group_size() const {
+		return std::clamp<double>(0.25 / loss_rate, min_group_size, max_group_size);
+	}
+};
+
+} // namespace stream
+} // namespace marlin
+
+#endif // MARLIN_STREAM_FEC_HPP
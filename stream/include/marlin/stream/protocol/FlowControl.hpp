@@ -0,0 +1,87 @@
+#ifndef MARLIN_STREAM_FLOWCONTROL_HPP
+#define MARLIN_STREAM_FLOWCONTROL_HPP
+
+#include <stdint.h>
+#include <algorithm>
+
+namespace marlin {
+namespace stream {
+
+/// Credit a receiver extends to its peer, either on a stream or on the whole connection
+///
+/// Positions are stream offsets for streams and running totals of new stream bytes for connections.
+/// The peer may send up to the limit, which trails consumed data by the window. The limit is only
+/// moved, and advertised, once half the window has opened up so updates stay few and far between.
+class RecvWindow {
+	uint64_t window;
+	/// Limit advertised to the peer
+	uint64_t limit;
+	/// Highest position received
+	uint64_t received = 0;
+	/// Position up to which the application has consumed data
+	uint64_t consumed = 0;
+
+public:
+	/// Initial credit of a stream, whole streams fit so they never wait on consumption to finish
+	static constexpr uint64_t stream_window = 6000000;
+	/// Initial credit of a connection, bounds what a connection buffers across streams
+	static constexpr uint64_t connection_window = 16000000;
+
+	explicit RecvWindow(uint64_t window) : window(window), limit(window) {}
+
+	/// Can data up to the given position be taken?
+	bool can_recv(uint64_t end) const {
+		return end <= limit;
+	}
+
+	/// Bytes data up to the given position would add, nothing if received already
+	uint64_t growth(uint64_t end) const {
+		return end > received ? end - received : 0;
+	}
+
+	/// Account for data received up to the given position, returns the bytes it adds
+	uint64_t on_recv(uint64_t end) {
+		auto grown = growth(end);
+		received = std::max(received, end);
+
+		return grown;
+	}
+
+	/// Account for data consumed up to the given position, skipped data counts as received too
+	void on_consume(uint64_t end) {
+		consumed = std::max(consumed, end);
+		received = std::max(received, end);
+	}
+
+	/// Move the limit if enough of the window opened up, true if the new limit is to be advertised
+	bool update() {
+		if(consumed + window < limit + window / 2) {
+			return false;
+		}
+
+		limit = consumed + window;
+		return true;
+	}
+
+	uint64_t get_limit() const {
+		return limit;
+	}
+
+	uint64_t get_received() const {
+		return received;
+	}
+
+	uint64_t get_consumed() const {
+		return consumed;
+	}
+
+	/// Bytes received but not consumed yet
+	uint64_t buffered() const {
+		return received - consumed;
+	}
+};
+
+} // namespace stream
+} // namespace marlin
+
+#endif // MARLIN_STREAM_FLOWCONTROL_HPP
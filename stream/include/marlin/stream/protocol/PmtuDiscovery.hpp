@@ -0,0 +1,260 @@
+#ifndef MARLIN_STREAM_PMTU_DISCOVERY_HPP
+#define MARLIN_STREAM_PMTU_DISCOVERY_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace marlin {
+namespace stream {
+
+/// Packetization layer path MTU discovery in the style of DPLPMTUD (RFC 8899)
+///
+/// Confirms a base size with a probe, then searches upwards with padded probes,
+/// largest size first and halving the interval after that. Each size gets a few
+/// probes before it is considered too large, so random loss does not end the search.
+/// Sizes which stop getting through are detected as a black hole and drop the MTU
+/// back to the base size, or to the minimum if the base size fails as well.
+///
+/// Sizes are datagram payload sizes, without IP and UDP headers. Times are in milliseconds.
+class PmtuDiscovery {
+public:
+	enum class State {
+		/// Probing the base size
+		Base,
+		/// Probing larger sizes
+		Searching,
+		/// Using the largest size found, searched again after raise_interval
+		SearchComplete,
+		/// Base size failed, using the minimum and probing the base size now and then
+		Error
+	};
+
+	/// Smallest size assumed to work on any path
+	static constexpr uint16_t min_plpmtu = 1200;
+	/// Size used until probes confirm otherwise, fits 1350 byte fragments
+	static constexpr uint16_t base_plpmtu = 1408;
+	/// 9000 byte jumbo frames without IPv4 and UDP headers
+	static constexpr uint16_t max_plpmtu = 8972;
+	/// Probes of a size before it is considered too large
+	static constexpr size_t max_probes = 3;
+	/// Search stops once it is narrowed down this far
+	static constexpr uint16_t search_granularity = 32;
+	/// Time after which a completed search looks for a larger MTU again
+	static constexpr uint64_t raise_interval = 600000;
+	/// Time between base size probes in the error state
+	static constexpr uint64_t error_interval = 10000;
+	/// Consecutive losses of full sized packets treated as a black hole
+	static constexpr size_t black_hole_losses = 8;
+	/// Consecutive timeouts with full sized packets in flight treated as a black hole
+	static constexpr size_t black_hole_timeouts = 2;
+
+private:
+	State state = State::Base;
+	uint16_t plpmtu = base_plpmtu;
+
+	/// Largest size known to work and smallest size known to fail during a search
+	uint16_t search_low = base_plpmtu;
+	uint16_t search_high = max_plpmtu + 1;
+
+	/// Size being probed and probes sent of it
+	uint16_t probe_size = 0;
+	size_t probe_count = 0;
+	/// Packet number of the outstanding probe
+	uint64_t probe_pn = -1;
+
+	/// Time at which probing resumes in the search complete and error states
+	uint64_t resume_time = 0;
+
+	// Black hole detection
+	/// Full sized packets lost and timeouts since one was last acked
+	size_t full_size_losses = 0;
+	size_t full_size_timeouts = 0;
+	/// Largest packet number of an acked full sized packet
+	uint64_t largest_full_size_acked = 0;
+
+	void start_search() {
+		state = State::Searching;
+		search_low = plpmtu;
+		search_high = max_plpmtu + 1;
+		probe_count = 0;
+	}
+
+public:
+	/// Largest datagram payload size to send
+	uint16_t get_plpmtu() const {
+		return plpmtu;
+	}
+
+	State get_state() const {
+		return state;
+	}
+
+	/// Whether a probe is waiting for an ack
+	bool is_probing() const {
+		return probe_pn != uint64_t(-1);
+	}
+
+	/// Packet number of the outstanding probe, -1 if none
+	uint64_t probe_packet_number() const {
+		return probe_pn;
+	}
+
+	/// Size of the next probe to send, 0 if none is due
+	uint16_t next_probe_size(uint64_t now) {
+		if(is_probing()) {
+			return 0;
+		}
+
+		switch(state) {
+			case State::Base:
+				probe_size = base_plpmtu;
+				break;
+			case State::Error:
+				if(now < resume_time) {
+					return 0;
+				}
+				probe_size = base_plpmtu;
+				break;
+			case State::SearchComplete:
+				if(now < resume_time) {
+					return 0;
+				}
+				start_search();
+				[[fallthrough]];
+			case State::Searching: {
+				if(search_high - search_low <= search_granularity) {
+					state = State::SearchComplete;
+					resume_time = now + raise_interval;
+					return 0;
+				}
+
+				// Optimistic about the largest size, most paths either support it or are close to the base
+				uint16_t size = search_high > max_plpmtu ? max_plpmtu : (search_low + search_high) / 2;
+				if(size != probe_size) {
+					probe_size = size;
+					probe_count = 0;
+				}
+				break;
+			}
+		}
+
+		return probe_size;
+	}
+
+	/// Time at which next_probe_size might return a probe without any other events
+	uint64_t next_probe_time() const {
+		return resume_time;
+	}
+
+	void on_probe_sent(uint64_t pn) {
+		probe_pn = pn;
+		probe_count++;
+	}
+
+	void on_probe_acked() {
+		// Probes are full sized packets as well
+		if(probe_pn > largest_full_size_acked) {
+			largest_full_size_acked = probe_pn;
+		}
+		full_size_losses = 0;
+		full_size_timeouts = 0;
+
+		probe_pn = -1;
+		probe_count = 0;
+
+		if(state == State::Searching) {
+			plpmtu = probe_size;
+			search_low = probe_size;
+		} else if(state == State::Base || state == State::Error) {
+			plpmtu = base_plpmtu;
+			start_search();
+		}
+	}
+
+	/// The outstanding probe was not acked in time
+	void on_probe_lost(uint64_t now) {
+		probe_pn = -1;
+		if(probe_count < max_probes && state != State::Error) {
+			// Retry the same size
+			return;
+		}
+		probe_count = 0;
+
+		if(state == State::Searching) {
+			search_high = probe_size;
+		} else if(state == State::Base || state == State::Error) {
+			state = State::Error;
+			plpmtu = min_plpmtu;
+			resume_time = now + error_interval;
+		}
+	}
+
+	/// A data packet of the given datagram size was acked
+	void on_packet_acked(uint64_t pn, uint64_t size) {
+		// Path is not dead, losses of full sized packets tell black holes apart from here on
+		full_size_timeouts = 0;
+
+		if(size >= plpmtu) {
+			full_size_losses = 0;
+			if(pn > largest_full_size_acked) {
+				largest_full_size_acked = pn;
+			}
+		}
+	}
+
+	/// A data packet of the given datagram size was lost, returns true if the MTU dropped
+	bool on_packet_lost(uint64_t pn, uint64_t size, uint64_t now) {
+		// Full sized packets sent later got through, congestion loss
+		if(size < plpmtu || plpmtu == min_plpmtu || pn < largest_full_size_acked) {
+			return false;
+		}
+
+		if(++full_size_losses < black_hole_losses) {
+			return false;
+		}
+
+		return on_black_hole(now);
+	}
+
+	/// Nothing was acked before a timeout, returns true if the MTU dropped
+	///
+	/// Counted once per timeout instead of once per packet in flight,
+	/// a single timeout after a burst of congestion loss is common.
+	/// Catches paths where every packet is full sized and none get through.
+	bool on_timeout(uint64_t largest_in_flight, uint64_t now) {
+		if(largest_in_flight < plpmtu || plpmtu == min_plpmtu) {
+			return false;
+		}
+
+		if(++full_size_timeouts < black_hole_timeouts) {
+			return false;
+		}
+
+		return on_black_hole(now);
+	}
+
+private:
+	bool on_black_hole(uint64_t now) {
+		full_size_losses = 0;
+		full_size_timeouts = 0;
+
+		// Fall back to the base size and confirm it, or to the minimum if the base size is broken
+		probe_pn = -1;
+		probe_count = 0;
+		if(plpmtu > base_plpmtu) {
+			state = State::Base;
+			plpmtu = base_plpmtu;
+		} else {
+			state = State::Error;
+			plpmtu = min_plpmtu;
+			resume_time = now + error_interval;
+		}
+
+		return true;
+	}
+};
+
+} // namespace stream
+} // namespace marlin
+
+#endif // MARLIN_STREAM_PMTU_DISCOVERY_HPP
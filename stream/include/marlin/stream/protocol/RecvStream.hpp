@@ -2,9 +2,17 @@
 #define MARLIN_STREAM_RECVSTREAM_HPP
 
 #include <marlin/asyncio/core/Timer.hpp>
+#include <marlin/core/Buffer.hpp>
 
+#include "Fec.hpp"
+#include "FlowControl.hpp"
+
+#include <algorithm>
+#include <cstring>
 #include <ctime>
+#include <map>
 #include <memory>
+#include <vector>
 
 namespace marlin {
 namespace stream {
@@ -117,6 +125,8 @@ struct RecvStream {
 
 	/// Offset marking application read position on the stream
 	uint64_t read_offset = 0;
+	/// Credit extended to the sender, moves along with the read offset
+	RecvWindow window = RecvWindow(RecvWindow::stream_window);
 
 	/// Check if all data on stream has been read by application
 	bool check_read() const {
@@ -127,6 +137,129 @@ struct RecvStream {
 		return this->read_offset == this->size;
 	}
 
+	// Whole stream reassembly
+	/// Is the stream delivered whole instead of in order?
+	bool whole = false;
+	/// Contiguous buffer fragments of a whole stream are written into at their offsets
+	core::Buffer assembly = core::Buffer(nullptr, 0);
+	/// Disjoint received byte ranges [first, second) of a whole stream in increasing order
+	std::vector<std::pair<uint64_t, uint64_t>> assembled;
+
+	/// Largest whole stream accepted, larger streams are dropped
+	static constexpr uint64_t max_whole_size = 5000000;
+
+	/// Copy a fragment of a whole stream into place, false if it does not fit the stream
+	bool assemble(uint64_t offset, core::Buffer const &bytes) {
+		auto end = offset + bytes.size();
+		if(end > (state == State::Recv ? max_whole_size : size)) {
+			return false;
+		}
+
+		// Size is exact once known, until then grow geometrically
+		if(end > assembly.size()) {
+			uint64_t capacity = state == State::Recv ? std::max<uint64_t>(2 * assembly.size(), 65536) : size;
+			capacity = std::min(std::max(capacity, end), state == State::Recv ? max_whole_size : size);
+
+			core::Buffer grown(capacity);
+			if(assembled.size() > 0) {
+				std::memcpy(grown.data(), assembly.data(), assembled.back().second);
+			}
+			assembly = std::move(grown);
+		}
+		bytes.read_unsafe(0, assembly.data() + offset, bytes.size());
+
+		// First range starting after the fragment
+		auto next = std::upper_bound(
+			assembled.begin(),
+			assembled.end(),
+			offset,
+			[](uint64_t offset, std::pair<uint64_t, uint64_t> const& range) {
+				return offset < range.first;
+			}
+		);
+
+		// Merge with previous range if touching, else insert
+		if(next != assembled.begin() && std::prev(next)->second >= offset) {
+			next = std::prev(next);
+			next->second = std::max(next->second, end);
+		} else {
+			next = assembled.insert(next, {offset, end});
+		}
+
+		// Absorb following ranges covered by the fragment
+		auto last = std::next(next);
+		while(last != assembled.end() && last->first <= next->second) {
+			next->second = std::max(next->second, last->second);
+			last++;
+		}
+		assembled.erase(std::next(next), last);
+
+		return true;
+	}
+
+	/// Check if all data of a whole stream has been assembled
+	bool check_assembled() const {
+		return state != State::Recv && assembled.size() == 1 &&
+			assembled.front().first == 0 && assembled.front().second == size;
+	}
+
+	/// Check if the given range of a whole stream has been assembled
+	bool is_assembled(uint64_t begin, uint64_t end) const {
+		auto next = std::upper_bound(
+			assembled.begin(),
+			assembled.end(),
+			begin,
+			[](uint64_t offset, std::pair<uint64_t, uint64_t> const& range) {
+				return offset < range.first;
+			}
+		);
+
+		return next != assembled.begin() && std::prev(next)->second >= end;
+	}
+
+	/// Repair groups of a whole stream missing several fragments, retried as fragments arrive
+	std::map<uint64_t, FecGroup> fec_groups;
+	/// Most repair groups kept per stream
+	static constexpr size_t max_fec_groups = 64;
+
+	/// Rebuild the only missing fragment of a repair group from the assembled ones.
+	/// Returns the number of missing fragments, the fragment is only set if it is 1.
+	uint32_t recover(FecGroup const &group, uint64_t &offset, core::Buffer &fragment) const {
+		uint32_t missing = 0;
+		uint32_t missing_idx = 0;
+		for(uint32_t i = 0; i < group.count(); i++) {
+			auto begin = group.fragment_offset(i);
+			if(!is_assembled(begin, begin + group.fragment_length(i))) {
+				missing++;
+				missing_idx = i;
+			}
+		}
+
+		if(missing != 1) {
+			return missing;
+		}
+
+		offset = group.fragment_offset(missing_idx);
+		auto length = group.fragment_length(missing_idx);
+		fragment = core::Buffer(length);
+		std::memcpy(fragment.data(), group.parity.data(), length);
+
+		// Padding of shorter fragments is zero, only their bytes matter
+		for(uint32_t i = 0; i < group.count(); i++) {
+			if(i == missing_idx) {
+				continue;
+			}
+
+			auto* data = assembly.data() + group.fragment_offset(i);
+			auto xor_length = std::min(length, group.fragment_length(i));
+			for(uint16_t j = 0; j < xor_length; j++) {
+				fragment.data()[j] ^= data[j];
+			}
+		}
+
+		return 1;
+	}
+
 	/// Timer interval for the state timer
 	uint64_t state_timer_interval = 1000;
 	/// Timer to retry SKIPSTREAM
@@ -0,0 +1,159 @@
+#ifndef MARLIN_STREAM_SENDQUEUE_HPP
+#define MARLIN_STREAM_SENDQUEUE_HPP
+
+#include "SendStream.hpp"
+
+#include <algorithm>
+#include <array>
+#include <deque>
+#include <set>
+#include <tuple>
+
+namespace marlin {
+namespace stream {
+
+/// Send streams with data ready to be sent, in the order they are to be served
+///
+/// Streams of a more urgent priority class are always served first. Within a class,
+/// streams share bandwidth in proportion to their weights through start time fair queueing:
+/// serving a stream advances its virtual time by the bytes sent over its weight, and the
+/// stream with the smallest virtual time goes next. Streams joining the queue start at the
+/// virtual time of the stream served last, so idle streams do not build up credit.
+///
+/// Whole streams are of no use to the destination until complete, so those of a class are served
+/// one at a time in the order they joined instead of sharing bandwidth among themselves. Sharing
+/// would delay all of them and leave partial streams holding up the connection credit.
+class SendQueue {
+	struct Order {
+		bool operator()(SendStream const* a, SendStream const* b) const {
+			return std::tie(a->priority, a->virtual_time, a->stream_id) <
+				std::tie(b->priority, b->virtual_time, b->stream_id);
+		}
+	};
+
+	std::set<SendStream *, Order> streams;
+	/// Virtual time of each priority class, the virtual time of the stream served last
+	std::array<uint64_t, SendStream::num_priorities> class_time = {};
+	/// Whole stream of each class being served, it is the only whole stream of the class in streams
+	std::array<SendStream *, SendStream::num_priorities> whole_streams = {};
+	/// Whole streams of each class waiting for the one being served to leave the queue
+	std::array<std::deque<SendStream *>, SendStream::num_priorities> waiting_whole_streams;
+	size_t num_waiting = 0;
+
+	void insert(SendStream &stream) {
+		stream.virtual_time = std::max(stream.virtual_time, class_time[stream.priority]);
+		streams.insert(&stream);
+	}
+
+	/// Serve the next waiting whole stream of the class once the one being served leaves
+	void on_leave(SendStream &stream) {
+		if(whole_streams[stream.priority] != &stream) {
+			return;
+		}
+		whole_streams[stream.priority] = nullptr;
+
+		auto &waiting = waiting_whole_streams[stream.priority];
+		if(!waiting.empty()) {
+			whole_streams[stream.priority] = waiting.front();
+			insert(*waiting.front());
+			waiting.pop_front();
+			num_waiting--;
+		}
+	}
+
+public:
+	/// Virtual time taken by a byte at weight 1
+	static constexpr uint64_t weight_scale = 65536;
+
+	/// Add the given stream, false if it is already queued
+	bool push(SendStream &stream) {
+		if(streams.find(&stream) != streams.end()) {
+			return false;
+		}
+
+		if(stream.whole) {
+			auto &waiting = waiting_whole_streams[stream.priority];
+			if(std::find(waiting.begin(), waiting.end(), &stream) != waiting.end()) {
+				return false;
+			}
+
+			if(whole_streams[stream.priority] != nullptr) {
+				waiting.push_back(&stream);
+				num_waiting++;
+				return true;
+			}
+			whole_streams[stream.priority] = &stream;
+		}
+
+		insert(stream);
+
+		return true;
+	}
+
+	/// Remove the given stream, false if it is not queued
+	bool erase(SendStream &stream) {
+		if(streams.erase(&stream) > 0) {
+			on_leave(stream);
+			return true;
+		}
+
+		if(stream.whole) {
+			auto &waiting = waiting_whole_streams[stream.priority];
+			auto iter = std::find(waiting.begin(), waiting.end(), &stream);
+			if(iter != waiting.end()) {
+				waiting.erase(iter);
+				num_waiting--;
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	/// Stream to be served next
+	SendStream &front() const {
+		return **streams.begin();
+	}
+
+	/// Charge the stream being served for the given bytes, it moves behind streams it got ahead of
+	void on_send(uint64_t bytes) {
+		auto node = streams.extract(streams.begin());
+		auto &stream = *node.value();
+
+		class_time[stream.priority] = stream.virtual_time;
+		stream.virtual_time += bytes * weight_scale / stream.weight;
+
+		streams.insert(std::move(node));
+	}
+
+	/// Remove the stream being served
+	void pop() {
+		auto &stream = **streams.begin();
+		streams.erase(streams.begin());
+		on_leave(stream);
+	}
+
+	/// Waiting whole streams always have one of their class being served
+	bool empty() const {
+		return streams.empty();
+	}
+
+	size_t size() const {
+		return streams.size() + num_waiting;
+	}
+
+	void clear() {
+		streams.clear();
+		class_time = {};
+		whole_streams = {};
+		for(auto &waiting : waiting_whole_streams) {
+			waiting.clear();
+		}
+		num_waiting = 0;
+	}
+};
+
+} // namespace stream
+} // namespace marlin
+
+#endif // MARLIN_STREAM_SENDQUEUE_HPP
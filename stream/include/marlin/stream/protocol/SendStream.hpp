@@ -9,15 +9,26 @@
 #include <list>
 #include <ctime>
 #include <map>
+#include <cstring>
+#include <algorithm>
 #include <marlin/asyncio/core/Timer.hpp>
+#include <marlin/core/SharedBuffer.hpp>
+
+#include "Fec.hpp"
+#include "FlowControl.hpp"
 
 namespace marlin {
 namespace stream {
 
 /// Struct to store data (and its params) which is queued to the output/send stream
+///
+/// Data consists of an owned buffer followed by an optional shared buffer,
+/// the shared part is referenced instead of copied so it can be queued on many streams
 struct DataItem {
 	/// Data buffer which is to be sent
 	core::Buffer data;
+	/// Shared data which is to be sent after the data buffer
+	core::SharedBuffer shared_data;
 	/// Offset in buffer which has already been sent at least once
 	uint64_t sent_offset = 0;
 	/// Offset of the start of the data buffer in the stream
@@ -28,6 +39,44 @@ struct DataItem {
 		core::Buffer &&_data,
 		uint64_t _stream_offset
 	) : data(std::move(_data)), stream_offset(_stream_offset) {}
+
+	/// Constructor with shared data
+	DataItem(
+		core::Buffer &&_data,
+		core::SharedBuffer const &_shared_data,
+		uint64_t _stream_offset
+	) : data(std::move(_data)), shared_data(_shared_data), stream_offset(_stream_offset) {}
+
+	/// Total size of the item
+	uint64_t size() const {
+		return data.size() + shared_data.size();
+	}
+
+	/// Copy length bytes starting at offset into out
+	void read_unsafe(uint64_t offset, uint8_t *out, uint64_t length) const {
+		if(offset < data.size()) {
+			auto dlen = std::min<uint64_t>(length, data.size() - offset);
+			std::memcpy(out, data.data() + offset, dlen);
+
+			out += dlen;
+			offset += dlen;
+			length -= dlen;
+		}
+
+		if(length > 0) {
+			std::memcpy(out, shared_data.data() + (offset - data.size()), length);
+		}
+	}
+
+	/// Number of bytes of the given range which lie in the data buffer
+	uint64_t owned_length(uint64_t offset, uint64_t length) const {
+		return offset < data.size() ? std::min<uint64_t>(length, data.size() - offset) : 0;
+	}
+
+	/// View of the given range, which must lie entirely in the shared data
+	core::SharedBuffer shared_slice(uint64_t offset, uint64_t length) const {
+		return shared_data.slice(offset - data.size(), length);
+	}
 };
 
 struct SendStream;
@@ -36,7 +85,7 @@ struct SendStream;
 struct SentPacketInfo {
 	/// Time it was sent (relative to arbitrary epoch)
 	uint64_t sent_time;
-	/// Stream it was sent on
+	/// Stream it was sent on, nullptr for datagrams
 	SendStream *stream;
 	/// Data item whose data was sent
 	DataItem *data_item;
@@ -44,6 +93,10 @@ struct SentPacketInfo {
 	uint64_t offset;
 	/// Length of the data sent
 	uint16_t length;
+	/// Bytes delivered when it was sent, used by congestion control for delivery rate samples
+	uint64_t delivered = 0;
+	/// Time delivered was last updated when it was sent
+	uint64_t delivered_time = 0;
 
 	/// Constructor
 	SentPacketInfo(
@@ -120,6 +173,32 @@ struct SendStream {
 
 	/// Is the application done adding data to the queue?
 	bool done_queueing = false;
+	/// Is the stream to be delivered whole to the destination?
+	bool whole = false;
+	/// Are repair packets sent for the stream?
+	bool is_fec = false;
+	/// Repair group being built out of sent fragments
+	FecEncoder fec;
+
+	// Scheduling
+	/// Number of priority classes
+	static constexpr uint8_t num_priorities = 8;
+	/// Priority class of new streams
+	static constexpr uint8_t default_priority = 3;
+	/// Weight of new streams
+	static constexpr uint16_t default_weight = 16;
+	/// Priority class, lower classes are served first
+	uint8_t priority = default_priority;
+	/// Share of bandwidth relative to other streams of its class
+	uint16_t weight = default_weight;
+	/// Virtual time used to share bandwidth within a class
+	uint64_t virtual_time = 0;
+
+	// Flow control
+	/// Offset the destination takes data up to
+	uint64_t max_offset = RecvWindow::stream_window;
+	/// Is the stream out of the send queue waiting for more credit?
+	bool is_blocked = false;
 
 	/// Offset of end of acked data in the stream
 	uint64_t acked_offset = 0;
@@ -0,0 +1,222 @@
+#ifndef MARLIN_STREAM_SENT_PACKETS_HPP
+#define MARLIN_STREAM_SENT_PACKETS_HPP
+
+#include "SendStream.hpp"
+
+#include <algorithm>
+#include <vector>
+
+namespace marlin {
+namespace stream {
+
+/// Sent packet records which have not been acked yet, indexed by packet number.
+/// Packet numbers are dense and increasing, so records live in a ring at their packet number.
+/// Bitmaps track which records are in flight and which are lost, marking a packet lost does not move it.
+class SentPackets {
+private:
+	std::vector<SentPacketInfo> records;
+	std::vector<uint64_t> in_flight_bits;
+	std::vector<uint64_t> lost_bits;
+	uint64_t mask = 0;
+
+	/// Packet number of the oldest record
+	uint64_t first = 0;
+	/// One past the packet number of the newest record
+	uint64_t last = 0;
+
+	size_t in_flight_count = 0;
+	size_t lost_count = 0;
+
+	static bool test(std::vector<uint64_t> const &bits, uint64_t idx) {
+		return (bits[idx >> 6] >> (idx & 63)) & 1;
+	}
+
+	static void set(std::vector<uint64_t> &bits, uint64_t idx) {
+		bits[idx >> 6] |= uint64_t(1) << (idx & 63);
+	}
+
+	static void reset(std::vector<uint64_t> &bits, uint64_t idx) {
+		bits[idx >> 6] &= ~(uint64_t(1) << (idx & 63));
+	}
+
+	/// First packet number at or after pn whose bit is set, end if none
+	uint64_t next(std::vector<uint64_t> const &bits, uint64_t pn) const {
+		if(pn < first) {
+			pn = first;
+		}
+
+		while(pn < last) {
+			auto idx = pn & mask;
+			auto word = bits[idx >> 6] >> (idx & 63);
+			if(word != 0) {
+				pn += __builtin_ctzll(word);
+				return pn < last ? pn : last;
+			}
+
+			// Capacity is a multiple of 64, the next word follows even across the wrap
+			pn += 64 - (idx & 63);
+		}
+
+		return last;
+	}
+
+	void grow(uint64_t capacity) {
+		SentPackets grown;
+		grown.records.resize(capacity);
+		grown.in_flight_bits.resize(capacity / 64);
+		grown.lost_bits.resize(capacity / 64);
+		grown.mask = capacity - 1;
+		grown.first = first;
+		grown.last = last;
+		grown.in_flight_count = in_flight_count;
+		grown.lost_count = lost_count;
+
+		for(auto pn = first; pn < last; pn++) {
+			auto idx = pn & mask;
+			auto new_idx = pn & grown.mask;
+			grown.records[new_idx] = records[idx];
+			if(test(in_flight_bits, idx)) {
+				set(grown.in_flight_bits, new_idx);
+			}
+			if(test(lost_bits, idx)) {
+				set(grown.lost_bits, new_idx);
+			}
+		}
+
+		*this = std::move(grown);
+	}
+
+	/// Drop empty slots from the front
+	void trim() {
+		if(empty()) {
+			first = last;
+			return;
+		}
+
+		auto in_flight = next(in_flight_bits, first);
+		auto lost = next(lost_bits, first);
+		first = in_flight < lost ? in_flight : lost;
+	}
+
+public:
+	/// Record a sent packet, packet numbers must increase
+	void add(uint64_t pn, SentPacketInfo const &info) {
+		if(empty()) {
+			first = pn;
+			last = pn;
+		}
+
+		if(pn + 1 - first > records.size()) {
+			auto capacity = records.size() == 0 ? 256 : records.size();
+			while(capacity < pn + 1 - first) {
+				capacity *= 2;
+			}
+			grow(capacity);
+		}
+
+		auto idx = pn & mask;
+		records[idx] = info;
+		set(in_flight_bits, idx);
+		in_flight_count++;
+		last = pn + 1;
+	}
+
+	/// Record of a packet in flight, nullptr if it is not in flight
+	SentPacketInfo *in_flight(uint64_t pn) {
+		if(pn < first || pn >= last || !test(in_flight_bits, pn & mask)) {
+			return nullptr;
+		}
+
+		return &records[pn & mask];
+	}
+
+	/// Record of a packet in flight or lost, nullptr if neither
+	SentPacketInfo *find(uint64_t pn) {
+		if(pn < first || pn >= last) {
+			return nullptr;
+		}
+
+		auto idx = pn & mask;
+		if(!test(in_flight_bits, idx) && !test(lost_bits, idx)) {
+			return nullptr;
+		}
+
+		return &records[idx];
+	}
+
+	/// Record of a packet which is in flight or lost
+	SentPacketInfo &at(uint64_t pn) {
+		return records[pn & mask];
+	}
+
+	/// Move a packet in flight to lost
+	void mark_lost(uint64_t pn) {
+		auto idx = pn & mask;
+		reset(in_flight_bits, idx);
+		set(lost_bits, idx);
+		in_flight_count--;
+		lost_count++;
+	}
+
+	/// Remove the record of a packet which is in flight or lost
+	void erase(uint64_t pn) {
+		auto idx = pn & mask;
+		if(test(in_flight_bits, idx)) {
+			reset(in_flight_bits, idx);
+			in_flight_count--;
+		} else if(test(lost_bits, idx)) {
+			reset(lost_bits, idx);
+			lost_count--;
+		} else {
+			return;
+		}
+
+		if(pn == first) {
+			trim();
+		}
+	}
+
+	/// First packet in flight at or after pn, end() if none
+	uint64_t next_in_flight(uint64_t pn) const {
+		return next(in_flight_bits, pn);
+	}
+
+	/// First lost packet at or after pn, end() if none
+	uint64_t next_lost(uint64_t pn) const {
+		return next(lost_bits, pn);
+	}
+
+	uint64_t begin() const {
+		return first;
+	}
+
+	/// One past the newest packet number
+	uint64_t end() const {
+		return last;
+	}
+
+	size_t num_in_flight() const {
+		return in_flight_count;
+	}
+
+	size_t num_lost() const {
+		return lost_count;
+	}
+
+	bool empty() const {
+		return in_flight_count == 0 && lost_count == 0;
+	}
+
+	void clear() {
+		std::fill(in_flight_bits.begin(), in_flight_bits.end(), 0);
+		std::fill(lost_bits.begin(), lost_bits.end(), 0);
+		first = last;
+		in_flight_count = 0;
+		lost_count = 0;
+	}
+};
+
+} // namespace stream
+} // namespace marlin
+
+#endif // MARLIN_STREAM_SENT_PACKETS_HPP
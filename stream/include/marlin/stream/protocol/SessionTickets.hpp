@@ -0,0 +1,219 @@
+#ifndef MARLIN_STREAM_SESSIONTICKETS_HPP
+#define MARLIN_STREAM_SESSIONTICKETS_HPP
+
+#include <marlin/core/SocketAddress.hpp>
+
+#include <cstring>
+#include <stdint.h>
+#include <stddef.h>
+#include <unordered_map>
+#include <sodium.h>
+
+namespace marlin {
+namespace stream {
+
+/// Session tickets for resuming connections without a handshake
+///
+/// Servers hand out a ticket and a random resumption secret once a connection is established.
+/// The ticket is the client static key, the secret and the issue time sealed under a key only
+/// the server knows, so the server keeps no state per ticket. A client dialling the server again
+/// sends the ticket in its first flight and keys the connection from the secret straight away.
+///
+/// Tickets are single use. The server remembers redeemed tickets until they expire and refuses
+/// them after that, so a replayed first flight falls back to a full handshake. Both the client
+/// cache and the redeemed set are bounded. Times are in milliseconds.
+class SessionTickets {
+public:
+	/// Size of the resumption secret
+	static constexpr size_t secret_size = 32;
+	/// Size of the random value each resumption mixes into its keys
+	static constexpr size_t random_size = 32;
+	/// Size of a sealed ticket, nonce followed by the sealed client key, secret and issue time
+	static constexpr size_t ticket_size = crypto_secretbox_NONCEBYTES + crypto_secretbox_MACBYTES +
+		crypto_box_PUBLICKEYBYTES + secret_size + 8;
+	/// Tickets are accepted for this long after being issued
+	static constexpr uint64_t lifetime = 600000;
+	/// Tickets kept by a client, one per peer
+	static constexpr size_t max_tickets = 1024;
+	/// Redeemed tickets remembered by a server, resumption is refused while it is full
+	static constexpr size_t max_redeemed = 65536;
+
+private:
+	/// Ticket kept by a client for a peer
+	struct Ticket {
+		uint8_t ticket[ticket_size];
+		uint8_t secret[secret_size];
+		/// Static key of the server that issued it
+		uint8_t remote_static_pk[crypto_box_PUBLICKEYBYTES];
+		uint64_t received_time;
+	};
+
+	uint8_t key[crypto_secretbox_KEYBYTES];
+
+	std::unordered_map<core::SocketAddress, Ticket> tickets;
+	/// Expiry of redeemed tickets, by the leading nonce bytes of the ticket
+	std::unordered_map<uint64_t, uint64_t> redeemed;
+
+public:
+	SessionTickets() {
+		crypto_secretbox_keygen(key);
+	}
+
+	SessionTickets(SessionTickets const&) = delete;
+
+	~SessionTickets() {
+		sodium_memzero(key, sizeof(key));
+	}
+
+	//---------------- Server ----------------//
+
+	/// Issue a ticket for the given client, filling in the ticket and the secret it carries
+	void issue(uint8_t const* client_pk, uint8_t* ticket, uint8_t* secret, uint64_t now) {
+		randombytes_buf(secret, secret_size);
+
+		uint8_t pt[crypto_box_PUBLICKEYBYTES + secret_size + 8];
+		std::memcpy(pt, client_pk, crypto_box_PUBLICKEYBYTES);
+		std::memcpy(pt + crypto_box_PUBLICKEYBYTES, secret, secret_size);
+		std::memcpy(pt + crypto_box_PUBLICKEYBYTES + secret_size, &now, 8);
+
+		randombytes_buf(ticket, crypto_secretbox_NONCEBYTES);
+		crypto_secretbox_easy(ticket + crypto_secretbox_NONCEBYTES, pt, sizeof(pt), ticket, key);
+
+		sodium_memzero(pt, sizeof(pt));
+	}
+
+	/// Redeem a ticket presented by the given client, filling in its secret.
+	/// False if the ticket is forged, expired, issued to someone else or already redeemed.
+	bool redeem(uint8_t const* ticket, uint8_t const* client_pk, uint8_t* secret, uint64_t now) {
+		uint8_t pt[crypto_box_PUBLICKEYBYTES + secret_size + 8];
+		if(crypto_secretbox_open_easy(
+			pt,
+			ticket + crypto_secretbox_NONCEBYTES,
+			ticket_size - crypto_secretbox_NONCEBYTES,
+			ticket,
+			key
+		) != 0) {
+			return false;
+		}
+
+		uint64_t issued_time;
+		std::memcpy(&issued_time, pt + crypto_box_PUBLICKEYBYTES + secret_size, 8);
+		if(now < issued_time || now - issued_time >= lifetime ||
+			sodium_memcmp(pt, client_pk, crypto_box_PUBLICKEYBYTES) != 0) {
+			sodium_memzero(pt, sizeof(pt));
+			return false;
+		}
+
+		// Sealed tickets are unique by their random nonce
+		uint64_t id;
+		std::memcpy(&id, ticket, 8);
+		if(redeemed.size() >= max_redeemed) {
+			prune(now);
+		}
+		if(redeemed.size() >= max_redeemed || !redeemed.try_emplace(id, issued_time + lifetime).second) {
+			sodium_memzero(pt, sizeof(pt));
+			return false;
+		}
+
+		std::memcpy(secret, pt + crypto_box_PUBLICKEYBYTES, secret_size);
+		sodium_memzero(pt, sizeof(pt));
+
+		return true;
+	}
+
+	/// Forget redeemed tickets which would be refused as expired anyway
+	void prune(uint64_t now) {
+		for(auto iter = redeemed.begin(); iter != redeemed.end();) {
+			if(iter->second <= now) {
+				iter = redeemed.erase(iter);
+			} else {
+				iter++;
+			}
+		}
+	}
+
+	//---------------- Client ----------------//
+
+	/// Keep a ticket received from the given peer, replacing any older one.
+	/// The oldest ticket makes way once the cache is full.
+	void store(
+		core::SocketAddress const& addr,
+		uint8_t const* remote_static_pk,
+		uint8_t const* ticket,
+		uint8_t const* secret,
+		uint64_t now
+	) {
+		if(tickets.size() >= max_tickets && tickets.find(addr) == tickets.end()) {
+			auto oldest = tickets.begin();
+			for(auto iter = tickets.begin(); iter != tickets.end(); iter++) {
+				if(iter->second.received_time < oldest->second.received_time) {
+					oldest = iter;
+				}
+			}
+			tickets.erase(oldest);
+		}
+
+		auto &entry = tickets[addr];
+		std::memcpy(entry.ticket, ticket, ticket_size);
+		std::memcpy(entry.secret, secret, secret_size);
+		std::memcpy(entry.remote_static_pk, remote_static_pk, crypto_box_PUBLICKEYBYTES);
+		entry.received_time = now;
+	}
+
+	/// Take the ticket for the given peer out of the cache, false if there is no usable one
+	bool take(
+		core::SocketAddress const& addr,
+		uint8_t const* remote_static_pk,
+		uint8_t* ticket,
+		uint8_t* secret,
+		uint64_t now
+	) {
+		auto iter = tickets.find(addr);
+		if(iter == tickets.end()) {
+			return false;
+		}
+
+		auto &entry = iter->second;
+		// Tickets are tied to the key of the server, a different key means a different peer
+		bool is_usable = now - entry.received_time < lifetime &&
+			sodium_memcmp(entry.remote_static_pk, remote_static_pk, crypto_box_PUBLICKEYBYTES) == 0;
+		if(is_usable) {
+			std::memcpy(ticket, entry.ticket, ticket_size);
+			std::memcpy(secret, entry.secret, secret_size);
+		}
+
+		sodium_memzero(entry.secret, secret_size);
+		tickets.erase(iter);
+
+		return is_usable;
+	}
+
+	/// Number of tickets kept for peers
+	size_t size() const {
+		return tickets.size();
+	}
+
+	//---------------- Keys ----------------//
+
+	/// Derive the session keys of a resumed connection from its secret and random value
+	static void derive_keys(
+		uint8_t const* secret,
+		uint8_t const* random,
+		bool is_client,
+		uint8_t* rx,
+		uint8_t* tx
+	) {
+		uint8_t keys[2 * crypto_kx_SESSIONKEYBYTES];
+		crypto_generichash(keys, sizeof(keys), random, random_size, secret, secret_size);
+
+		std::memcpy(is_client ? tx : rx, keys, crypto_kx_SESSIONKEYBYTES);
+		std::memcpy(is_client ? rx : tx, keys + crypto_kx_SESSIONKEYBYTES, crypto_kx_SESSIONKEYBYTES);
+
+		sodium_memzero(keys, sizeof(keys));
+	}
+};
+
+} // namespace stream
+} // namespace marlin
+
+#endif // MARLIN_STREAM_SESSIONTICKETS_HPP
@@ -0,0 +1,68 @@
+#include <marlin/stream/protocol/AckRanges.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+
+using namespace marlin::stream;
+
+/// Packet numbers as a receiver sees them with some loss and reordering
+static std::vector<uint64_t> arrivals(size_t count, double loss, size_t reorder) {
+	std::mt19937_64 gen(42);
+	std::bernoulli_distribution lost(loss);
+	std::uniform_int_distribution<size_t> swap(0, reorder);
+
+	std::vector<uint64_t> pns;
+	pns.reserve(count);
+	for(uint64_t pn = 0; pn < count; pn++) {
+		if(!lost(gen)) {
+			pns.push_back(pn);
+		}
+	}
+
+	for(size_t i = 0; reorder > 0 && i < pns.size(); i++) {
+		auto j = i + swap(gen);
+		if(j < pns.size()) {
+			std::swap(pns[i], pns[j]);
+		}
+	}
+
+	return pns;
+}
+
+static void run(char const* name, std::vector<uint64_t> const& pns) {
+	constexpr size_t rounds = 20;
+
+	size_t ranges = 0;
+	auto start = std::chrono::steady_clock::now();
+	for(size_t round = 0; round < rounds; round++) {
+		AckRanges ack_ranges;
+		for(auto pn : pns) {
+			ack_ranges.add_packet_number(pn);
+		}
+		ranges += ack_ranges.size();
+	}
+	auto end = std::chrono::steady_clock::now();
+
+	auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+	std::printf(
+		"%-24s %8.2f ns/packet, %zu ranges\n",
+		name,
+		double(ns) / (rounds * pns.size()),
+		ranges / rounds
+	);
+}
+
+int main() {
+	spdlog::set_level(spdlog::level::off);
+
+	constexpr size_t count = 1000000;
+	run("in order", arrivals(count, 0, 0));
+	run("1% loss", arrivals(count, 0.01, 0));
+	run("5% loss, reorder 64", arrivals(count, 0.05, 64));
+	run("20% loss, reorder 1024", arrivals(count, 0.2, 1024));
+
+	return 0;
+}
@@ -1,101 +1,132 @@
 #include "gtest/gtest.h"
 #include <marlin/stream/protocol/AckRanges.hpp>
 
+#include <vector>
+
 
 using namespace marlin::stream;
 
+static std::vector<uint64_t> runs(AckRanges const& ranges, size_t idx = 0) {
+	return std::vector<uint64_t>(ranges.runs_begin(idx), ranges.runs_end());
+}
+
+// Seen 10, not seen 5-9, seen 0-4
+static AckRanges split_ranges() {
+	AckRanges ranges;
+	for(uint64_t i = 0; i < 5; i++) {
+		ranges.add_packet_number(i);
+	}
+	ranges.add_packet_number(10);
+
+	return ranges;
+}
+
 TEST(AckRangesTest, First) {
 	AckRanges ranges;
 
 	ranges.add_packet_number(10);
 
-	EXPECT_EQ(ranges.largest, 10);
-	EXPECT_EQ(ranges.ranges, std::list<uint64_t>({1}));
+	EXPECT_EQ(ranges.largest(), 10u);
+	EXPECT_EQ(runs(ranges), std::vector<uint64_t>({1}));
 }
 
 TEST(AckRangesTest, Largest) {
 	AckRanges ranges;
-	ranges.largest = 4;
-	ranges.ranges.push_back(5);
+	for(uint64_t i = 0; i < 5; i++) {
+		ranges.add_packet_number(i);
+	}
 
 	ranges.add_packet_number(10);
 
-	EXPECT_EQ(ranges.largest, 10);
-	EXPECT_EQ(ranges.ranges, std::list<uint64_t>({1, 5, 5}));
+	EXPECT_EQ(ranges.largest(), 10u);
+	EXPECT_EQ(runs(ranges), std::vector<uint64_t>({1, 5, 5}));
 }
 
 TEST(AckRangesTest, Existing) {
-	AckRanges ranges;
-	ranges.largest = 10;
-	ranges.ranges.push_back(1);
-	ranges.ranges.push_back(5);
-	ranges.ranges.push_back(5);
+	auto ranges = split_ranges();
 
 	ranges.add_packet_number(3);
+	ranges.add_packet_number(10);
 
-	EXPECT_EQ(ranges.largest, 10);
-	EXPECT_EQ(ranges.ranges, std::list<uint64_t>({1, 5, 5}));
+	EXPECT_EQ(ranges.largest(), 10u);
+	EXPECT_EQ(runs(ranges), std::vector<uint64_t>({1, 5, 5}));
 }
 
 TEST(AckRangesTest, BeginningOfGap) {
-	AckRanges ranges;
-	ranges.largest = 10;
-	ranges.ranges.push_back(1);
-	ranges.ranges.push_back(5);
-	ranges.ranges.push_back(5);
+	auto ranges = split_ranges();
 
 	ranges.add_packet_number(9);
 
-	EXPECT_EQ(ranges.largest, 10);
-	EXPECT_EQ(ranges.ranges, std::list<uint64_t>({2, 4, 5}));
+	EXPECT_EQ(ranges.largest(), 10u);
+	EXPECT_EQ(runs(ranges), std::vector<uint64_t>({2, 4, 5}));
 }
 
 TEST(AckRangesTest, EndOfGap) {
-	AckRanges ranges;
-	ranges.largest = 10;
-	ranges.ranges.push_back(1);
-	ranges.ranges.push_back(5);
-	ranges.ranges.push_back(5);
+	auto ranges = split_ranges();
 
 	ranges.add_packet_number(5);
 
-	EXPECT_EQ(ranges.largest, 10);
-	EXPECT_EQ(ranges.ranges, std::list<uint64_t>({1, 4, 6}));
+	EXPECT_EQ(ranges.largest(), 10u);
+	EXPECT_EQ(runs(ranges), std::vector<uint64_t>({1, 4, 6}));
 }
 
 TEST(AckRangesTest, MiddleOfGap) {
-	AckRanges ranges;
-	ranges.largest = 10;
-	ranges.ranges.push_back(1);
-	ranges.ranges.push_back(5);
-	ranges.ranges.push_back(5);
+	auto ranges = split_ranges();
 
 	ranges.add_packet_number(7);
 
-	EXPECT_EQ(ranges.largest, 10);
-	EXPECT_EQ(ranges.ranges, std::list<uint64_t>({1, 2, 1, 2, 5}));
+	EXPECT_EQ(ranges.largest(), 10u);
+	EXPECT_EQ(runs(ranges), std::vector<uint64_t>({1, 2, 1, 2, 5}));
 }
 
 TEST(AckRangesTest, FillGap) {
 	AckRanges ranges;
-	ranges.largest = 10;
-	ranges.ranges.push_back(5);
-	ranges.ranges.push_back(1);
-	ranges.ranges.push_back(5);
+	for(uint64_t i = 0; i < 5; i++) {
+		ranges.add_packet_number(i);
+	}
+	for(uint64_t i = 6; i <= 10; i++) {
+		ranges.add_packet_number(i);
+	}
 
 	ranges.add_packet_number(5);
 
-	EXPECT_EQ(ranges.largest, 10);
-	EXPECT_EQ(ranges.ranges, std::list<uint64_t>({11}));
+	EXPECT_EQ(ranges.largest(), 10u);
+	EXPECT_EQ(ranges.size(), 1u);
+	EXPECT_EQ(runs(ranges), std::vector<uint64_t>({11}));
 }
 
 TEST(AckRangesTest, Last) {
 	AckRanges ranges;
-	ranges.largest = 10;
-	ranges.ranges.push_back(5);
+	for(uint64_t i = 6; i <= 10; i++) {
+		ranges.add_packet_number(i);
+	}
 
 	ranges.add_packet_number(3);
 
-	EXPECT_EQ(ranges.largest, 10);
-	EXPECT_EQ(ranges.ranges, std::list<uint64_t>({5, 2, 1}));
+	EXPECT_EQ(ranges.largest(), 10u);
+	EXPECT_EQ(runs(ranges), std::vector<uint64_t>({5, 2, 1}));
+}
+
+TEST(AckRangesTest, RunsFromRange) {
+	AckRanges ranges;
+	// Every other packet, newest range is 20
+	for(uint64_t i = 0; i <= 20; i += 2) {
+		ranges.add_packet_number(i);
+	}
+
+	EXPECT_EQ(ranges.size(), 11u);
+	EXPECT_EQ(ranges.range(3).high, 14u);
+	EXPECT_EQ(ranges.num_runs(3, 2), 3u);
+	EXPECT_EQ(ranges.num_runs(9), 3u);
+	EXPECT_EQ(runs(ranges, 9), std::vector<uint64_t>({1, 1, 1}));
+}
+
+TEST(AckRangesTest, DropsOldest) {
+	AckRanges ranges;
+	for(uint64_t i = 0; i < 2 * (AckRanges::max_ranges + 10); i += 2) {
+		ranges.add_packet_number(i);
+	}
+
+	EXPECT_EQ(ranges.size(), AckRanges::max_ranges);
+	EXPECT_EQ(ranges.range(AckRanges::max_ranges - 1).low, 20u);
 }
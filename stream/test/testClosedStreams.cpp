@@ -0,0 +1,57 @@
+#include "gtest/gtest.h"
+#include <marlin/stream/protocol/ClosedStreams.hpp>
+
+
+using namespace marlin;
+using namespace marlin::stream;
+
+TEST(ClosedStreams, Contains) {
+	ClosedStreams closed;
+
+	closed.close(1, 1000);
+	closed.close(2, 1000);
+
+	EXPECT_TRUE(closed.contains(1, 1000));
+	EXPECT_TRUE(closed.contains(2, 1000));
+	EXPECT_FALSE(closed.contains(3, 1000));
+	EXPECT_EQ(closed.size(), 2u);
+}
+
+TEST(ClosedStreams, Expiry) {
+	ClosedStreams closed;
+
+	closed.close(1, 1000);
+	closed.close(2, 2000);
+
+	EXPECT_TRUE(closed.contains(1, 1000 + ClosedStreams::expiry - 1));
+	EXPECT_FALSE(closed.contains(1, 1000 + ClosedStreams::expiry));
+	EXPECT_TRUE(closed.contains(2, 1000 + ClosedStreams::expiry));
+	EXPECT_EQ(closed.size(), 1u);
+
+	EXPECT_FALSE(closed.contains(2, 2000 + ClosedStreams::expiry));
+	EXPECT_EQ(closed.size(), 0u);
+}
+
+TEST(ClosedStreams, Refresh) {
+	ClosedStreams closed;
+
+	closed.close(1, 1000);
+	closed.close(1, 5000);
+
+	// Earlier record does not expire the refreshed one
+	EXPECT_TRUE(closed.contains(1, 1000 + ClosedStreams::expiry));
+	EXPECT_FALSE(closed.contains(1, 5000 + ClosedStreams::expiry));
+}
+
+TEST(ClosedStreams, Erase) {
+	ClosedStreams closed;
+
+	closed.close(1, 1000);
+	closed.erase(1);
+	EXPECT_FALSE(closed.contains(1, 1000));
+
+	// Stale entry of the erased record does not expire a later one
+	closed.close(1, 2000);
+	EXPECT_TRUE(closed.contains(1, 1000 + ClosedStreams::expiry));
+	EXPECT_FALSE(closed.contains(1, 2000 + ClosedStreams::expiry));
+}
@@ -0,0 +1,48 @@
+#include "gtest/gtest.h"
+#include <marlin/stream/protocol/ConnectionIds.hpp>
+
+
+using namespace marlin;
+using namespace marlin::stream;
+
+struct Transport {};
+
+TEST(ConnectionIds, AddGet) {
+	Transport a, b;
+	ConnectionIds<Transport> conn_ids;
+
+	EXPECT_TRUE(conn_ids.add(1, &a));
+	EXPECT_TRUE(conn_ids.add(2, &b));
+	EXPECT_EQ(conn_ids.get(1), &a);
+	EXPECT_EQ(conn_ids.get(2), &b);
+	EXPECT_EQ(conn_ids.get(3), nullptr);
+	EXPECT_EQ(conn_ids.size(), 2u);
+}
+
+TEST(ConnectionIds, NoZeroId) {
+	Transport a;
+	ConnectionIds<Transport> conn_ids;
+
+	EXPECT_FALSE(conn_ids.add(0, &a));
+	EXPECT_EQ(conn_ids.get(0), nullptr);
+	EXPECT_EQ(conn_ids.size(), 0u);
+}
+
+TEST(ConnectionIds, TakenId) {
+	Transport a, b;
+	ConnectionIds<Transport> conn_ids;
+
+	// First one keeps the id
+	EXPECT_TRUE(conn_ids.add(1, &a));
+	EXPECT_FALSE(conn_ids.add(1, &b));
+	EXPECT_EQ(conn_ids.get(1), &a);
+
+	// Others can not remove it
+	conn_ids.remove(1, &b);
+	EXPECT_EQ(conn_ids.get(1), &a);
+
+	conn_ids.remove(1, &a);
+	EXPECT_EQ(conn_ids.get(1), nullptr);
+	EXPECT_TRUE(conn_ids.add(1, &b));
+	EXPECT_EQ(conn_ids.get(1), &b);
+}
@@ -0,0 +1,154 @@
+#include "gtest/gtest.h"
+#include <marlin/stream/protocol/Fec.hpp>
+#include <marlin/stream/protocol/RecvStream.hpp>
+
+
+using namespace marlin;
+using namespace marlin::stream;
+
+struct Delegate {};
+
+static core::Buffer fragment(uint64_t offset, size_t size) {
+	core::Buffer bytes(size);
+	for(size_t i = 0; i < size; i++) {
+		bytes.data()[i] = ((offset + i) * 13 + (offset + i) / 251) & 0xff;
+	}
+
+	return bytes;
+}
+
+// Group over [offset, offset + length) in fragments of the given size
+static FecGroup encode(uint64_t offset, uint64_t length, uint16_t size) {
+	FecEncoder encoder;
+	for(uint64_t i = offset; i < offset + length; i += size) {
+		uint16_t dsize = std::min<uint64_t>(size, offset + length - i);
+		encoder.add(i, fragment(i, dsize).data(), dsize, size);
+	}
+	EXPECT_EQ(encoder.size(), (length + size - 1) / size);
+
+	return encoder.take(false);
+}
+
+TEST(FecEncoder, Group) {
+	auto group = encode(1000, 3500, 1000);
+
+	EXPECT_EQ(group.offset, 1000u);
+	EXPECT_EQ(group.end(), 4500u);
+	EXPECT_EQ(group.fragment(), 1000);
+	EXPECT_EQ(group.count(), 4u);
+	EXPECT_EQ(group.fragment_offset(3), 4000u);
+	EXPECT_EQ(group.fragment_length(3), 500);
+
+	// Fresh group after take
+	FecEncoder encoder;
+	encoder.add(0, fragment(0, 100).data(), 100, 100);
+	encoder.take(true);
+	EXPECT_EQ(encoder.size(), 0);
+	encoder.add(100, fragment(100, 50).data(), 50, 100);
+
+	auto next = encoder.take(true);
+	EXPECT_EQ(next.offset, 100u);
+	EXPECT_EQ(next.length, 50u);
+	EXPECT_TRUE(next.is_fin);
+}
+
+TEST(FecEncoder, SplitFragment) {
+	auto group = encode(0, 2500, 1000);
+
+	// Same parity with fragments split across a header and shared data
+	FecEncoder encoder;
+	auto bytes = fragment(0, 2500);
+	encoder.add(0, bytes.data(), 8, bytes.data() + 8, 992, 1000);
+	encoder.add(1000, nullptr, 0, bytes.data() + 1000, 1000, 1000);
+	encoder.add(2000, bytes.data() + 2000, 500, nullptr, 0, 1000);
+	auto split = encoder.take(false);
+
+	EXPECT_EQ(split.offset, group.offset);
+	EXPECT_EQ(split.length, group.length);
+	EXPECT_EQ(std::memcmp(split.parity.data(), group.parity.data(), 1000), 0);
+}
+
+TEST(FecRecover, EachFragment) {
+	auto group = encode(0, 3500, 1000);
+
+	for(uint32_t missing = 0; missing < group.count(); missing++) {
+		Delegate delegate;
+		RecvStream stream(1, &delegate);
+		stream.size = 3500;
+		stream.state = RecvStream::State::SizeKnown;
+
+		for(uint32_t i = 0; i < group.count(); i++) {
+			if(i != missing) {
+				auto offset = group.fragment_offset(i);
+				stream.assemble(offset, fragment(offset, group.fragment_length(i)));
+			}
+		}
+
+		uint64_t offset = 0;
+		core::Buffer recovered(nullptr, 0);
+		ASSERT_EQ(stream.recover(group, offset, recovered), 1u);
+		EXPECT_EQ(offset, group.fragment_offset(missing));
+
+		auto expected = fragment(offset, group.fragment_length(missing));
+		ASSERT_EQ(recovered.size(), expected.size());
+		EXPECT_EQ(std::memcmp(recovered.data(), expected.data(), expected.size()), 0);
+
+		stream.assemble(offset, recovered);
+		EXPECT_TRUE(stream.check_assembled());
+		EXPECT_EQ(stream.recover(group, offset, recovered), 0u);
+	}
+}
+
+TEST(FecRecover, SeveralMissing) {
+	Delegate delegate;
+	RecvStream stream(1, &delegate);
+	auto group = encode(2000, 4000, 1000);
+
+	stream.assemble(0, fragment(0, 3000));
+	stream.assemble(4000, fragment(4000, 1000));
+
+	uint64_t offset = 0;
+	core::Buffer recovered(nullptr, 0);
+	EXPECT_EQ(stream.recover(group, offset, recovered), 2u);
+
+	// Partially received fragments count as missing
+	stream.assemble(5000, fragment(5000, 500));
+	EXPECT_EQ(stream.recover(group, offset, recovered), 2u);
+
+	stream.assemble(5500, fragment(5500, 500));
+	ASSERT_EQ(stream.recover(group, offset, recovered), 1u);
+	EXPECT_EQ(offset, 3000u);
+	EXPECT_EQ(std::memcmp(recovered.data(), fragment(3000, 1000).data(), 1000), 0);
+}
+
+TEST(FecRate, AdaptsToLoss) {
+	FecRate rate;
+
+	// Clean path, fewest repairs
+	for(int i = 0; i < 10000; i++) {
+		rate.on_packet_acked();
+	}
+	EXPECT_EQ(rate.group_size(), FecRate::max_group_size);
+
+	// 10% loss, most repairs
+	for(int i = 0; i < 10000; i++) {
+		if(i % 10 == 0) {
+			rate.on_packet_lost();
+		} else {
+			rate.on_packet_acked();
+		}
+	}
+	EXPECT_NEAR(rate.get_loss_rate(), 0.1, 0.05);
+	EXPECT_EQ(rate.group_size(), FecRate::min_group_size);
+
+	// 1% loss in between
+	for(int i = 0; i < 10000; i++) {
+		if(i % 100 == 0) {
+			rate.on_packet_lost();
+		} else {
+			rate.on_packet_acked();
+		}
+	}
+	EXPECT_GT(rate.group_size(), FecRate::min_group_size);
+	EXPECT_LT(rate.group_size(), FecRate::max_group_size);
+}
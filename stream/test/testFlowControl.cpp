@@ -0,0 +1,102 @@
+#include "gtest/gtest.h"
+#include <marlin/stream/protocol/FlowControl.hpp>
+
+
+using namespace marlin;
+using namespace marlin::stream;
+
+TEST(RecvWindow, Construct) {
+	RecvWindow window(1000);
+
+	EXPECT_EQ(window.get_limit(), 1000u);
+	EXPECT_EQ(window.get_received(), 0u);
+	EXPECT_EQ(window.get_consumed(), 0u);
+	EXPECT_EQ(window.buffered(), 0u);
+}
+
+TEST(RecvWindow, CanRecvUpToLimit) {
+	RecvWindow window(1000);
+
+	EXPECT_TRUE(window.can_recv(999));
+	EXPECT_TRUE(window.can_recv(1000));
+	EXPECT_FALSE(window.can_recv(1001));
+}
+
+TEST(RecvWindow, OnRecvReturnsGrowth) {
+	RecvWindow window(1000);
+
+	EXPECT_EQ(window.on_recv(300), 300u);
+	EXPECT_EQ(window.on_recv(500), 200u);
+	// Reordered and duplicate data adds nothing
+	EXPECT_EQ(window.on_recv(400), 0u);
+	EXPECT_EQ(window.on_recv(500), 0u);
+
+	EXPECT_EQ(window.get_received(), 500u);
+	EXPECT_EQ(window.buffered(), 500u);
+}
+
+TEST(RecvWindow, UpdateAfterHalfWindow) {
+	RecvWindow window(1000);
+	window.on_recv(800);
+
+	window.on_consume(499);
+	EXPECT_FALSE(window.update());
+	EXPECT_EQ(window.get_limit(), 1000u);
+
+	window.on_consume(500);
+	EXPECT_TRUE(window.update());
+	EXPECT_EQ(window.get_limit(), 1500u);
+	EXPECT_EQ(window.buffered(), 300u);
+
+	// Nothing more to advertise until another half window is consumed
+	EXPECT_FALSE(window.update());
+	window.on_consume(1000);
+	EXPECT_TRUE(window.update());
+	EXPECT_EQ(window.get_limit(), 2000u);
+}
+
+TEST(RecvWindow, ConsumeNeverMovesBack) {
+	RecvWindow window(1000);
+	window.on_recv(800);
+	window.on_consume(600);
+	window.on_consume(300);
+
+	EXPECT_EQ(window.get_consumed(), 600u);
+}
+
+TEST(RecvWindow, SkippedDataCountsAsReceived) {
+	RecvWindow window(1000);
+	window.on_recv(200);
+	window.on_consume(700);
+
+	EXPECT_EQ(window.get_received(), 700u);
+	EXPECT_EQ(window.buffered(), 0u);
+	EXPECT_EQ(window.on_recv(600), 0u);
+}
+
+TEST(RecvWindow, GrowthOfNewDataOnly) {
+	RecvWindow window(1000);
+	window.on_recv(300);
+
+	EXPECT_EQ(window.growth(500), 200u);
+	EXPECT_EQ(window.growth(300), 0u);
+	EXPECT_EQ(window.growth(100), 0u);
+	// Growth is only looked at, not accounted
+	EXPECT_EQ(window.get_received(), 300u);
+}
+
+TEST(RecvWindow, ConnectionCreditAcrossStreams) {
+	RecvWindow connection(1000);
+	RecvWindow first(800), second(800);
+
+	EXPECT_TRUE(connection.can_recv(connection.get_received() + first.growth(700)));
+	connection.on_recv(connection.get_received() + first.on_recv(700));
+
+	// Within the stream credit but past what is left of the connection credit
+	EXPECT_TRUE(second.can_recv(400));
+	EXPECT_FALSE(connection.can_recv(connection.get_received() + second.growth(400)));
+	EXPECT_TRUE(connection.can_recv(connection.get_received() + second.growth(300)));
+
+	// Retransmissions take no further credit
+	EXPECT_TRUE(connection.can_recv(connection.get_received() + first.growth(700)));
+}
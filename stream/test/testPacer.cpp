@@ -0,0 +1,56 @@
+#include "gtest/gtest.h"
+#include <marlin/stream/congestion/Pacer.hpp>
+
+
+using namespace marlin::stream;
+
+TEST(PacerTest, SpacesPackets) {
+	Pacer pacer;
+	// 1000 bytes per ms, a 1000 byte packet every ms
+	pacer.set_rate(1000);
+
+	uint64_t now = 5000000;
+	auto departure = pacer.departure_time(now);
+	EXPECT_EQ(departure, now - Pacer::max_credit);
+
+	// Catches up by one tick worth of packets, then follows the rate
+	for(uint64_t i = 0; i < 5; i++) {
+		departure = pacer.departure_time(now);
+		EXPECT_EQ(departure, now - Pacer::max_credit + i * 1000000);
+		pacer.on_send(departure, 1000);
+	}
+	EXPECT_EQ(pacer.departure_time(now), now + 4000000);
+}
+
+TEST(PacerTest, SubMillisecondSpacing) {
+	Pacer pacer;
+	// 4 packets of 1250 bytes per ms
+	pacer.set_rate(5000);
+	pacer.on_send(10000000, 1250);
+
+	EXPECT_EQ(pacer.departure_time(10000000), 10250000);
+	pacer.on_send(10250000, 1250);
+	EXPECT_EQ(pacer.departure_time(10000000), 10500000);
+}
+
+TEST(PacerTest, BoundsCreditAfterIdle) {
+	Pacer pacer;
+	pacer.set_rate(1000);
+	pacer.on_send(1000000, 1000);
+	EXPECT_EQ(pacer.departure_time(1500000), 2000000);
+
+	// Idle for a long time, burst is limited to max_credit
+	EXPECT_EQ(pacer.departure_time(100000000), 100000000 - Pacer::max_credit);
+}
+
+TEST(PacerTest, RateChange) {
+	Pacer pacer;
+	pacer.set_rate(1000);
+	pacer.on_send(1000000, 1000);
+	EXPECT_EQ(pacer.departure_time(1000000), 2000000);
+
+	// New rate applies from the next packet
+	pacer.set_rate(2000);
+	pacer.on_send(2000000, 1000);
+	EXPECT_EQ(pacer.departure_time(1000000), 2500000);
+}
@@ -0,0 +1,136 @@
+#include "gtest/gtest.h"
+#include <marlin/stream/protocol/PmtuDiscovery.hpp>
+
+
+using namespace marlin::stream;
+
+// Runs probes against a path which delivers datagrams up to mtu
+static uint16_t search(PmtuDiscovery &pmtud, uint16_t mtu) {
+	uint64_t pn = 0;
+	for(uint64_t now = 0; now < 1000; now++) {
+		auto size = pmtud.next_probe_size(now);
+		if(size == 0) {
+			break;
+		}
+
+		pmtud.on_probe_sent(pn++);
+		if(size <= mtu) {
+			pmtud.on_probe_acked();
+		} else {
+			pmtud.on_probe_lost(now);
+		}
+	}
+
+	return pmtud.get_plpmtu();
+}
+
+TEST(PmtuDiscoveryTest, StartsAtBase) {
+	PmtuDiscovery pmtud;
+
+	EXPECT_EQ(pmtud.get_state(), PmtuDiscovery::State::Base);
+	EXPECT_EQ(pmtud.get_plpmtu(), PmtuDiscovery::base_plpmtu);
+	EXPECT_EQ(pmtud.next_probe_size(0), PmtuDiscovery::base_plpmtu);
+
+	// One probe at a time
+	pmtud.on_probe_sent(5);
+	EXPECT_TRUE(pmtud.is_probing());
+	EXPECT_EQ(pmtud.probe_packet_number(), 5u);
+	EXPECT_EQ(pmtud.next_probe_size(0), 0);
+
+	pmtud.on_probe_acked();
+	EXPECT_EQ(pmtud.get_state(), PmtuDiscovery::State::Searching);
+	EXPECT_EQ(pmtud.next_probe_size(0), PmtuDiscovery::max_plpmtu);
+}
+
+TEST(PmtuDiscoveryTest, FindsJumboFrames) {
+	PmtuDiscovery pmtud;
+
+	EXPECT_EQ(search(pmtud, 8972), PmtuDiscovery::max_plpmtu);
+	EXPECT_EQ(pmtud.get_state(), PmtuDiscovery::State::SearchComplete);
+}
+
+TEST(PmtuDiscoveryTest, FindsEthernet) {
+	PmtuDiscovery pmtud;
+
+	auto plpmtu = search(pmtud, 1472);
+	EXPECT_LE(plpmtu, 1472);
+	EXPECT_GT(plpmtu + PmtuDiscovery::search_granularity, 1472);
+	EXPECT_EQ(pmtud.get_state(), PmtuDiscovery::State::SearchComplete);
+
+	// Searched again after a while
+	EXPECT_EQ(pmtud.next_probe_size(PmtuDiscovery::raise_interval - 1), 0);
+	EXPECT_EQ(pmtud.next_probe_size(PmtuDiscovery::raise_interval + 1000), PmtuDiscovery::max_plpmtu);
+}
+
+TEST(PmtuDiscoveryTest, RetriesLostProbes) {
+	PmtuDiscovery pmtud;
+	pmtud.on_probe_sent(0);
+	pmtud.on_probe_acked();
+
+	auto size = pmtud.next_probe_size(0);
+	for(size_t i = 0; i < PmtuDiscovery::max_probes - 1; i++) {
+		pmtud.on_probe_sent(i + 1);
+		pmtud.on_probe_lost(0);
+		EXPECT_EQ(pmtud.next_probe_size(0), size);
+	}
+
+	pmtud.on_probe_sent(10);
+	pmtud.on_probe_lost(0);
+	EXPECT_LT(pmtud.next_probe_size(0), size);
+}
+
+TEST(PmtuDiscoveryTest, SmallPath) {
+	PmtuDiscovery pmtud;
+
+	// Base size does not get through
+	EXPECT_EQ(search(pmtud, 1300), PmtuDiscovery::min_plpmtu);
+	EXPECT_EQ(pmtud.get_state(), PmtuDiscovery::State::Error);
+
+	// Base size retried later
+	EXPECT_EQ(pmtud.next_probe_size(PmtuDiscovery::error_interval + 1000), PmtuDiscovery::base_plpmtu);
+}
+
+TEST(PmtuDiscoveryTest, BlackHole) {
+	PmtuDiscovery pmtud;
+	search(pmtud, 8972);
+
+	// Losses of packets sent before an acked one are congestion
+	pmtud.on_packet_acked(100, 8972);
+	for(uint64_t pn = 50; pn < 100; pn++) {
+		EXPECT_FALSE(pmtud.on_packet_lost(pn, 8972, 0));
+	}
+
+	// Small packets do not count
+	for(uint64_t pn = 101; pn < 120; pn++) {
+		EXPECT_FALSE(pmtud.on_packet_lost(pn, 1000, 0));
+	}
+
+	for(uint64_t pn = 120; pn < 120 + PmtuDiscovery::black_hole_losses - 1; pn++) {
+		EXPECT_FALSE(pmtud.on_packet_lost(pn, 8972, 0));
+	}
+	EXPECT_TRUE(pmtud.on_packet_lost(200, 8972, 0));
+
+	EXPECT_EQ(pmtud.get_plpmtu(), PmtuDiscovery::base_plpmtu);
+	EXPECT_EQ(pmtud.get_state(), PmtuDiscovery::State::Base);
+
+	// Path got smaller, the search finds the new size
+	auto plpmtu = search(pmtud, 4000);
+	EXPECT_LE(plpmtu, 4000);
+	EXPECT_GT(plpmtu + PmtuDiscovery::search_granularity, 4000);
+}
+
+TEST(PmtuDiscoveryTest, TimeoutBlackHole) {
+	PmtuDiscovery pmtud;
+	search(pmtud, 8972);
+
+	// A single timeout is congestion, an ack in between starts over
+	EXPECT_FALSE(pmtud.on_timeout(8972, 0));
+	pmtud.on_packet_acked(10, 8972);
+	EXPECT_FALSE(pmtud.on_timeout(8972, 0));
+
+	// Only small packets in flight
+	EXPECT_FALSE(pmtud.on_timeout(1000, 0));
+
+	EXPECT_TRUE(pmtud.on_timeout(8972, 0));
+	EXPECT_EQ(pmtud.get_plpmtu(), PmtuDiscovery::base_plpmtu);
+}
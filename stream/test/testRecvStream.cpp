@@ -0,0 +1,59 @@
+#include "gtest/gtest.h"
+#include <marlin/stream/protocol/RecvStream.hpp>
+
+#include <vector>
+
+
+using namespace marlin;
+using namespace marlin::stream;
+
+struct Delegate {};
+
+static core::Buffer fragment(uint64_t offset, size_t size) {
+	core::Buffer bytes(size);
+	for(size_t i = 0; i < size; i++) {
+		bytes.data()[i] = (offset + i) & 0xff;
+	}
+
+	return bytes;
+}
+
+TEST(RecvStreamAssemble, OutOfOrder) {
+	Delegate delegate;
+	RecvStream stream(1, &delegate);
+
+	EXPECT_TRUE(stream.assemble(1000, fragment(1000, 1000)));
+	EXPECT_TRUE(stream.assemble(3000, fragment(3000, 500)));
+	EXPECT_EQ(stream.assembled.size(), 2u);
+
+	// Size known from the fin fragment
+	stream.size = 3500;
+	stream.state = RecvStream::State::SizeKnown;
+	EXPECT_FALSE(stream.check_assembled());
+
+	EXPECT_TRUE(stream.assemble(0, fragment(0, 1000)));
+	// Duplicate
+	EXPECT_TRUE(stream.assemble(1000, fragment(1000, 1000)));
+	EXPECT_FALSE(stream.check_assembled());
+
+	EXPECT_TRUE(stream.assemble(2000, fragment(2000, 1000)));
+	ASSERT_TRUE(stream.check_assembled());
+
+	for(size_t i = 0; i < 3500; i++) {
+		EXPECT_EQ(stream.assembly.data()[i], i & 0xff);
+	}
+}
+
+TEST(RecvStreamAssemble, SizeBound) {
+	Delegate delegate;
+	RecvStream stream(1, &delegate);
+
+	EXPECT_FALSE(stream.assemble(RecvStream::max_whole_size, fragment(0, 1)));
+
+	stream.size = 100;
+	stream.state = RecvStream::State::SizeKnown;
+	EXPECT_TRUE(stream.assemble(0, fragment(0, 100)));
+	EXPECT_EQ(stream.assembly.size(), 100u);
+	EXPECT_FALSE(stream.assemble(50, fragment(50, 100)));
+	EXPECT_TRUE(stream.check_assembled());
+}
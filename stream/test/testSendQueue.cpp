@@ -0,0 +1,156 @@
+#include "gtest/gtest.h"
+#include <marlin/stream/protocol/SendQueue.hpp>
+
+#include <deque>
+#include <map>
+
+
+using namespace marlin;
+using namespace marlin::stream;
+
+struct Delegate {};
+
+// Serves the queue a packet at a time, returns bytes sent per stream
+static std::map<uint16_t, uint64_t> serve(SendQueue &queue, size_t packets, uint64_t size = 1000) {
+	std::map<uint16_t, uint64_t> sent;
+	for(size_t i = 0; i < packets && !queue.empty(); i++) {
+		auto &stream = queue.front();
+		sent[stream.stream_id] += size;
+		queue.on_send(size);
+	}
+
+	return sent;
+}
+
+TEST(SendQueue, PushOnce) {
+	Delegate delegate;
+	SendStream a(1, &delegate);
+	SendQueue queue;
+
+	EXPECT_TRUE(queue.push(a));
+	EXPECT_FALSE(queue.push(a));
+	EXPECT_EQ(queue.size(), 1u);
+
+	EXPECT_TRUE(queue.erase(a));
+	EXPECT_FALSE(queue.erase(a));
+	EXPECT_TRUE(queue.empty());
+}
+
+TEST(SendQueue, StrictPriority) {
+	Delegate delegate;
+	SendStream bulk(1, &delegate);
+	SendStream urgent(2, &delegate);
+	urgent.priority = 0;
+	SendQueue queue;
+
+	queue.push(bulk);
+	serve(queue, 100);
+
+	// Urgent stream goes first as soon as it has data, however much bulk sent
+	queue.push(urgent);
+	EXPECT_EQ(queue.front().stream_id, 2);
+	auto sent = serve(queue, 10);
+	EXPECT_EQ(sent[2], 10000u);
+	EXPECT_EQ(sent[1], 0u);
+
+	queue.erase(urgent);
+	EXPECT_EQ(queue.front().stream_id, 1);
+}
+
+TEST(SendQueue, WeightedShare) {
+	Delegate delegate;
+	SendStream a(1, &delegate);
+	SendStream b(2, &delegate);
+	SendStream c(3, &delegate);
+	b.weight = 2 * a.weight;
+	c.weight = 4 * a.weight;
+	SendQueue queue;
+
+	queue.push(a);
+	queue.push(b);
+	queue.push(c);
+
+	auto sent = serve(queue, 700);
+	EXPECT_NEAR(sent[1], 100000, 2000);
+	EXPECT_NEAR(sent[2], 200000, 2000);
+	EXPECT_NEAR(sent[3], 400000, 2000);
+}
+
+TEST(SendQueue, NoCreditWhileIdle) {
+	Delegate delegate;
+	SendStream a(1, &delegate);
+	SendStream b(2, &delegate);
+	SendQueue queue;
+
+	queue.push(a);
+	serve(queue, 1000);
+
+	// Joining late does not let b catch up on what a sent alone
+	queue.push(b);
+	auto sent = serve(queue, 100);
+	EXPECT_NEAR(sent[1], 50000, 1000);
+	EXPECT_NEAR(sent[2], 50000, 1000);
+
+	// Nor does leaving for a while and coming back
+	queue.erase(b);
+	serve(queue, 1000);
+	queue.push(b);
+	sent = serve(queue, 100);
+	EXPECT_NEAR(sent[1], 50000, 1000);
+	EXPECT_NEAR(sent[2], 50000, 1000);
+}
+
+TEST(SendQueue, Pop) {
+	Delegate delegate;
+	SendStream a(1, &delegate);
+	SendStream b(2, &delegate);
+	SendQueue queue;
+
+	queue.push(a);
+	queue.push(b);
+	queue.pop();
+	EXPECT_EQ(queue.size(), 1u);
+	EXPECT_EQ(queue.front().stream_id, 2);
+
+	queue.clear();
+	EXPECT_TRUE(queue.empty());
+}
+
+TEST(SendQueue, WholeStreamsInTurn) {
+	Delegate delegate;
+	SendStream a(3, &delegate);
+	SendStream b(1, &delegate);
+	SendStream c(2, &delegate);
+	SendStream d(4, &delegate);
+	a.whole = b.whole = c.whole = true;
+	SendQueue queue;
+
+	queue.push(a);
+	serve(queue, 10);
+	queue.push(b);
+	queue.push(c);
+	queue.push(d);
+	EXPECT_FALSE(queue.push(b));
+	EXPECT_EQ(queue.size(), 4u);
+
+	// The whole stream being served shares with other streams but not with waiting whole streams
+	auto sent = serve(queue, 100);
+	EXPECT_NEAR(sent[3], 50000, 1000);
+	EXPECT_NEAR(sent[4], 50000, 1000);
+	EXPECT_EQ(sent[1], 0u);
+	EXPECT_EQ(sent[2], 0u);
+
+	// Next in the order they joined
+	queue.erase(a);
+	queue.erase(d);
+	EXPECT_EQ(queue.front().stream_id, 1);
+	queue.pop();
+	EXPECT_EQ(queue.front().stream_id, 2);
+
+	// Waiting whole streams can be removed
+	queue.push(a);
+	EXPECT_TRUE(queue.erase(a));
+	EXPECT_FALSE(queue.erase(a));
+	queue.pop();
+	EXPECT_TRUE(queue.empty());
+}
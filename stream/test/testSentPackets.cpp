@@ -0,0 +1,109 @@
+#include "gtest/gtest.h"
+#include <marlin/stream/protocol/SentPackets.hpp>
+
+
+using namespace marlin::stream;
+
+static SentPacketInfo info(uint64_t sent_time) {
+	return SentPacketInfo(sent_time, nullptr, nullptr, 0, 1000);
+}
+
+TEST(SentPacketsTest, AddAndAck) {
+	SentPackets packets;
+
+	for(uint64_t pn = 0; pn < 10; pn++) {
+		packets.add(pn, info(pn));
+	}
+	EXPECT_EQ(packets.num_in_flight(), 10);
+	EXPECT_EQ(packets.begin(), 0);
+	EXPECT_EQ(packets.end(), 10);
+
+	ASSERT_NE(packets.in_flight(4), nullptr);
+	EXPECT_EQ(packets.in_flight(4)->sent_time, 4);
+	EXPECT_EQ(packets.in_flight(10), nullptr);
+
+	packets.erase(4);
+	EXPECT_EQ(packets.in_flight(4), nullptr);
+	EXPECT_EQ(packets.next_in_flight(4), 5);
+
+	// Acking the oldest packets moves the front
+	packets.erase(0);
+	packets.erase(1);
+	EXPECT_EQ(packets.begin(), 2);
+	EXPECT_EQ(packets.num_in_flight(), 7);
+}
+
+TEST(SentPacketsTest, MarkLost) {
+	SentPackets packets;
+
+	for(uint64_t pn = 100; pn < 110; pn++) {
+		packets.add(pn, info(pn));
+	}
+
+	packets.mark_lost(101);
+	packets.mark_lost(105);
+
+	EXPECT_EQ(packets.num_in_flight(), 8);
+	EXPECT_EQ(packets.num_lost(), 2);
+	EXPECT_EQ(packets.in_flight(101), nullptr);
+	ASSERT_NE(packets.find(101), nullptr);
+	EXPECT_EQ(packets.find(101)->sent_time, 101);
+
+	EXPECT_EQ(packets.next_lost(packets.begin()), 101);
+	EXPECT_EQ(packets.next_lost(102), 105);
+	EXPECT_EQ(packets.next_lost(106), packets.end());
+	EXPECT_EQ(packets.next_in_flight(101), 102);
+
+	packets.erase(101);
+	packets.erase(105);
+	EXPECT_EQ(packets.num_lost(), 0);
+	EXPECT_FALSE(packets.empty());
+}
+
+TEST(SentPacketsTest, GrowsAcrossWrap) {
+	SentPackets packets;
+
+	// Keep an old packet outstanding while the ring wraps and grows
+	uint64_t pn = 0;
+	for(; pn < 200; pn++) {
+		packets.add(pn, info(pn));
+	}
+	for(uint64_t i = 1; i < 200; i++) {
+		packets.erase(i);
+	}
+	for(; pn < 2000; pn++) {
+		packets.add(pn, info(pn));
+	}
+
+	EXPECT_EQ(packets.begin(), 0);
+	EXPECT_EQ(packets.num_in_flight(), 1801);
+	EXPECT_EQ(packets.next_in_flight(1), 200);
+
+	for(uint64_t i = 200; i < 2000; i++) {
+		ASSERT_NE(packets.in_flight(i), nullptr);
+		EXPECT_EQ(packets.in_flight(i)->sent_time, i);
+	}
+
+	packets.erase(0);
+	EXPECT_EQ(packets.begin(), 200);
+}
+
+TEST(SentPacketsTest, Clear) {
+	SentPackets packets;
+
+	for(uint64_t pn = 0; pn < 10; pn++) {
+		packets.add(pn, info(pn));
+	}
+	packets.mark_lost(3);
+	packets.clear();
+
+	EXPECT_TRUE(packets.empty());
+	EXPECT_EQ(packets.in_flight(5), nullptr);
+	EXPECT_EQ(packets.next_lost(0), packets.end());
+
+	// Packet numbers restart after a reset
+	packets.add(0, info(0));
+	EXPECT_EQ(packets.begin(), 0);
+	EXPECT_NE(packets.in_flight(0), nullptr);
+	EXPECT_EQ(packets.find(3), nullptr);
+}
@@ -0,0 +1,149 @@
+#include "gtest/gtest.h"
+#include <marlin/stream/protocol/SessionTickets.hpp>
+
+#include <cstring>
+#include <string>
+
+
+using namespace marlin;
+using namespace marlin::stream;
+
+struct SessionTicketsTest : public ::testing::Test {
+	uint8_t client_pk[crypto_box_PUBLICKEYBYTES];
+	uint8_t client_sk[crypto_box_SECRETKEYBYTES];
+	uint8_t server_pk[crypto_box_PUBLICKEYBYTES];
+	uint8_t server_sk[crypto_box_SECRETKEYBYTES];
+
+	uint8_t ticket[SessionTickets::ticket_size];
+	uint8_t secret[SessionTickets::secret_size];
+	uint8_t redeemed_secret[SessionTickets::secret_size];
+
+	SessionTicketsTest() {
+		crypto_box_keypair(client_pk, client_sk);
+		crypto_box_keypair(server_pk, server_sk);
+	}
+};
+
+TEST_F(SessionTicketsTest, Redeem) {
+	SessionTickets server;
+	server.issue(client_pk, ticket, secret, 1000);
+
+	EXPECT_TRUE(server.redeem(ticket, client_pk, redeemed_secret, 2000));
+	EXPECT_EQ(std::memcmp(secret, redeemed_secret, SessionTickets::secret_size), 0);
+}
+
+TEST_F(SessionTicketsTest, RedeemOnce) {
+	SessionTickets server;
+	server.issue(client_pk, ticket, secret, 1000);
+
+	EXPECT_TRUE(server.redeem(ticket, client_pk, redeemed_secret, 2000));
+	EXPECT_FALSE(server.redeem(ticket, client_pk, redeemed_secret, 3000));
+
+	// Still refused after forgetting expired tickets
+	server.prune(3000);
+	EXPECT_FALSE(server.redeem(ticket, client_pk, redeemed_secret, 4000));
+}
+
+TEST_F(SessionTicketsTest, RefuseOthers) {
+	SessionTickets server;
+	server.issue(client_pk, ticket, secret, 1000);
+
+	// Issued to someone else
+	EXPECT_FALSE(server.redeem(ticket, server_pk, redeemed_secret, 2000));
+
+	// Issued by someone else
+	SessionTickets other;
+	EXPECT_FALSE(other.redeem(ticket, client_pk, redeemed_secret, 2000));
+
+	// Tampered with
+	ticket[SessionTickets::ticket_size - 1] ^= 1;
+	EXPECT_FALSE(server.redeem(ticket, client_pk, redeemed_secret, 2000));
+	ticket[SessionTickets::ticket_size - 1] ^= 1;
+
+	EXPECT_TRUE(server.redeem(ticket, client_pk, redeemed_secret, 2000));
+}
+
+TEST_F(SessionTicketsTest, RefuseExpired) {
+	SessionTickets server;
+	server.issue(client_pk, ticket, secret, 1000);
+
+	EXPECT_FALSE(server.redeem(ticket, client_pk, redeemed_secret, 1000 + SessionTickets::lifetime));
+	EXPECT_FALSE(server.redeem(ticket, client_pk, redeemed_secret, 999));
+}
+
+TEST_F(SessionTicketsTest, Take) {
+	SessionTickets server;
+	SessionTickets client;
+	auto addr = core::SocketAddress::from_string("192.168.0.1:8000");
+
+	server.issue(client_pk, ticket, secret, 1000);
+	client.store(addr, server_pk, ticket, secret, 1000);
+	EXPECT_EQ(client.size(), 1u);
+
+	uint8_t taken_ticket[SessionTickets::ticket_size];
+	uint8_t taken_secret[SessionTickets::secret_size];
+
+	// Single use
+	EXPECT_TRUE(client.take(addr, server_pk, taken_ticket, taken_secret, 2000));
+	EXPECT_FALSE(client.take(addr, server_pk, taken_ticket, taken_secret, 2000));
+	EXPECT_EQ(client.size(), 0u);
+
+	EXPECT_EQ(std::memcmp(secret, taken_secret, SessionTickets::secret_size), 0);
+	EXPECT_TRUE(server.redeem(taken_ticket, client_pk, redeemed_secret, 2000));
+}
+
+TEST_F(SessionTicketsTest, TakeRefused) {
+	SessionTickets client;
+	auto addr = core::SocketAddress::from_string("192.168.0.1:8000");
+
+	uint8_t taken_ticket[SessionTickets::ticket_size];
+	uint8_t taken_secret[SessionTickets::secret_size];
+
+	// Different server key at the same address
+	client.store(addr, server_pk, ticket, secret, 1000);
+	EXPECT_FALSE(client.take(addr, client_pk, taken_ticket, taken_secret, 2000));
+	EXPECT_EQ(client.size(), 0u);
+
+	// Expired
+	client.store(addr, server_pk, ticket, secret, 1000);
+	EXPECT_FALSE(client.take(addr, server_pk, taken_ticket, taken_secret, 1000 + SessionTickets::lifetime));
+	EXPECT_EQ(client.size(), 0u);
+}
+
+TEST_F(SessionTicketsTest, StoreBounded) {
+	SessionTickets client;
+
+	for(uint64_t i = 0; i <= SessionTickets::max_tickets; i++) {
+		auto addr = core::SocketAddress::from_string("192.168." + std::to_string(i / 256) + "." + std::to_string(i % 256) + ":8000");
+		client.store(addr, server_pk, ticket, secret, 1000 + i);
+	}
+	EXPECT_EQ(client.size(), SessionTickets::max_tickets);
+
+	uint8_t taken_ticket[SessionTickets::ticket_size];
+	uint8_t taken_secret[SessionTickets::secret_size];
+
+	// Oldest made way for the newest
+	EXPECT_FALSE(client.take(core::SocketAddress::from_string("192.168.0.0:8000"), server_pk, taken_ticket, taken_secret, 5000));
+	EXPECT_TRUE(client.take(core::SocketAddress::from_string("192.168.4.0:8000"), server_pk, taken_ticket, taken_secret, 5000));
+}
+
+TEST_F(SessionTicketsTest, DeriveKeys) {
+	uint8_t random[SessionTickets::random_size];
+	randombytes_buf(secret, sizeof(secret));
+	randombytes_buf(random, sizeof(random));
+
+	uint8_t client_rx[crypto_kx_SESSIONKEYBYTES], client_tx[crypto_kx_SESSIONKEYBYTES];
+	uint8_t server_rx[crypto_kx_SESSIONKEYBYTES], server_tx[crypto_kx_SESSIONKEYBYTES];
+	SessionTickets::derive_keys(secret, random, true, client_rx, client_tx);
+	SessionTickets::derive_keys(secret, random, false, server_rx, server_tx);
+
+	EXPECT_EQ(std::memcmp(client_tx, server_rx, crypto_kx_SESSIONKEYBYTES), 0);
+	EXPECT_EQ(std::memcmp(client_rx, server_tx, crypto_kx_SESSIONKEYBYTES), 0);
+	EXPECT_NE(std::memcmp(client_rx, client_tx, crypto_kx_SESSIONKEYBYTES), 0);
+
+	// Each resumption gets fresh keys
+	uint8_t other_rx[crypto_kx_SESSIONKEYBYTES], other_tx[crypto_kx_SESSIONKEYBYTES];
+	random[0] ^= 1;
+	SessionTickets::derive_keys(secret, random, true, other_rx, other_tx);
+	EXPECT_NE(std::memcmp(client_tx, other_tx, crypto_kx_SESSIONKEYBYTES), 0);
+}